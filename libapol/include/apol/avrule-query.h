@@ -35,9 +35,23 @@ extern "C"
 #include "policy.h"
 #include "vector.h"
 #include <qpol/policy.h>
+#include <stdio.h>
 
 	typedef struct apol_avrule_query apol_avrule_query_t;
 
+/**
+ * Function called by apol_avrule_get_by_query_map() for each matching
+ * rule.
+ *
+ * @param p Policy being searched.
+ * @param rule Rule that matched the query.
+ * @param arg Arbitrary argument given to apol_avrule_get_by_query_map().
+ *
+ * @return 0 to continue the search, > 0 to stop it early, or < 0 to
+ * stop it with an error (and errno set).
+ */
+	typedef int (apol_avrule_map_func) (const apol_policy_t * p, const qpol_avrule_t * rule, void *arg);
+
 /**
  * Execute a query against all access vector rules within the policy.
  *
@@ -53,6 +67,47 @@ extern "C"
  */
 	extern int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v);
 
+/**
+ * Execute a query against all access vector rules within the policy, calling
+ * a function for each matching rule instead of collecting them into
+ * a vector.  Rules are passed in the same order that
+ * apol_avrule_get_by_query() would return them, and memory used by the
+ * search does not grow with the number of results.  The search runs
+ * in the calling thread regardless of apol_policy_set_query_threads().
+ *
+ * @param p Policy within which to look up avrules.
+ * @param a Structure containing parameters for query.  If this is
+ * NULL then every avrule is passed to the function.
+ * @param fn Function to call for each matching rule.  If it returns
+ * non-zero the search stops.
+ * @param arg Arbitrary argument to pass to fn.
+ *
+ * @return 0 on success (including none found or when fn stopped the
+ * search early), negative on error.
+ */
+	extern int apol_avrule_get_by_query_map(const apol_policy_t * p, const apol_avrule_query_t * a, apol_avrule_map_func * fn,
+					      void *arg);
+
+/**
+ * Execute several queries against all access vector rules within the
+ * policy.  All of the queries are answered during a single pass over
+ * the rules, which is faster than calling apol_avrule_get_by_query()
+ * once per query.
+ *
+ * @param p Policy within which to look up avrules.
+ * @param queries Vector of apol_avrule_query_t to run.  A NULL
+ * element matches all avrules.
+ * @param v Reference to a vector of vectors.  Element i of the vector
+ * is a vector of qpol_avrule_t holding the same rules, in the same
+ * order, that apol_avrule_get_by_query() would return for query i.
+ * The vector will be allocated by this function.  The caller must
+ * call apol_vector_destroy() afterwards; this also destroys the inner
+ * vectors.  This will be set to NULL upon error.
+ *
+ * @return 0 on success (including none found), negative on error.
+ */
+	extern int apol_avrule_get_by_queries(const apol_policy_t * p, const apol_vector_t * queries, apol_vector_t ** v);
+
 /**
  * Execute a query against all syntactic access vector rules within
  * the policy.  If the policy has line numbers, then the returned list
@@ -354,6 +409,20 @@ extern "C"
  */
 	extern char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rule);
 
+/**
+ *  Write an avrule to a file, in the same form as apol_avrule_render() but
+ *  without building an intermediate string.  Nothing is written
+ *  after the rule's closing semicolon.
+ *
+ *  @param policy Policy handler, to report errors.
+ *  @param rule The rule to render.
+ *  @param fp File to which to write.
+ *
+ *  @return 0 on success, or < 0 on failure; if the call fails, errno
+ *  will be set and part of the rule may have been written.
+ */
+	extern int apol_avrule_render_file(const apol_policy_t * policy, const qpol_avrule_t * rule, FILE * fp);
+
 /**
  *  Render a syntactic avrule to a string.
  *
@@ -366,6 +435,20 @@ extern "C"
 */
 	extern char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule_t * rule);
 
+/**
+ *  Write a syntactic avrule to a file, in the same form as apol_syn_avrule_render() but
+ *  without building an intermediate string.  Nothing is written
+ *  after the rule's closing semicolon.
+ *
+ *  @param policy Policy handler, to report errors.
+ *  @param rule The rule to render.
+ *  @param fp File to which to write.
+ *
+ *  @return 0 on success, or < 0 on failure; if the call fails, errno
+ *  will be set and part of the rule may have been written.
+ */
+	extern int apol_syn_avrule_render_file(const apol_policy_t * policy, const qpol_syn_avrule_t * rule, FILE * fp);
+
 #ifdef	__cplusplus
 }
 #endif
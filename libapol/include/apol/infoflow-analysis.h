@@ -112,6 +112,31 @@ extern "C"
 	extern int apol_infoflow_analysis_do_more(const apol_policy_t * p, apol_infoflow_graph_t * g, const char *type,
 						  apol_vector_t ** v);
 
+/**
+ * Execute an information flow analysis from each of several starting
+ * types.  The analysis's own starting type is ignored.  One graph is
+ * built and shared; the analyses from each starting type are spread
+ * among the number of threads given to
+ * apol_policy_set_query_threads().  The results are the same as
+ * calling apol_infoflow_analysis_do_more() for each starting type in
+ * turn and concatenating what it returns.
+ *
+ * @param p Policy within which to look up allow rules.
+ * @param ia A non-NULL structure containing parameters for analysis.
+ * @param start_types Vector of type names (type char *) from which to
+ * begin analysis.
+ * @param v Reference to a vector of apol_infoflow_result_t.  Results
+ * are in the order of start_types, and for each starting type in the
+ * order that apol_infoflow_analysis_do_more() would give.  The vector
+ * will be allocated by this function.  The caller must call
+ * apol_vector_destroy() afterwards.  This will be set to NULL upon
+ * error.
+ *
+ * @return 0 on success, negative on error.
+ */
+	extern int apol_infoflow_analysis_do_batch(const apol_policy_t * p, const apol_infoflow_analysis_t * ia,
+						   const apol_vector_t * start_types, apol_vector_t ** v);
+
 /**
  * Prepare an existing transitive infoflow graph to do further
  * searches upon two specific start and end types.  The analysis is by
@@ -151,6 +176,42 @@ extern "C"
 	extern int apol_infoflow_analysis_trans_further_next(const apol_policy_t * p, apol_infoflow_graph_t * g,
 							     apol_vector_t ** v);
 
+/**
+ * Find further transitive infoflow paths by way of many random
+ * restarts, divided among the number of threads set by
+ * apol_policy_set_query_threads().  The infoflow graph must be first
+ * prepared by calling apol_infoflow_analysis_trans_further_prepare().
+ * Each iteration restarts from one of the start type's nodes, in
+ * turn, and draws its random numbers from its own stream derived
+ * from seed and the iteration's number.  Thus when every iteration
+ * completes the paths found, and their order, depend only upon seed
+ * and num_iterations, regardless of the number of threads.  This
+ * function does not use the state of the graph's own random restarts
+ * used by apol_infoflow_analysis_trans_further_next().
+ *
+ * @param p Policy from which infoflow rules derived.
+ * @param g Prepared transitive infoflow graph.  It may not be used by
+ * any other function until this one returns.
+ * @param seed Seed from which every iteration's random numbers
+ * derive.
+ * @param num_iterations Number of random restarts to perform.  This
+ * must be greater than zero.
+ * @param max_msecs If non-zero, then after this many milliseconds no
+ * more iterations start; the paths found then depend upon how many
+ * iterations completed.  To run until the time is up, num_iterations
+ * may be made very large; iterations that never start cost nothing.
+ * @param v Pointer to a vector of existing apol_infoflow_result_t
+ * pointers.  Any additional unique results found will be appended to
+ * this vector.  If the pointer is NULL then this will allocate and
+ * return a new vector.  It is the caller's responsibility to call
+ * apol_vector_destroy() afterwards.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	extern int apol_infoflow_analysis_trans_further_run(const apol_policy_t * p, apol_infoflow_graph_t * g,
+							    unsigned int seed, size_t num_iterations, unsigned long max_msecs,
+							    apol_vector_t ** v);
+
 /********** functions to create/modify an analysis object **********/
 
 /**
@@ -326,7 +387,9 @@ extern "C"
  * The caller <b>should not</b> call apol_vector_destroy() upon the
  * returned vector.  Note that for a direct infoflow analysis this
  * vector will consist of exactly one step; for transitive analysis
- * the vector will have multiple steps.
+ * the vector will have multiple steps.  A transitive result's steps
+ * are a shortest path; when several paths are equally short, the one
+ * given may differ from that given by libapol before version 4.3.
  *
  * @param result Infoflow result from which to get steps.
  *
@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *
+ *  A table of interned strings.  Each distinct string is stored once
+ *  and given a dense integer identifier, starting from 0 in order of
+ *  insertion.  Interned strings never move and stay valid until the
+ *  table is destroyed, so they may be compared by pointer.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef APOL_INTERN_H
+#define APOL_INTERN_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include "vector.h"
+#include <stdlib.h>
+
+	typedef struct apol_intern apol_intern_t;
+
+/**
+ *  Allocate and initialize an empty intern table.
+ *
+ *  @return A pointer to a newly created table on success and NULL on
+ *  failure.  If the call fails, errno will be set.  The caller is
+ *  responsible for calling apol_intern_destroy() to free memory used.
+ */
+	extern apol_intern_t *apol_intern_create(void);
+
+/**
+ *  Free an intern table and all of the strings within it.
+ *
+ *  @param t Pointer to the table to free.  The pointer will be set to
+ *  NULL afterwards.  If already NULL then this function does nothing.
+ */
+	extern void apol_intern_destroy(apol_intern_t ** t);
+
+/**
+ *  Get the number of strings in an intern table.
+ *
+ *  @param t Table to query.
+ *
+ *  @return Number of strings, which is also one more than the largest
+ *  identifier; if t is NULL, return 0 and set errno.
+ */
+	extern size_t apol_intern_get_size(const apol_intern_t * t);
+
+/**
+ *  Add a string to an intern table if it is not already there, and
+ *  return the table's copy of it.
+ *
+ *  @param t Table to which to add the string.
+ *  @param str String to add.  The table makes its own copy.
+ *  @param id If non-NULL, location to write the string's identifier.
+ *
+ *  @return The interned string, or NULL upon error (and errno set).
+ *  The string belongs to the table and must not be modified or freed.
+ */
+	extern const char *apol_intern_str(apol_intern_t * t, const char *str, size_t * id);
+
+/**
+ *  Look up a string in an intern table without adding it.
+ *
+ *  @param t Table to search.
+ *  @param str String to find.
+ *  @param id If non-NULL and the string was found, location to write
+ *  its identifier.
+ *
+ *  @return The interned string, or NULL if it is not in the table.
+ */
+	extern const char *apol_intern_get(const apol_intern_t * t, const char *str, size_t * id);
+
+/**
+ *  Get an interned string from its identifier.
+ *
+ *  @param t Table to search.
+ *  @param id Identifier returned by apol_intern_str().
+ *
+ *  @return The interned string, or NULL if id is out of range.
+ */
+	extern const char *apol_intern_get_by_id(const apol_intern_t * t, size_t id);
+
+/**
+ *  Allocate and return a vector of all strings in an intern table,
+ *  sorted alphabetically.  This is a <b>shallow copy</b>; the table
+ *  still owns the strings.
+ *
+ *  @param t Table from which to copy.
+ *
+ *  @return A pointer to a newly created vector on success and NULL on
+ *  failure.  If the call fails, errno will be set.  The caller is
+ *  responsible for calling apol_vector_destroy() to free memory used
+ *  by the vector.
+ */
+	extern apol_vector_t *apol_intern_get_vector(const apol_intern_t * t);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* APOL_INTERN_H */
@@ -0,0 +1,141 @@
+/**
+ * @file
+ *
+ * Routines to check a policy's allow rules against its neverallow
+ * rules.
+ *
+ * This file is part of SETools; see the AUTHORS file for its
+ * contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef APOL_NEVERALLOW_ANALYSIS_H
+#define APOL_NEVERALLOW_ANALYSIS_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include "policy.h"
+#include "vector.h"
+#include <qpol/policy.h>
+
+	typedef struct apol_neverallow_analysis apol_neverallow_analysis_t;
+	typedef struct apol_neverallow_result apol_neverallow_result_t;
+
+/******************** functions to do neverallow analysis ********************/
+
+/**
+ * Execute a neverallow analysis against a particular policy.  Every
+ * allow rule, including conditional ones regardless of their state,
+ * is checked against every neverallow rule.  An allow rule violates
+ * a neverallow rule if they share an object class and at least one
+ * permission, and if some type in the allow rule's source (after
+ * expanding attributes) is in the neverallow rule's source and
+ * likewise for their targets.
+ *
+ * The policy must have been loaded with its neverallow rules; see
+ * qpol_policy_has_capability() and QPOL_CAP_NEVERALLOW.
+ *
+ * @param p Policy within which to look up rules.
+ * @param n A non-NULL structure containing parameters for analysis.
+ * @param v Reference to a vector of apol_neverallow_result_t, one
+ * per violating pair of rules.  The vector will be allocated by this
+ * function.  The caller must call apol_vector_destroy() afterwards.
+ * This will be set to NULL upon error.
+ *
+ * @return 0 on success, negative on error.
+ */
+	extern int apol_neverallow_analysis_do(const apol_policy_t * p, apol_neverallow_analysis_t * n, apol_vector_t ** v);
+
+/**
+ * Allocate and return a new neverallow analysis structure.  All
+ * fields are cleared, meaning that all neverallow rules are checked.
+ * The caller must call apol_neverallow_analysis_destroy() upon the
+ * return value afterwards.
+ *
+ * @return An initialized neverallow analysis structure, or NULL upon
+ * error.
+ */
+	extern apol_neverallow_analysis_t *apol_neverallow_analysis_create(void);
+
+/**
+ * Deallocate all memory associated with the referenced neverallow
+ * analysis, and then set it to NULL.  This function does nothing if
+ * the analysis is already NULL.
+ *
+ * @param n Reference to a neverallow analysis structure to destroy.
+ */
+	extern void apol_neverallow_analysis_destroy(apol_neverallow_analysis_t ** n);
+
+/**
+ * Set a neverallow analysis to check only neverallow rules with this
+ * object (non-common) class.  If more than one class is appended to
+ * the analysis, the rule's class must be one of those appended.
+ * Pass a NULL to clear all classes.
+ *
+ * @param p Policy handler, to report errors.
+ * @param n Neverallow analysis to set.
+ * @param obj_class Name of object class to add to search set, or
+ * NULL to clear all classes.
+ *
+ * @return 0 on success, negative on error.
+ */
+	extern int apol_neverallow_analysis_append_class(const apol_policy_t * p, apol_neverallow_analysis_t * n,
+							 const char *obj_class);
+
+/******************** functions to access neverallow results ********************/
+
+/**
+ * Return the neverallow rule that was violated.
+ *
+ * @param r Neverallow result node.
+ *
+ * @return Pointer to a neverallow rule, relative to the policy
+ * originally used to generate the result.
+ */
+	extern const qpol_avrule_t *apol_neverallow_result_get_neverallow(const apol_neverallow_result_t * r);
+
+/**
+ * Return the allow rule that violates the neverallow rule.
+ *
+ * @param r Neverallow result node.
+ *
+ * @return Pointer to an allow rule, relative to the policy originally
+ * used to generate the result.
+ */
+	extern const qpol_avrule_t *apol_neverallow_result_get_allow(const apol_neverallow_result_t * r);
+
+/**
+ * Return the permissions granted by the allow rule that the
+ * neverallow rule forbids.
+ *
+ * @param p Policy that generated the result.
+ * @param r Neverallow result node.
+ *
+ * @return A newly allocated vector of permission names (type const
+ * char *), or NULL upon error.  The caller must call
+ * apol_vector_destroy() afterwards, but must not free the strings
+ * themselves.
+ */
+	extern apol_vector_t *apol_neverallow_result_get_perms(const apol_policy_t * p, const apol_neverallow_result_t * r);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
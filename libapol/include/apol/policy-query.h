@@ -79,6 +79,7 @@ extern "C"
 
 #include "domain-trans-analysis.h"
 #include "infoflow-analysis.h"
+#include "neverallow-analysis.h"
 #include "relabel-analysis.h"
 #include "types-relation-analysis.h"
 
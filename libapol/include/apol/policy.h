@@ -111,6 +111,67 @@ extern "C"
  */
 	extern qpol_policy_t *apol_policy_get_qpol(const apol_policy_t * policy);
 
+/**
+ * Make a policy read-only so that one policy may be shared by many
+ * analysis threads.  This freezes the underlying qpol policy (see
+ * qpol_policy_freeze()) and builds the domain transition table now
+ * rather than on first use.  Load a permission map, if one is
+ * needed, before freezing; afterwards apol_policy_open_permmap() and
+ * apol_policy_set_permmap() fail with errno set to EPERM.
+ *
+ * Every query and analysis function may then be called concurrently
+ * on the frozen policy, provided that each thread uses its own query
+ * and analysis objects and that the policy's message callback is
+ * safe to call from several threads.  Domain transition analyses
+ * share scratch state within the table, so they are run one at a
+ * time; each starts from a reset table, making
+ * apol_policy_reset_domain_trans_table() unnecessary.
+ *
+ * @param policy Policy to freeze.
+ *
+ * @return 0 on success, < 0 on error.  If the call fails, errno will
+ * be set and the policy will not be frozen.
+ */
+	extern int apol_policy_freeze(apol_policy_t * policy);
+
+/**
+ * Determine if a policy has been frozen by apol_policy_freeze().
+ *
+ * @param policy Policy to check.
+ *
+ * @return Non-zero if the policy is frozen, and zero otherwise.
+ */
+	extern int apol_policy_is_frozen(const apol_policy_t * policy);
+
+/**
+ * Set the number of threads used to answer av rule and type rule
+ * queries.  With more than one thread, apol_avrule_get_by_query() and
+ * apol_terule_get_by_query() split the rule tables among worker
+ * threads; their results are identical to those of a single thread.
+ * apol_infoflow_analysis_do_batch() likewise divides its starting
+ * types, and apol_infoflow_analysis_trans_further_run() its random
+ * restarts, among that many threads.  The workers only read the
+ * policy, and each query waits for its workers to finish, so the
+ * policy need not be frozen.  The default is one thread.
+ *
+ * @param policy Policy whose queries to configure.
+ * @param num_threads Number of threads to use.  Zero is treated as
+ * one.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	extern int apol_policy_set_query_threads(apol_policy_t * policy, size_t num_threads);
+
+/**
+ * Get the number of threads used to answer rule queries.
+ *
+ * @param policy Policy whose setting to get.
+ *
+ * @return Number of threads, which is always at least one, or 0 if
+ * policy is NULL.
+ */
+	extern size_t apol_policy_get_query_threads(const apol_policy_t * policy);
+
 /**
  * Given a policy, return 1 if the policy within is MLS, 0 if not.  If
  * it cannot be determined or upon error, return < 0.
@@ -296,7 +296,8 @@ extern "C"
 
 /**
  *  Sort the vector's elements within place, using an unstable sorting
- *  algorithm.
+ *  algorithm.  This takes O(n log n) time even for input that is
+ *  already sorted.
  *
  *  @param v The vector to sort.
  *  @param cmp A comparison call back for the type of element stored
@@ -310,6 +311,42 @@ extern "C"
  */
 	extern void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data);
 
+/**
+ *  Sort the vector's elements within place, using a stable sorting
+ *  algorithm; elements that compare equal keep their relative order.
+ *
+ *  @param v The vector to sort.
+ *  @param cmp A comparison call back for the type of element stored
+ *  in the vector (see apol_vector_sort()).  If this is NULL then treat
+ *  the vector's contents as unsigned integers and sort in increasing
+ *  order.
+ *  @param data Arbitrary data to pass as the comparison function's
+ *  third paramater.
+ *
+ *  @return 0 on success, < 0 on error (the vector is unchanged).
+ */
+	extern int apol_vector_sort_stable(apol_vector_t * v, apol_vector_comp_func * cmp, void *data);
+
+/**
+ *  Sort the vector's elements within place, splitting the work among
+ *  several threads.  The result is identical to that of
+ *  apol_vector_sort_stable(), which is used instead for small vectors.
+ *
+ *  @param v The vector to sort.
+ *  @param cmp A comparison call back for the type of element stored
+ *  in the vector (see apol_vector_sort()).  It will be called from
+ *  several threads at once.  If this is NULL then treat the vector's
+ *  contents as unsigned integers and sort in increasing order.
+ *  @param data Arbitrary data to pass as the comparison function's
+ *  third paramater.
+ *  @param num_threads Largest number of threads to use.  No more
+ *  threads are used than there are online processors, nor than leave
+ *  each thread a large share of the vector to sort.
+ *
+ *  @return 0 on success, < 0 on error (the vector is unchanged).
+ */
+	extern int apol_vector_sort_parallel(apol_vector_t * v, apol_vector_comp_func * cmp, void *data, size_t num_threads);
+
 /**
  *  Sort the vector's elements within place (see apol_vector_sort()),
  *  and then compact vector by removing duplicate entries.  The
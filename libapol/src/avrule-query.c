@@ -41,209 +41,646 @@ struct apol_avrule_query
 	unsigned int flags;
 };
 
+/** A query prepared for matching against rules; see avrule_select_init(). */
+typedef struct avrule_select
+{
+	uint32_t rule_type;
+	unsigned int flags;
+	/** if non-NULL, types to use as source; if NULL, accept all types */
+	apol_vector_t *source_list;
+	/** if non-NULL, types to use as target; if NULL, accept all types */
+	apol_vector_t *target_list;
+	/** if non-NULL, classes to use; if NULL, accept all classes */
+	apol_vector_t *class_list;
+	/** if non-NULL, permissions to use; this points into the query */
+	const apol_vector_t *perm_list;
+	/** if non-NULL, find conditional rules affected by this boolean */
+	const char *bool_name;
+	/** candidate lists as bitmaps; see apol_query_bitmap_test() */
+	apol_query_bitmap_t source_set, target_set, class_set;
+	/** non-zero if target_list is the same vector as source_list */
+	int target_is_source;
+} avrule_select_t;
+
+/** Scratch space used by one thread while matching rules against
+ *  one query. */
+typedef struct avrule_match_cache
+{
+	regex_t *bool_regex;
+	/** permission names are compiled into a mask the first time a
+	 *  rule of each class is seen; class_num_perms holds how many of
+	 *  the names the class defines, or -1 if not compiled yet */
+	uint32_t *class_perm_masks;
+	int *class_num_perms;
+} avrule_match_cache_t;
+
+/** Fields of one rule, looked up once no matter how many queries the
+ *  rule is matched against. */
+typedef struct avrule_facts
+{
+	qpol_avrule_t *rule;
+	uint32_t rule_type, is_enabled, source_val, target_val, class_val, perms;
+	const qpol_cond_t *cond;
+	const qpol_class_t *obj_class;
+} avrule_facts_t;
+
+/** State shared by the tasks of one rule_select() call. */
+typedef struct avrule_select_run
+{
+	const apol_policy_t *p;
+	const avrule_select_t *sels;
+	size_t num_sels;
+	/** all rule types wanted by any of the queries */
+	uint32_t rule_type;
+	/** if non-NULL, look up rules by these sources instead of
+	 *  scanning the rule tables */
+	const apol_vector_t *by_source;
+	/** number of object classes in the policy */
+	size_t num_classes;
+	/** number of tasks into which the selection is split */
+	size_t num_tasks;
+	/** rules found by each task for each query, indexed by
+	 *  task * num_sels + query; these are joined in task order */
+	apol_vector_t **results;
+	/** if non-NULL, call this for each matching rule instead of
+	 *  adding it to results; see apol_avrule_get_by_query_map() */
+	apol_avrule_map_func *map_fn;
+	void *map_arg;
+} avrule_select_run_t;
+
 /**
- *  Common semantic rule selection routine used in get*rule_by_query.
+ *  Build the bitmaps of a prepared query from its candidate lists.
  *  @param p Policy to search.
- *  @param v Vector of rules to populate (of type qpol_avrule_t).
- *  @param rule_type Mask of rules to search.
- *  @param flags Query options as specified by the apol_avrule_query.
- *  @param source_list If non-NULL, list of types to use as source.
- *  If NULL, accept all types.
- *  @param target_list If non-NULL, list of types to use as target.
- *  If NULL, accept all types.
- *  @param class_list If non-NULL, list of classes to use.
- *  If NULL, accept all classes.
- *  @param perm_list If non-NULL, list of permisions to use.
- *  If NULL, accept all permissions.
- *  @param bool_name If non-NULL, find conditional rules affected by this boolean.
- *  If NULL, all rules will be considered (including unconditional rules).
+ *  @param sel Selection whose lists have been set.
  *  @return 0 on success and < 0 on failure.
  */
-static int rule_select(const apol_policy_t * p, apol_vector_t * v, uint32_t rule_type, unsigned int flags,
-		       const apol_vector_t * source_list, const apol_vector_t * target_list, const apol_vector_t * class_list,
-		       const apol_vector_t * perm_list, const char *bool_name)
+static int avrule_select_create_sets(const apol_policy_t * p, avrule_select_t * sel)
 {
-	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
-	const int only_enabled = flags & APOL_QUERY_ONLY_ENABLED;
-	const int is_regex = flags & APOL_QUERY_REGEX;
-	const int source_as_any = flags & APOL_QUERY_SOURCE_AS_ANY;
-	size_t num_perms_to_match = 1;
-	int retv = -1;
-	regex_t *bool_regex = NULL;
+	/* candidate lists become bitmaps indexed by symbol value, so
+	 * that each rule is matched with a bit test rather than a scan
+	 * of the (possibly attribute-expanded) list */
+	if ((sel->source_list != NULL && apol_query_bitmap_create_from_types(p, sel->source_list, &sel->source_set) < 0) ||
+	    (sel->target_list != NULL && apol_query_bitmap_create_from_types(p, sel->target_list, &sel->target_set) < 0) ||
+	    (sel->class_list != NULL && apol_query_bitmap_create_from_classes(p, sel->class_list, &sel->class_set) < 0)) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *  Prepare a query for rule_select() by finding its candidate types
+ *  and classes.
+ *  @param p Policy to search.
+ *  @param a Query to prepare, or NULL to accept all rules.
+ *  @param sel Selection to initialize.  The caller must call
+ *  avrule_select_destroy() afterwards, even on error.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int avrule_select_init(const apol_policy_t * p, const apol_avrule_query_t * a, avrule_select_t * sel)
+{
+	int is_regex;
 
-	if ((flags & APOL_QUERY_MATCH_ALL_PERMS) && perm_list != NULL) {
-		num_perms_to_match = apol_vector_get_size(perm_list);
+	memset(sel, 0, sizeof(*sel));
+	sel->rule_type = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+//	if (qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_NEVERALLOW)) {
+		sel->rule_type |= QPOL_RULE_NEVERALLOW;
+//	}
+	if (a == NULL) {
+		return 0;
 	}
-	if (qpol_policy_get_avrule_iter(p->p, rule_type, &iter) < 0) {
-		goto cleanup;
+	if (a->rules != 0) {
+		sel->rule_type &= a->rules;
+	}
+	sel->flags = a->flags;
+	is_regex = a->flags & APOL_QUERY_REGEX;
+	sel->bool_name = a->bool_name;
+	if (a->source != NULL &&
+	    (sel->source_list =
+	     apol_query_create_candidate_type_list(p, a->source, is_regex,
+						   a->flags & APOL_QUERY_SOURCE_INDIRECT,
+						   ((a->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
+						    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+		return -1;
+	}
+	if ((a->flags & APOL_QUERY_SOURCE_AS_ANY) && a->source != NULL) {
+		sel->target_list = sel->source_list;
+		sel->target_is_source = 1;
+	} else if (a->target != NULL &&
+		   (sel->target_list =
+		    apol_query_create_candidate_type_list(p, a->target, is_regex,
+							  a->flags & APOL_QUERY_TARGET_INDIRECT,
+							  ((a->flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
+							   / APOL_QUERY_TARGET_TYPE))) == NULL) {
+		return -1;
+	}
+	if (a->classes != NULL &&
+	    apol_vector_get_size(a->classes) > 0 &&
+	    (sel->class_list = apol_query_create_candidate_class_list(p, a->classes)) == NULL) {
+		return -1;
+	}
+	if (a->perms != NULL && apol_vector_get_size(a->perms) > 0) {
+		sel->perm_list = a->perms;
 	}
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		qpol_avrule_t *rule;
-		uint32_t is_enabled;
-		const qpol_cond_t *cond = NULL;
-		int match_source = 0, match_target = 0, match_bool = 0;
-		size_t match_perm = 0, i;
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0) {
-			goto cleanup;
-		}
 
-		if (qpol_avrule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
-			goto cleanup;
+	return avrule_select_create_sets(p, sel);
+}
+
+static void avrule_select_destroy(avrule_select_t * sel)
+{
+	apol_vector_destroy(&sel->source_list);
+	if (!sel->target_is_source) {
+		apol_vector_destroy(&sel->target_list);
+	}
+	apol_vector_destroy(&sel->class_list);
+	/* don't destroy perm_list - it points to query's permission list */
+	apol_query_bitmap_destroy(&sel->source_set);
+	apol_query_bitmap_destroy(&sel->target_set);
+	apol_query_bitmap_destroy(&sel->class_set);
+}
+
+static int avrule_match_cache_init(const apol_policy_t * p, const avrule_select_t * sel, size_t num_classes,
+				   avrule_match_cache_t * cache)
+{
+	size_t i;
+
+	if (sel->perm_list != NULL) {
+		if ((cache->class_perm_masks = calloc(num_classes, sizeof(*cache->class_perm_masks))) == NULL ||
+		    (cache->class_num_perms = malloc(num_classes * sizeof(*cache->class_num_perms))) == NULL) {
+			ERR(p, "%s", strerror(ENOMEM));
+			return -1;
 		}
-		if (!is_enabled && only_enabled) {
-			continue;
+		for (i = 0; i < num_classes; i++) {
+			cache->class_num_perms[i] = -1;
 		}
+	}
+	return 0;
+}
 
-		if (bool_name != NULL) {
-			if (qpol_avrule_get_cond(p->p, rule, &cond) < 0) {
-				goto cleanup;
-			}
-			if (cond == NULL) {
-				continue;	/* skip unconditional rule */
-			}
-			match_bool = apol_compare_cond_expr(p, cond, bool_name, is_regex, &bool_regex);
-			if (match_bool < 0) {
-				goto cleanup;
-			} else if (match_bool == 0) {
-				continue;
-			}
+static void avrule_match_cache_destroy(avrule_match_cache_t * cache)
+{
+	apol_regex_destroy(&cache->bool_regex);
+	free(cache->class_perm_masks);
+	cache->class_perm_masks = NULL;
+	free(cache->class_num_perms);
+	cache->class_num_perms = NULL;
+}
+
+static int avrule_facts_get(const apol_policy_t * p, qpol_avrule_t * rule, avrule_facts_t * f)
+{
+	const qpol_type_t *source_type, *target_type;
+
+	f->rule = rule;
+	if (qpol_avrule_get_rule_type(p->p, rule, &f->rule_type) < 0 ||
+	    qpol_avrule_get_is_enabled(p->p, rule, &f->is_enabled) < 0 ||
+	    qpol_avrule_get_cond(p->p, rule, &f->cond) < 0 ||
+	    qpol_avrule_get_source_type(p->p, rule, &source_type) < 0 ||
+	    qpol_type_get_value(p->p, source_type, &f->source_val) < 0 ||
+	    qpol_avrule_get_target_type(p->p, rule, &target_type) < 0 ||
+	    qpol_type_get_value(p->p, target_type, &f->target_val) < 0 ||
+	    qpol_avrule_get_object_class(p->p, rule, &f->obj_class) < 0 ||
+	    qpol_avrule_get_perm_mask(p->p, rule, &f->class_val, &f->perms) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *  Check if a rule matches a prepared query.
+ *  @param p Policy being searched.
+ *  @param sel Prepared query.
+ *  @param cache Scratch space for this query and thread.
+ *  @param f Fields of the rule to check.
+ *  @return 1 if the rule matches, 0 if not, and < 0 on error.
+ */
+static int avrule_select_match(const apol_policy_t * p, const avrule_select_t * sel, avrule_match_cache_t * cache,
+			       const avrule_facts_t * f)
+{
+	const int source_as_any = sel->flags & APOL_QUERY_SOURCE_AS_ANY;
+	int match_source, match_target;
+	size_t i;
+
+	if (!(f->rule_type & sel->rule_type)) {
+		return 0;
+	}
+	if (!f->is_enabled && (sel->flags & APOL_QUERY_ONLY_ENABLED)) {
+		return 0;
+	}
+
+	if (sel->bool_name != NULL) {
+		int match_bool;
+		if (f->cond == NULL) {
+			return 0;      /* skip unconditional rule */
+		}
+		match_bool = apol_compare_cond_expr(p, f->cond, sel->bool_name, sel->flags & APOL_QUERY_REGEX, &cache->bool_regex);
+		if (match_bool <= 0) {
+			return match_bool;
 		}
+	}
 
-		if (source_list == NULL) {
-			match_source = 1;
-		} else {
-			const qpol_type_t *source_type;
-			if (qpol_avrule_get_source_type(p->p, rule, &source_type) < 0) {
-				goto cleanup;
+	match_source = (sel->source_list == NULL || apol_query_bitmap_test(&sel->source_set, f->source_val));
+
+	/* if source did not match, but treating source symbol
+	 * as any field, then delay rejecting this rule until
+	 * the target has been checked */
+	if (!source_as_any && !match_source) {
+		return 0;
+	}
+
+	match_target = (sel->target_list == NULL || (source_as_any && match_source) ||
+			apol_query_bitmap_test(&sel->target_set, f->target_val));
+	if (!match_target) {
+		return 0;
+	}
+
+	if (sel->class_list != NULL && !apol_query_bitmap_test(&sel->class_set, f->class_val)) {
+		return 0;
+	}
+
+	if (sel->perm_list != NULL) {
+		uint32_t *query_perms = &cache->class_perm_masks[f->class_val - 1];
+		int *num_perms = &cache->class_num_perms[f->class_val - 1];
+		if (*num_perms < 0) {
+			*num_perms = 0;
+			for (i = 0; i < apol_vector_get_size(sel->perm_list); i++) {
+				const char *perm = apol_vector_get_element(sel->perm_list, i);
+				uint32_t perm_mask;
+				int found = qpol_class_get_perm_mask(p->p, f->obj_class, &perm, 1, &perm_mask);
+				if (found < 0) {
+					return -1;
+				}
+				*num_perms += found;
+				*query_perms |= perm_mask;
 			}
-			if (apol_vector_get_index(source_list, source_type, NULL, NULL, &i) == 0) {
-				match_source = 1;
+		}
+		if (sel->flags & APOL_QUERY_MATCH_ALL_PERMS) {
+			if ((size_t)*num_perms < apol_vector_get_size(sel->perm_list) || (f->perms & *query_perms) != *query_perms) {
+				return 0;
 			}
+		} else if (!(f->perms & *query_perms)) {
+			return 0;
 		}
+	}
+	return 1;
+}
 
-		/* if source did not match, but treating source symbol
-		 * as any field, then delay rejecting this rule until
-		 * the target has been checked */
-		if (!source_as_any && !match_source) {
-			continue;
+/**
+ *  Select the rules for one task of rule_select().  If rules are
+ *  looked up by source, the task covers a contiguous range of the
+ *  candidate sources; otherwise it covers one part of the rule tables
+ *  (see qpol_policy_get_avrule_iter_part()).  Joining the results of
+ *  all tasks in order gives the same rules in the same order as a
+ *  single task would; rule_select() then sorts rules looked up by
+ *  more than one source back into rule table order.
+ *  @param arg The avrule_select_run_t for this selection.
+ *  @param task Task number.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int rule_select_task(void *arg, size_t task)
+{
+	const avrule_select_run_t *run = arg;
+	const apol_policy_t *p = run->p;
+	apol_vector_t **v = (run->results != NULL ? run->results + task * run->num_sels : NULL);
+	avrule_match_cache_t *caches = NULL;
+	qpol_iterator_t *iter = NULL;
+	size_t first = 0, last = 1, s, q;
+	void *batch[APOL_QUERY_BATCH_SIZE];
+	size_t b, num_batch;
+	int retv = -1, match;
+
+	if ((caches = calloc(run->num_sels, sizeof(*caches))) == NULL) {
+		ERR(p, "%s", strerror(ENOMEM));
+		goto cleanup;
+	}
+	for (q = 0; q < run->num_sels; q++) {
+		if (avrule_match_cache_init(p, run->sels + q, run->num_classes, caches + q) < 0) {
+			goto cleanup;
 		}
+	}
 
-		if (target_list == NULL || (source_as_any && match_source)) {
-			match_target = 1;
-		} else {
-			const qpol_type_t *target_type;
-			if (qpol_avrule_get_target_type(p->p, rule, &target_type) < 0) {
+	/* when the source is known, only visit the rules naming one of
+	 * the candidate sources instead of scanning the whole table */
+	if (run->by_source != NULL) {
+		first = apol_vector_get_size(run->by_source) * task / run->num_tasks;
+		last = apol_vector_get_size(run->by_source) * (task + 1) / run->num_tasks;
+	}
+	for (s = first; s < last; s++) {
+		if (run->by_source == NULL) {
+			if (qpol_policy_get_avrule_iter_part(p->p, run->rule_type, task, run->num_tasks, &iter) < 0) {
 				goto cleanup;
 			}
-			if (apol_vector_get_index(target_list, target_type, NULL, NULL, &i) == 0) {
-				match_target = 1;
+		} else if (qpol_policy_get_avrule_iter_by_source(p->p, run->rule_type,
+								(const qpol_type_t *)apol_vector_get_element(run->by_source, s),
+								&iter) < 0) {
+			goto cleanup;
+		}
+		for (b = 0, num_batch = 0;; b++) {
+			avrule_facts_t facts;
+			if (b == num_batch) {
+				if (qpol_iterator_next_batch(iter, batch, APOL_QUERY_BATCH_SIZE, &num_batch) < 0) {
+					goto cleanup;
+				}
+				if (num_batch == 0) {
+					break;
+				}
+				b = 0;
+			}
+			if (avrule_facts_get(p, batch[b], &facts) < 0) {
+				goto cleanup;
+			}
+			for (q = 0; q < run->num_sels; q++) {
+				if ((match = avrule_select_match(p, run->sels + q, caches + q, &facts)) < 0) {
+					goto cleanup;
+				}
+				if (!match) {
+					continue;
+				}
+				if (run->map_fn != NULL) {
+					/* a non-zero return ends the selection early */
+					if ((match = run->map_fn(p, facts.rule, run->map_arg)) != 0) {
+						retv = (match < 0 ? -1 : 0);
+						goto cleanup;
+					}
+				} else if (apol_vector_append(v[q], facts.rule)) {
+					ERR(p, "%s", strerror(ENOMEM));
+					goto cleanup;
+				}
 			}
 		}
+		qpol_iterator_destroy(&iter);
+	}
 
-		if (!match_target) {
-			continue;
+	retv = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	if (caches != NULL) {
+		for (q = 0; q < run->num_sels; q++) {
+			avrule_match_cache_destroy(caches + q);
 		}
+		free(caches);
+	}
+	return retv;
+}
 
-		if (class_list != NULL) {
-			const qpol_class_t *obj_class;
-			if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0) {
-				goto cleanup;
-			}
-			if (apol_vector_get_index(class_list, obj_class, NULL, NULL, &i) < 0) {
-				continue;
+/**
+ *  Fill in the parts of a rule selection that do not depend on how
+ *  it is run.
+ *  @param p Policy to search.
+ *  @param sels Array of prepared queries.
+ *  @param num_sels Number of queries; must be at least 1.
+ *  @param run Selection to initialize.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int avrule_select_run_init(const apol_policy_t * p, const avrule_select_t * sels, size_t num_sels,
+				  avrule_select_run_t * run)
+{
+	qpol_iterator_t *iter = NULL;
+	size_t q;
+
+	memset(run, 0, sizeof(*run));
+	run->p = p;
+	run->sels = sels;
+	run->num_sels = num_sels;
+	run->num_tasks = 1;
+	for (q = 0; q < num_sels; q++) {
+		run->rule_type |= sels[q].rule_type;
+		if (sels[q].perm_list != NULL && run->num_classes == 0) {
+			if (qpol_policy_get_class_iter(p->p, &iter) < 0 || qpol_iterator_get_size(iter, &run->num_classes) < 0) {
+				qpol_iterator_destroy(&iter);
+				return -1;
 			}
+			qpol_iterator_destroy(&iter);
 		}
+	}
+	if (num_sels == 1 && sels[0].source_list != NULL && !(sels[0].flags & APOL_QUERY_SOURCE_AS_ANY)) {
+		run->by_source = sels[0].source_list;
+	}
+	return 0;
+}
 
-		if (perm_list != NULL) {
-			for (i = 0; i < apol_vector_get_size(perm_list) && match_perm < num_perms_to_match; i++) {
-				char *perm = (char *)apol_vector_get_element(perm_list, i);
-				if (qpol_avrule_get_perm_iter(p->p, rule, &perm_iter) < 0) {
-					goto cleanup;
-				}
-				int match = apol_compare_iter(p, perm_iter, perm, 0, NULL, 1);
-				if (match < 0) {
+/**
+ *  Compare two rules by their position in the rule tables.
+ *  @param a First qpol_avrule_t to compare.
+ *  @param b Second qpol_avrule_t to compare.
+ *  @param data The apol_policy_t containing the rules.
+ */
+static int avrule_position_comp(const void *a, const void *b, void *data)
+{
+	const apol_policy_t *p = data;
+	size_t pos1, pos2;
+	if (qpol_avrule_get_position(p->p, a, &pos1) < 0 || qpol_avrule_get_position(p->p, b, &pos2) < 0) {
+		return 0;
+	}
+	if (pos1 != pos2) {
+		return (pos1 < pos2 ? -1 : 1);
+	}
+	return 0;
+}
+
+/**
+ *  Common semantic rule selection routine used in get*rule_by_query.
+ *  A single query whose source is known looks up rules by source;
+ *  otherwise every query is matched during one pass over the rule
+ *  tables.  Either way the rules are returned in rule table order.
+ *  @param p Policy to search.
+ *  @param sels Array of prepared queries.
+ *  @param num_sels Number of queries; must be at least 1.
+ *  @param v Array of num_sels vectors to which to append the rules
+ *  (of type qpol_avrule_t) matching each query.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int rule_select(const apol_policy_t * p, const avrule_select_t * sels, size_t num_sels, apol_vector_t ** v)
+{
+	avrule_select_run_t run;
+	qpol_iterator_t *iter = NULL;
+	const size_t num_threads = apol_policy_get_query_threads(p);
+	size_t i;
+	int retv = -1;
+
+	if (avrule_select_run_init(p, sels, num_sels, &run) < 0) {
+		goto cleanup;
+	}
+
+	/* with several threads, split the work into more tasks than
+	 * threads; the index of rules by source is built on first use,
+	 * so build it before the tasks share it */
+	run.num_tasks = 1;
+	if (num_threads > 1) {
+		run.num_tasks = num_threads * APOL_QUERY_TASKS_PER_THREAD;
+		if (run.by_source != NULL) {
+			if (run.num_tasks > apol_vector_get_size(run.by_source)) {
+				run.num_tasks = apol_vector_get_size(run.by_source);
+			}
+			if (run.num_tasks > 1) {
+				if (qpol_policy_get_avrule_iter_by_source(p->p, run.rule_type,
+									 (const qpol_type_t *)apol_vector_get_element(run.by_source, 0),
+									 &iter) < 0) {
 					goto cleanup;
-				} else if (match > 0) {
-					match_perm++;
 				}
-				qpol_iterator_destroy(&perm_iter);
+				qpol_iterator_destroy(&iter);
+			} else {
+				run.num_tasks = 1;
 			}
-		} else {
-			match_perm = num_perms_to_match;
 		}
-		if (match_perm < num_perms_to_match) {
-			continue;
+	}
+	if ((run.results = calloc(run.num_tasks * num_sels, sizeof(*run.results))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < run.num_tasks * num_sels; i++) {
+		if (i < num_sels) {
+			run.results[i] = v[i];
+		} else if ((run.results[i] = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
 		}
+	}
 
-		if (apol_vector_append(v, rule)) {
-			ERR(p, "%s", strerror(ENOMEM));
+	if (apol_query_run_tasks(p, num_threads, run.num_tasks, rule_select_task, &run) < 0) {
+		goto cleanup;
+	}
+	for (i = num_sels; i < run.num_tasks * num_sels; i++) {
+		if (apol_vector_cat(v[i % num_sels], run.results[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
 			goto cleanup;
 		}
 	}
+	/* each source's rules are in table order, but the sources are
+	 * visited one after another; merge them back into table order so
+	 * that the result does not depend on how the rules were found */
+	if (run.by_source != NULL && apol_vector_get_size(run.by_source) > 1) {
+		apol_vector_sort(v[0], avrule_position_comp, (void *)p);
+	}
 
 	retv = 0;
       cleanup:
-	apol_regex_destroy(&bool_regex);
 	qpol_iterator_destroy(&iter);
-	qpol_iterator_destroy(&perm_iter);
+	if (run.results != NULL) {
+		for (i = num_sels; i < run.num_tasks * num_sels; i++) {
+			apol_vector_destroy(&run.results[i]);
+		}
+		free(run.results);
+	}
 	return retv;
 }
 
 int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v)
 {
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *perm_list = NULL;
-	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
+	avrule_select_t sel;
+	int retval = -1;
 	*v = NULL;
-	unsigned int flags = 0;
 
-	uint32_t rule_type = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
-//	if (qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_NEVERALLOW)) {
-		rule_type |= QPOL_RULE_NEVERALLOW;
-//	}
-	if (a != NULL) {
-		if (a->rules != 0) {
-			rule_type &= a->rules;
-		}
-		flags = a->flags;
-		is_regex = a->flags & APOL_QUERY_REGEX;
-		bool_name = a->bool_name;
-		if (a->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_type_list(p, a->source, is_regex,
-							   a->flags & APOL_QUERY_SOURCE_INDIRECT,
-							   ((a->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
-							    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+	if (avrule_select_init(p, a, &sel) < 0) {
+		goto cleanup;
+	}
+
+	if ((*v = apol_vector_create(NULL)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+
+	if (rule_select(p, &sel, 1, v)) {
+		goto cleanup;
+	}
+
+	retval = 0;
+      cleanup:
+	if (retval != 0) {
+		apol_vector_destroy(v);
+	}
+	avrule_select_destroy(&sel);
+	return retval;
+}
+
+int apol_avrule_get_by_query_map(const apol_policy_t * p, const apol_avrule_query_t * a, apol_avrule_map_func * fn, void *arg)
+{
+	avrule_select_t sel;
+	avrule_select_run_t run;
+	apol_vector_t *rules = NULL;
+	size_t i;
+	int retval = -1, match;
+
+	if (p == NULL || fn == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (avrule_select_init(p, a, &sel) < 0 || avrule_select_run_init(p, &sel, 1, &run) < 0) {
+		goto cleanup;
+	}
+
+	if (run.by_source != NULL && apol_vector_get_size(run.by_source) > 1) {
+		/* rules found under several sources must be sorted back
+		 * into table order before any is passed to the callback */
+		if ((rules = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
 			goto cleanup;
 		}
-		if ((a->flags & APOL_QUERY_SOURCE_AS_ANY) && a->source != NULL) {
-			target_list = source_list;
-			source_as_any = 1;
-		} else if (a->target != NULL &&
-			   (target_list =
-			    apol_query_create_candidate_type_list(p, a->target, is_regex,
-								  a->flags & APOL_QUERY_TARGET_INDIRECT,
-								  ((a->
-								    flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
-								   / APOL_QUERY_TARGET_TYPE))) == NULL) {
+		if (rule_select(p, &sel, 1, &rules) < 0) {
 			goto cleanup;
 		}
-		if (a->classes != NULL &&
-		    apol_vector_get_size(a->classes) > 0 &&
-		    (class_list = apol_query_create_candidate_class_list(p, a->classes)) == NULL) {
-			goto cleanup;
+		for (i = 0; i < apol_vector_get_size(rules); i++) {
+			if ((match = fn(p, apol_vector_get_element(rules, i), arg)) != 0) {
+				if (match < 0) {
+					goto cleanup;
+				}
+				break;
+			}
 		}
-		if (a->perms != NULL && apol_vector_get_size(a->perms) > 0) {
-			perm_list = a->perms;
+	} else {
+		/* rules are passed to the callback in order as they are
+		 * found, so the selection runs as a single task in this
+		 * thread */
+		run.map_fn = fn;
+		run.map_arg = arg;
+		if (rule_select_task(&run, 0) < 0) {
+			goto cleanup;
 		}
 	}
 
-	if ((*v = apol_vector_create(NULL)) == NULL) {
+	retval = 0;
+      cleanup:
+	apol_vector_destroy(&rules);
+	avrule_select_destroy(&sel);
+	return retval;
+}
+
+int apol_avrule_get_by_queries(const apol_policy_t * p, const apol_vector_t * queries, apol_vector_t ** v)
+{
+	avrule_select_t *sels = NULL;
+	apol_vector_t **results = NULL;
+	size_t num_sels, i;
+	int retval = -1;
+
+	if (v != NULL) {
+		*v = NULL;
+	}
+	if (p == NULL || queries == NULL || v == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+
+	num_sels = apol_vector_get_size(queries);
+	if ((*v = apol_vector_create_with_capacity(num_sels, apol_query_vector_free)) == NULL ||
+	    (sels = calloc(num_sels + 1, sizeof(*sels))) == NULL || (results = calloc(num_sels + 1, sizeof(*results))) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
+	for (i = 0; i < num_sels; i++) {
+		if ((results[i] = apol_vector_create(NULL)) == NULL || apol_vector_append(*v, results[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
+			apol_vector_destroy(&results[i]);
+			goto cleanup;
+		}
+	}
+	for (i = 0; i < num_sels; i++) {
+		if (avrule_select_init(p, apol_vector_get_element(queries, i), sels + i) < 0) {
+			goto cleanup;
+		}
+	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, perm_list, bool_name)) {
+	/* all queries are answered during the same pass over the rules */
+	if (num_sels > 0 && rule_select(p, sels, num_sels, results)) {
 		goto cleanup;
 	}
 
@@ -252,12 +689,13 @@ int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t
 	if (retval != 0) {
 		apol_vector_destroy(v);
 	}
-	apol_vector_destroy(&source_list);
-	if (!source_as_any) {
-		apol_vector_destroy(&target_list);
+	if (sels != NULL) {
+		for (i = 0; i < num_sels; i++) {
+			avrule_select_destroy(sels + i);
+		}
+		free(sels);
 	}
-	apol_vector_destroy(&class_list);
-	/* don't destroy perm_list - it points to query's permission list */
+	free(results);
 	return retval;
 }
 
@@ -269,10 +707,13 @@ int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_quer
 	int retval = -1, source_as_any = 0, is_regex = 0;
 	char *bool_name = NULL;
 	regex_t *bool_regex = NULL;
+	avrule_select_t sel;
 	*v = NULL;
 	size_t i;
 	unsigned int flags = 0;
 
+	memset(&sel, 0, sizeof(sel));
+
 	if (!p || !qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_SYN_RULES)) {
 		ERR(p, "%s", strerror(EINVAL));
 		goto cleanup;
@@ -322,7 +763,14 @@ int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_quer
 		goto cleanup;
 	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, perm_list, bool_name)) {
+	sel.rule_type = rule_type;
+	sel.flags = flags;
+	sel.source_list = source_list;
+	sel.target_list = target_list;
+	sel.class_list = class_list;
+	sel.perm_list = perm_list;
+	sel.bool_name = bool_name;
+	if (avrule_select_create_sets(p, &sel) < 0 || rule_select(p, &sel, 1, v)) {
 		goto cleanup;
 	}
 
@@ -442,6 +890,9 @@ int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_quer
 	apol_regex_destroy(&bool_regex);
 	qpol_iterator_destroy(&iter);
 	qpol_iterator_destroy(&perm_iter);
+	apol_query_bitmap_destroy(&sel.source_set);
+	apol_query_bitmap_destroy(&sel.target_set);
+	apol_query_bitmap_destroy(&sel.class_set);
 	return retval;
 }
 
@@ -738,38 +1189,38 @@ apol_vector_t *apol_avrule_list_to_syn_avrules(const apol_policy_t * p, const ap
 	return v;
 }
 
-char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rule)
+static int avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rule, apol_render_out_t * out)
 {
-	char *tmp = NULL;
 	const char *rule_type_str, *tmp_name = NULL;
 	int error = 0;
-	uint32_t rule_type = 0;
+	uint32_t rule_type = 0, class_val = 0, perm_mask = 0;
 	const qpol_type_t *type = NULL;
 	const qpol_class_t *obj_class = NULL;
-	qpol_iterator_t *iter = NULL;
-	size_t tmp_sz = 0, num_perms = 0;
+	const char *const *perm_names;
+	size_t num_perms = 0;
+	int bit;
 
 	if (!policy || !rule) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 
 	/* rule type */
 	if (qpol_avrule_get_rule_type(policy->p, rule, &rule_type)) {
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type &= (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT))) {
 		ERR(policy, "%s", "Invalid AV rule type");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type_str = apol_rule_type_to_str(rule_type))) {
 		ERR(policy, "%s", "Could not get AV rule type's string");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", rule_type_str)) {
+	if (apol_render_out_printf(out, "%s ", rule_type_str)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -784,7 +1235,7 @@ char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -799,7 +1250,7 @@ char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s : ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s : ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -814,102 +1265,125 @@ char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
 
-	/* perms */
-	if (qpol_avrule_get_perm_iter(policy->p, rule, &iter)) {
+	/* perms, named through the policy's table rather than an
+	 * iterator that copies each name */
+	if (qpol_avrule_get_perm_mask(policy->p, rule, &class_val, &perm_mask)) {
 		error = errno;
 		goto err;
 	}
-	if (qpol_iterator_get_size(iter, &num_perms)) {
+	if ((perm_names = apol_query_get_perm_names(policy, class_val)) == NULL) {
 		error = errno;
-		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
+	for (bit = 0; bit < APOL_QUERY_MAX_PERMS; bit++) {
+		if (perm_mask & (1U << bit)) {
+			num_perms++;
+		}
+	}
 	if (num_perms > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+		if (apol_render_out_puts(out, "{ ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
 	}
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		char *perm_name = NULL;
-		if (qpol_iterator_get_item(iter, (void **)&perm_name)) {
-			error = errno;
+	for (bit = 0; bit < APOL_QUERY_MAX_PERMS; bit++) {
+		if (!(perm_mask & (1U << bit))) {
+			continue;
+		}
+		if (perm_names[bit] == NULL) {
+			error = EINVAL;
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
-		if (apol_str_appendf(&tmp, &tmp_sz, "%s ", perm_name)) {
+		if (apol_render_out_puts(out, perm_names[bit]) || apol_render_out_puts(out, " ")) {
 			error = errno;
-			free(perm_name);
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
-		free(perm_name);
-		tmp_name = NULL;
 	}
 	if (num_perms > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+		if (apol_render_out_puts(out, "} ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
 	}
 
-	if (apol_str_append(&tmp, &tmp_sz, ";")) {
+	if (apol_render_out_puts(out, ";")) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
 
-	qpol_iterator_destroy(&iter);
-	return tmp;
+	return 0;
 
       err:
-	free(tmp);
-	qpol_iterator_destroy(&iter);
 	errno = error;
-	return NULL;
+	return -1;
 }
 
-char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule_t * rule)
+char *apol_avrule_render(const apol_policy_t * policy, const qpol_avrule_t * rule)
+{
+	apol_render_out_t out = { NULL, NULL, 0, 0 };
+	if (avrule_render(policy, rule, &out) < 0) {
+		int error = errno;
+		free(out.buf);
+		errno = error;
+		return NULL;
+	}
+	return out.buf;
+}
+
+int apol_avrule_render_file(const apol_policy_t * policy, const qpol_avrule_t * rule, FILE * fp)
+{
+	apol_render_out_t out = { fp, NULL, 0, 0 };
+	if (fp == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	return avrule_render(policy, rule, &out);
+}
+
+static int syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule_t * rule, apol_render_out_t * out)
 {
-	char *tmp = NULL;
 	const char *rule_type_str, *tmp_name = NULL;
 	int error = 0;
 	uint32_t rule_type = 0, star = 0, comp = 0, self = 0;
 	const qpol_type_t *type = NULL;
 	const qpol_class_t *obj_class = NULL;
 	qpol_iterator_t *iter = NULL, *iter2 = NULL;
-	size_t tmp_sz = 0, iter_sz = 0, iter2_sz = 0;
+	size_t iter_sz = 0, iter2_sz = 0;
 	const qpol_type_set_t *set = NULL;
 
 	if (!policy || !rule) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 
 	/* rule type */
 	if (qpol_syn_avrule_get_rule_type(policy->p, rule, &rule_type)) {
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type &= (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT))) {
 		ERR(policy, "%s", "Invalid AV rule type");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type_str = apol_rule_type_to_str(rule_type))) {
 		ERR(policy, "%s", "Could not get AV rule type's string");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", rule_type_str)) {
+	if (apol_render_out_printf(out, "%s ", rule_type_str)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -925,7 +1399,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		goto err;
 	}
 	if (star) {
-		if (apol_str_append(&tmp, &tmp_sz, "* ")) {
+		if (apol_render_out_puts(out, "* ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -936,7 +1410,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			goto err;
 		}
 		if (comp) {
-			if (apol_str_append(&tmp, &tmp_sz, "~")) {
+			if (apol_render_out_puts(out, "~")) {
 				error = errno;
 				ERR(policy, "%s", strerror(ENOMEM));
 				goto err;
@@ -956,7 +1430,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			goto err;
 		}
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+			if (apol_render_out_puts(out, "{ ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(ENOMEM));
 				goto err;
@@ -972,7 +1446,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -988,7 +1462,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "-%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "-%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -997,7 +1471,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		qpol_iterator_destroy(&iter);
 		qpol_iterator_destroy(&iter2);
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+			if (apol_render_out_puts(out, "} ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1015,7 +1489,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		goto err;
 	}
 	if (star) {
-		if (apol_str_append(&tmp, &tmp_sz, "* ")) {
+		if (apol_render_out_puts(out, "* ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1026,7 +1500,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			goto err;
 		}
 		if (comp) {
-			if (apol_str_append(&tmp, &tmp_sz, "~")) {
+			if (apol_render_out_puts(out, "~")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1050,7 +1524,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			goto err;
 		}
 		if (iter_sz + iter2_sz + self > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+			if (apol_render_out_puts(out, "{ ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1066,7 +1540,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1082,7 +1556,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "-%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "-%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1091,14 +1565,14 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		qpol_iterator_destroy(&iter);
 		qpol_iterator_destroy(&iter2);
 		if (self) {
-			if (apol_str_append(&tmp, &tmp_sz, "self ")) {
+			if (apol_render_out_puts(out, "self ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
 			}
 		}
 		if (iter_sz + iter2_sz + self > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+			if (apol_render_out_puts(out, "} ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -1106,7 +1580,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		}
 	}
 
-	if (apol_str_append(&tmp, &tmp_sz, ": ")) {
+	if (apol_render_out_puts(out, ": ")) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -1123,7 +1597,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		goto err;
 	}
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+		if (apol_render_out_puts(out, "{ ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1139,7 +1613,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			error = errno;
 			goto err;
 		}
-		if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+		if (apol_render_out_printf(out, "%s ", tmp_name)) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1147,7 +1621,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 	}
 	qpol_iterator_destroy(&iter);
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+		if (apol_render_out_puts(out, "} ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1165,7 +1639,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 		goto err;
 	}
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+		if (apol_render_out_puts(out, "{ ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1177,7 +1651,7 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
-		if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+		if (apol_render_out_printf(out, "%s ", tmp_name)) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1185,25 +1659,47 @@ char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule
 	}
 	qpol_iterator_destroy(&iter);
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+		if (apol_render_out_puts(out, "} ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
 		}
 	}
 
-	if (apol_str_append(&tmp, &tmp_sz, ";")) {
+	if (apol_render_out_puts(out, ";")) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
 
-	return tmp;
+	return 0;
 
       err:
-	free(tmp);
 	qpol_iterator_destroy(&iter);
 	qpol_iterator_destroy(&iter2);
 	errno = error;
-	return NULL;
+	return -1;
+}
+
+char *apol_syn_avrule_render(const apol_policy_t * policy, const qpol_syn_avrule_t * rule)
+{
+	apol_render_out_t out = { NULL, NULL, 0, 0 };
+	if (syn_avrule_render(policy, rule, &out) < 0) {
+		int error = errno;
+		free(out.buf);
+		errno = error;
+		return NULL;
+	}
+	return out.buf;
+}
+
+int apol_syn_avrule_render_file(const apol_policy_t * policy, const qpol_syn_avrule_t * rule, FILE * fp)
+{
+	apol_render_out_t out = { fp, NULL, 0, 0 };
+	if (fp == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	return syn_avrule_render(policy, rule, &out);
 }
@@ -607,13 +607,27 @@ void domain_trans_table_destroy(apol_domain_trans_table_t ** table)
 	*table = NULL;
 }
 
-void apol_policy_reset_domain_trans_table(apol_policy_t * policy)
+/**
+ * Clear the scratch flags used by a domain transition analysis.
+ * Unlike apol_policy_reset_domain_trans_table(), this also resets the
+ * table of a frozen policy; the caller must hold the policy's
+ * domain_trans_lock in that case.
+ */
+static void domain_trans_table_reset(apol_policy_t * policy)
 {
 	if (!policy || !policy->domain_trans_table)
 		return;
 	apol_bst_inorder_map(policy->domain_trans_table->domain_table, dom_node_reset, NULL);
 	apol_bst_inorder_map(policy->domain_trans_table->entrypoint_table, ep_node_reset, NULL);
-	return;
+}
+
+void apol_policy_reset_domain_trans_table(apol_policy_t * policy)
+{
+	/* analyses on a frozen policy reset the table themselves while
+	 * holding the lock; resetting here would race with them */
+	if (!policy || policy->frozen)
+		return;
+	domain_trans_table_reset(policy);
 }
 
 void apol_domain_trans_table_reset(apol_policy_t * policy)
@@ -1624,7 +1638,7 @@ static int domain_trans_table_get_all_reverse_trans(apol_policy_t * policy, apol
 	return -1;
 }
 
-int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
+static int domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
 {
 	apol_vector_t *local_results = NULL;
 	apol_avrule_query_t *accessq = NULL;
@@ -1802,6 +1816,23 @@ int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_anal
 	return -1;
 }
 
+int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
+{
+	int retv, error;
+	if (policy && policy->frozen) {
+		/* the table was built by apol_policy_freeze(); only its
+		 * scratch flags change, so one analysis runs at a time */
+		pthread_mutex_lock(&policy->domain_trans_lock);
+		domain_trans_table_reset(policy);
+		retv = domain_trans_analysis_do(policy, dta, results);
+		error = errno;
+		pthread_mutex_unlock(&policy->domain_trans_lock);
+		errno = error;
+		return retv;
+	}
+	return domain_trans_analysis_do(policy, dta, results);
+}
+
 /* result */
 
 const qpol_type_t *apol_domain_trans_result_get_start_type(const apol_domain_trans_result_t * dtr)
@@ -1904,8 +1935,8 @@ const apol_vector_t *apol_domain_trans_result_get_access_rules(const apol_domain
 	}
 }
 
-int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
-					 const qpol_type_t * end_dom)
+static int domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
+					   const qpol_type_t * end_dom)
 {
 	int missing_rules = 0;
 
@@ -1914,7 +1945,7 @@ int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type
 		return -1;
 	}
 	//reset the table
-	apol_policy_reset_domain_trans_table(policy);
+	domain_trans_table_reset(policy);
 	//find nodes for each type
 	dom_node_t start_dummy = { start_dom, NULL, NULL, NULL };
 	dom_node_t *start_node = NULL;
@@ -2005,6 +2036,19 @@ int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type
 	return missing_rules;
 }
 
+int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
+					 const qpol_type_t * end_dom)
+{
+	int retv;
+	if (policy && policy->frozen) {
+		pthread_mutex_lock(&policy->domain_trans_lock);
+		retv = domain_trans_table_verify_trans(policy, start_dom, ep_type, end_dom);
+		pthread_mutex_unlock(&policy->domain_trans_lock);
+		return retv;
+	}
+	return domain_trans_table_verify_trans(policy, start_dom, ep_type, end_dom);
+}
+
 apol_domain_trans_result_t *apol_domain_trans_result_create_from_domain_trans_result(const apol_domain_trans_result_t * result)
 {
 	apol_domain_trans_result_t *new_r = NULL;
@@ -24,14 +24,14 @@
 
 #include "policy-query-internal.h"
 #include "infoflow-analysis-internal.h"
-#include "queue.h"
-#include <apol/bst.h>
 #include <apol/perm-map.h>
 
 #include <assert.h>
 #include <config.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include <time.h>
 
 /*
@@ -48,61 +48,137 @@
 #define APOL_INFOFLOW_COLOR_WHITE 0
 #define APOL_INFOFLOW_COLOR_GREY  1
 #define APOL_INFOFLOW_COLOR_BLACK 2
-#define APOL_INFOFLOW_COLOR_RED   3
+
+/** Marks a node or edge number that has not been set. */
+#define APOL_INFOFLOW_NONE ((size_t) -1)
 
 typedef struct apol_infoflow_node apol_infoflow_node_t;
 typedef struct apol_infoflow_edge apol_infoflow_edge_t;
 
-struct apol_infoflow_graph
+/** One flow found while reading the policy's rules, before flows
+ *  between the same nodes are gathered into edges. */
+typedef struct apol_infoflow_flow
 {
-	/** vector of apol_infoflow_node_t */
-	apol_vector_t *nodes;
-	/** vector of apol_infoflow_edge_t */
-	apol_vector_t *edges;
-	/** temporary BST of apol_infoflow_node_t used while building
-         *  the graph */
-	apol_bst_t *nodes_bst;
-
-	unsigned int mode, direction;
-	regex_t *regex;
+	size_t start_node, end_node, edge;
+	const qpol_avrule_t *rule;
+	/** number of the rule within the policy's allow rules, in the
+	 *  order read */
+	size_t rule_index;
+	int length;
+} apol_infoflow_flow_t;
 
-	/** vector of apol_infoflow_node_t, used for random restarts
-	 * for further transitive analysis */
-	apol_vector_t *further_start;
-	/** vector of apol_infoflow_node_t of targets, used for
-	 * further transitive analysis */
-	apol_vector_t *further_end;
-	size_t current_start;
-#ifdef HAVE_RAND_R
-	unsigned int seed;
-#endif
+/**
+ * The nodes and edges of an information flow graph, in compressed
+ * sparse row form.  Nodes and edges are numbered from 0; the edges
+ * leaving a node are contiguous, as are the rules of an edge.  Once
+ * built it is never modified, so one may be shared by any number of
+ * apol_infoflow_graph_t and kept within the policy for reuse.
+ */
+struct apol_infoflow_csr
+{
+	size_t num_nodes, num_edges;
+	/** array of num_nodes nodes */
+	apol_infoflow_node_t *nodes;
+	/** array of num_edges edges, sorted by start node */
+	apol_infoflow_edge_t *edges;
+	/** edges leaving node n are edges[out_start[n]] through
+	 *  edges[out_start[n + 1] - 1] */
+	size_t *out_start;
+	/** edges entering node n are those numbered in_edges[in_start[n]]
+	 *  through in_edges[in_start[n + 1] - 1] */
+	size_t *in_start, *in_edges;
+	/** rules of every edge, pointing into the policy */
+	const qpol_avrule_t **rules;
+	/** parameters the graph was built with, to know if a cached
+	 *  graph may be reused */
+	unsigned int mode;
+	int min_weight;
+	unsigned int policy_generation, permmap_generation;
+
+	/* The rest is kept only for graphs within the policy's cache,
+	 * so that they may be updated after the permission map
+	 * changes, and filtered for analyses that limit the minimum
+	 * weight or permissions, without reading every rule again. */
+
+	/** every allow rule, in the order read */
+	const qpol_avrule_t **all_rules;
+	size_t num_all_rules;
+	/** all_rules numbers of the rules of class value c are
+	 *  class_rules[class_start[c - 1]] through
+	 *  class_rules[class_start[c] - 1] */
+	size_t *class_start, *class_rules;
+	size_t num_classes;
+	/** every flow, in the order found; each records the rule
+	 *  from which it came */
+	apol_infoflow_flow_t *flows;
+	size_t num_flows;
+	/** flow lengths of each class's permissions when built, as
+	 *  described within apol_infoflow_builder_t */
+	int *read_len, *write_len;
+	uint32_t *perms_known, *perms_unmapped;
+
+	/** number of graphs, plus the policy's cache, using this */
+	unsigned int refcount;
+	pthread_mutex_t refcount_lock;
 };
 
 struct apol_infoflow_node
 {
 	const qpol_type_t *type;
+	/** value of type, for quick lookups */
+	uint32_t type_value;
 	/** one of APOL_INFOFLOW_NODE_SOURCE or APOL_INFOFLOW_NODE_TARGET */
 	int node_type;
-	/** vector of apol_infoflow_edge_t, pointing into the graph */
-	apol_vector_t *in_edges;
-	/** vector of apol_infoflow_edge_t, pointing into the graph */
-	apol_vector_t *out_edges;
-	unsigned char color;
-	apol_infoflow_node_t *parent;
-	int distance;
 };
 
 struct apol_infoflow_edge
 {
-	/** vector of qpol_avrule_t, pointing into the policy */
-	apol_vector_t *rules;
-	/** pointer into a node within the graph */
-	apol_infoflow_node_t *start_node;
-	/** pointer into a node within the graph */
-	apol_infoflow_node_t *end_node;
+	size_t start_node, end_node;
+	/** this edge's rules are rules[first_rule] through
+	 *  rules[first_rule + num_rules - 1] */
+	size_t first_rule, num_rules;
 	int length;
 };
 
+struct apol_infoflow_graph
+{
+	/** nodes and edges, possibly shared with the policy's cache */
+	struct apol_infoflow_csr *csr;
+	/** per-node state for the transitive searches; each is an
+	 *  array of csr->num_nodes */
+	unsigned char *color;
+	int *distance;
+	/** edge by which each node was reached, or APOL_INFOFLOW_NONE */
+	size_t *parent;
+	/** ring of nodes waiting to be searched, of csr->num_nodes + 1 */
+	size_t *queue;
+	size_t queue_head, queue_len;
+	/** binary heap of nodes waiting to be settled, ordered by
+	 *  distance, and the position of each node within it or
+	 *  APOL_INFOFLOW_NONE */
+	size_t *heap, *heap_index;
+	size_t heap_len;
+
+	unsigned int mode, direction;
+	regex_t *regex;
+
+	/** nodes used for random restarts for further transitive
+	 *  analysis */
+	size_t *further_start;
+	size_t num_further_start;
+	/** for each node, non-zero if it is a target of further
+	 *  transitive analysis */
+	unsigned char *further_end;
+	size_t current_start;
+#ifdef HAVE_RAND_R
+	unsigned int seed;
+#endif
+	/** if non-zero, draw random numbers from stream rather than
+	 *  from the seed above */
+	int use_stream;
+	uint32_t stream;
+};
+
 /**
  * apol_infoflow_analysis_h encapsulates all of the paramaters of a
  * query.  It should always be allocated with
@@ -198,6 +274,13 @@ static void apol_infoflow_srand(apol_infoflow_graph_t * g)
  */
 static int apol_infoflow_rand(apol_infoflow_graph_t * g)
 {
+	if (g->use_stream) {
+		/* xorshift; the state is never zero */
+		g->stream ^= g->stream << 13;
+		g->stream ^= g->stream >> 17;
+		g->stream ^= g->stream << 5;
+		return (int)(g->stream % ((uint32_t) RAND_MAX + 1));
+	}
 #ifdef HAVE_RAND_R
 	return rand_r(&g->seed);
 #else
@@ -205,269 +288,292 @@ static int apol_infoflow_rand(apol_infoflow_graph_t * g)
 #endif
 }
 
-/******************** infoflow graph node routines ********************/
-
 /**
- * Given a pointer to an apol_infoflow_node_t, free its space
- * including the pointer itself.  Does nothing if the pointer is
- * already NULL.
+ * Start a graph's stream of pseudo-random numbers for one iteration
+ * of a further transitive analysis run.  The stream depends only upon
+ * the run's seed and the iteration number, so that a run's results do
+ * not depend upon which thread performs which iteration.
  *
- * @param data Node to free.
+ * @param g Transitive infoflow graph.
+ * @param seed Seed given to the run.
+ * @param iteration Iteration about to be performed.
  */
-static void apol_infoflow_node_free(void *data)
-{
-	apol_infoflow_node_t *node = (apol_infoflow_node_t *) data;
-	if (node != NULL) {
-		/* the edges themselves are owned by the graph, not by
-		 * the node */
-		apol_vector_destroy(&node->in_edges);
-		apol_vector_destroy(&node->out_edges);
-		free(node);
-	}
+static void apol_infoflow_srand_stream(apol_infoflow_graph_t * g, unsigned int seed, size_t iteration)
+{
+	uint32_t x = (uint32_t) seed + ((uint32_t) iteration + 1) * 0x9e3779b9U;
+	/* scramble the bits, so that neighboring iterations start
+	 * from unrelated states */
+	x = (x ^ (x >> 16)) * 0x85ebca6bU;
+	x = (x ^ (x >> 13)) * 0xc2b2ae35U;
+	x ^= x >> 16;
+	g->use_stream = 1;
+	g->stream = (x != 0 ? x : 0x9e3779b9U);
 }
 
-struct apol_infoflow_node_key
-{
-	const qpol_type_t *type;
-	int node_type;
-};
+/******************** infoflow graph sharing routines ********************/
 
 /**
- * Given an infoflow node and a key, returns 0 if they are the same,
- * non-zero if not.
+ * Take another reference to a compressed graph.
  *
- * @param a Existing node within the infoflow graph.
- * @param b <i>Unused.</i>
- * @param data Pointer to a struct infoflow_node_key.
+ * @param csr Graph to reference.
+ */
+static void apol_infoflow_csr_ref(apol_infoflow_csr_t * csr)
+{
+	pthread_mutex_lock(&csr->refcount_lock);
+	csr->refcount++;
+	pthread_mutex_unlock(&csr->refcount_lock);
+}
+
+/**
+ * Drop a reference to a compressed graph, freeing it if that was the
+ * last one, and then set the pointer to NULL.  Does nothing if the
+ * pointer is already NULL.
  *
- * @return 0 if the key matches a, non-zero if not.
+ * @param csr Reference to a graph to release.
  */
-static int apol_infoflow_node_compare(const void *a, const void *b __attribute__ ((unused)), void *data)
+static void apol_infoflow_csr_unref(apol_infoflow_csr_t ** csr)
+{
+	unsigned int refcount;
+	if (csr == NULL || *csr == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&(*csr)->refcount_lock);
+	refcount = --(*csr)->refcount;
+	pthread_mutex_unlock(&(*csr)->refcount_lock);
+	if (refcount == 0) {
+		free((*csr)->nodes);
+		free((*csr)->edges);
+		free((*csr)->out_start);
+		free((*csr)->in_start);
+		free((*csr)->in_edges);
+		free((*csr)->rules);
+		free((*csr)->all_rules);
+		free((*csr)->class_start);
+		free((*csr)->class_rules);
+		free((*csr)->flows);
+		free((*csr)->read_len);
+		free((*csr)->write_len);
+		free((*csr)->perms_known);
+		free((*csr)->perms_unmapped);
+		pthread_mutex_destroy(&(*csr)->refcount_lock);
+		free(*csr);
+	}
+	*csr = NULL;
+}
+
+void apol_infoflow_graph_cache_destroy(apol_policy_t * p)
 {
-	apol_infoflow_node_t *node = (apol_infoflow_node_t *) a;
-	struct apol_infoflow_node_key *key = (struct apol_infoflow_node_key *)data;
-	if (node->type != key->type) {
-		return (int)((char *)node->type - (char *)key->type);
+	size_t i;
+	if (p != NULL) {
+		for (i = 0; i < sizeof(p->infoflow_graphs) / sizeof(p->infoflow_graphs[0]); i++) {
+			apol_infoflow_csr_unref(&p->infoflow_graphs[i]);
+		}
 	}
-	return node->node_type - key->node_type;
+}
+
+/******************** infoflow graph creation routines ********************/
+
+/** Everything needed while building a graph. */
+typedef struct apol_infoflow_builder
+{
+	apol_infoflow_csr_t *csr;
+	/** largest type value in the policy */
+	uint32_t num_type_values;
+	/** node number of each type value and node type, indexed by
+	 *  2 * value + node type - 1, or APOL_INFOFLOW_NONE */
+	size_t *node_of;
+	size_t num_node_slots;
+	/** if non-NULL, non-zero for each type value that may appear
+	 *  within the graph */
+	unsigned char *allowed_types;
+	/** flows found so far */
+	apol_infoflow_flow_t *flows;
+	size_t num_flows, flows_size;
+	/** all_rules number of the rule whose flows are being found */
+	size_t rule_index;
+	/** node numbers of the current rule's source and target */
+	size_t *src_nodes, *tgt_nodes;
+	size_t src_nodes_size, tgt_nodes_size;
+	/** name of each class, indexed by value - 1 */
+	const char **class_names;
+	size_t num_classes;
+	/** flow length of each class's permissions, indexed by (class
+	 *  value - 1) * APOL_QUERY_MAX_PERMS + permission bit; INT_MAX
+	 *  for no flow */
+	int *read_len, *write_len;
+	/** permissions per class whose lengths have been looked up */
+	uint32_t *perms_known;
+	/** permissions per class that are unmapped */
+	uint32_t *perms_unmapped;
+	/** if non-NULL, permissions per class that a rule must have
+	 *  at least one of to be within the graph */
+	uint32_t *perms_required;
+	int max_len, perm_error;
+} apol_infoflow_builder_t;
+
+static void apol_infoflow_builder_destroy(apol_infoflow_builder_t * b)
+{
+	apol_infoflow_csr_unref(&b->csr);
+	free(b->node_of);
+	free(b->allowed_types);
+	free(b->flows);
+	free(b->src_nodes);
+	free(b->tgt_nodes);
+	free(b->class_names);
+	free(b->read_len);
+	free(b->write_len);
+	free(b->perms_known);
+	free(b->perms_unmapped);
+	free(b->perms_required);
 }
 
 /**
- * Attempt to allocate a new node, add it to the infoflow graph, and
- * return a pointer to it.  If there already exists a node with the
- * same type then reuse that node.
+ * Return the node for a type, adding it to the graph if there is
+ * not one already.
  *
  * @param p Policy handler, for reporting error.
- * @param g Infoflow to which add the node.
- * @param type Type for the new node.
+ * @param b Graph being built.
+ * @param type Type for the node.
  * @param node_type Node type, one of APOL_INFOFLOW_NODE_SOURCE or
  * APOL_INFOFLOW_NODE_TARGET.
  *
- * @return Pointer an allocated node within the infoflow graph, or
- * NULL upon error.
+ * @return Node number, or APOL_INFOFLOW_NONE upon error.
  */
-static apol_infoflow_node_t *apol_infoflow_graph_create_node(const apol_policy_t * p,
-							     apol_infoflow_graph_t * g, const qpol_type_t * type, int node_type)
+static size_t apol_infoflow_graph_create_node(const apol_policy_t * p, apol_infoflow_builder_t * b, const qpol_type_t * type,
+					      int node_type)
 {
-	struct apol_infoflow_node_key key = { type, node_type };
-	apol_infoflow_node_t *node = NULL;
-	if (apol_bst_get_element(g->nodes_bst, NULL, &key, (void **)&node) == 0) {
-		return node;
-	}
-	if ((node = calloc(1, sizeof(*node))) == NULL ||
-	    (node->in_edges = apol_vector_create(NULL)) == NULL || (node->out_edges = apol_vector_create(NULL)) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		apol_infoflow_node_free(node);
-		return NULL;
-	}
-	node->type = type;
-	node->node_type = node_type;
-	if (apol_bst_insert(g->nodes_bst, node, &key) != 0) {
-		ERR(p, "%s", strerror(errno));
-		apol_infoflow_node_free(node);
-		return NULL;
-	}
-	return node;
+	apol_infoflow_csr_t *csr = b->csr;
+	apol_infoflow_node_t *node;
+	uint32_t value;
+	size_t i;
+	if (qpol_type_get_value(p->p, type, &value) < 0) {
+		return APOL_INFOFLOW_NONE;
+	}
+	if (value > b->num_type_values) {
+		ERR(p, "%s", strerror(ERANGE));
+		errno = ERANGE;
+		return APOL_INFOFLOW_NONE;
+	}
+	i = 2 * (size_t) value + node_type - 1;
+	if (b->node_of[i] == APOL_INFOFLOW_NONE) {
+		node = csr->nodes + csr->num_nodes;
+		node->type = type;
+		node->type_value = value;
+		node->node_type = node_type;
+		b->node_of[i] = csr->num_nodes++;
+	}
+	return b->node_of[i];
 }
 
 /**
- * Attempt to allocate a new node, add it to the infoflow graph, and
- * return a pointer to it.  If there already exists a node with the
- * same type then reuse that node.
+ * Get the nodes for one end of a rule.  Attributes are expanded into
+ * their member types for transitive graphs, but not for direct
+ * graphs; apol_infoflow_analysis_direct_expand() expands those.
  *
  * @param p Policy handler, for reporting error.
- * @param g Infoflow to which add the node.
- * @param type Type for the new node.  If this is an attribute then it
- * will be expanded into its component types.
- * @param types If non-NULL, a BST of qpol_type_t pointers.  Only
- * create and return nodes which are members of this tree.
+ * @param b Graph being built.
+ * @param type Type for the new nodes.
  * @param node_type Node type, one of APOL_INFOFLOW_NODE_SOURCE or
  * APOL_INFOFLOW_NODE_TARGET.
+ * @param nodes Reference to an array to fill, grown as needed.
+ * @param nodes_size Reference to the size of the array.
+ * @param num_nodes Reference to where to write the number of nodes.
  *
- * @return Vector of nodes (type apol_infoflow_node_t *) within the
- * infoflow graph, or NULL upon error.  The caller is responsible for
- * calling apol_vector_destroy() upon the return value.
+ * @return 0 on success, < 0 on error.
  */
-static apol_vector_t *apol_infoflow_graph_create_nodes(const apol_policy_t * p,
-						       apol_infoflow_graph_t * g, const qpol_type_t * type, apol_bst_t * types,
-						       int node_type)
+static int apol_infoflow_graph_create_nodes(const apol_policy_t * p, apol_infoflow_builder_t * b, const qpol_type_t * type,
+					    int node_type, size_t ** nodes, size_t * nodes_size, size_t * num_nodes)
 {
+	qpol_iterator_t *iter = NULL;
+	const qpol_type_t *t;
 	unsigned char isattr;
-	apol_vector_t *v = NULL;
-	apol_infoflow_node_t *node = NULL;
+	uint32_t value;
+	size_t len, n, *new_nodes;
+	int retval = -1;
+
+	*num_nodes = 0;
 	if (qpol_type_get_isattr(p->p, type, &isattr) < 0) {
-		return NULL;
+		goto cleanup;
+	}
+	if (isattr && b->csr->mode != APOL_INFOFLOW_MODE_DIRECT) {
+		if (qpol_type_get_type_iter(p->p, type, &iter) < 0 || qpol_iterator_get_size(iter, &len) < 0) {
+			goto cleanup;
+		}
+	} else {
+		len = 1;
+	}
+	if (len > *nodes_size) {
+		if ((new_nodes = realloc(*nodes, len * sizeof(**nodes))) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+		*nodes = new_nodes;
+		*nodes_size = len;
 	}
-	if (isattr && g->mode != APOL_INFOFLOW_MODE_DIRECT) {
-		qpol_iterator_t *iter = NULL;
-		qpol_type_t *t;
-		size_t len;
-		if (qpol_type_get_type_iter(p->p, type, &iter) < 0 ||
-		    qpol_iterator_get_size(iter, &len) < 0 || (v = apol_vector_create_with_capacity(len, NULL)) == NULL) {
-			qpol_iterator_destroy(&iter);
-			apol_vector_destroy(&v);
-			return NULL;
-		}
-		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-			qpol_iterator_get_item(iter, (void **)&t);
-			void *result;
-			if (types != NULL && apol_bst_get_element(types, t, NULL, &result) < 0) {
+	if (iter != NULL) {
+		for (; !qpol_iterator_end(iter) && *num_nodes < len; qpol_iterator_next(iter)) {
+			if (qpol_iterator_get_item(iter, (void **)&t) < 0 || qpol_type_get_value(p->p, t, &value) < 0) {
+				goto cleanup;
+			}
+			if (b->allowed_types != NULL && (value > b->num_type_values || !b->allowed_types[value])) {
 				continue;
 			}
-			if ((node = apol_infoflow_graph_create_node(p, g, t, node_type)) == NULL || apol_vector_append(v, node) < 0) {
-				qpol_iterator_destroy(&iter);
-				apol_vector_destroy(&v);
-				return NULL;
+			if ((n = apol_infoflow_graph_create_node(p, b, t, node_type)) == APOL_INFOFLOW_NONE) {
+				goto cleanup;
 			}
+			(*nodes)[(*num_nodes)++] = n;
 		}
-		qpol_iterator_destroy(&iter);
 	} else {
-		/* for a direct search, do not expand types; the
-		 * algorithm will do that with
-		 * apol_infoflow_graph_get_nodes_for_type() and
-		 * apol_infoflow_analysis_direct_expand().  for
-		 * transitive searches the \a types BST was checked in
-		 * apol_infoflow_graph_check_types() if \a type is
-		 * just a type.
-		 */
-		if ((v = apol_vector_create_with_capacity(1, NULL)) == NULL) {
-			return NULL;
-		}
-		if ((node = apol_infoflow_graph_create_node(p, g, type, node_type)) == NULL || apol_vector_append(v, node) < 0) {
-			apol_vector_destroy(&v);
-			return NULL;
+		/* for transitive searches the allowed types were
+		 * checked in apol_infoflow_graph_check_types() if
+		 * type is just a type */
+		if ((n = apol_infoflow_graph_create_node(p, b, type, node_type)) == APOL_INFOFLOW_NONE) {
+			goto cleanup;
 		}
+		(*nodes)[(*num_nodes)++] = n;
 	}
-	return v;
-}
-
-/******************** infoflow graph edge routines ********************/
-
-/**
- * Given a pointer to an apol_infoflow_edge_t, free its space
- * including the pointer itself.  Does nothing if the pointer is
- * already NULL.
- *
- * @param data Edge to free.
- */
-static void apol_infoflow_edge_free(void *data)
-{
-	apol_infoflow_edge_t *edge = (apol_infoflow_edge_t *) data;
-	if (edge != NULL) {
-		apol_vector_destroy(&edge->rules);
-		free(edge);
-	}
-}
-
-struct apol_infoflow_edge_key
-{
-	apol_infoflow_node_t *start_node, *end_node;
-};
-
-/**
- * Given an infoflow edge and a key, returns 0 if they are the same,
- * non-zero if not.
- *
- * @param a Existing edge within the infoflow graph.
- * @param b <i>Unused.</i>
- * @param data Pointer to a struct infoflow_edge_key.
- *
- * @return 0 if the key matches a, non-zero if not.
- */
-static int apol_infoflow_edge_compare(const void *a, const void *b __attribute__ ((unused)), void *data)
-{
-	apol_infoflow_edge_t *edge = (apol_infoflow_edge_t *) a;
-	struct apol_infoflow_edge_key *key = (struct apol_infoflow_edge_key *)data;
-	if (key->start_node != NULL && edge->start_node != key->start_node) {
-		return (int)((char *)edge->start_node - (char *)key->start_node);
-	}
-	if (key->end_node != NULL && edge->end_node != key->end_node) {
-		return (int)((char *)edge->end_node - (char *)key->end_node);
-	}
-	return 0;
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	return retval;
 }
 
 /**
- * Attempt to allocate a new edge, add it to the infoflow graph, and
- * return a pointer to it.  If there already exists a edge from the
- * start node to the end node then reuse that edge.
- *
- * @param p Policy handler, for reporting errors.
- * @param g Infoflow graph to which add the edge.
- * @param start_node Starting node for the edge.
- * @param end_node Ending node for the edge.
- * @param len Length of edge (proportionally inverse of permission weight)
+ * Record a flow from one node to another.
  *
- * @return Pointer an allocated node within the infoflow graph, or
- * NULL upon error.
+ * @return 0 on success, < 0 on error.
  */
-static apol_infoflow_edge_t *apol_infoflow_graph_create_edge(const apol_policy_t * p,
-							     apol_infoflow_graph_t * g __attribute__ ((unused)),
-							     apol_infoflow_node_t * start_node,
-							     apol_infoflow_node_t * end_node, int len)
-{
-	struct apol_infoflow_edge_key key = { NULL, end_node };
-	size_t i;
-	apol_infoflow_edge_t *edge = NULL;
-	if (apol_vector_get_index(start_node->out_edges, NULL, apol_infoflow_edge_compare, &key, &i) == 0) {
-		edge = (apol_infoflow_edge_t *) apol_vector_get_element(start_node->out_edges, i);
-		if (edge->length < len) {
-			edge->length = len;
+static int apol_infoflow_graph_add_flow(const apol_policy_t * p, apol_infoflow_builder_t * b, size_t start_node,
+					size_t end_node, const qpol_avrule_t * rule, int len)
+{
+	apol_infoflow_flow_t *f;
+	size_t new_size;
+	if (b->num_flows >= b->flows_size) {
+		new_size = (b->flows_size > 0 ? b->flows_size * 2 : 1024);
+		if ((f = realloc(b->flows, new_size * sizeof(*f))) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			return -1;
 		}
-		return edge;
-	}
-	if ((edge = calloc(1, sizeof(*edge))) == NULL || (edge->rules = apol_vector_create(NULL)) == NULL ||
-	    apol_vector_append(g->edges, edge) < 0) {
-		ERR(p, "%s", strerror(errno));
-		apol_infoflow_edge_free(edge);
-		return NULL;
-	}
-	edge->start_node = start_node;
-	edge->end_node = end_node;
-	edge->length = len;
-	if (apol_vector_append(start_node->out_edges, edge) < 0 || apol_vector_append(end_node->in_edges, edge) < 0) {
-		/* don't free the edge -- it is owned by the graph */
-		ERR(p, "%s", strerror(errno));
-		return NULL;
-	}
-	return edge;
+		b->flows = f;
+		b->flows_size = new_size;
+	}
+	f = b->flows + b->num_flows++;
+	f->start_node = start_node;
+	f->end_node = end_node;
+	f->edge = APOL_INFOFLOW_NONE;
+	f->rule = rule;
+	f->rule_index = b->rule_index;
+	f->length = len;
+	return 0;
 }
 
-/******************** infoflow graph creation routines ********************/
-
 /**
- * Take an avrule within a policy and possibly add it to the infoflow
- * graph.  The rule's source and target type sets are expanded.  If
- * the rule is to be added, then add its end nodes as necessary, and
- * an edge connecting those nodes as necessary, and then add the rule
- * to the edge.
+ * Take an avrule within a policy and record its flows.  The rule's
+ * source and target type sets are expanded as needed.
  *
  * @param p Policy containing rules.
- * @param g Information flow graph being created.
+ * @param b Information flow graph being created.
  * @param rule AV rule to use.
- * @param types BST of qpol_type_t pointers; while adding avrules to
- * the graph, only add those whose source and/or target is a member of
- * \a types, if \a types is non-NULL.
  * @param found_read Non-zero to indicate that this rule performs a
  * read operation.
  * @param read_len Length of the edge to create (proportionally
@@ -480,159 +586,161 @@ static apol_infoflow_edge_t *apol_infoflow_graph_create_edge(const apol_policy_t
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_graph_connect_nodes(const apol_policy_t * p,
-					     apol_infoflow_graph_t * g,
-					     const qpol_avrule_t * rule,
-					     apol_bst_t * types, int found_read, int read_len, int found_write, int write_len)
+					     apol_infoflow_builder_t * b,
+					     const qpol_avrule_t * rule, int found_read, int read_len, int found_write, int write_len)
 {
 	const qpol_type_t *src_type, *tgt_type;
-	apol_vector_t *src_nodes = NULL, *tgt_nodes = NULL;
-	size_t i, j;
-	apol_infoflow_node_t *src_node, *tgt_node;
-	apol_infoflow_edge_t *edge;
-	int retval = -1;
+	size_t i, j, num_src, num_tgt;
 
 	if (qpol_avrule_get_source_type(p->p, rule, &src_type) < 0 || qpol_avrule_get_target_type(p->p, rule, &tgt_type) < 0) {
-		goto cleanup;
-	}
-
-	if ((src_nodes = apol_infoflow_graph_create_nodes(p, g, src_type, types, APOL_INFOFLOW_NODE_SOURCE)) == NULL) {
-		goto cleanup;
+		return -1;
 	}
-	if ((tgt_nodes = apol_infoflow_graph_create_nodes(p, g, tgt_type, types, APOL_INFOFLOW_NODE_TARGET)) == NULL) {
-		goto cleanup;
+	if (apol_infoflow_graph_create_nodes(p, b, src_type, APOL_INFOFLOW_NODE_SOURCE, &b->src_nodes, &b->src_nodes_size,
+					     &num_src) < 0 ||
+	    apol_infoflow_graph_create_nodes(p, b, tgt_type, APOL_INFOFLOW_NODE_TARGET, &b->tgt_nodes, &b->tgt_nodes_size,
+					     &num_tgt) < 0) {
+		return -1;
 	}
-	for (i = 0; i < apol_vector_get_size(src_nodes); i++) {
-		src_node = apol_vector_get_element(src_nodes, i);
-		for (j = 0; j < apol_vector_get_size(tgt_nodes); j++) {
-			tgt_node = apol_vector_get_element(tgt_nodes, j);
-			if (found_read) {
-				if ((edge = apol_infoflow_graph_create_edge(p, g, tgt_node, src_node, read_len)) == NULL) {
-					goto cleanup;
-				}
-				if (apol_vector_append(edge->rules, (void *)rule) < 0) {
-					ERR(p, "%s", strerror(ENOMEM));
-					goto cleanup;
-				}
+	for (i = 0; i < num_src; i++) {
+		for (j = 0; j < num_tgt; j++) {
+			if (found_read && apol_infoflow_graph_add_flow(p, b, b->tgt_nodes[j], b->src_nodes[i], rule, read_len) < 0) {
+				return -1;
 			}
-			if (found_write) {
-				if ((edge = apol_infoflow_graph_create_edge(p, g, src_node, tgt_node, write_len)) == NULL) {
-					goto cleanup;
-				}
-				if (apol_vector_append(edge->rules, (void *)rule) < 0) {
-					ERR(p, "%s", strerror(ENOMEM));
-					goto cleanup;
-				}
+			if (found_write && apol_infoflow_graph_add_flow(p, b, b->src_nodes[i], b->tgt_nodes[j], rule, write_len) < 0) {
+				return -1;
 			}
 		}
 	}
-	retval = 0;
-      cleanup:
-	apol_vector_destroy(&src_nodes);
-	apol_vector_destroy(&tgt_nodes);
-	return retval;
+	return 0;
+}
+
+/**
+ * Look up how information flows through one permission of a class,
+ * remembering the answer within the builder.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_graph_lookup_perm(const apol_policy_t * p, apol_infoflow_builder_t * b, uint32_t class_val,
+					   size_t bit)
+{
+	const char *const *perm_names;
+	size_t i = (class_val - 1) * APOL_QUERY_MAX_PERMS + bit;
+	int perm_map, perm_weight, len;
+
+	if ((perm_names = apol_query_get_perm_names(p, class_val)) == NULL) {
+		return -1;
+	}
+	if (perm_names[bit] == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (apol_policy_get_permmap(p, b->class_names[class_val - 1], perm_names[bit], &perm_map, &perm_weight) < 0) {
+		return -1;
+	}
+	b->perms_known[class_val - 1] |= (1U << bit);
+	b->read_len[i] = b->write_len[i] = INT_MAX;
+	if (perm_map == APOL_PERMMAP_UNMAPPED) {
+		b->perms_unmapped[class_val - 1] |= (1U << bit);
+		return 0;
+	}
+	len = APOL_PERMMAP_MAX_WEIGHT - perm_weight + 1;
+	if (len < APOL_PERMMAP_MIN_WEIGHT) {
+		len = APOL_PERMMAP_MIN_WEIGHT;
+	} else if (len > APOL_PERMMAP_MAX_WEIGHT) {
+		len = APOL_PERMMAP_MAX_WEIGHT;
+	}
+	if (perm_map & APOL_PERMMAP_READ) {
+		b->read_len[i] = len;
+	}
+	if (perm_map & APOL_PERMMAP_WRITE) {
+		b->write_len[i] = len;
+	}
+	return 0;
 }
 
 /**
- * Given a policy and a partially completed infoflow graph, create the
- * nodes and edges associated with a particular rule.
+ * Given a policy and a partially completed infoflow graph, record
+ * the flows of a particular rule.
  *
  * @param p Policy from which to create the infoflow graph.
- * @param g Infoflow graph being created.
+ * @param b Infoflow graph being created.
  * @param rule AV rule to add.
- * @param types BST of qpol_type_t pointers; while adding avrules to
- * the graph, only add those whose source and/or target is a member of
- * \a types, if \a types is non-NULL.
- * @param max_len Maximum permission length (i.e., inverse of
- * permission weight) to consider when deciding to add this rule or
- * not.
  *
  * @return 0 on success, < 0 on error.
  */
-static int apol_infoflow_graph_create_avrule(const apol_policy_t * p, apol_infoflow_graph_t * g, const qpol_avrule_t * rule,
-					     apol_bst_t * types, int max_len)
+static int apol_infoflow_graph_create_avrule(const apol_policy_t * p, apol_infoflow_builder_t * b, const qpol_avrule_t * rule)
 {
-	const qpol_class_t *obj_class;
-	qpol_iterator_t *perm_iter = NULL;
-	const char *obj_class_name;
-	char *perm_name;
-	int found_read = 0, found_write = 0, perm_error = 0;
+	uint32_t class_val, perms;
+	size_t bit, i;
+	int found_read = 0, found_write = 0;
 	int read_len = INT_MAX, write_len = INT_MAX;
-	int retval = -1;
-	if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 ||
-	    qpol_class_get_name(p->p, obj_class, &obj_class_name) < 0 || qpol_avrule_get_perm_iter(p->p, rule, &perm_iter) < 0) {
-		goto cleanup;
-	}
 
-	/* find read or write flows for each object class/perm pair */
-	for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
-		int perm_map, perm_weight, len;
+	if (qpol_avrule_get_perm_mask(p->p, rule, &class_val, &perms) < 0) {
+		return -1;
+	}
+	if (class_val < 1 || class_val > b->num_classes) {
+		ERR(p, "%s", strerror(ERANGE));
+		errno = ERANGE;
+		return -1;
+	}
+	if (b->perms_required != NULL && (perms & b->perms_required[class_val - 1]) == 0) {
+		return 0;
+	}
 
-		if (qpol_iterator_get_item(perm_iter, (void **)&perm_name) < 0) {
-			goto cleanup;
+	/* find read or write flows for each permission */
+	for (bit = 0; bit < APOL_QUERY_MAX_PERMS; bit++) {
+		if (!(perms & (1U << bit))) {
+			continue;
 		}
-		if (apol_policy_get_permmap(p, obj_class_name, perm_name, &perm_map, &perm_weight) < 0) {
-			goto cleanup;
+		if (!(b->perms_known[class_val - 1] & (1U << bit)) && apol_infoflow_graph_lookup_perm(p, b, class_val, bit) < 0) {
+			return -1;
 		}
-		free(perm_name);
-		if (perm_map == APOL_PERMMAP_UNMAPPED) {
-			perm_error = 1;
+		if (b->perms_unmapped[class_val - 1] & (1U << bit)) {
+			b->perm_error = 1;
 			continue;
 		}
-		len = APOL_PERMMAP_MAX_WEIGHT - perm_weight + 1;
-		if (len < APOL_PERMMAP_MIN_WEIGHT) {
-			len = APOL_PERMMAP_MIN_WEIGHT;
-		} else if (len > APOL_PERMMAP_MAX_WEIGHT) {
-			len = APOL_PERMMAP_MAX_WEIGHT;
+		i = (class_val - 1) * APOL_QUERY_MAX_PERMS + bit;
+		if (b->read_len[i] < read_len && b->read_len[i] <= b->max_len) {
+			found_read = 1;
+			read_len = b->read_len[i];
 		}
-		if (perm_map & APOL_PERMMAP_READ) {
-			if (len < read_len && len <= max_len) {
-				found_read = 1;
-				read_len = len;
-			}
-		}
-		if (perm_map & APOL_PERMMAP_WRITE) {
-			if (len < write_len && len <= max_len) {
-				found_write = 1;
-				write_len = len;
-			}
+		if (b->write_len[i] < write_len && b->write_len[i] <= b->max_len) {
+			found_write = 1;
+			write_len = b->write_len[i];
 		}
 	}
 
 	/* if we have found any flows then connect them within the graph */
 	if ((found_read || found_write) &&
-	    apol_infoflow_graph_connect_nodes(p, g, rule, types, found_read, read_len, found_write, write_len) < 0) {
-		goto cleanup;
-	}
-	if (perm_error) {
-		WARN(p, "%s", "Not all of the permissions found had associated permission maps.");
+	    apol_infoflow_graph_connect_nodes(p, b, rule, found_read, read_len, found_write, write_len) < 0) {
+		return -1;
 	}
-
-	retval = 0;
-      cleanup:
-	qpol_iterator_destroy(&perm_iter);
-	return retval;
+	return 0;
 }
 
 /**
- * Given a vector of strings representing types, return a BST of
- * qpol_type_t pointers consisting of those types, those types'
- * attributes, and those types' aliases.
+ * Given a vector of strings representing types, return a table of
+ * the values of those types and those types' attributes.
  *
  * @param p Policy within which to look up types,
  * @param v Vector of type strings.
+ * @param num_type_values Largest type value within the policy.
  *
- * @return BST of qpol_type_t pointers, or NULL on error.  The caller
- * is responsible for calling apol_bst_destroy() upon the returned
- * value.
+ * @return Array of num_type_values + 1 flags, non-zero for each
+ * value in the set, or NULL on error.  The caller is responsible for
+ * calling free() upon the returned value.
  */
-static apol_bst_t *apol_infoflow_graph_create_required_types(const apol_policy_t * p, const apol_vector_t * v)
+static unsigned char *apol_infoflow_graph_create_required_types(const apol_policy_t * p, const apol_vector_t * v,
+								uint32_t num_type_values)
 {
-	apol_bst_t *types = NULL;
+	unsigned char *types = NULL;
 	apol_vector_t *expanded_types = NULL;
-	size_t i;
+	uint32_t value;
+	size_t i, j;
 	char *s;
 	int retval = -1;
-	if ((types = apol_bst_create(NULL, NULL)) == NULL) {
+	if ((types = calloc(num_type_values + 1, 1)) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
@@ -642,12 +750,14 @@ static apol_bst_t *apol_infoflow_graph_create_required_types(const apol_policy_t
 		if (expanded_types == NULL) {
 			goto cleanup;
 		}
-		for (size_t j = 0; j < apol_vector_get_size(expanded_types); j++) {
+		for (j = 0; j < apol_vector_get_size(expanded_types); j++) {
 			qpol_type_t *t = (qpol_type_t *) apol_vector_get_element(expanded_types, j);
-			if (apol_bst_insert(types, t, NULL) < 0) {
-				ERR(p, "%s", strerror(errno));
+			if (qpol_type_get_value(p->p, t, &value) < 0) {
 				goto cleanup;
 			}
+			if (value <= num_type_values) {
+				types[value] = 1;
+			}
 		}
 		apol_vector_destroy(&expanded_types);
 	}
@@ -655,245 +765,1046 @@ static apol_bst_t *apol_infoflow_graph_create_required_types(const apol_policy_t
       cleanup:
 	apol_vector_destroy(&expanded_types);
 	if (retval != 0) {
-		apol_bst_destroy(&types);
+		free(types);
+		types = NULL;
 	}
 	return types;
 }
 
 /**
- * Determine if an av rule matches a list of qpol_type_t pointers.
- * Both the source and target of the rule must be in the list.
+ * Determine if an av rule's source and target are both allowed
+ * within the graph.
  *
  * @param p Policy to which look up classes and permissions.
+ * @param b Graph being built.
  * @param rule AV rule to check.
- * @param types BST of qpol_type_t, of which both the source and
- * target types must be members.  If NULL allow all types.
  *
  * @return 1 if rule matches, 0 if not, < 0 on error.
  */
-static int apol_infoflow_graph_check_types(const apol_policy_t * p, const qpol_avrule_t * rule, const apol_bst_t * types)
+static int apol_infoflow_graph_check_types(const apol_policy_t * p, const apol_infoflow_builder_t * b,
+					   const qpol_avrule_t * rule)
 {
 	const qpol_type_t *source, *target;
-	void *result;
-	int retval = -1;
-	if (types == NULL) {
-		retval = 1;
-		goto cleanup;
+	uint32_t source_value, target_value;
+	if (b->allowed_types == NULL) {
+		return 1;
 	}
-	if (qpol_avrule_get_source_type(p->p, rule, &source) < 0 || qpol_avrule_get_target_type(p->p, rule, &target) < 0) {
-		goto cleanup;
+	if (qpol_avrule_get_source_type(p->p, rule, &source) < 0 || qpol_avrule_get_target_type(p->p, rule, &target) < 0 ||
+	    qpol_type_get_value(p->p, source, &source_value) < 0 || qpol_type_get_value(p->p, target, &target_value) < 0) {
+		return -1;
 	}
-	if (apol_bst_get_element(types, source, NULL, &result) < 0 || apol_bst_get_element(types, target, NULL, &result) < 0) {
-		retval = 0;
-		goto cleanup;
+	if (source_value > b->num_type_values || !b->allowed_types[source_value] ||
+	    target_value > b->num_type_values || !b->allowed_types[target_value]) {
+		return 0;
 	}
-	retval = 1;
-      cleanup:
-	return retval;
+	return 1;
 }
 
 /**
- * Determine if an av rule matches a list of apol_obj_perm_t.  The
- * rule's class must match at least one item in the list, and at least
- * one of the rule's permissions must be on the list.
+ * Convert a vector of apol_obj_perm_t into the permissions that a
+ * rule of each class must have one of.  Rules of classes not in the
+ * vector are not allowed at all.
  *
  * @param p Policy to which look up classes and permissions.
- * @param rule AV rule to check.
- * @param class_perms Vector of apol_obj_perm_t, of which rule's class
- * and permissions must be a member.  If NULL or empty then allow all
- * classes and permissions.
+ * @param b Graph being built.
+ * @param class_perms Vector of apol_obj_perm_t.
  *
- * @return 1 if rule matches, 0 if not, < 0 on error.
+ * @return 0 on success, < 0 on error.
  */
-static int apol_infoflow_graph_check_class_perms(const apol_policy_t * p, const qpol_avrule_t * rule,
-						 const apol_vector_t * class_perms)
+static int apol_infoflow_graph_create_required_perms(const apol_policy_t * p, apol_infoflow_builder_t * b,
+						     const apol_vector_t * class_perms)
 {
 	const qpol_class_t *obj_class;
-	const char *obj_name;
-	char *perm;
-	qpol_iterator_t *iter = NULL;
-	apol_obj_perm_t *obj_perm = NULL;
-	apol_vector_t *obj_perm_v = NULL;
-	size_t i;
+	apol_obj_perm_t *obj_perm;
+	apol_vector_t *perm_v;
+	const char **names = NULL;
+	uint32_t class_val, mask;
+	size_t i, j;
 	int retval = -1;
 
-	if (class_perms == NULL || apol_vector_get_size(class_perms) == 0) {
-		retval = 1;
-		goto cleanup;
-	}
-	if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 || qpol_class_get_name(p->p, obj_class, &obj_name) < 0) {
+	if ((b->perms_required = calloc(b->num_classes, sizeof(*b->perms_required))) == NULL) {
+		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
 	for (i = 0; i < apol_vector_get_size(class_perms); i++) {
 		obj_perm = (apol_obj_perm_t *) apol_vector_get_element(class_perms, i);
-		if (strcmp(apol_obj_perm_get_obj_name(obj_perm), obj_name) == 0) {
-			obj_perm_v = apol_obj_perm_get_perm_vector(obj_perm);
-			break;
+		if (qpol_policy_get_class_by_name(p->p, apol_obj_perm_get_obj_name(obj_perm), &obj_class) < 0) {
+			/* a class not in this policy matches no rules */
+			continue;
 		}
-	}
-	if (i >= apol_vector_get_size(class_perms)) {
-		retval = 0;	       /* no matching class */
-		goto cleanup;
-	}
-	if (qpol_avrule_get_perm_iter(p->p, rule, &iter) < 0) {
-		goto cleanup;
-	}
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		if (qpol_iterator_get_item(iter, (void **)&perm) < 0) {
+		perm_v = apol_obj_perm_get_perm_vector(obj_perm);
+		free(names);
+		if ((names = malloc((apol_vector_get_size(perm_v) + 1) * sizeof(*names))) == NULL) {
+			ERR(p, "%s", strerror(errno));
 			goto cleanup;
 		}
-		if (apol_vector_get_index(obj_perm_v, perm, apol_str_strcmp, NULL, &i) == 0) {
-			free(perm);
-			retval = 1;
+		for (j = 0; j < apol_vector_get_size(perm_v); j++) {
+			names[j] = apol_vector_get_element(perm_v, j);
+		}
+		if (qpol_class_get_value(p->p, obj_class, &class_val) < 0 ||
+		    qpol_class_get_perm_mask(p->p, obj_class, names, apol_vector_get_size(perm_v), &mask) < 0) {
 			goto cleanup;
 		}
-		free(perm);
+		if (class_val >= 1 && class_val <= b->num_classes) {
+			b->perms_required[class_val - 1] |= mask;
+		}
 	}
-	retval = 0;		       /* no matching perm */
+	retval = 0;
       cleanup:
-	qpol_iterator_destroy(&iter);
+	free(names);
 	return retval;
 }
 
 /**
- * Given a particular information flow analysis object, generate an
- * infoflow graph relative to a particular policy.  This graph is
- * customized for the particular analysis.
- *
- * @param p Policy from which to create the infoflow graph.
- * @param ia Parameters to tune the created graph.
- * @param g Reference to where to store the graph.  The caller is
- * responsible for calling apol_infoflow_graph_destroy() upon this.
+ * Allocate the tables used while building a graph.
  *
- * @return 0 if the graph was created, < 0 on error.  Upon error *g
- * will be set to NULL.
+ * @return 0 on success, < 0 on error.
  */
-static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infoflow_analysis_t * ia, apol_infoflow_graph_t ** g)
+static int apol_infoflow_builder_init(const apol_policy_t * p, const apol_infoflow_analysis_t * ia, apol_infoflow_builder_t * b)
 {
-	apol_bst_t *types = NULL;
 	qpol_iterator_t *iter = NULL;
-	int max_len = APOL_PERMMAP_MAX_WEIGHT - ia->min_weight + 1;
-	int compval, retval = -1;
-
-	*g = NULL;
-	if (p->pmap == NULL) {
-		ERR(p, "%s", "A permission map must be loaded prior to building the infoflow graph.");
-		goto cleanup;
+	const qpol_type_t *type;
+	const qpol_class_t *obj_class;
+	const char *class_name;
+	uint32_t value;
+	size_t i;
+	int error = 0;
+
+	memset(b, 0, sizeof(*b));
+	b->max_len = APOL_PERMMAP_MAX_WEIGHT - ia->min_weight + 1;
+	if ((b->csr = calloc(1, sizeof(*b->csr))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	if ((error = pthread_mutex_init(&b->csr->refcount_lock, NULL)) != 0) {
+		free(b->csr);
+		b->csr = NULL;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	b->csr->refcount = 1;
+	b->csr->mode = ia->mode;
+	b->csr->min_weight = ia->min_weight;
+	b->csr->policy_generation = qpol_policy_get_generation(p->p);
+	b->csr->permmap_generation = p->permmap_generation;
+
+	if (qpol_policy_get_type_iter(p->p, &iter) < 0) {
+		error = errno;
+		goto err;
 	}
-
-	INFO(p, "%s", "Generating information flow graph.");
-	if (ia->mode == APOL_INFOFLOW_MODE_TRANS && ia->intermed != NULL &&
-	    (types = apol_infoflow_graph_create_required_types(p, ia->intermed)) == NULL) {
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&type) < 0 || qpol_type_get_value(p->p, type, &value) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (value > b->num_type_values) {
+			b->num_type_values = value;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	b->num_node_slots = 2 * ((size_t) b->num_type_values + 1);
+	if ((b->node_of = malloc(b->num_node_slots * sizeof(*b->node_of))) == NULL ||
+	    (b->csr->nodes = malloc(b->num_node_slots * sizeof(*b->csr->nodes))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	for (i = 0; i < b->num_node_slots; i++) {
+		b->node_of[i] = APOL_INFOFLOW_NONE;
+	}
+
+	if (qpol_policy_get_class_iter(p->p, &iter) < 0 || qpol_iterator_get_size(iter, &b->num_classes) < 0) {
+		error = errno;
+		goto err;
+	}
+	if ((b->class_names = calloc(b->num_classes + 1, sizeof(*b->class_names))) == NULL ||
+	    (b->read_len = malloc((b->num_classes + 1) * APOL_QUERY_MAX_PERMS * sizeof(*b->read_len))) == NULL ||
+	    (b->write_len = malloc((b->num_classes + 1) * APOL_QUERY_MAX_PERMS * sizeof(*b->write_len))) == NULL ||
+	    (b->perms_known = calloc(b->num_classes + 1, sizeof(*b->perms_known))) == NULL ||
+	    (b->perms_unmapped = calloc(b->num_classes + 1, sizeof(*b->perms_unmapped))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&obj_class) < 0 ||
+		    qpol_class_get_value(p->p, obj_class, &value) < 0 || qpol_class_get_name(p->p, obj_class, &class_name) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (value >= 1 && value <= b->num_classes) {
+			b->class_names[value - 1] = class_name;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+
+	if (ia->mode == APOL_INFOFLOW_MODE_TRANS && ia->intermed != NULL &&
+	    (b->allowed_types = apol_infoflow_graph_create_required_types(p, ia->intermed, b->num_type_values)) == NULL) {
+		error = errno;
+		goto err;
+	}
+	if (ia->class_perms != NULL && apol_vector_get_size(ia->class_perms) > 0 &&
+	    apol_infoflow_graph_create_required_perms(p, b, ia->class_perms) < 0) {
+		error = errno;
+		goto err;
+	}
+	return 0;
+      err:
+	qpol_iterator_destroy(&iter);
+	errno = error;
+	return -1;
+}
+
+/**
+ * Renumber the graph's nodes so that they are ordered by type value
+ * and then node type, rather than by when each was first found.
+ * This keeps the order of results independent of the order of rules.
+ *
+ * @param p Policy handler, for reporting errors.
+ * @param b Graph being built.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_graph_sort_nodes(const apol_policy_t * p, apol_infoflow_builder_t * b)
+{
+	apol_infoflow_csr_t *csr = b->csr;
+	apol_infoflow_node_t *nodes = NULL;
+	size_t *new_id = NULL, i, n;
+	int retval = -1;
+
+	if ((nodes = malloc((csr->num_nodes + 1) * sizeof(*nodes))) == NULL ||
+	    (new_id = malloc((csr->num_nodes + 1) * sizeof(*new_id))) == NULL) {
+		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
+	for (i = 0, n = 0; i < b->num_node_slots; i++) {
+		if (b->node_of[i] != APOL_INFOFLOW_NONE) {
+			nodes[n] = csr->nodes[b->node_of[i]];
+			new_id[b->node_of[i]] = n;
+			b->node_of[i] = n++;
+		}
+	}
+	for (i = 0; i < b->num_flows; i++) {
+		b->flows[i].start_node = new_id[b->flows[i].start_node];
+		b->flows[i].end_node = new_id[b->flows[i].end_node];
+	}
+	free(csr->nodes);
+	csr->nodes = nodes;
+	nodes = NULL;
+	retval = 0;
+      cleanup:
+	free(nodes);
+	free(new_id);
+	return retval;
+}
 
-	if ((*g = calloc(1, sizeof(**g))) == NULL ||
-	    ((*g)->nodes_bst = apol_bst_create(apol_infoflow_node_compare, apol_infoflow_node_free)) == NULL) {
+/**
+ * Gather the recorded flows into the graph's edges.  Flows between
+ * the same two nodes become one edge whose length is the greatest of
+ * theirs and whose rules are all of theirs, in the order found.
+ *
+ * @param p Policy handler, for reporting errors.
+ * @param b Graph being built.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_graph_create_edges(const apol_policy_t * p, apol_infoflow_builder_t * b)
+{
+	apol_infoflow_csr_t *csr = b->csr;
+	apol_infoflow_flow_t *sorted = NULL, *f, *first, *end;
+	size_t *edge_of_end = NULL, *fill = NULL, n, i, e;
+	int retval = -1;
+
+	if ((csr->out_start = calloc(csr->num_nodes + 1, sizeof(*csr->out_start))) == NULL ||
+	    (csr->in_start = calloc(csr->num_nodes + 1, sizeof(*csr->in_start))) == NULL ||
+	    (edge_of_end = malloc((csr->num_nodes + 1) * sizeof(*edge_of_end))) == NULL ||
+	    (fill = malloc((csr->num_nodes + 1) * sizeof(*fill))) == NULL ||
+	    (sorted = malloc((b->num_flows + 1) * sizeof(*sorted))) == NULL ||
+	    (csr->edges = malloc((b->num_flows + 1) * sizeof(*csr->edges))) == NULL ||
+	    (csr->rules = malloc((b->num_flows + 1) * sizeof(*csr->rules))) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
-	(*g)->mode = ia->mode;
-	(*g)->direction = ia->direction;
-	if (ia->result != NULL && ia->result[0] != '\0') {
-		if (((*g)->regex = malloc(sizeof(regex_t))) == NULL || regcomp((*g)->regex, ia->result, REG_EXTENDED | REG_NOSUB)) {
-			ERR(p, "%s", strerror(errno));
-			goto cleanup;
+
+	/* stable counting sort of the flows by start node; fill[n]
+	 * ends up as the offset of node n's first flow */
+	memset(fill, 0, (csr->num_nodes + 1) * sizeof(*fill));
+	for (i = 0; i < b->num_flows; i++) {
+		fill[b->flows[i].start_node]++;
+	}
+	for (n = 0, i = 0; n <= csr->num_nodes; n++) {
+		e = fill[n];
+		fill[n] = i;
+		i += e;
+	}
+	for (i = 0; i < b->num_flows; i++) {
+		sorted[fill[b->flows[i].start_node]++] = b->flows[i];
+	}
+	free(b->flows);
+	b->flows = sorted;
+	sorted = NULL;
+
+	/* within each start node, flows to the same end node form one
+	 * edge; edges are thus numbered in order of start node */
+	for (n = 0; n < csr->num_nodes; n++) {
+		edge_of_end[n] = APOL_INFOFLOW_NONE;
+	}
+	first = b->flows;
+	for (n = 0; n < csr->num_nodes; n++) {
+		csr->out_start[n] = csr->num_edges;
+		for (end = first; end < b->flows + b->num_flows && end->start_node == n; end++) {
+			if ((e = edge_of_end[end->end_node]) == APOL_INFOFLOW_NONE) {
+				e = edge_of_end[end->end_node] = csr->num_edges++;
+				csr->edges[e].start_node = n;
+				csr->edges[e].end_node = end->end_node;
+				csr->edges[e].num_rules = 0;
+				csr->edges[e].length = end->length;
+			} else if (csr->edges[e].length < end->length) {
+				csr->edges[e].length = end->length;
+			}
+			csr->edges[e].num_rules++;
+			end->edge = e;
+		}
+		for (f = first; f < end; f++) {
+			edge_of_end[f->end_node] = APOL_INFOFLOW_NONE;
 		}
+		first = end;
 	}
-	if (((*g)->edges = apol_vector_create(apol_infoflow_edge_free)) == NULL) {
+	csr->out_start[csr->num_nodes] = csr->num_edges;
+
+	/* lay out each edge's rules contiguously, keeping the order
+	 * in which they were found */
+	for (e = 0, i = 0; e < csr->num_edges; e++) {
+		csr->edges[e].first_rule = i;
+		i += csr->edges[e].num_rules;
+		csr->edges[e].num_rules = 0;
+	}
+	for (i = 0; i < b->num_flows; i++) {
+		apol_infoflow_edge_t *edge = csr->edges + b->flows[i].edge;
+		csr->rules[edge->first_rule + edge->num_rules++] = b->flows[i].rule;
+	}
+
+	/* edges entering each node */
+	if ((csr->in_edges = malloc((csr->num_edges + 1) * sizeof(*csr->in_edges))) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
+	memset(fill, 0, (csr->num_nodes + 1) * sizeof(*fill));
+	for (e = 0; e < csr->num_edges; e++) {
+		fill[csr->edges[e].end_node]++;
+	}
+	for (n = 0, i = 0; n <= csr->num_nodes; n++) {
+		csr->in_start[n] = i;
+		i += fill[n];
+		fill[n] = csr->in_start[n];
+	}
+	for (e = 0; e < csr->num_edges; e++) {
+		csr->in_edges[fill[csr->edges[e].end_node]++] = e;
+	}
+	retval = 0;
+      cleanup:
+	free(sorted);
+	free(edge_of_end);
+	free(fill);
+	return retval;
+}
+
+/**
+ * Group the allow rules of a graph being built by their classes.
+ *
+ * @param p Policy handler, for reporting errors.
+ * @param b Graph being built.  Every allow rule must be within its
+ * graph's all_rules array.
+ * @param rule_classes Class value of each rule within all_rules.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_graph_group_rules(const apol_policy_t * p, apol_infoflow_builder_t * b, const uint32_t * rule_classes)
+{
+	apol_infoflow_csr_t *csr = b->csr;
+	size_t *fill = NULL, c, i;
+
+	if ((csr->class_start = calloc(b->num_classes + 1, sizeof(*csr->class_start))) == NULL ||
+	    (csr->class_rules = malloc((csr->num_all_rules + 1) * sizeof(*csr->class_rules))) == NULL ||
+	    (fill = malloc((b->num_classes + 1) * sizeof(*fill))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	/* counting sort of the rules by class, keeping their order
+	 * within each class; class_start[c] is the offset after the
+	 * rules of class value c */
+	for (i = 0; i < csr->num_all_rules; i++) {
+		csr->class_start[rule_classes[i]]++;
+	}
+	for (c = 1; c <= b->num_classes; c++) {
+		csr->class_start[c] += csr->class_start[c - 1];
+	}
+	memcpy(fill, csr->class_start, (b->num_classes + 1) * sizeof(*fill));
+	for (i = csr->num_all_rules; i > 0; i--) {
+		csr->class_rules[--fill[rule_classes[i - 1]]] = i - 1;
+	}
+	csr->num_classes = b->num_classes;
+	free(fill);
+	return 0;
+}
+
+/**
+ * Keep within a graph being built its flows and the permission
+ * lengths looked up, for apol_infoflow_csr_derive().  This must be
+ * called after the nodes are sorted but before the edges are created.
+ *
+ * @param p Policy handler, for reporting errors.
+ * @param b Graph being built.  Its tables of permission lengths are
+ * handed over to the graph.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_graph_keep_flows(const apol_policy_t * p, apol_infoflow_builder_t * b)
+{
+	apol_infoflow_csr_t *csr = b->csr;
+	if ((csr->flows = malloc((b->num_flows + 1) * sizeof(*csr->flows))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	memcpy(csr->flows, b->flows, b->num_flows * sizeof(*csr->flows));
+	csr->num_flows = b->num_flows;
+	csr->read_len = b->read_len;
+	csr->write_len = b->write_len;
+	csr->perms_known = b->perms_known;
+	csr->perms_unmapped = b->perms_unmapped;
+	b->read_len = b->write_len = NULL;
+	b->perms_known = b->perms_unmapped = NULL;
+	return 0;
+}
 
+/**
+ * Build a compressed infoflow graph for a particular analysis,
+ * relative to a particular policy.
+ *
+ * @param p Policy from which to create the infoflow graph.
+ * @param ia Parameters to tune the created graph.
+ * @param keep If non-zero, keep within the graph what
+ * apol_infoflow_csr_derive() needs.  The analysis must then not limit
+ * intermediate types or permissions.
+ * @param csr Reference to where to store the graph.  The caller is
+ * responsible for calling apol_infoflow_csr_unref() upon this.
+ *
+ * @return 0 if the graph was created, < 0 on error.
+ */
+static int apol_infoflow_csr_create(const apol_policy_t * p, const apol_infoflow_analysis_t * ia, int keep,
+				    apol_infoflow_csr_t ** csr)
+{
+	apol_infoflow_builder_t b;
+	qpol_iterator_t *iter = NULL;
+	const qpol_avrule_t *rule;
+	uint32_t *rule_classes = NULL, perms;
+	size_t num_rules;
+	int compval, retval = -1;
+
+	*csr = NULL;
+	INFO(p, "%s", "Generating information flow graph.");
+	if (apol_infoflow_builder_init(p, ia, &b) < 0) {
+		goto cleanup;
+	}
 	if (qpol_policy_get_avrule_iter(p->p, QPOL_RULE_ALLOW, &iter) < 0) {
 		goto cleanup;
 	}
-
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		qpol_avrule_t *rule;
+	if (keep) {
+		if (qpol_iterator_get_size(iter, &num_rules) < 0) {
+			goto cleanup;
+		}
+		if ((b.csr->all_rules = malloc((num_rules + 1) * sizeof(*b.csr->all_rules))) == NULL ||
+		    (rule_classes = malloc((num_rules + 1) * sizeof(*rule_classes))) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter), b.rule_index++) {
 		if (qpol_iterator_get_item(iter, (void **)&rule) < 0) {
 			goto cleanup;
 		}
-		compval = apol_infoflow_graph_check_types(p, rule, types);
+		if (keep) {
+			if (b.rule_index >= num_rules || qpol_avrule_get_perm_mask(p->p, rule, &rule_classes[b.rule_index], &perms) < 0) {
+				ERR(p, "%s", strerror(ERANGE));
+				errno = ERANGE;
+				goto cleanup;
+			}
+			if (rule_classes[b.rule_index] < 1 || rule_classes[b.rule_index] > b.num_classes) {
+				ERR(p, "%s", strerror(ERANGE));
+				errno = ERANGE;
+				goto cleanup;
+			}
+			b.csr->all_rules[b.csr->num_all_rules++] = rule;
+		}
+		compval = apol_infoflow_graph_check_types(p, &b, rule);
 		if (compval < 0) {
 			goto cleanup;
 		} else if (compval == 0) {
 			continue;
 		}
-		compval = apol_infoflow_graph_check_class_perms(p, rule, ia->class_perms);
-		if (compval < 0) {
+		if (apol_infoflow_graph_create_avrule(p, &b, rule) < 0) {
 			goto cleanup;
-		} else if (compval == 0) {
+		}
+	}
+	if (b.perm_error) {
+		WARN(p, "%s", "Not all of the permissions found had associated permission maps.");
+	}
+	if (apol_infoflow_graph_sort_nodes(p, &b) < 0 ||
+	    (keep && (apol_infoflow_graph_group_rules(p, &b, rule_classes) < 0 || apol_infoflow_graph_keep_flows(p, &b) < 0)) ||
+	    apol_infoflow_graph_create_edges(p, &b) < 0) {
+		goto cleanup;
+	}
+	*csr = b.csr;
+	b.csr = NULL;
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	free(rule_classes);
+	apol_infoflow_builder_destroy(&b);
+	return retval;
+}
+
+/**
+ * Build a compressed infoflow graph for an analysis from one kept
+ * within the policy's cache, rather than from the policy's rules.
+ * The flows of rules that have a permission whose flow has changed
+ * within the permission map since the cached graph was built are
+ * found again.  All other flows are copied, less those that the
+ * analysis's minimum weight or permissions exclude.  Because flows
+ * keep the order of their rules, the graph is the same as one from
+ * apol_infoflow_csr_create().
+ *
+ * @param p Policy from which to create the infoflow graph.
+ * @param base Graph from the policy's cache, built from the same
+ * policy and for the same mode, with a minimum weight no greater than
+ * the analysis's.
+ * @param ia Parameters to tune the created graph.  These may not
+ * limit intermediate types.
+ * @param keep If non-zero, keep within the graph what this function
+ * needs, so that it may replace base within the cache.  The analysis
+ * must then not limit permissions.
+ * @param csr Reference to where to store the graph.  The caller is
+ * responsible for calling apol_infoflow_csr_unref() upon this.
+ *
+ * @return 0 if the graph was created, < 0 on error.
+ */
+static int apol_infoflow_csr_derive(const apol_policy_t * p, const apol_infoflow_csr_t * base,
+				    const apol_infoflow_analysis_t * ia, int keep, apol_infoflow_csr_t ** csr)
+{
+	apol_infoflow_builder_t b;
+	const apol_infoflow_flow_t *f;
+	const qpol_avrule_t *rule = NULL;
+	uint32_t *changed = NULL, class_val = 0, perms = 0;
+	unsigned char *redo = NULL;
+	size_t *node_map = NULL, num_changed = 0, next_redo, last, start_node, end_node, c, i, k, bit;
+	int retval = -1;
+
+	*csr = NULL;
+	if (apol_infoflow_builder_init(p, ia, &b) < 0) {
+		goto cleanup;
+	}
+	if (b.num_classes != base->num_classes) {
+		ERR(p, "%s", strerror(ERANGE));
+		errno = ERANGE;
+		goto cleanup;
+	}
+	if ((changed = calloc(b.num_classes + 1, sizeof(*changed))) == NULL ||
+	    (redo = calloc(base->num_all_rules + 1, 1)) == NULL ||
+	    (node_map = malloc((base->num_nodes + 1) * sizeof(*node_map))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < base->num_nodes; i++) {
+		node_map[i] = APOL_INFOFLOW_NONE;
+	}
+
+	/* find the permissions whose flows have changed; those that
+	 * no rule has were never looked up, and do not matter */
+	if (keep || base->permmap_generation != p->permmap_generation) {
+		for (c = 0; c < b.num_classes; c++) {
+			for (bit = 0; bit < APOL_QUERY_MAX_PERMS; bit++) {
+				if (!(base->perms_known[c] & (1U << bit))) {
+					continue;
+				}
+				if (apol_infoflow_graph_lookup_perm(p, &b, c + 1, bit) < 0) {
+					goto cleanup;
+				}
+				k = c * APOL_QUERY_MAX_PERMS + bit;
+				if (b.read_len[k] != base->read_len[k] || b.write_len[k] != base->write_len[k]) {
+					changed[c] |= (1U << bit);
+					num_changed++;
+				}
+				if (b.perms_unmapped[c] & (1U << bit)) {
+					b.perm_error = 1;
+				}
+			}
+			for (i = base->class_start[c]; changed[c] != 0 && i < base->class_start[c + 1]; i++) {
+				k = base->class_rules[i];
+				if (qpol_avrule_get_perm_mask(p->p, base->all_rules[k], &class_val, &perms) < 0) {
+					goto cleanup;
+				}
+				if (perms & changed[c]) {
+					redo[k] = 1;
+				}
+			}
+		}
+	}
+
+	/* merge the flows found again with those copied, in order of
+	 * their rules */
+	next_redo = (num_changed > 0 ? 0 : base->num_all_rules);
+	for (i = 0; i <= base->num_flows; i++) {
+		last = (i < base->num_flows ? base->flows[i].rule_index : base->num_all_rules);
+		for (; next_redo < last; next_redo++) {
+			if (redo[next_redo]) {
+				b.rule_index = next_redo;
+				if (apol_infoflow_graph_create_avrule(p, &b, base->all_rules[next_redo]) < 0) {
+					goto cleanup;
+				}
+			}
+		}
+		if (i == base->num_flows) {
+			break;
+		}
+		f = base->flows + i;
+		if (redo[f->rule_index] || f->length > b.max_len) {
 			continue;
 		}
-		if (apol_infoflow_graph_create_avrule(p, *g, rule, types, max_len) < 0) {
+		if (b.perms_required != NULL) {
+			if (f->rule != rule) {
+				rule = f->rule;
+				if (qpol_avrule_get_perm_mask(p->p, rule, &class_val, &perms) < 0) {
+					goto cleanup;
+				}
+			}
+			if (class_val < 1 || class_val > b.num_classes || (perms & b.perms_required[class_val - 1]) == 0) {
+				continue;
+			}
+		}
+		if ((start_node = node_map[f->start_node]) == APOL_INFOFLOW_NONE &&
+		    (start_node = node_map[f->start_node] =
+		     apol_infoflow_graph_create_node(p, &b, base->nodes[f->start_node].type,
+						     base->nodes[f->start_node].node_type)) == APOL_INFOFLOW_NONE) {
 			goto cleanup;
 		}
+		if ((end_node = node_map[f->end_node]) == APOL_INFOFLOW_NONE &&
+		    (end_node = node_map[f->end_node] =
+		     apol_infoflow_graph_create_node(p, &b, base->nodes[f->end_node].type,
+						     base->nodes[f->end_node].node_type)) == APOL_INFOFLOW_NONE) {
+			goto cleanup;
+		}
+		b.rule_index = f->rule_index;
+		if (apol_infoflow_graph_add_flow(p, &b, start_node, end_node, f->rule, f->length) < 0) {
+			goto cleanup;
+		}
+	}
+	if (keep && b.perm_error) {
+		WARN(p, "%s", "Not all of the permissions found had associated permission maps.");
+	}
+	if (apol_infoflow_graph_sort_nodes(p, &b) < 0) {
+		goto cleanup;
+	}
+	if (keep) {
+		/* the rules themselves have not changed */
+		if ((b.csr->all_rules = malloc((base->num_all_rules + 1) * sizeof(*b.csr->all_rules))) == NULL ||
+		    (b.csr->class_start = malloc((base->num_classes + 1) * sizeof(*b.csr->class_start))) == NULL ||
+		    (b.csr->class_rules = malloc((base->num_all_rules + 1) * sizeof(*b.csr->class_rules))) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+		memcpy(b.csr->all_rules, base->all_rules, base->num_all_rules * sizeof(*b.csr->all_rules));
+		memcpy(b.csr->class_start, base->class_start, (base->num_classes + 1) * sizeof(*b.csr->class_start));
+		memcpy(b.csr->class_rules, base->class_rules, base->num_all_rules * sizeof(*b.csr->class_rules));
+		b.csr->num_all_rules = base->num_all_rules;
+		b.csr->num_classes = base->num_classes;
+		if (apol_infoflow_graph_keep_flows(p, &b) < 0) {
+			goto cleanup;
+		}
+	}
+	if (apol_infoflow_graph_create_edges(p, &b) < 0) {
+		goto cleanup;
+	}
+	if (keep) {
+		INFO(p, "Updated information flow graph for %zu changed permission(s); it now has %zu edges, previously %zu.",
+		     num_changed, b.csr->num_edges, base->num_edges);
+	}
+	*csr = b.csr;
+	b.csr = NULL;
+	retval = 0;
+      cleanup:
+	free(changed);
+	free(redo);
+	free(node_map);
+	apol_infoflow_builder_destroy(&b);
+	return retval;
+}
+
+/**
+ * Get a compressed infoflow graph for an analysis.  The policy keeps
+ * a graph of every flow for each mode, built the first time one is
+ * needed.  When the permission map changes it is updated by
+ * apol_infoflow_csr_derive(), which only reads again the rules with
+ * permissions whose flows changed.  Analyses that do not limit
+ * anything use the kept graph itself; those that limit the minimum
+ * weight or permissions use a graph derived from it.  Only analyses
+ * that limit intermediate types build their graphs from the policy's
+ * rules.
+ *
+ * @param p Policy from which to create the infoflow graph.
+ * @param ia Parameters to tune the created graph.
+ * @param csr Reference to where to store the graph.  The caller is
+ * responsible for calling apol_infoflow_csr_unref() upon this.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_csr_get(const apol_policy_t * p, const apol_infoflow_analysis_t * ia, apol_infoflow_csr_t ** csr)
+{
+	apol_policy_t *mp = (apol_policy_t *) p;
+	apol_infoflow_analysis_t base_ia;
+	apol_infoflow_csr_t *base = NULL, *c, *old = NULL;
+	size_t slot = (ia->mode == APOL_INFOFLOW_MODE_DIRECT ? 0 : 1);
+	int retval;
+
+	*csr = NULL;
+	if (ia->mode == APOL_INFOFLOW_MODE_TRANS && ia->intermed != NULL) {
+		return apol_infoflow_csr_create(p, ia, 0, csr);
+	}
+	memset(&base_ia, 0, sizeof(base_ia));
+	base_ia.mode = ia->mode;
+
+	if (p->frozen) {
+		pthread_mutex_lock(&mp->infoflow_lock);
+	}
+	c = p->infoflow_graphs[slot];
+	if (c != NULL && c->mode == ia->mode && c->policy_generation == qpol_policy_get_generation(p->p)) {
+		apol_infoflow_csr_ref(c);
+		base = c;
+	}
+	if (p->frozen) {
+		pthread_mutex_unlock(&mp->infoflow_lock);
+	}
+
+	if (base == NULL || base->permmap_generation != p->permmap_generation) {
+		/* build outside of the lock, so that other analyses may
+		 * go on */
+		if (base == NULL) {
+			retval = apol_infoflow_csr_create(p, &base_ia, 1, &c);
+		} else {
+			retval = apol_infoflow_csr_derive(p, base, &base_ia, 1, &c);
+		}
+		apol_infoflow_csr_unref(&base);
+		if (retval < 0) {
+			return -1;
+		}
+		base = c;
+		apol_infoflow_csr_ref(base);
+		if (p->frozen) {
+			pthread_mutex_lock(&mp->infoflow_lock);
+		}
+		old = mp->infoflow_graphs[slot];
+		mp->infoflow_graphs[slot] = base;
+		if (p->frozen) {
+			pthread_mutex_unlock(&mp->infoflow_lock);
+		}
+		apol_infoflow_csr_unref(&old);
+	}
+
+	/* no flow is longer than APOL_PERMMAP_MAX_WEIGHT, so minimum
+	 * weights up to APOL_PERMMAP_MIN_WEIGHT exclude nothing */
+	if (ia->min_weight <= APOL_PERMMAP_MIN_WEIGHT && (ia->class_perms == NULL || apol_vector_get_size(ia->class_perms) == 0)) {
+		*csr = base;
+		return 0;
 	}
+	retval = apol_infoflow_csr_derive(p, base, ia, 0, csr);
+	apol_infoflow_csr_unref(&base);
+	return retval;
+}
+
+/**
+ * Allocate an infoflow graph that searches a compressed graph.  Any
+ * number of these may share one compressed graph, each with its own
+ * search state.
+ *
+ * @param p Policy handler, for reporting errors.
+ * @param ia Parameters of the analysis that will use the graph.
+ * @param csr Compressed graph to search.  The new graph takes its own
+ * reference to it.
+ * @param g Reference to where to store the graph.  The caller is
+ * responsible for calling apol_infoflow_graph_destroy() upon this.
+ *
+ * @return 0 if the graph was created, < 0 on error.  Upon error *g
+ * will be set to NULL.
+ */
+static int apol_infoflow_graph_create_from_csr(const apol_policy_t * p, const apol_infoflow_analysis_t * ia,
+					       apol_infoflow_csr_t * csr, apol_infoflow_graph_t ** g)
+{
+	size_t num_nodes = csr->num_nodes;
+	int retval = -1;
 
-	if (((*g)->nodes = apol_bst_get_vector((*g)->nodes_bst, 1)) == NULL) {
+	if ((*g = calloc(1, sizeof(**g))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	apol_infoflow_csr_ref(csr);
+	(*g)->csr = csr;
+	(*g)->mode = ia->mode;
+	(*g)->direction = ia->direction;
+	if (ia->result != NULL && ia->result[0] != '\0') {
+		if (((*g)->regex = malloc(sizeof(regex_t))) == NULL || regcomp((*g)->regex, ia->result, REG_EXTENDED | REG_NOSUB)) {
+			free((*g)->regex);
+			(*g)->regex = NULL;
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+	}
+	if (((*g)->color = malloc(num_nodes + 1)) == NULL ||
+	    ((*g)->distance = malloc((num_nodes + 1) * sizeof(*(*g)->distance))) == NULL ||
+	    ((*g)->parent = malloc((num_nodes + 1) * sizeof(*(*g)->parent))) == NULL ||
+	    ((*g)->queue = malloc((num_nodes + 1) * sizeof(*(*g)->queue))) == NULL ||
+	    ((*g)->heap = malloc((num_nodes + 1) * sizeof(*(*g)->heap))) == NULL ||
+	    ((*g)->heap_index = malloc((num_nodes + 1) * sizeof(*(*g)->heap_index))) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
-	apol_bst_destroy(&(*g)->nodes_bst);
 	retval = 0;
       cleanup:
-	apol_bst_destroy(&types);
-	qpol_iterator_destroy(&iter);
 	if (retval < 0) {
 		apol_infoflow_graph_destroy(g);
 	}
 	return retval;
 }
 
+/**
+ * Given a particular information flow analysis object, generate an
+ * infoflow graph relative to a particular policy.  This graph is
+ * customized for the particular analysis.
+ *
+ * @param p Policy from which to create the infoflow graph.
+ * @param ia Parameters to tune the created graph.
+ * @param g Reference to where to store the graph.  The caller is
+ * responsible for calling apol_infoflow_graph_destroy() upon this.
+ *
+ * @return 0 if the graph was created, < 0 on error.  Upon error *g
+ * will be set to NULL.
+ */
+static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infoflow_analysis_t * ia, apol_infoflow_graph_t ** g)
+{
+	apol_infoflow_csr_t *csr = NULL;
+	int retval;
+
+	*g = NULL;
+	if (p->pmap == NULL) {
+		ERR(p, "%s", "A permission map must be loaded prior to building the infoflow graph.");
+		return -1;
+	}
+	if (apol_infoflow_csr_get(p, ia, &csr) < 0) {
+		return -1;
+	}
+	retval = apol_infoflow_graph_create_from_csr(p, ia, csr, g);
+	apol_infoflow_csr_unref(&csr);
+	return retval;
+}
+
 void apol_infoflow_graph_destroy(apol_infoflow_graph_t ** g)
 {
 	if (g != NULL && *g != NULL) {
-		apol_bst_destroy(&(*g)->nodes_bst);
-		apol_vector_destroy(&(*g)->nodes);
-		apol_vector_destroy(&(*g)->edges);
-		apol_vector_destroy(&(*g)->further_start);
-		apol_vector_destroy(&(*g)->further_end);
+		apol_infoflow_csr_unref(&(*g)->csr);
+		free((*g)->color);
+		free((*g)->distance);
+		free((*g)->parent);
+		free((*g)->queue);
+		free((*g)->heap);
+		free((*g)->heap_index);
+		free((*g)->further_start);
+		free((*g)->further_end);
 		apol_regex_destroy(&(*g)->regex);
 		free(*g);
 		*g = NULL;
 	}
 }
 
+/******************** infoflow graph queue routines ********************/
+
+/* The transitive searches hold each node within the queue at most
+ * once at a time, so a ring of one more than the number of nodes
+ * never overflows. */
+
+static void apol_infoflow_queue_clear(apol_infoflow_graph_t * g)
+{
+	g->queue_head = g->queue_len = 0;
+}
+
+/** Add a node to the end of the queue. */
+static void apol_infoflow_queue_insert(apol_infoflow_graph_t * g, size_t node)
+{
+	size_t size = g->csr->num_nodes + 1;
+	assert(g->queue_len < size);
+	g->queue[(g->queue_head + g->queue_len) % size] = node;
+	g->queue_len++;
+}
+
+/** Add a node to the front of the queue. */
+static void apol_infoflow_queue_push(apol_infoflow_graph_t * g, size_t node)
+{
+	size_t size = g->csr->num_nodes + 1;
+	assert(g->queue_len < size);
+	g->queue_head = (g->queue_head + size - 1) % size;
+	g->queue[g->queue_head] = node;
+	g->queue_len++;
+}
+
+/** Remove and return the node at the front of the queue, or
+ *  APOL_INFOFLOW_NONE if it is empty. */
+static size_t apol_infoflow_queue_remove(apol_infoflow_graph_t * g)
+{
+	size_t node;
+	if (g->queue_len == 0) {
+		return APOL_INFOFLOW_NONE;
+	}
+	node = g->queue[g->queue_head];
+	g->queue_head = (g->queue_head + 1) % (g->csr->num_nodes + 1);
+	g->queue_len--;
+	return node;
+}
+
+/******************** infoflow graph heap routines ********************/
+
+/* Nodes within the heap are ordered by distance, and then by node
+ * number so that the order in which equally distant nodes are settled
+ * does not depend upon the heap's history. */
+
+static int apol_infoflow_heap_less(const apol_infoflow_graph_t * g, size_t a, size_t b)
+{
+	if (g->distance[a] != g->distance[b]) {
+		return g->distance[a] < g->distance[b];
+	}
+	return a < b;
+}
+
+/** Put the node at position i into its place within the heap. */
+static void apol_infoflow_heap_move(apol_infoflow_graph_t * g, size_t i, size_t node)
+{
+	g->heap[i] = node;
+	g->heap_index[node] = i;
+}
+
+/** Move a node whose distance has lessened towards the heap's top. */
+static void apol_infoflow_heap_up(apol_infoflow_graph_t * g, size_t i)
+{
+	size_t node = g->heap[i], parent;
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!apol_infoflow_heap_less(g, node, g->heap[parent])) {
+			break;
+		}
+		apol_infoflow_heap_move(g, i, g->heap[parent]);
+		i = parent;
+	}
+	apol_infoflow_heap_move(g, i, node);
+}
+
+/** Add a node to the heap, or if it is already within move it to
+ *  account for its lessened distance. */
+static void apol_infoflow_heap_update(apol_infoflow_graph_t * g, size_t node)
+{
+	if (g->heap_index[node] == APOL_INFOFLOW_NONE) {
+		assert(g->heap_len < g->csr->num_nodes);
+		apol_infoflow_heap_move(g, g->heap_len++, node);
+	}
+	apol_infoflow_heap_up(g, g->heap_index[node]);
+}
+
+/** Remove and return the nearest node within the heap, or
+ *  APOL_INFOFLOW_NONE if it is empty. */
+static size_t apol_infoflow_heap_remove(apol_infoflow_graph_t * g)
+{
+	size_t top, node, i = 0, child;
+	if (g->heap_len == 0) {
+		return APOL_INFOFLOW_NONE;
+	}
+	top = g->heap[0];
+	g->heap_index[top] = APOL_INFOFLOW_NONE;
+	if (--g->heap_len > 0) {
+		node = g->heap[g->heap_len];
+		while ((child = 2 * i + 1) < g->heap_len) {
+			if (child + 1 < g->heap_len && apol_infoflow_heap_less(g, g->heap[child + 1], g->heap[child])) {
+				child++;
+			}
+			if (!apol_infoflow_heap_less(g, g->heap[child], node)) {
+				break;
+			}
+			apol_infoflow_heap_move(g, i, g->heap[child]);
+			i = child;
+		}
+		apol_infoflow_heap_move(g, i, node);
+	}
+	return top;
+}
+
 /*************** infoflow graph direct analysis routines ***************/
 
 /**
- * Given a graph and a target type, append to vector v all nodes
- * (apol_infoflow_node_t) within the graph that use that type, one of
- * that type's aliases, or one of that type's attributes.  This will
- * also implicitly permutate across all of the type's object classes.
+ * Given a graph and a target type, find all nodes within the graph
+ * that use that type, one of that type's aliases, or one of that
+ * type's attributes.  This will also implicitly permutate across all
+ * of the type's object classes.
  *
  * @param p Error reporting handler.
  * @param g Information flow graph containing nodes.
  * @param type Target type name to find.
- * @param v Initialized vector to which append nodes.
+ * @param nodes Reference to an array of node numbers, allocated by
+ * this function.  The caller must call free() upon it afterwards.
+ * @param num_nodes Reference to where to write the number of nodes.
  *
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_graph_get_nodes_for_type(const apol_policy_t * p, const apol_infoflow_graph_t * g, const char *type,
-						  apol_vector_t * v)
+						  size_t ** nodes, size_t * num_nodes)
 {
-	size_t i, j;
+	const apol_infoflow_csr_t *csr = g->csr;
 	apol_vector_t *cand_list = NULL;
+	unsigned char *wanted = NULL;
+	uint32_t value, max_value = 0;
+	size_t i;
 	int retval = -1;
+
+	*nodes = NULL;
+	*num_nodes = 0;
 	if ((cand_list = apol_query_create_candidate_type_list(p, type, 0, 1, APOL_QUERY_SYMBOL_IS_BOTH)) == NULL) {
 		goto cleanup;
 	}
-	for (i = 0; i < apol_vector_get_size(g->nodes); i++) {
-		apol_infoflow_node_t *node;
-		node = (apol_infoflow_node_t *) apol_vector_get_element(g->nodes, i);
-		if (apol_vector_get_index(cand_list, node->type, NULL, NULL, &j) == 0 && apol_vector_append(v, node) < 0) {
+	for (i = 0; i < csr->num_nodes; i++) {
+		if (csr->nodes[i].type_value > max_value) {
+			max_value = csr->nodes[i].type_value;
+		}
+	}
+	if ((wanted = calloc(max_value + 1, 1)) == NULL || (*nodes = malloc((csr->num_nodes + 1) * sizeof(**nodes))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < apol_vector_get_size(cand_list); i++) {
+		if (qpol_type_get_value(p->p, apol_vector_get_element(cand_list, i), &value) < 0) {
 			goto cleanup;
 		}
+		if (value <= max_value) {
+			wanted[value] = 1;
+		}
+	}
+	for (i = 0; i < csr->num_nodes; i++) {
+		if (wanted[csr->nodes[i].type_value]) {
+			(*nodes)[(*num_nodes)++] = i;
+		}
 	}
 	retval = 0;
       cleanup:
 	apol_vector_destroy(&cand_list);
+	free(wanted);
+	if (retval != 0) {
+		free(*nodes);
+		*nodes = NULL;
+		*num_nodes = 0;
+	}
 	return retval;
 }
 
@@ -924,8 +1835,8 @@ static apol_infoflow_result_t *apol_infoflow_direct_get_result(const apol_policy
 	}
 	if ((r = calloc(1, sizeof(*r))) == NULL || (r->steps = apol_vector_create(apol_infoflow_step_free)) == NULL
 	    || apol_vector_append(v, r) < 0) {
-		ERR(p, "%s", strerror(ENOMEM));
 		infoflow_result_free(r);
+		ERR(p, "%s", strerror(errno));
 		return NULL;
 	}
 	r->start_type = start_type;
@@ -938,6 +1849,7 @@ static apol_infoflow_result_t *apol_infoflow_direct_get_result(const apol_policy
  * Append the rules on an edge to a direct infoflow result.
  *
  * @param p Policy containing rules.
+ * @param g Graph containing the edge.
  * @param edge Infoflow edge containing rules.
  * @param direction Direction of flow, one of APOL_INFOFLOW_IN, etc.
  * @param result Infoflow result to modify.
@@ -945,14 +1857,17 @@ static apol_infoflow_result_t *apol_infoflow_direct_get_result(const apol_policy
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_direct_define(const apol_policy_t * p,
+				       const apol_infoflow_graph_t * g,
 				       const apol_infoflow_edge_t * edge, unsigned int direction, apol_infoflow_result_t * result)
 {
 	apol_infoflow_step_t *step = NULL;
+	size_t i;
 	if (apol_vector_get_size(result->steps) == 0) {
 		if ((step = calloc(1, sizeof(*step))) == NULL ||
-		    (step->rules = apol_vector_create(NULL)) == NULL || apol_vector_append(result->steps, step) < 0) {
+		    (step->rules = apol_vector_create_with_capacity(edge->num_rules, NULL)) == NULL ||
+		    apol_vector_append(result->steps, step) < 0) {
 			apol_infoflow_step_free(step);
-			ERR(p, "%s", strerror(ENOMEM));
+			ERR(p, "%s", strerror(errno));
 			return -1;
 		}
 		step->start_type = result->start_type;
@@ -961,9 +1876,11 @@ static int apol_infoflow_direct_define(const apol_policy_t * p,
 	} else {
 		step = (apol_infoflow_step_t *) apol_vector_get_element(result->steps, 0);
 	}
-	if (apol_vector_cat(step->rules, edge->rules) < 0) {
-		ERR(p, "%s", strerror(ENOMEM));
-		return -1;
+	for (i = 0; i < edge->num_rules; i++) {
+		if (apol_vector_append(step->rules, (void *)g->csr->rules[edge->first_rule + i]) < 0) {
+			ERR(p, "%s", strerror(ENOMEM));
+			return -1;
+		}
 	}
 	result->direction |= direction;
 	//TODO: check that edge->lenght can be safely unsigned
@@ -1077,10 +1994,10 @@ static int apol_infoflow_results_check_both(const apol_policy_t * p,
  */
 static int apol_infoflow_analysis_direct_expand(const apol_policy_t * p,
 						apol_infoflow_graph_t * g,
-						apol_infoflow_node_t * start_node,
-						apol_infoflow_edge_t * edge, unsigned int flow_dir, apol_vector_t * results)
+						size_t start_node, const apol_infoflow_edge_t * edge, unsigned int flow_dir,
+						apol_vector_t * results)
 {
-	apol_infoflow_node_t *end_node;
+	const apol_infoflow_node_t *end_node;
 	unsigned char isattr;
 	qpol_iterator_t *iter = NULL;
 	const qpol_type_t *type;
@@ -1088,9 +2005,9 @@ static int apol_infoflow_analysis_direct_expand(const apol_policy_t * p,
 	int retval = -1, compval;
 
 	if (edge->start_node == start_node) {
-		end_node = edge->end_node;
+		end_node = g->csr->nodes + edge->end_node;
 	} else {
-		end_node = edge->start_node;
+		end_node = g->csr->nodes + edge->start_node;
 	}
 	if (qpol_type_get_isattr(p->p, end_node->type, &isattr) < 0) {
 		goto cleanup;
@@ -1120,8 +2037,8 @@ static int apol_infoflow_analysis_direct_expand(const apol_policy_t * p,
 		} else if (compval == 0) {
 			continue;
 		}
-		if ((r = apol_infoflow_direct_get_result(p, results, start_node->type, type)) == NULL ||
-		    apol_infoflow_direct_define(p, edge, flow_dir, r) < 0) {
+		if ((r = apol_infoflow_direct_get_result(p, results, g->csr->nodes[start_node].type, type)) == NULL ||
+		    apol_infoflow_direct_define(p, g, edge, flow_dir, r) < 0) {
 			goto cleanup;
 		}
 	} while (isattr && !qpol_iterator_end(iter));
@@ -1138,7 +2055,8 @@ static int apol_infoflow_analysis_direct_expand(const apol_policy_t * p,
  *
  * @param p Policy to analyze.
  * @param g Information flow graph to analyze.
- * @param start_type Type from which to begin search.
+ * @param nodes Nodes of the type from which to begin search.
+ * @param num_nodes Number of nodes.
  * @param results Non-NULL vector to which append infoflow results.
  * The caller is responsible for calling apol_infoflow_results_free()
  * upon each element afterwards.
@@ -1146,40 +2064,35 @@ static int apol_infoflow_analysis_direct_expand(const apol_policy_t * p,
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_analysis_direct(const apol_policy_t * p,
-					 apol_infoflow_graph_t * g, const char *start_type, apol_vector_t * results)
+					 apol_infoflow_graph_t * g, const size_t * nodes, size_t num_nodes, apol_vector_t * results)
 {
-	apol_vector_t *nodes = NULL;
-	size_t i, j;
-	apol_infoflow_node_t *node;
-	apol_infoflow_edge_t *edge;
+	const apol_infoflow_csr_t *csr = g->csr;
+	size_t i, j, node;
 	apol_vector_t *working_results = NULL;
 	int retval = -1;
 
-	if ((nodes = apol_vector_create(NULL)) == NULL || (working_results = apol_vector_create(infoflow_result_free)) == NULL) {
+	if ((working_results = apol_vector_create(infoflow_result_free)) == NULL) {
 		ERR(p, "%s", strerror(ENOMEM));
 		goto cleanup;
 	}
-	if (apol_infoflow_graph_get_nodes_for_type(p, g, start_type, nodes) < 0) {
-		goto cleanup;
-	}
 
 	if (g->direction == APOL_INFOFLOW_IN || g->direction == APOL_INFOFLOW_EITHER || g->direction == APOL_INFOFLOW_BOTH) {
-		for (i = 0; i < apol_vector_get_size(nodes); i++) {
-			node = (apol_infoflow_node_t *) apol_vector_get_element(nodes, i);
-			for (j = 0; j < apol_vector_get_size(node->in_edges); j++) {
-				edge = (apol_infoflow_edge_t *) apol_vector_get_element(node->in_edges, j);
-				if (apol_infoflow_analysis_direct_expand(p, g, node, edge, APOL_INFOFLOW_IN, working_results) < 0) {
+		for (i = 0; i < num_nodes; i++) {
+			node = nodes[i];
+			for (j = csr->in_start[node]; j < csr->in_start[node + 1]; j++) {
+				if (apol_infoflow_analysis_direct_expand
+				    (p, g, node, csr->edges + csr->in_edges[j], APOL_INFOFLOW_IN, working_results) < 0) {
 					goto cleanup;
 				}
 			}
 		}
 	}
 	if (g->direction == APOL_INFOFLOW_OUT || g->direction == APOL_INFOFLOW_EITHER || g->direction == APOL_INFOFLOW_BOTH) {
-		for (i = 0; i < apol_vector_get_size(nodes); i++) {
-			node = (apol_infoflow_node_t *) apol_vector_get_element(nodes, i);
-			for (j = 0; j < apol_vector_get_size(node->out_edges); j++) {
-				edge = (apol_infoflow_edge_t *) apol_vector_get_element(node->out_edges, j);
-				if (apol_infoflow_analysis_direct_expand(p, g, node, edge, APOL_INFOFLOW_OUT, working_results) < 0) {
+		for (i = 0; i < num_nodes; i++) {
+			node = nodes[i];
+			for (j = csr->out_start[node]; j < csr->out_start[node + 1]; j++) {
+				if (apol_infoflow_analysis_direct_expand(p, g, node, csr->edges + j, APOL_INFOFLOW_OUT, working_results) <
+				    0) {
 					goto cleanup;
 				}
 			}
@@ -1192,7 +2105,6 @@ static int apol_infoflow_analysis_direct(const apol_policy_t * p,
 
 	retval = 0;
       cleanup:
-	apol_vector_destroy(&nodes);
 	apol_vector_destroy(&working_results);
 	return retval;
 }
@@ -1201,37 +2113,24 @@ static int apol_infoflow_analysis_direct(const apol_policy_t * p,
 
 /**
  * Prepare an infoflow graph for a transitive analysis by coloring its
- * nodes and setting its parent and distance.  For the start node
- * color it red; for all others color them white.
+ * nodes and setting its parent and distance.  The start node is
+ * placed within the heap; all others are colored white.
  *
- * @param p Policy handler, for reporting errors.
  * @param g Infoflow graph to initialize.
  * @param start Node from which to begin analysis.
- * @param q Queue of apol_infoflow_node_t pointers to which search.
- *
- * @return 0 on success, < 0 on error.
  */
-static int apol_infoflow_graph_trans_init(const apol_policy_t * p,
-					  apol_infoflow_graph_t * g, apol_infoflow_node_t * start, apol_queue_t * q)
+static void apol_infoflow_graph_trans_init(apol_infoflow_graph_t * g, size_t start)
 {
 	size_t i;
-	apol_infoflow_node_t *node;
-	for (i = 0; i < apol_vector_get_size(g->nodes); i++) {
-		node = (apol_infoflow_node_t *) apol_vector_get_element(g->nodes, i);
-		node->parent = NULL;
-		if (node == start) {
-			node->color = APOL_INFOFLOW_COLOR_RED;
-			node->distance = 0;
-			if (apol_queue_insert(q, node) < 0) {
-				ERR(p, "%s", strerror(ENOMEM));
-				return -1;
-			}
-		} else {
-			node->color = APOL_INFOFLOW_COLOR_WHITE;
-			node->distance = INT_MAX;
-		}
-	}
-	return 0;
+	for (i = 0; i < g->csr->num_nodes; i++) {
+		g->parent[i] = APOL_INFOFLOW_NONE;
+		g->color[i] = APOL_INFOFLOW_COLOR_WHITE;
+		g->distance[i] = INT_MAX;
+		g->heap_index[i] = APOL_INFOFLOW_NONE;
+	}
+	g->distance[start] = 0;
+	g->heap_len = 0;
+	apol_infoflow_heap_update(g, start);
 }
 
 /**
@@ -1239,138 +2138,41 @@ static int apol_infoflow_graph_trans_init(const apol_policy_t * p,
  * coloring its nodes and setting its parent and distance.  For the
  * start node color it grey; for all others color them white.
  *
- * @param p Policy handler, for reporting errors.
  * @param g Infoflow graph to initialize.
  * @param start Node from which to begin analysis.
- * @param q Queue of apol_infoflow_node_t pointers to which search.
- *
- * @return 0 on success, < 0 on error.
  */
-static int apol_infoflow_graph_trans_further_init(const apol_policy_t * p,
-						  apol_infoflow_graph_t * g, apol_infoflow_node_t * start, apol_queue_t * q)
+static void apol_infoflow_graph_trans_further_init(apol_infoflow_graph_t * g, size_t start)
 {
 	size_t i;
-	apol_infoflow_node_t *node;
-	for (i = 0; i < apol_vector_get_size(g->nodes); i++) {
-		node = (apol_infoflow_node_t *) apol_vector_get_element(g->nodes, i);
-		node->parent = NULL;
-		if (node == start) {
-			node->color = APOL_INFOFLOW_COLOR_GREY;
-			node->distance = 0;
-			if (apol_queue_insert(q, node) < 0) {
-				ERR(p, "%s", strerror(ENOMEM));
-				return -1;
-			}
-		} else {
-			node->color = APOL_INFOFLOW_COLOR_WHITE;
-			node->distance = -1;
-		}
-	}
-	return 0;
+	for (i = 0; i < g->csr->num_nodes; i++) {
+		g->parent[i] = APOL_INFOFLOW_NONE;
+		g->color[i] = APOL_INFOFLOW_COLOR_WHITE;
+		g->distance[i] = -1;
+	}
+	g->color[start] = APOL_INFOFLOW_COLOR_GREY;
+	g->distance[start] = 0;
+	apol_infoflow_queue_clear(g);
+	apol_infoflow_queue_insert(g, start);
 }
 
 /**
- * Given a colored infoflow graph from apol_infoflow_analysis_trans(),
- * find the shortest path from the end node to the start node.
- * Allocate and return a vector of apol_infoflow_node_t that lists the
- * nodes from the end to start.
- *
- * @param p Policy from which infoflow graph was generated.
- * @param g Infoflow graph that has been colored.
- * @param start_node Starting node for the path
- * @param end_node Ending node to which to find a path.
- * @param path Reference to a vector that will be allocated and filled
- * with apol_infoflow_node_t pointers from the graph.  The path will
- * be in reverse order (i.e., from end node to a start node).  Upon
- * error this will be set to NULL.
- *
- * @return 0 on success, < 0 on error.
+ * Return the node at the far end of an edge, when searching in the
+ * graph's direction.
  */
-static int apol_infoflow_trans_path(const apol_policy_t * p,
-				    apol_infoflow_graph_t * g,
-				    apol_infoflow_node_t * start_node, apol_infoflow_node_t * end_node, apol_vector_t ** path)
+static size_t apol_infoflow_trans_next_node(const apol_infoflow_graph_t * g, const apol_infoflow_edge_t * edge)
 {
-	int retval = -1;
-	apol_infoflow_node_t *next_node = end_node;
-	if ((*path = apol_vector_create(NULL)) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		goto cleanup;
-	}
-	while (1) {
-		if (apol_vector_append(*path, next_node) < 0) {
-			ERR(p, "%s", strerror(errno));
-			goto cleanup;
-		}
-		if (next_node == start_node) {
-			break;
-		}
-		if (next_node == NULL || apol_vector_get_size(*path) >= apol_vector_get_size(g->nodes)) {
-			ERR(p, "%s", "Infinite loop in trans_path.");
-			errno = EPERM;
-			goto cleanup;
-		}
-		next_node = next_node->parent;
-	}
-	retval = 0;
-      cleanup:
-	if (retval != 0) {
-		apol_vector_destroy(path);
-	}
-	return retval;
+	return (g->direction == APOL_INFOFLOW_OUT ? edge->end_node : edge->start_node);
 }
 
 /**
- * Given a node within an infoflow graph, return the edge that
- * connects it to next_node.
- *
- * @param p Policy handler, for reporting errors.
- * @param g Infoflow graph from which to find edge.
- * @param node Starting node.
- * @param next_node Ending node.
- *
- * @return Edge connecting node to next_node, or NULL on error.
- */
-static apol_infoflow_edge_t *apol_infoflow_trans_find_edge(const apol_policy_t * p,
-							   apol_infoflow_graph_t * g,
-							   apol_infoflow_node_t * node, apol_infoflow_node_t * next_node)
-{
-	apol_vector_t *v;
-	apol_infoflow_edge_t *edge;
-	size_t i;
-
-	if (g->direction == APOL_INFOFLOW_OUT) {
-		v = node->out_edges;
-	} else {
-		v = node->in_edges;
-	}
-	for (i = 0; i < apol_vector_get_size(v); i++) {
-		edge = (apol_infoflow_edge_t *) apol_vector_get_element(v, i);
-		if (g->direction == APOL_INFOFLOW_OUT) {
-			if (edge->start_node == node && edge->end_node == next_node) {
-				return edge;
-			}
-		} else {
-			if (edge->end_node == node && edge->start_node == next_node) {
-				return edge;
-			}
-
-		}
-	}
-	ERR(p, "%s", "Did not find an edge.");
-	return NULL;
-}
-
-/**
- * Given a path of nodes, define a new infoflow result that represents
- * that path.  The given path is a list of nodes that must be in
- * reverse order (i.e., from end node to start node) and must have at
- * least 2 elements within.
+ * Given a colored infoflow graph from apol_infoflow_analysis_trans(),
+ * define a new infoflow result that represents the path by which the
+ * search reached the end node from the start node.
  *
  * @param p Policy handler, for reporting errors.
- * @param g Graph from which the node path originated.
- * @param path Vector of apol_infoflow_node_t representing an infoflow
- * path.
- * @param end_type Ending type for the path.
+ * @param g Graph that has been colored.
+ * @param start_node Starting node for the path.
+ * @param end_node Ending node of the path.
  * @param result Reference pointer to where to store result.  The
  * caller is responsible for calling apol_infoflow_result_free() upon
  * the returned value.  Upon error this will be set to NULL.
@@ -1378,48 +2180,67 @@ static apol_infoflow_edge_t *apol_infoflow_trans_find_edge(const apol_policy_t *
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_trans_define(const apol_policy_t * p,
-				      apol_infoflow_graph_t * g,
-				      apol_vector_t * path, const qpol_type_t * end_type, apol_infoflow_result_t ** result)
+				      apol_infoflow_graph_t * g, size_t start_node, size_t end_node,
+				      apol_infoflow_result_t ** result)
 {
+	const apol_infoflow_csr_t *csr = g->csr;
 	apol_infoflow_step_t *step = NULL;
-	size_t path_len = apol_vector_get_size(path), i;
-	apol_infoflow_node_t *node, *next_node;
-	apol_infoflow_edge_t *edge;
+	const apol_infoflow_edge_t *edge;
+	size_t *path = NULL, path_len = 0, node, i;
 	int retval = -1, length = 0;
 	*result = NULL;
 
+	/* the path is found from end node back to start node */
+	if ((path = malloc((csr->num_nodes + 1) * sizeof(*path))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	node = end_node;
+	while (node != start_node) {
+		if (g->parent[node] == APOL_INFOFLOW_NONE || path_len >= csr->num_nodes) {
+			ERR(p, "%s", "Infinite loop in trans_path.");
+			errno = EPERM;
+			goto cleanup;
+		}
+		path[path_len++] = g->parent[node];
+		edge = csr->edges + g->parent[node];
+		node = (g->direction == APOL_INFOFLOW_OUT ? edge->start_node : edge->end_node);
+	}
+
 	if (((*result) = calloc(1, sizeof(**result))) == NULL ||
 	    ((*result)->steps = apol_vector_create_with_capacity(path_len, apol_infoflow_step_free)) == NULL) {
 		ERR(p, "%s", strerror(ENOMEM));
 		goto cleanup;
 	}
-	(*result)->end_type = end_type;
+	(*result)->start_type = csr->nodes[start_node].type;
+	(*result)->end_type = csr->nodes[end_node].type;
+	(*result)->direction = g->direction;
 	/* build in reverse order because path is from end node to
 	 * start node */
-	node = (apol_infoflow_node_t *) apol_vector_get_element(path, path_len - 1);
-	(*result)->start_type = node->type;
-	(*result)->direction = g->direction;
-	for (i = path_len - 1; i > 0; i--, node = next_node) {
-		next_node = (apol_infoflow_node_t *) apol_vector_get_element(path, i - 1);
-		edge = apol_infoflow_trans_find_edge(p, g, node, next_node);
-		if (edge == NULL) {
-			goto cleanup;
-		}
+	for (i = path_len; i > 0; i--) {
+		edge = csr->edges + path[i - 1];
 		length += edge->length;
 		if ((step = calloc(1, sizeof(*step))) == NULL ||
-		    (step->rules = apol_vector_create_from_vector(edge->rules, NULL, NULL, NULL)) == NULL ||
+		    (step->rules = apol_vector_create_with_capacity(edge->num_rules, NULL)) == NULL ||
 		    apol_vector_append((*result)->steps, step) < 0) {
 			apol_infoflow_step_free(step);
 			ERR(p, "%s", strerror(ENOMEM));
-			return -1;
+			goto cleanup;
 		}
-		step->start_type = edge->start_node->type;
-		step->end_type = edge->end_node->type;
+		for (node = 0; node < edge->num_rules; node++) {
+			if (apol_vector_append(step->rules, (void *)csr->rules[edge->first_rule + node]) < 0) {
+				ERR(p, "%s", strerror(ENOMEM));
+				goto cleanup;
+			}
+		}
+		step->start_type = csr->nodes[edge->start_node].type;
+		step->end_type = csr->nodes[edge->end_node].type;
 		step->weight = APOL_PERMMAP_MAX_WEIGHT - edge->length + 1;
 	}
 	(*result)->length = length;
 	retval = 0;
       cleanup:
+	free(path);
 	if (retval != 0) {
 		infoflow_result_free(*result);
 		*result = NULL;
@@ -1449,40 +2270,65 @@ static int apol_infoflow_trans_step_comp(const void *a, const void *b, void *dat
 	if (step_a->end_type != step_b->end_type) {
 		return (int)((char *)step_a->end_type - (char *)step_b->end_type);
 	}
-	return apol_vector_compare(step_a->rules, step_b->rules, NULL, NULL, &i);
+	return apol_vector_compare(step_a->rules, step_b->rules, NULL, NULL, &i);
+}
+
+/**
+ * Determine if a vector of transitive results already holds one that
+ * describes the same path as another result.  Unlike the check within
+ * apol_infoflow_trans_append(), every element of the vector is
+ * examined.
+ *
+ * @param results Vector of apol_infoflow_result_t to search.
+ * @param r Result to find.
+ *
+ * @return Non-zero if a result with the same path was found, zero if
+ * not.
+ */
+static int apol_infoflow_trans_find(const apol_vector_t * results, const apol_infoflow_result_t * r)
+{
+	const apol_infoflow_result_t *other;
+	size_t i, j;
+	for (i = 0; i < apol_vector_get_size(results); i++) {
+		other = apol_vector_get_element(results, i);
+		if (other->start_type == r->start_type && other->end_type == r->end_type &&
+		    other->direction == r->direction && apol_vector_get_size(other->steps) == apol_vector_get_size(r->steps) &&
+		    apol_vector_compare(other->steps, r->steps, apol_infoflow_trans_step_comp, NULL, &j) == 0) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /**
- * Given a path, append to the results vector a new
- * apol_infoflow_result object - but only if there is not already a
- * result describing the same path.
+ * Given the path by which a colored graph reached a node, append to
+ * the results vector a new apol_infoflow_result object - but only if
+ * there is not already a result describing the same path.
  *
  * @param p Policy handler, for reporting errors.
  * @param g Infoflow graph to which create results.
- * @param path Vector of apol_infoflow_node_t describing a path from
- * an end node to a starting node.
- * @param end_type Ending type for the path.
+ * @param start_node Starting node for the path.
+ * @param end_node Ending node of the path.
  * @param results Vector of apol_infoflow_result_t to possibly append
  * a new result.
  *
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_trans_append(const apol_policy_t * p,
-				      apol_infoflow_graph_t * g,
-				      apol_vector_t * path, const qpol_type_t * end_type, apol_vector_t * results)
+				      apol_infoflow_graph_t * g, size_t start_node, size_t end_node, apol_vector_t * results)
 {
 	apol_infoflow_result_t *new_r = NULL, *r;
 	size_t i, j;
 	int compval, retval = -1;
 
-	if (apol_infoflow_trans_define(p, g, path, end_type, &new_r) < 0) {
+	if (apol_infoflow_trans_define(p, g, start_node, end_node, &new_r) < 0) {
 		goto cleanup;
 	}
 
 	/* First we look for duplicate paths */
 	for (i = 0; i < apol_vector_get_size(results); i++) {
 		r = (apol_infoflow_result_t *) apol_vector_get_element(results, i);
-		if (r->end_type != end_type ||
+		if (r->end_type != new_r->end_type ||
 		    r->direction != new_r->direction || apol_vector_get_size(r->steps) != apol_vector_get_size(new_r->steps)) {
 			break;
 		}
@@ -1527,59 +2373,41 @@ static int apol_infoflow_trans_append(const apol_policy_t * p,
  * on error.
  */
 static int apol_infoflow_analysis_trans_expand(const apol_policy_t * p,
-					       apol_infoflow_graph_t * g,
-					       apol_infoflow_node_t * start_node,
-					       apol_infoflow_node_t * end_node, apol_vector_t * results)
+					       apol_infoflow_graph_t * g, size_t start_node, size_t end_node,
+					       apol_vector_t * results)
 {
-	unsigned char isattr;
-	apol_vector_t *path = NULL;
-	int retval = -1, compval;
+	const qpol_type_t *start_type = g->csr->nodes[start_node].type, *end_type = g->csr->nodes[end_node].type;
+	int compval;
 
-	if (qpol_type_get_isattr(p->p, end_node->type, &isattr) < 0) {
-		goto cleanup;
-	}
-	assert(isattr == 0);
-	if (start_node->type == end_node->type) {
+	if (start_type == end_type) {
 		return 0;
 	}
-	compval = apol_infoflow_graph_compare(p, g, end_node->type);
+	compval = apol_infoflow_graph_compare(p, g, end_type);
 	if (compval < 0) {
-		goto cleanup;
+		return -1;
 	} else if (compval == 0) {
 		return 0;
 	}
-	if (apol_infoflow_trans_path(p, g, start_node, end_node, &path) < 0 ||
-	    apol_infoflow_trans_append(p, g, path, end_node->type, results) < 0) {
-		goto cleanup;
-	}
-	retval = 0;
-      cleanup:
-	apol_vector_destroy(&path);
-	return retval;
+	return apol_infoflow_trans_append(p, g, start_node, end_node, results);
 }
 
 /**
  * Perform a transitive information flow analysis upon the given
  * infoflow graph starting from some particular node within the graph.
  *
- * This is a label correcting shortest path algorithm; see Bertsekas,
- * D. P., "A Simple and Fast Label Correcting Algorithm for Shortest
- * Paths," Networks, Vol. 23, pp. 703-709, 1993. for more information.
- * A label correcting algorithm is needed instead of the more common
- * Dijkstra label setting algorithm to correctly handle the the cycles
- * that are possible in these graphs.
- *
- * This algorithm finds the shortest path between a given start node
- * and all other nodes in the graph.  Any paths that it finds it
- * appends to the iflow_transitive_t structure. This is a basic label
- * correcting algorithm with 1 optimization.  It uses the D'Esopo-Pape
- * method for node selection in the node queue.  Why is this faster?
- * The paper referenced above says "No definitive explanation has been
- * given."  They have fancy graphs to show that it is faster though
- * and the important part is that the worst case isn't much worse that
- * N^2 - much better than an n^3 transitive closure.  Additionally,
- * most normal sparse graphs are significantly better than the worst
- * case.
+ * This finds the shortest path between a given start node and all
+ * other nodes in the graph, and appends each path found to the
+ * results vector.  Edge lengths come from permission weights and are
+ * never negative, so Dijkstra's label setting algorithm applies:
+ * nodes are settled in order of distance from a binary heap, and
+ * each node's edges are examined only once, when it is settled.
+ *
+ * A node's parent is the first edge found to reach it at its final
+ * distance, with nodes settled by distance and then by node number.
+ * When several paths are equally short this may choose a different
+ * one than the D'Esopo-Pape label correcting search used before, in
+ * which the first edge found depended upon the order of its queue.
+ * Distances, and thus result lengths, are the same.
  *
  * @param p Policy to analyze.
  * @param g Information flow graph to analyze.
@@ -1591,84 +2419,49 @@ static int apol_infoflow_analysis_trans_expand(const apol_policy_t * p,
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_analysis_trans_shortest_path(const apol_policy_t * p,
-						      apol_infoflow_graph_t * g,
-						      apol_infoflow_node_t * start, apol_vector_t * results)
+						      apol_infoflow_graph_t * g, size_t start, apol_vector_t * results)
 {
-	apol_vector_t *edge_list;
-	apol_queue_t *queue = NULL;
-	apol_infoflow_node_t *node, *cur_node;
-	apol_infoflow_edge_t *edge;
-	size_t i;
-	int retval = -1;
+	const apol_infoflow_csr_t *csr = g->csr;
+	const apol_infoflow_edge_t *edge;
+	size_t cur_node, node, i, e, first, last;
 
-	if ((queue = apol_queue_create()) == NULL) {
-		ERR(p, "%s", strerror(ENOMEM));
-		goto cleanup;
-	}
-	if (apol_infoflow_graph_trans_init(p, g, start, queue) < 0) {
-		goto cleanup;
-	}
+	apol_infoflow_graph_trans_init(g, start);
 
-	while ((cur_node = apol_queue_remove(queue)) != NULL) {
-		cur_node->color = APOL_INFOFLOW_COLOR_GREY;
+	while ((cur_node = apol_infoflow_heap_remove(g)) != APOL_INFOFLOW_NONE) {
+		g->color[cur_node] = APOL_INFOFLOW_COLOR_BLACK;
 		if (g->direction == APOL_INFOFLOW_OUT) {
-			edge_list = cur_node->out_edges;
+			first = csr->out_start[cur_node];
+			last = csr->out_start[cur_node + 1];
 		} else {
-			edge_list = cur_node->in_edges;
-		}
-		for (i = 0; i < apol_vector_get_size(edge_list); i++) {
-			edge = (apol_infoflow_edge_t *) apol_vector_get_element(edge_list, i);
-			if (g->direction == APOL_INFOFLOW_OUT) {
-				node = edge->end_node;
-			} else {
-				node = edge->start_node;
-			}
-			if (node == start) {
+			first = csr->in_start[cur_node];
+			last = csr->in_start[cur_node + 1];
+		}
+		for (i = first; i < last; i++) {
+			e = (g->direction == APOL_INFOFLOW_OUT ? i : csr->in_edges[i]);
+			edge = csr->edges + e;
+			node = apol_infoflow_trans_next_node(g, edge);
+			if (node == start || g->color[node] == APOL_INFOFLOW_COLOR_BLACK) {
 				continue;
 			}
-
-			if (node->distance > cur_node->distance + edge->length) {
-				node->distance = cur_node->distance + edge->length;
-				node->parent = cur_node;
-				/* If this node has been inserted into
-				 * the queue before insert it at the
-				 * beginning, otherwise it goes to the
-				 * end.  See the comment at the
-				 * beginning of the function for
-				 * why. */
-				if (node->color != APOL_INFOFLOW_COLOR_RED) {
-					if (node->color == APOL_INFOFLOW_COLOR_GREY) {
-						if (apol_queue_push(queue, node) < 0) {
-							ERR(p, "%s", strerror(ENOMEM));
-							goto cleanup;
-						}
-					} else {
-						if (apol_queue_insert(queue, node) < 0) {
-							ERR(p, "%s", strerror(ENOMEM));
-							goto cleanup;
-						}
-					}
-					node->color = APOL_INFOFLOW_COLOR_RED;
-				}
+			if (g->distance[node] > g->distance[cur_node] + edge->length) {
+				g->distance[node] = g->distance[cur_node] + edge->length;
+				g->parent[node] = e;
+				g->color[node] = APOL_INFOFLOW_COLOR_GREY;
+				apol_infoflow_heap_update(g, node);
 			}
 		}
 	}
 
 	/* Find all of the paths and add them to the results vector */
-	for (i = 0; i < apol_vector_get_size(g->nodes); i++) {
-		cur_node = (apol_infoflow_node_t *) apol_vector_get_element(g->nodes, i);
-		if (cur_node->parent == NULL || cur_node == start) {
+	for (node = 0; node < csr->num_nodes; node++) {
+		if (g->parent[node] == APOL_INFOFLOW_NONE || node == start) {
 			continue;
 		}
-		if (apol_infoflow_analysis_trans_expand(p, g, start, cur_node, results) < 0) {
-			goto cleanup;
+		if (apol_infoflow_analysis_trans_expand(p, g, start, node, results) < 0) {
+			return -1;
 		}
 	}
-
-	retval = 0;
-      cleanup:
-	apol_queue_destroy(&queue);
-	return retval;
+	return 0;
 }
 
 /**
@@ -1677,7 +2470,8 @@ static int apol_infoflow_analysis_trans_shortest_path(const apol_policy_t * p,
  *
  * @param p Policy to analyze.
  * @param g Information flow graph to analyze.
- * @param start_type Type from which to begin search.
+ * @param start_nodes Nodes of the type from which to begin search.
+ * @param num_start_nodes Number of nodes.
  * @param results Non-NULL vector to which append infoflow results.
  * The caller is responsible for calling apol_infoflow_results_free()
  * upon each element afterwards.
@@ -1685,149 +2479,114 @@ static int apol_infoflow_analysis_trans_shortest_path(const apol_policy_t * p,
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_analysis_trans(const apol_policy_t * p,
-					apol_infoflow_graph_t * g, const char *start_type, apol_vector_t * results)
+					apol_infoflow_graph_t * g, const size_t * start_nodes, size_t num_start_nodes,
+					apol_vector_t * results)
 {
-	apol_vector_t *start_nodes = NULL;
-	apol_infoflow_node_t *start_node;
 	size_t i;
-	int retval = -1;
 
 	if (g->direction != APOL_INFOFLOW_IN && g->direction != APOL_INFOFLOW_OUT) {
 		ERR(p, "%s", strerror(EINVAL));
-		goto cleanup;
-	}
-	if ((start_nodes = apol_vector_create(NULL)) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		goto cleanup;
-	}
-	if (apol_infoflow_graph_get_nodes_for_type(p, g, start_type, start_nodes) < 0) {
-		goto cleanup;
+		errno = EINVAL;
+		return -1;
 	}
-	for (i = 0; i < apol_vector_get_size(start_nodes); i++) {
-		start_node = (apol_infoflow_node_t *) apol_vector_get_element(start_nodes, i);
-		if (apol_infoflow_analysis_trans_shortest_path(p, g, start_node, results) < 0) {
-			goto cleanup;
+	for (i = 0; i < num_start_nodes; i++) {
+		if (apol_infoflow_analysis_trans_shortest_path(p, g, start_nodes[i], results) < 0) {
+			return -1;
 		}
 	}
-	retval = 0;
-      cleanup:
-	apol_vector_destroy(&start_nodes);
-	return retval;
+	return 0;
 }
 
 /**
- * Given a vector, allocate and return a new vector with the elements
- * shuffled about.  This will make a shallow copy of the original
- * vector's elements.
- *
- * @param p Policy handler, for error reporting.
- * @param g Transitive infoflow graph containing PRNG object.
- * @param v Vector to shuffle.
+ * Search an infoflow graph from the given starting nodes, according
+ * to the graph's mode.
  *
- * @return A newly allocated vector with shuffled elements, or NULL
- * upon error.  The caller must call apol_vector_destroy() upon the
- * returned value.
+ * @return 0 on success, < 0 on error.
  */
-static apol_vector_t *apol_infoflow_trans_further_shuffle(const apol_policy_t * p, apol_infoflow_graph_t * g, apol_vector_t * v)
+static int apol_infoflow_analysis_search(const apol_policy_t * p, apol_infoflow_graph_t * g, const size_t * start_nodes,
+					 size_t num_start_nodes, apol_vector_t * results)
 {
-	size_t i, j, size;
-	void **deck = NULL, *tmp;
-	apol_vector_t *new_v = NULL;
-	int retval = -1;
-	size = apol_vector_get_size(v);
-	if ((new_v = apol_vector_create_with_capacity(size, NULL)) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		goto cleanup;
-	}
-	if (size == 0) {
-		retval = 0;
-		goto cleanup;
-	}
-	if ((deck = malloc(size * sizeof(*deck))) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		goto cleanup;
-	}
-	for (i = 0; i < size; i++) {
-		deck[i] = apol_vector_get_element(v, i);
+	if (g->mode == APOL_INFOFLOW_MODE_DIRECT) {
+		return apol_infoflow_analysis_direct(p, g, start_nodes, num_start_nodes, results);
+	} else if (g->mode == APOL_INFOFLOW_MODE_TRANS) {
+		return apol_infoflow_analysis_trans(p, g, start_nodes, num_start_nodes, results);
 	}
-	for (i = size - 1; i > 0; i--) {
-		j = (size_t) ((apol_infoflow_rand(g) / (RAND_MAX + 1.0)) * i);
-		tmp = deck[i];
-		deck[i] = deck[j];
+	return 0;
+}
+
+/**
+ * Shuffle an array of edge numbers in place.
+ *
+ * @param g Transitive infoflow graph containing PRNG object.
+ * @param deck Array to shuffle.
+ * @param size Number of elements within the array.
+ */
+static void apol_infoflow_trans_further_shuffle(apol_infoflow_graph_t * g, size_t * deck, size_t size)
+{
+	size_t i, j, tmp;
+	for (i = size; i > 1; i--) {
+		j = (size_t) ((apol_infoflow_rand(g) / (RAND_MAX + 1.0)) * (i - 1));
+		tmp = deck[i - 1];
+		deck[i - 1] = deck[j];
 		deck[j] = tmp;
 	}
-	for (i = 0; i < size; i++) {
-		if (apol_vector_append(new_v, deck[i]) < 0) {
-			ERR(p, "%s", strerror(ENOMEM));
-			goto cleanup;
-		}
-	}
-	retval = 0;
-      cleanup:
-	free(deck);
-	if (retval != 0) {
-		apol_vector_destroy(&new_v);
-	}
-	return new_v;
 }
 
 static int apol_infoflow_analysis_trans_further(const apol_policy_t * p,
-						apol_infoflow_graph_t * g, apol_infoflow_node_t * start, apol_vector_t * results)
+						apol_infoflow_graph_t * g, size_t start, apol_vector_t * results)
 {
-	apol_vector_t *edge_list = NULL;
-	apol_queue_t *queue = NULL;
-	apol_infoflow_node_t *node, *cur_node;
-	apol_infoflow_edge_t *edge;
-	size_t i;
+	const apol_infoflow_csr_t *csr = g->csr;
+	const apol_infoflow_edge_t *edge;
+	size_t *deck = NULL, max_degree = 0, degree, cur_node, node, n, i;
 	int retval = -1;
 
-	if ((queue = apol_queue_create()) == NULL) {
-		ERR(p, "%s", strerror(ENOMEM));
-		goto cleanup;
+	for (n = 0; n < csr->num_nodes; n++) {
+		if (g->direction == APOL_INFOFLOW_OUT) {
+			degree = csr->out_start[n + 1] - csr->out_start[n];
+		} else {
+			degree = csr->in_start[n + 1] - csr->in_start[n];
+		}
+		if (degree > max_degree) {
+			max_degree = degree;
+		}
 	}
-	if (apol_infoflow_graph_trans_further_init(p, g, start, queue) < 0) {
+	if ((deck = malloc((max_degree + 1) * sizeof(*deck))) == NULL) {
+		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
+	apol_infoflow_graph_trans_further_init(g, start);
 
-	while ((cur_node = apol_queue_remove(queue)) != NULL) {
-		if (cur_node != start &&
-		    apol_vector_get_index(g->further_end, cur_node, NULL, NULL, &i) == 0 &&
+	while ((cur_node = apol_infoflow_queue_remove(g)) != APOL_INFOFLOW_NONE) {
+		if (cur_node != start && g->further_end[cur_node] &&
 		    apol_infoflow_analysis_trans_expand(p, g, start, cur_node, results) < 0) {
 			goto cleanup;
 		}
-		cur_node->color = APOL_INFOFLOW_COLOR_BLACK;
+		g->color[cur_node] = APOL_INFOFLOW_COLOR_BLACK;
+		degree = 0;
 		if (g->direction == APOL_INFOFLOW_OUT) {
-			edge_list = cur_node->out_edges;
+			for (i = csr->out_start[cur_node]; i < csr->out_start[cur_node + 1]; i++) {
+				deck[degree++] = i;
+			}
 		} else {
-			edge_list = cur_node->in_edges;
-		}
-		edge_list = apol_infoflow_trans_further_shuffle(p, g, edge_list);
-		if (edge_list == NULL) {
-			goto cleanup;
-		}
-		for (i = 0; i < apol_vector_get_size(edge_list); i++) {
-			edge = (apol_infoflow_edge_t *) apol_vector_get_element(edge_list, i);
-			if (g->direction == APOL_INFOFLOW_OUT) {
-				node = edge->end_node;
-			} else {
-				node = edge->start_node;
+			for (i = csr->in_start[cur_node]; i < csr->in_start[cur_node + 1]; i++) {
+				deck[degree++] = csr->in_edges[i];
 			}
-			if (node->color == APOL_INFOFLOW_COLOR_WHITE) {
-				node->color = APOL_INFOFLOW_COLOR_GREY;
-				node->distance = cur_node->distance + 1;
-				node->parent = cur_node;
-				if (apol_queue_push(queue, node) < 0) {
-					ERR(p, "%s", strerror(ENOMEM));
-					goto cleanup;
-				}
+		}
+		apol_infoflow_trans_further_shuffle(g, deck, degree);
+		for (i = 0; i < degree; i++) {
+			edge = csr->edges + deck[i];
+			node = apol_infoflow_trans_next_node(g, edge);
+			if (g->color[node] == APOL_INFOFLOW_COLOR_WHITE) {
+				g->color[node] = APOL_INFOFLOW_COLOR_GREY;
+				g->distance[node] = g->distance[cur_node] + 1;
+				g->parent[node] = deck[i];
+				apol_infoflow_queue_push(g, node);
 			}
 		}
-		apol_vector_destroy(&edge_list);
 	}
 	retval = 0;
       cleanup:
-	apol_vector_destroy(&edge_list);
-	apol_queue_destroy(&queue);
+	free(deck);
 	return retval;
 }
 
@@ -1862,6 +2621,7 @@ int apol_infoflow_analysis_do(const apol_policy_t * p, const apol_infoflow_analy
 int apol_infoflow_analysis_do_more(const apol_policy_t * p, apol_infoflow_graph_t * g, const char *type, apol_vector_t ** v)
 {
 	const qpol_type_t *start_type;
+	size_t *start_nodes = NULL, num_start_nodes;
 	int retval = -1;
 	if (v != NULL) {
 		*v = NULL;
@@ -1880,24 +2640,144 @@ int apol_infoflow_analysis_do_more(const apol_policy_t * p, apol_infoflow_graph_
 		goto cleanup;
 	}
 
-	if ((g->mode == APOL_INFOFLOW_MODE_DIRECT &&
-	     apol_infoflow_analysis_direct(p, g, type, *v) < 0) ||
-	    (g->mode == APOL_INFOFLOW_MODE_TRANS && apol_infoflow_analysis_trans(p, g, type, *v) < 0)) {
+	if (apol_infoflow_graph_get_nodes_for_type(p, g, type, &start_nodes, &num_start_nodes) < 0 ||
+	    apol_infoflow_analysis_search(p, g, start_nodes, num_start_nodes, *v) < 0) {
 		goto cleanup;
 	}
 
 	retval = 0;
       cleanup:
+	free(start_nodes);
 	if (retval != 0) {
 		apol_vector_destroy(v);
 	}
 	return retval;
 }
 
+/** Shared state of a batch of infoflow analyses, one task per
+ *  starting type. */
+struct apol_infoflow_batch
+{
+	const apol_policy_t *p;
+	const apol_infoflow_analysis_t *ia;
+	apol_infoflow_csr_t *csr;
+	/** nodes of each starting type */
+	size_t **start_nodes, *num_start_nodes;
+	/** results of each starting type; the vectors do not own
+	 *  their results */
+	apol_vector_t **results;
+};
+
+/**
+ * Run the analysis from one starting type of a batch.  Each task
+ * searches with its own graph; all of them share the compressed
+ * graph, which is never modified.
+ */
+static int apol_infoflow_batch_task(void *arg, size_t task)
+{
+	struct apol_infoflow_batch *b = (struct apol_infoflow_batch *)arg;
+	apol_infoflow_graph_t *g = NULL;
+	int retval = -1;
+
+	if (apol_infoflow_graph_create_from_csr(b->p, b->ia, b->csr, &g) < 0) {
+		goto cleanup;
+	}
+	if (apol_infoflow_analysis_search(b->p, g, b->start_nodes[task], b->num_start_nodes[task], b->results[task]) < 0) {
+		goto cleanup;
+	}
+	retval = 0;
+      cleanup:
+	apol_infoflow_graph_destroy(&g);
+	return retval;
+}
+
+int apol_infoflow_analysis_do_batch(const apol_policy_t * p, const apol_infoflow_analysis_t * ia,
+				    const apol_vector_t * start_types, apol_vector_t ** v)
+{
+	struct apol_infoflow_batch b;
+	apol_infoflow_graph_t *g = NULL;
+	const qpol_type_t *start_type;
+	size_t num_types = 0, i, j;
+	int retval = -1;
+
+	memset(&b, 0, sizeof(b));
+	if (v != NULL) {
+		*v = NULL;
+	}
+	if (p == NULL || ia == NULL || start_types == NULL || v == NULL || ia->mode == 0 || ia->direction == 0) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		goto cleanup;
+	}
+	num_types = apol_vector_get_size(start_types);
+	b.p = p;
+	b.ia = ia;
+	if ((b.start_nodes = calloc(num_types + 1, sizeof(*b.start_nodes))) == NULL ||
+	    (b.num_start_nodes = calloc(num_types + 1, sizeof(*b.num_start_nodes))) == NULL ||
+	    (b.results = calloc(num_types + 1, sizeof(*b.results))) == NULL || (*v = apol_vector_create(infoflow_result_free)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	if (apol_infoflow_graph_create(p, ia, &g) < 0) {
+		goto cleanup;
+	}
+	b.csr = g->csr;
+
+	/* resolve starting types here, so that the tasks themselves
+	 * need not look up symbols */
+	for (i = 0; i < num_types; i++) {
+		const char *type = apol_vector_get_element(start_types, i);
+		if (apol_query_get_type(p, type, &start_type) < 0 ||
+		    apol_infoflow_graph_get_nodes_for_type(p, g, type, &b.start_nodes[i], &b.num_start_nodes[i]) < 0) {
+			goto cleanup;
+		}
+		if ((b.results[i] = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+	}
+
+	INFO(p, "%s", "Searching information flow graph.");
+	if (apol_query_run_tasks(p, apol_policy_get_query_threads(p), num_types, apol_infoflow_batch_task, &b) < 0) {
+		goto cleanup;
+	}
+	for (i = 0; i < num_types; i++) {
+		/* upon failure nothing is appended, so the results still
+		 * belong to b.results[i] */
+		if (apol_vector_cat(*v, b.results[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+		apol_vector_destroy(&b.results[i]);
+	}
+	retval = 0;
+      cleanup:
+	for (i = 0; i < num_types; i++) {
+		if (b.start_nodes != NULL) {
+			free(b.start_nodes[i]);
+		}
+		if (b.results != NULL && b.results[i] != NULL) {
+			for (j = 0; j < apol_vector_get_size(b.results[i]); j++) {
+				infoflow_result_free(apol_vector_get_element(b.results[i], j));
+			}
+			apol_vector_destroy(&b.results[i]);
+		}
+	}
+	free(b.start_nodes);
+	free(b.num_start_nodes);
+	free(b.results);
+	apol_infoflow_graph_destroy(&g);
+	if (retval != 0 && v != NULL) {
+		apol_vector_destroy(v);
+	}
+	return retval;
+}
+
 int apol_infoflow_analysis_trans_further_prepare(const apol_policy_t * p,
 						 apol_infoflow_graph_t * g, const char *start_type, const char *end_type)
 {
 	const qpol_type_t *stype, *etype;
+	size_t *end_nodes = NULL, num_end_nodes, i;
 	int retval = -1;
 
 	apol_infoflow_srand(g);
@@ -1908,25 +2788,30 @@ int apol_infoflow_analysis_trans_further_prepare(const apol_policy_t * p,
 		ERR(p, "%s", "May only perform further infoflow analysis when the graph is transitive.");
 		goto cleanup;
 	}
-	apol_vector_destroy(&g->further_start);
-	apol_vector_destroy(&g->further_end);
-	if ((g->further_start = apol_vector_create(NULL)) == NULL || (g->further_end = apol_vector_create(NULL)) == NULL) {
+	free(g->further_start);
+	g->further_start = NULL;
+	g->num_further_start = 0;
+	free(g->further_end);
+	if ((g->further_end = calloc(g->csr->num_nodes + 1, 1)) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
-	if (apol_infoflow_graph_get_nodes_for_type(p, g, start_type, g->further_start) < 0 ||
-	    apol_infoflow_graph_get_nodes_for_type(p, g, end_type, g->further_end) < 0) {
+	if (apol_infoflow_graph_get_nodes_for_type(p, g, start_type, &g->further_start, &g->num_further_start) < 0 ||
+	    apol_infoflow_graph_get_nodes_for_type(p, g, end_type, &end_nodes, &num_end_nodes) < 0) {
 		goto cleanup;
 	}
+	for (i = 0; i < num_end_nodes; i++) {
+		g->further_end[end_nodes[i]] = 1;
+	}
 	g->current_start = 0;
 	retval = 0;
       cleanup:
+	free(end_nodes);
 	return retval;
 }
 
 int apol_infoflow_analysis_trans_further_next(const apol_policy_t * p, apol_infoflow_graph_t * g, apol_vector_t ** v)
 {
-	apol_infoflow_node_t *start_node;
 	int retval = -1;
 	if (p == NULL || g == NULL || v == NULL) {
 		ERR(p, "%s", strerror(EINVAL));
@@ -1936,16 +2821,21 @@ int apol_infoflow_analysis_trans_further_next(const apol_policy_t * p, apol_info
 	if (*v == NULL) {
 		*v = apol_vector_create(infoflow_result_free);
 	}
-	if (g->further_start == NULL) {
+	if (g->further_end == NULL) {
 		ERR(p, "%s", "Infoflow graph was not prepared yet.");
 		goto cleanup;
 	}
-	start_node = apol_vector_get_element(g->further_start, g->current_start);
-	if (apol_infoflow_analysis_trans_further(p, g, start_node, *v) < 0) {
+	if (g->num_further_start == 0) {
+		/* the start type is not within the graph, so there
+		 * are no paths from it */
+		retval = 0;
+		goto cleanup;
+	}
+	if (apol_infoflow_analysis_trans_further(p, g, g->further_start[g->current_start], *v) < 0) {
 		goto cleanup;
 	}
 	g->current_start++;
-	if (g->current_start >= apol_vector_get_size(g->further_start)) {
+	if (g->current_start >= g->num_further_start) {
 		g->current_start = 0;
 	}
 	retval = 0;
@@ -1953,6 +2843,247 @@ int apol_infoflow_analysis_trans_further_next(const apol_policy_t * p, apol_info
 	return retval;
 }
 
+/**
+ * Results found by one worker of
+ * apol_infoflow_analysis_trans_further_run(), kept until all workers
+ * are done so that they may be merged in order of iteration.
+ */
+struct apol_infoflow_further_worker
+{
+	/** results that the worker had not already found, in the order
+	 *  found; this vector does not own its results */
+	apol_vector_t *results;
+	/** iteration that found each result, of iterations_size */
+	size_t *iterations;
+	size_t iterations_size;
+};
+
+/**
+ * State shared by the workers of
+ * apol_infoflow_analysis_trans_further_run().  Worker number w
+ * performs iterations w, w + num_workers, w + 2 * num_workers, and so
+ * forth.
+ */
+struct apol_infoflow_further_run
+{
+	const apol_policy_t *p;
+	/** prepared graph whose compressed graph, regular expression,
+	 *  and end nodes the workers share */
+	const apol_infoflow_graph_t *g;
+	unsigned int seed;
+	size_t num_workers, num_iterations;
+	/** if has_deadline, no iteration starts after this time */
+	int has_deadline;
+	struct timeval deadline;
+	/** array of num_workers workers' results */
+	struct apol_infoflow_further_worker *workers;
+};
+
+/**
+ * Determine if a further transitive analysis run has used up its
+ * time.
+ *
+ * @param run Run to check.
+ *
+ * @return Non-zero if no more iterations should start, zero if not.
+ */
+static int apol_infoflow_further_run_expired(const struct apol_infoflow_further_run *run)
+{
+	struct timeval now;
+	if (!run->has_deadline) {
+		return 0;
+	}
+	gettimeofday(&now, NULL);
+	return (now.tv_sec > run->deadline.tv_sec || (now.tv_sec == run->deadline.tv_sec && now.tv_usec >= run->deadline.tv_usec));
+}
+
+/**
+ * Perform one worker's share of a further transitive analysis run,
+ * upon its own infoflow graph.  This is a callback to
+ * apol_query_run_tasks().
+ *
+ * @param arg Pointer to a struct apol_infoflow_further_run.
+ * @param task Worker number.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_further_run_task(void *arg, size_t task)
+{
+	struct apol_infoflow_further_run *run = arg;
+	struct apol_infoflow_further_worker *worker = run->workers + task;
+	const apol_infoflow_graph_t *g = run->g;
+	apol_infoflow_analysis_t ia;
+	apol_infoflow_graph_t *w = NULL;
+	apol_vector_t *v = NULL;
+	apol_infoflow_result_t *r;
+	size_t i, next = 0, num_found, new_size, *iterations;
+	int retval = -1;
+
+	memset(&ia, 0, sizeof(ia));
+	ia.mode = g->mode;
+	ia.direction = g->direction;
+	if (apol_infoflow_graph_create_from_csr(run->p, &ia, g->csr, &w) < 0) {
+		goto cleanup;
+	}
+	/* borrow the prepared graph's regular expression and end
+	 * nodes; the searches only read them */
+	w->regex = g->regex;
+	w->further_end = g->further_end;
+	if ((worker->results = apol_vector_create(NULL)) == NULL) {
+		ERR(run->p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = task; i < run->num_iterations && !apol_infoflow_further_run_expired(run); i += run->num_workers) {
+		if ((v = apol_vector_create(NULL)) == NULL) {
+			ERR(run->p, "%s", strerror(errno));
+			goto cleanup;
+		}
+		next = 0;
+		apol_infoflow_srand_stream(w, run->seed, i);
+		if (apol_infoflow_analysis_trans_further(run->p, w, g->further_start[i % g->num_further_start], v) < 0) {
+			goto cleanup;
+		}
+		/* keep only paths this worker has not yet seen; a path
+		 * found by several iterations is thus kept at least by
+		 * the earliest of them */
+		for (; next < apol_vector_get_size(v); next++) {
+			r = apol_vector_get_element(v, next);
+			if (apol_infoflow_trans_find(worker->results, r)) {
+				infoflow_result_free(r);
+				continue;
+			}
+			num_found = apol_vector_get_size(worker->results);
+			if (num_found >= worker->iterations_size) {
+				new_size = (worker->iterations_size > 0 ? worker->iterations_size * 2 : 16);
+				if ((iterations = realloc(worker->iterations, new_size * sizeof(*iterations))) == NULL) {
+					ERR(run->p, "%s", strerror(errno));
+					goto cleanup;
+				}
+				worker->iterations = iterations;
+				worker->iterations_size = new_size;
+			}
+			if (apol_vector_append(worker->results, r) < 0) {
+				ERR(run->p, "%s", strerror(errno));
+				goto cleanup;
+			}
+			worker->iterations[num_found] = i;
+		}
+		apol_vector_destroy(&v);
+	}
+	retval = 0;
+      cleanup:
+	if (v != NULL) {
+		for (; next < apol_vector_get_size(v); next++) {
+			infoflow_result_free(apol_vector_get_element(v, next));
+		}
+		apol_vector_destroy(&v);
+	}
+	if (w != NULL) {
+		w->regex = NULL;
+		w->further_end = NULL;
+		apol_infoflow_graph_destroy(&w);
+	}
+	return retval;
+}
+
+int apol_infoflow_analysis_trans_further_run(const apol_policy_t * p, apol_infoflow_graph_t * g, unsigned int seed,
+					     size_t num_iterations, unsigned long max_msecs, apol_vector_t ** v)
+{
+	struct apol_infoflow_further_run run;
+	struct apol_infoflow_further_worker *worker;
+	apol_infoflow_result_t *r;
+	size_t *next = NULL, i = 0, w, iteration = 0;
+	int retval = -1;
+
+	memset(&run, 0, sizeof(run));
+	if (p == NULL || g == NULL || v == NULL || num_iterations == 0) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (*v == NULL && (*v = apol_vector_create(infoflow_result_free)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	if (g->further_end == NULL) {
+		ERR(p, "%s", "Infoflow graph was not prepared yet.");
+		return -1;
+	}
+	if (g->num_further_start == 0) {
+		/* the start type is not within the graph, so there
+		 * are no paths from it */
+		return 0;
+	}
+
+	run.p = p;
+	run.g = g;
+	run.seed = seed;
+	run.num_iterations = num_iterations;
+	if ((run.num_workers = apol_policy_get_query_threads(p)) > num_iterations) {
+		run.num_workers = num_iterations;
+	}
+	if (max_msecs > 0) {
+		run.has_deadline = 1;
+		gettimeofday(&run.deadline, NULL);
+		run.deadline.tv_sec += max_msecs / 1000;
+		run.deadline.tv_usec += (max_msecs % 1000) * 1000;
+		if (run.deadline.tv_usec >= 1000000) {
+			run.deadline.tv_sec++;
+			run.deadline.tv_usec -= 1000000;
+		}
+	}
+	if ((run.workers = calloc(run.num_workers, sizeof(*run.workers))) == NULL ||
+	    (next = calloc(run.num_workers, sizeof(*next))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	if (apol_query_run_tasks(p, run.num_workers, run.num_workers, apol_infoflow_further_run_task, &run) < 0) {
+		goto cleanup;
+	}
+
+	/* merge in order of iteration, so that the results are the
+	 * same no matter how many threads found them; each worker's
+	 * results are already in order */
+	for (;;) {
+		worker = NULL;
+		for (w = 0; w < run.num_workers; w++) {
+			if (next[w] < apol_vector_get_size(run.workers[w].results) &&
+			    (worker == NULL || run.workers[w].iterations[next[w]] < iteration)) {
+				worker = run.workers + w;
+				iteration = worker->iterations[next[w]];
+				i = w;
+			}
+		}
+		if (worker == NULL) {
+			break;
+		}
+		for (; next[i] < apol_vector_get_size(worker->results) && worker->iterations[next[i]] == iteration; next[i]++) {
+			r = apol_vector_get_element(worker->results, next[i]);
+			if (apol_infoflow_trans_find(*v, r)) {
+				infoflow_result_free(r);
+			} else if (apol_vector_append(*v, r) < 0) {
+				ERR(p, "%s", strerror(errno));
+				goto cleanup;
+			}
+		}
+	}
+	retval = 0;
+      cleanup:
+	if (run.workers != NULL) {
+		/* free whatever results were not yet merged */
+		for (w = 0; w < run.num_workers; w++) {
+			for (i = (next != NULL ? next[w] : 0); i < apol_vector_get_size(run.workers[w].results); i++) {
+				infoflow_result_free(apol_vector_get_element(run.workers[w].results, i));
+			}
+			apol_vector_destroy(&run.workers[w].results);
+			free(run.workers[w].iterations);
+		}
+		free(run.workers);
+	}
+	free(next);
+	return retval;
+}
+
 apol_infoflow_analysis_t *apol_infoflow_analysis_create(void)
 {
 	return calloc(1, sizeof(apol_infoflow_analysis_t));
@@ -0,0 +1,271 @@
+/**
+ *  @file
+ *  Implementation of a table of interned strings, using open
+ *  addressing over string hashes and an arena for the strings.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <apol/intern.h>
+#include <apol/util.h>
+#include <apol/vector.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Size of each block of string storage, unless a longer string
+ *  needs a bigger one. */
+#define INTERN_CHUNK_SIZE 16384
+
+/** Initial number of hash slots; must be a power of 2. */
+#define INTERN_INIT_SLOTS 64
+
+/** A block of string storage. */
+typedef struct intern_chunk
+{
+	struct intern_chunk *next;
+	char data[];
+} intern_chunk_t;
+
+struct apol_intern
+{
+	/** interned strings, indexed by identifier */
+	const char **strs;
+	/** hash of each string, indexed by identifier */
+	uint32_t *hashes;
+	/** number of strings, and space in strs and hashes */
+	size_t size, capacity;
+	/** open addressed hash table holding identifier + 1 for each
+	 *  string, or 0 for unused slots */
+	size_t *slots;
+	/** number of slots; always a power of 2 and kept at most 3/4
+	 *  full */
+	size_t num_slots;
+	/** list of storage blocks, most recent first */
+	intern_chunk_t *chunks;
+	/** unused space at the end of the most recent block */
+	char *next;
+	size_t avail;
+};
+
+/** FNV-1a hash of a string. */
+static uint32_t intern_hash(const char *str)
+{
+	uint32_t h = 2166136261U;
+	for (; *str != '\0'; str++) {
+		h ^= (unsigned char)*str;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/**
+ * Find the slot holding a string, or the empty slot where it would
+ * be inserted.
+ */
+static size_t intern_find_slot(const apol_intern_t * t, const char *str, uint32_t h)
+{
+	size_t mask = t->num_slots - 1, i = h & mask;
+	while (t->slots[i] != 0) {
+		size_t id = t->slots[i] - 1;
+		if (t->hashes[id] == h && strcmp(t->strs[id], str) == 0) {
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+static int intern_grow_slots(apol_intern_t * t)
+{
+	size_t num_slots = t->num_slots * 2, mask = num_slots - 1, *slots, id;
+	if ((slots = calloc(num_slots, sizeof(*slots))) == NULL) {
+		return -1;
+	}
+	for (id = 0; id < t->size; id++) {
+		size_t i = t->hashes[id] & mask;
+		while (slots[i] != 0) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = id + 1;
+	}
+	free(t->slots);
+	t->slots = slots;
+	t->num_slots = num_slots;
+	return 0;
+}
+
+/** Copy a string into the table's storage. */
+static char *intern_copy(apol_intern_t * t, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *s;
+	if (len > t->avail) {
+		size_t size = (len > INTERN_CHUNK_SIZE ? len : INTERN_CHUNK_SIZE);
+		intern_chunk_t *chunk = malloc(sizeof(*chunk) + size);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunk->next = t->chunks;
+		t->chunks = chunk;
+		t->next = chunk->data;
+		t->avail = size;
+	}
+	s = t->next;
+	memcpy(s, str, len);
+	t->next += len;
+	t->avail -= len;
+	return s;
+}
+
+apol_intern_t *apol_intern_create(void)
+{
+	apol_intern_t *t;
+	if ((t = calloc(1, sizeof(*t))) == NULL) {
+		return NULL;
+	}
+	if ((t->slots = calloc(INTERN_INIT_SLOTS, sizeof(*t->slots))) == NULL) {
+		free(t);
+		errno = ENOMEM;
+		return NULL;
+	}
+	t->num_slots = INTERN_INIT_SLOTS;
+	return t;
+}
+
+void apol_intern_destroy(apol_intern_t ** t)
+{
+	intern_chunk_t *chunk, *next;
+	if (!t || !(*t)) {
+		return;
+	}
+	for (chunk = (*t)->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	free((*t)->strs);
+	free((*t)->hashes);
+	free((*t)->slots);
+	free(*t);
+	*t = NULL;
+}
+
+size_t apol_intern_get_size(const apol_intern_t * t)
+{
+	if (!t) {
+		errno = EINVAL;
+		return 0;
+	}
+	return t->size;
+}
+
+const char *apol_intern_str(apol_intern_t * t, const char *str, size_t * id)
+{
+	uint32_t h;
+	size_t i;
+	char *s;
+
+	if (!t || !str) {
+		errno = EINVAL;
+		return NULL;
+	}
+	h = intern_hash(str);
+	i = intern_find_slot(t, str, h);
+	if (t->slots[i] == 0) {
+		if (t->size == t->capacity) {
+			size_t cap = (t->capacity > 0 ? t->capacity * 2 : INTERN_INIT_SLOTS);
+			const char **strs;
+			uint32_t *hashes;
+			if ((strs = realloc(t->strs, cap * sizeof(*strs))) == NULL) {
+				return NULL;
+			}
+			t->strs = strs;
+			if ((hashes = realloc(t->hashes, cap * sizeof(*hashes))) == NULL) {
+				return NULL;
+			}
+			t->hashes = hashes;
+			t->capacity = cap;
+		}
+		if ((t->size + 1) * 4 > t->num_slots * 3) {
+			if (intern_grow_slots(t) < 0) {
+				return NULL;
+			}
+			i = intern_find_slot(t, str, h);
+		}
+		if ((s = intern_copy(t, str)) == NULL) {
+			return NULL;
+		}
+		t->strs[t->size] = s;
+		t->hashes[t->size] = h;
+		t->slots[i] = ++t->size;
+	}
+	if (id != NULL) {
+		*id = t->slots[i] - 1;
+	}
+	return t->strs[t->slots[i] - 1];
+}
+
+const char *apol_intern_get(const apol_intern_t * t, const char *str, size_t * id)
+{
+	size_t i;
+	if (!t || !str) {
+		errno = EINVAL;
+		return NULL;
+	}
+	i = intern_find_slot(t, str, intern_hash(str));
+	if (t->slots[i] == 0) {
+		return NULL;
+	}
+	if (id != NULL) {
+		*id = t->slots[i] - 1;
+	}
+	return t->strs[t->slots[i] - 1];
+}
+
+const char *apol_intern_get_by_id(const apol_intern_t * t, size_t id)
+{
+	if (!t || id >= t->size) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return t->strs[id];
+}
+
+apol_vector_t *apol_intern_get_vector(const apol_intern_t * t)
+{
+	apol_vector_t *v;
+	size_t id;
+	if (!t) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((v = apol_vector_create_with_capacity(t->size, NULL)) == NULL) {
+		return NULL;
+	}
+	for (id = 0; id < t->size; id++) {
+		if (apol_vector_append(v, (void *)t->strs[id]) < 0) {
+			int error = errno;
+			apol_vector_destroy(&v);
+			errno = error;
+			return NULL;
+		}
+	}
+	apol_vector_sort(v, apol_str_strcmp, NULL);
+	return v;
+}
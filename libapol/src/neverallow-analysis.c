@@ -0,0 +1,550 @@
+/**
+ * @file
+ * Implementation of the neverallow analysis.  Each rule's source and
+ * target are expanded into bitsets of type and attribute values, and
+ * the allow rules are indexed by object class and source so that
+ * each neverallow rule need only look at the allow rules that could
+ * possibly overlap it.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "policy-query-internal.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct apol_neverallow_analysis
+{
+	apol_vector_t *classes;
+};
+
+struct apol_neverallow_result
+{
+	const qpol_avrule_t *neverallow, *allow;
+	uint32_t class_val, perms;
+};
+
+#define NEVERALLOW_WORD_BITS (sizeof(unsigned long) * 8)
+
+/** An allow rule as stored within the index. */
+typedef struct neverallow_allow
+{
+	uint32_t target, perms;
+	const qpol_avrule_t *rule;
+} neverallow_allow_t;
+
+/**
+ * Everything needed to check neverallow rules.  Type and attribute
+ * values share one numbering, from 1 to num_types.
+ */
+typedef struct neverallow_index
+{
+	uint32_t num_types, num_classes;
+	/** number of words in each bitset */
+	size_t num_words;
+	/** qpol type for each value, indexed by value - 1 */
+	const qpol_type_t **types;
+	/** for each value, a bitset of every type and attribute whose
+	 *  expansion shares a type with this value's expansion; built
+	 *  as needed */
+	unsigned long **keys;
+	/** allow rules, grouped by object class and then source */
+	neverallow_allow_t *allows;
+	/** allows[start[k]] through allows[start[k + 1] - 1] are the
+	 *  rules of key k, where k is (class - 1) * num_types + (source
+	 *  - 1) */
+	size_t *start;
+} neverallow_index_t;
+
+static void neverallow_index_destroy(neverallow_index_t * idx)
+{
+	uint32_t i;
+	if (idx->keys != NULL) {
+		for (i = 0; i < idx->num_types; i++) {
+			free(idx->keys[i]);
+		}
+	}
+	free(idx->keys);
+	free(idx->types);
+	free(idx->allows);
+	free(idx->start);
+}
+
+/**
+ * Get the value of a rule's source and target types, object class,
+ * and permission mask.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int neverallow_rule_get_key(const apol_policy_t * p, const qpol_avrule_t * rule, uint32_t * source, uint32_t * target,
+				   uint32_t * class_val, uint32_t * perms)
+{
+	const qpol_type_t *type;
+	if (qpol_avrule_get_source_type(p->p, rule, &type) < 0 || qpol_type_get_value(p->p, type, source) < 0 ||
+	    qpol_avrule_get_target_type(p->p, rule, &type) < 0 || qpol_type_get_value(p->p, type, target) < 0 ||
+	    qpol_avrule_get_perm_mask(p->p, rule, class_val, perms) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Return the bitset of types and attributes that overlap with a
+ * value.  For a type this is the type itself and every attribute
+ * containing it; for an attribute it is the union of that over every
+ * member type.
+ *
+ * @return Bitset owned by the index, or NULL on error.
+ */
+static const unsigned long *neverallow_index_get_keys(const apol_policy_t * p, neverallow_index_t * idx, uint32_t value)
+{
+	qpol_iterator_t *iter = NULL;
+	const qpol_type_t *type;
+	const unsigned long *sub;
+	unsigned long *keys = NULL;
+	unsigned char isattr;
+	uint32_t v;
+	size_t i;
+	int error = 0;
+
+	if (value < 1 || value > idx->num_types || idx->types[value - 1] == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return NULL;
+	}
+	if (idx->keys[value - 1] != NULL) {
+		return idx->keys[value - 1];
+	}
+	if ((keys = calloc(idx->num_words, sizeof(*keys))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	if (qpol_type_get_isattr(p->p, idx->types[value - 1], &isattr) < 0) {
+		error = errno;
+		goto err;
+	}
+	if (isattr) {
+		if (qpol_type_get_type_iter(p->p, idx->types[value - 1], &iter) < 0) {
+			error = errno;
+			goto err;
+		}
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			if (qpol_iterator_get_item(iter, (void **)&type) < 0 || qpol_type_get_value(p->p, type, &v) < 0 ||
+			    (sub = neverallow_index_get_keys(p, idx, v)) == NULL) {
+				error = errno;
+				goto err;
+			}
+			for (i = 0; i < idx->num_words; i++) {
+				keys[i] |= sub[i];
+			}
+		}
+	} else {
+		keys[(value - 1) / NEVERALLOW_WORD_BITS] |= 1UL << ((value - 1) % NEVERALLOW_WORD_BITS);
+		if (qpol_type_get_attr_iter(p->p, idx->types[value - 1], &iter) < 0) {
+			error = errno;
+			goto err;
+		}
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			if (qpol_iterator_get_item(iter, (void **)&type) < 0 || qpol_type_get_value(p->p, type, &v) < 0) {
+				error = errno;
+				goto err;
+			}
+			if (v >= 1 && v <= idx->num_types) {
+				keys[(v - 1) / NEVERALLOW_WORD_BITS] |= 1UL << ((v - 1) % NEVERALLOW_WORD_BITS);
+			}
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	idx->keys[value - 1] = keys;
+	return keys;
+      err:
+	qpol_iterator_destroy(&iter);
+	free(keys);
+	errno = error;
+	return NULL;
+}
+
+/**
+ * Record every type, and then sort all allow rules by object class
+ * and source value with a counting sort.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int neverallow_index_build(const apol_policy_t * p, neverallow_index_t * idx)
+{
+	qpol_iterator_t *iter = NULL;
+	const qpol_type_t *type;
+	const qpol_class_t *obj_class;
+	const qpol_avrule_t *rule;
+	neverallow_allow_t *a;
+	unsigned char isalias;
+	uint32_t v, source, target, class_val, perms;
+	size_t num_keys, num_allows = 0, i, k, *fill = NULL;
+	int error = 0;
+
+	if (qpol_policy_get_type_iter(p->p, &iter) < 0) {
+		error = errno;
+		goto err;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&type) < 0 || qpol_type_get_value(p->p, type, &v) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (v > idx->num_types) {
+			idx->num_types = v;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	idx->num_words = (idx->num_types + NEVERALLOW_WORD_BITS - 1) / NEVERALLOW_WORD_BITS;
+	if ((idx->types = calloc(idx->num_types + 1, sizeof(*idx->types))) == NULL ||
+	    (idx->keys = calloc(idx->num_types + 1, sizeof(*idx->keys))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	if (qpol_policy_get_type_iter(p->p, &iter) < 0) {
+		error = errno;
+		goto err;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&type) < 0 || qpol_type_get_isalias(p->p, type, &isalias) < 0 ||
+		    qpol_type_get_value(p->p, type, &v) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (!isalias && v >= 1) {
+			idx->types[v - 1] = type;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+
+	if (qpol_policy_get_class_iter(p->p, &iter) < 0) {
+		error = errno;
+		goto err;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&obj_class) < 0 || qpol_class_get_value(p->p, obj_class, &v) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (v > idx->num_classes) {
+			idx->num_classes = v;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+
+	num_keys = (size_t) idx->num_classes * idx->num_types;
+	if ((idx->start = calloc(num_keys + 2, sizeof(*idx->start))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+
+	/* first pass counts the rules for each key, second places them */
+	if (qpol_policy_get_avrule_iter(p->p, QPOL_RULE_ALLOW, &iter) < 0) {
+		error = errno;
+		goto err;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&rule) < 0 ||
+		    neverallow_rule_get_key(p, rule, &source, &target, &class_val, &perms) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (source < 1 || source > idx->num_types || class_val < 1 || class_val > idx->num_classes) {
+			continue;
+		}
+		idx->start[(class_val - 1) * (size_t) idx->num_types + source]++;
+		num_allows++;
+	}
+	qpol_iterator_destroy(&iter);
+	for (k = 1; k <= num_keys; k++) {
+		idx->start[k] += idx->start[k - 1];
+	}
+	if ((idx->allows = malloc((num_allows + 1) * sizeof(*idx->allows))) == NULL ||
+	    (fill = malloc((num_keys + 1) * sizeof(*fill))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto err;
+	}
+	memcpy(fill, idx->start, (num_keys + 1) * sizeof(*fill));
+	if (qpol_policy_get_avrule_iter(p->p, QPOL_RULE_ALLOW, &iter) < 0) {
+		error = errno;
+		goto err;
+	}
+	for (i = 0; !qpol_iterator_end(iter) && i < num_allows; qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&rule) < 0 ||
+		    neverallow_rule_get_key(p, rule, &source, &target, &class_val, &perms) < 0) {
+			error = errno;
+			goto err;
+		}
+		if (source < 1 || source > idx->num_types || class_val < 1 || class_val > idx->num_classes) {
+			continue;
+		}
+		a = idx->allows + fill[(class_val - 1) * (size_t) idx->num_types + source - 1]++;
+		a->target = target;
+		a->perms = perms;
+		a->rule = rule;
+		i++;
+	}
+	qpol_iterator_destroy(&iter);
+	free(fill);
+	return 0;
+      err:
+	qpol_iterator_destroy(&iter);
+	free(fill);
+	errno = error;
+	return -1;
+}
+
+/**
+ * Check one neverallow rule against the indexed allow rules,
+ * appending an apol_neverallow_result_t to v for each violation.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int neverallow_check_rule(const apol_policy_t * p, neverallow_index_t * idx, const qpol_avrule_t * neverallow,
+				 const unsigned char *class_ok, apol_vector_t * v)
+{
+	const unsigned long *source_keys, *target_keys;
+	const neverallow_allow_t *a, *end;
+	apol_neverallow_result_t *r;
+	uint32_t source, target, class_val, perms, k;
+	unsigned long word;
+	size_t w, base;
+	int bit;
+
+	if (neverallow_rule_get_key(p, neverallow, &source, &target, &class_val, &perms) < 0) {
+		return -1;
+	}
+	if (class_val < 1 || class_val > idx->num_classes || (class_ok != NULL && !class_ok[class_val])) {
+		return 0;
+	}
+	if ((source_keys = neverallow_index_get_keys(p, idx, source)) == NULL ||
+	    (target_keys = neverallow_index_get_keys(p, idx, target)) == NULL) {
+		return -1;
+	}
+	base = (class_val - 1) * (size_t) idx->num_types;
+	for (w = 0; w < idx->num_words; w++) {
+		for (word = source_keys[w], bit = 0; word != 0; word >>= 1, bit++) {
+			if (!(word & 1)) {
+				continue;
+			}
+			k = w * NEVERALLOW_WORD_BITS + bit;
+			end = idx->allows + idx->start[base + k + 1];
+			for (a = idx->allows + idx->start[base + k]; a < end; a++) {
+				if ((a->perms & perms) == 0 || a->target < 1 || a->target > idx->num_types ||
+				    !(target_keys[(a->target - 1) / NEVERALLOW_WORD_BITS] &
+				      (1UL << ((a->target - 1) % NEVERALLOW_WORD_BITS)))) {
+					continue;
+				}
+				if ((r = malloc(sizeof(*r))) == NULL || apol_vector_append(v, r) < 0) {
+					ERR(p, "%s", strerror(ENOMEM));
+					free(r);
+					errno = ENOMEM;
+					return -1;
+				}
+				r->neverallow = neverallow;
+				r->allow = a->rule;
+				r->class_val = class_val;
+				r->perms = a->perms & perms;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * Convert the analysis's class names into a table of flags, indexed
+ * by class value.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int neverallow_analysis_get_classes(const apol_policy_t * p, const apol_neverallow_analysis_t * n,
+					   const neverallow_index_t * idx, unsigned char **class_ok)
+{
+	const qpol_class_t *obj_class;
+	uint32_t v;
+	size_t i;
+
+	*class_ok = NULL;
+	if (n->classes == NULL || apol_vector_get_size(n->classes) == 0) {
+		return 0;
+	}
+	if ((*class_ok = calloc(idx->num_classes + 1, 1)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < apol_vector_get_size(n->classes); i++) {
+		/* unknown classes simply match nothing */
+		if (qpol_policy_get_class_by_name(p->p, apol_vector_get_element(n->classes, i), &obj_class) < 0) {
+			continue;
+		}
+		if (qpol_class_get_value(p->p, obj_class, &v) < 0) {
+			free(*class_ok);
+			*class_ok = NULL;
+			return -1;
+		}
+		if (v <= idx->num_classes) {
+			(*class_ok)[v] = 1;
+		}
+	}
+	return 0;
+}
+
+/******************** public functions below ********************/
+
+int apol_neverallow_analysis_do(const apol_policy_t * p, apol_neverallow_analysis_t * n, apol_vector_t ** v)
+{
+	neverallow_index_t idx;
+	qpol_iterator_t *iter = NULL;
+	const qpol_avrule_t *rule;
+	unsigned char *class_ok = NULL;
+	int retval = -1, error = 0;
+
+	memset(&idx, 0, sizeof(idx));
+	if (v != NULL) {
+		*v = NULL;
+	}
+	if (p == NULL || n == NULL || v == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (!qpol_policy_has_capability(p->p, QPOL_CAP_NEVERALLOW)) {
+		ERR(p, "%s", "Cannot check neverallow rules: Neverallow rules were not loaded.");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if (neverallow_index_build(p, &idx) < 0 || neverallow_analysis_get_classes(p, n, &idx, &class_ok) < 0) {
+		error = errno;
+		goto cleanup;
+	}
+	if ((*v = apol_vector_create(free)) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto cleanup;
+	}
+	if (qpol_policy_get_avrule_iter(p->p, QPOL_RULE_NEVERALLOW, &iter) < 0) {
+		error = errno;
+		goto cleanup;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&rule) < 0 || neverallow_check_rule(p, &idx, rule, class_ok, *v) < 0) {
+			error = errno;
+			goto cleanup;
+		}
+	}
+
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	free(class_ok);
+	neverallow_index_destroy(&idx);
+	if (retval != 0) {
+		apol_vector_destroy(v);
+		errno = error;
+	}
+	return retval;
+}
+
+apol_neverallow_analysis_t *apol_neverallow_analysis_create(void)
+{
+	return calloc(1, sizeof(apol_neverallow_analysis_t));
+}
+
+void apol_neverallow_analysis_destroy(apol_neverallow_analysis_t ** n)
+{
+	if (n != NULL && *n != NULL) {
+		apol_vector_destroy(&(*n)->classes);
+		free(*n);
+		*n = NULL;
+	}
+}
+
+int apol_neverallow_analysis_append_class(const apol_policy_t * p, apol_neverallow_analysis_t * n, const char *obj_class)
+{
+	char *s = NULL;
+	if (p == NULL || n == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (obj_class == NULL) {
+		apol_vector_destroy(&n->classes);
+	} else if ((s = strdup(obj_class)) == NULL || (n->classes == NULL && (n->classes = apol_vector_create(free)) == NULL)
+		   || apol_vector_append(n->classes, s) < 0) {
+		ERR(p, "%s", strerror(errno));
+		free(s);
+		return -1;
+	}
+	return 0;
+}
+
+/******************** functions to access neverallow results ********************/
+
+const qpol_avrule_t *apol_neverallow_result_get_neverallow(const apol_neverallow_result_t * r)
+{
+	if (r == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return r->neverallow;
+}
+
+const qpol_avrule_t *apol_neverallow_result_get_allow(const apol_neverallow_result_t * r)
+{
+	if (r == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return r->allow;
+}
+
+apol_vector_t *apol_neverallow_result_get_perms(const apol_policy_t * p, const apol_neverallow_result_t * r)
+{
+	const char *const *names;
+	apol_vector_t *v = NULL;
+	size_t i;
+
+	if (p == NULL || r == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return NULL;
+	}
+	if ((names = apol_query_get_perm_names(p, r->class_val)) == NULL) {
+		return NULL;
+	}
+	if ((v = apol_vector_create(NULL)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return NULL;
+	}
+	for (i = 0; i < APOL_QUERY_MAX_PERMS; i++) {
+		if ((r->perms & (1U << i)) && names[i] != NULL && apol_vector_append(v, (void *)names[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
+			apol_vector_destroy(&v);
+			return NULL;
+		}
+	}
+	return v;
+}
@@ -40,7 +40,9 @@ extern "C"
 #include <apol/util.h>
 #include <apol/vector.h>
 
+#include <pthread.h>
 #include <regex.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <qpol/policy.h>
 
@@ -53,6 +55,9 @@ extern "C"
 /* declared in perm-map.c */
 	typedef struct apol_permmap apol_permmap_t;
 
+/* forward declaration. the definition resides within infoflow-analysis.c */
+	typedef struct apol_infoflow_csr apol_infoflow_csr_t;
+
 	struct apol_policy
 	{
 		qpol_policy_t *p;
@@ -63,8 +68,41 @@ extern "C"
 		struct apol_permmap *pmap;
 	/** for domain trans analysis; table built as needed */
 		struct apol_domain_trans_table *domain_trans_table;
+	/** non-zero once apol_policy_freeze() has been called */
+		int frozen;
+	/** once frozen, held while an analysis uses the scratch flags
+	 *  within domain_trans_table */
+		pthread_mutex_t domain_trans_lock;
+	/** number of threads used by rule queries; 0 means one */
+		size_t query_threads;
+	/** candidate type lists already resolved, keyed by symbol and
+	 *  flags; built as needed */
+		struct apol_bst *type_list_cache;
+	/** qpol generation for which type_list_cache is valid */
+		unsigned int type_list_generation;
+	/** once frozen, held while type_list_cache is used */
+		pthread_mutex_t type_list_lock;
+	/** permission names of each class, APOL_QUERY_MAX_PERMS per
+	 *  class, indexed by class value - 1 and then permission value
+	 *  - 1; built as needed and always built once frozen */
+		const char **perm_names;
+	/** number of classes within perm_names */
+		size_t perm_names_num_classes;
+	/** qpol generation for which perm_names is valid */
+		unsigned int perm_names_generation;
+	/** incremented whenever the permission map changes */
+		unsigned int permmap_generation;
+	/** information flow graphs for unfiltered direct and
+	 *  transitive analyses, in that order; built as needed */
+		apol_infoflow_csr_t *infoflow_graphs[2];
+	/** once frozen, held while infoflow_graphs is used */
+		pthread_mutex_t infoflow_lock;
 	};
 
+/** Most permissions a class may have; permission sets are 32-bit
+ *  masks. */
+#define APOL_QUERY_MAX_PERMS 32
+
 /** Every query allows the treatment of strings as regular expressions
  *  instead.  Within the query structure are flags; if the first bit
  *  is set then use regex matching instead. */
@@ -83,6 +121,45 @@ extern "C"
 
 #define APOL_QUERY_MATCH_ALL_PERMS 0x1000
 
+/** Number of rules fetched at a time from a qpol iterator by the rule
+ *  queries; see qpol_iterator_next_batch(). */
+#define APOL_QUERY_BATCH_SIZE 256
+
+/** Number of tasks per thread into which a parallel rule query is
+ *  split, so that threads given quick tasks can take on more. */
+#define APOL_QUERY_TASKS_PER_THREAD 4
+
+/**
+ * Function run for each task by apol_query_run_tasks().
+ *
+ * @param arg Argument given to apol_query_run_tasks().
+ * @param task Task number, from 0 to one less than the number of
+ * tasks.
+ *
+ * @return 0 on success, < 0 on error with errno set.
+ */
+	typedef int (apol_query_task_fn_t) (void *arg, size_t task);
+
+/**
+ * Run a number of independent tasks using up to num_threads threads,
+ * including the calling thread.  Tasks are handed out in increasing
+ * order, but may finish in any order; each task should write its
+ * results to its own location.  Once a task fails no further tasks
+ * are started.
+ *
+ * @param p Policy handler, for error reporting.
+ * @param num_threads Maximum number of threads to use.  If 0 or 1,
+ * all tasks are run by the calling thread.
+ * @param num_tasks Number of tasks.
+ * @param fn Function to call for each task.
+ * @param arg Argument passed to fn.
+ *
+ * @return 0 if every task succeeded, < 0 if any failed.  On failure
+ * errno is set to the error of the first task that failed.
+ */
+	int apol_query_run_tasks(const apol_policy_t * p, size_t num_threads, size_t num_tasks, apol_query_task_fn_t * fn,
+				 void *arg);
+
 /**
  * Destroy a compiled regular expression, setting it to NULL
  * afterwards.	Does nothing if the reference is NULL.
@@ -133,7 +210,9 @@ extern "C"
  * expression if NULL, and (2) apply it to target.  Otherwise do a
  * string comparison between name and target.  If name is NULL and/or
  * empty then the comparison always succeeds regardless of flags and
- * regex.
+ * regex.  Expressions made only of literals, anchors and
+ * alternations (such as "^httpd_" or "^(a|b)$") are matched without
+ * calling regexec().
  *
  * @param p Policy handler.
  * @param target Name of target symbol to compare.
@@ -143,7 +222,8 @@ extern "C"
  * @param regex If using regexp comparison, the compiled regular
  * expression to use; the pointer will be allocated space if regexp is
  * legal.  If NULL, then compile the regexp pattern given by name and
- * cache it here.
+ * cache it here.  A non-NULL value must have come from an earlier
+ * call to this function; release it with apol_regex_destroy().
  *
  * @return 1 If comparison succeeds, 0 if not; < 0 on error.
  */
@@ -349,6 +429,10 @@ extern "C"
  * APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_SYMBOL_IS_BOTH) whether
  * symbol should be matched against type names or attribute names.
  *
+ * The list is remembered within p, so later calls with the same
+ * arguments skip resolving the symbol again until the policy is
+ * rebuilt.
+ *
  * @return Vector of unique qpol_type_t pointers (relative to policy
  * within p), or NULL upon error.  Caller is responsible for calling
  * apol_vector_destroy() afterwards.
@@ -376,6 +460,9 @@ extern "C"
  * APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_SYMBOL_IS_BOTH) whether
  * symbol should be matched against type names or attribute names.
  *
+ * Like apol_query_create_candidate_type_list(), the list is
+ * remembered within p.
+ *
  * @return Vector of unique qpol_type_t pointers (relative to policy
  * within p), or NULL upon error.  Caller is responsible for calling
  * apol_vector_destroy() afterwards.
@@ -383,6 +470,70 @@ extern "C"
 	apol_vector_t *apol_query_create_candidate_syn_type_list(const apol_policy_t * p, const char *symbol, int do_regex,
 								 int do_indirect, unsigned int ta_flag);
 
+/**
+ * Forget all candidate type lists remembered within a policy.
+ *
+ * @param p Policy whose cache to destroy.
+ */
+	void apol_query_type_list_cache_destroy(apol_policy_t * p);
+
+/**
+ * Build the policy's table of permission names, so that
+ * apol_query_get_perm_names() need not look up names one at a time.
+ * This does nothing if the table is already current.
+ *
+ * @param p Policy whose table to build.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_build_perm_names(apol_policy_t * p);
+
+/**
+ * Get the names of a class's permissions, including those it
+ * inherits from its common, indexed by permission value - 1.  The
+ * name of permission value v is thus set if bit (v - 1) of a mask
+ * returned by qpol_avrule_get_perm_mask() is set.
+ *
+ * @param p Policy containing the class.
+ * @param class_val Value of the class.
+ *
+ * @return Array of APOL_QUERY_MAX_PERMS names, NULL for unused
+ * values, or NULL on error.  The array belongs to the policy and is
+ * valid until the policy is rebuilt.
+ */
+	const char *const *apol_query_get_perm_names(const apol_policy_t * p, uint32_t class_val);
+
+/** Where a renderer writes: to a file if fp is set, or else appended
+ *  to a growing string. */
+	typedef struct apol_render_out
+	{
+		FILE *fp;
+	/** the string so far, or NULL if nothing is written yet */
+		char *buf;
+	/** length of buf and the space allocated for it */
+		size_t len, size;
+	} apol_render_out_t;
+
+/**
+ * Write a string to a render destination.
+ *
+ * @param out Destination to write.
+ * @param str String to write.
+ *
+ * @return 0 on success, < 0 on error with errno set.
+ */
+	int apol_render_out_puts(apol_render_out_t * out, const char *str);
+
+/**
+ * Write a formatted string, as per printf(3), to a render destination.
+ *
+ * @param out Destination to write.
+ * @param fmt Format of the string to write.
+ *
+ * @return 0 on success, < 0 on error with errno set.
+ */
+	int apol_render_out_printf(apol_render_out_t * out, const char *fmt, ...) __attribute__ ((format(printf, 2, 3)));
+
 /**
  * Given a symbol name (a role or a regular expression string),
  * determine all roles it matches.  Return a vector of qpol_role_t
@@ -414,6 +565,75 @@ extern "C"
  */
 	apol_vector_t *apol_query_create_candidate_class_list(const apol_policy_t * p, apol_vector_t * classes);
 
+/** A set of policy symbols held as one bit per symbol value, so that
+ *  membership can be tested without searching a candidate vector. */
+	typedef struct apol_query_bitmap
+	{
+	/** bit (v - 1) is set if the symbol with value v is a member */
+		uint32_t *bits;
+	/** number of bits allocated; values beyond this are not members */
+		uint32_t num_bits;
+	} apol_query_bitmap_t;
+
+/**
+ * Build a bitmap from a candidate type list, such as the one returned
+ * by apol_query_create_candidate_type_list().
+ *
+ * @param p Policy in which the types were found.
+ * @param types Vector of qpol_type_t pointers.
+ * @param bitmap Bitmap to initialize.  The caller must call
+ * apol_query_bitmap_destroy() afterwards, even on error.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_bitmap_create_from_types(const apol_policy_t * p, const apol_vector_t * types, apol_query_bitmap_t * bitmap);
+
+/**
+ * Build a bitmap from a candidate class list, such as the one
+ * returned by apol_query_create_candidate_class_list().
+ *
+ * @param p Policy in which the classes were found.
+ * @param classes Vector of qpol_class_t pointers.
+ * @param bitmap Bitmap to initialize.  The caller must call
+ * apol_query_bitmap_destroy() afterwards, even on error.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_bitmap_create_from_classes(const apol_policy_t * p, const apol_vector_t * classes,
+						  apol_query_bitmap_t * bitmap);
+
+/**
+ * Free the space used by a bitmap.  The bitmap itself is not freed
+ * and may be reused.
+ *
+ * @param bitmap Bitmap to clear.
+ */
+	void apol_query_bitmap_destroy(apol_query_bitmap_t * bitmap);
+
+/**
+ * Check if a symbol value is a member of a bitmap.
+ *
+ * @param bitmap Bitmap to test.
+ * @param value Symbol value, as returned by qpol_type_get_value() or
+ * qpol_class_get_value().
+ *
+ * @return Non-zero if the value is a member, 0 if not.
+ */
+	static inline int apol_query_bitmap_test(const apol_query_bitmap_t * bitmap, uint32_t value)
+	{
+		return value > 0 && value <= bitmap->num_bits &&
+			(bitmap->bits[(value - 1) / 32] & (1U << ((value - 1) % 32))) != 0;
+	}
+
+/**
+ * Destroy a vector of results; used as the free function of the
+ * vectors of vectors returned by batch queries such as
+ * apol_avrule_get_by_queries().
+ *
+ * @param v Vector (of type apol_vector_t) to destroy.
+ */
+	void apol_query_vector_free(void *v);
+
 /**
  * Given a type, return a vector of qpol_type_t pointers to which the
  * type expands.  If the type is just a type or an alias, the vector
@@ -523,6 +743,13 @@ extern "C"
  */
 	void domain_trans_table_destroy(apol_domain_trans_table_t ** table);
 
+/**
+ * Release the information flow graphs kept within a policy.
+ *
+ * @param p Policy whose graphs to release.
+ */
+	void apol_infoflow_graph_cache_destroy(apol_policy_t * p);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -28,9 +28,11 @@
  */
 
 #include "policy-query-internal.h"
+#include <apol/bst.h>
 
 #include <errno.h>
 #include <regex.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -76,30 +78,505 @@ int apol_query_set_regex(const apol_policy_t * p, unsigned int *flags, const int
 	return apol_query_set_flag(p, flags, is_regex, APOL_QUERY_REGEX);
 }
 
+/******************** permission name table ********************/
+
+static int perm_names_add(apol_policy_t * p, const qpol_class_t * cls, const char **names, qpol_iterator_t * iter)
+{
+	const char *name;
+	uint32_t mask;
+	int bit;
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&name) < 0 || qpol_class_get_perm_mask(p->p, cls, &name, 1, &mask) < 0) {
+			return -1;
+		}
+		for (bit = 0; bit < APOL_QUERY_MAX_PERMS; bit++) {
+			if (mask & (1U << bit)) {
+				names[bit] = name;
+				break;
+			}
+		}
+	}
+	return 0;
+}
+
+int apol_query_build_perm_names(apol_policy_t * p)
+{
+	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
+	const qpol_class_t *cls;
+	const qpol_common_t *common;
+	const char **names = NULL;
+	size_t num_classes;
+	uint32_t class_val;
+	unsigned int generation = qpol_policy_get_generation(p->p);
+	int retval = -1, error = 0;
+
+	if (p->perm_names != NULL && p->perm_names_generation == generation) {
+		return 0;
+	}
+	if (qpol_policy_get_class_iter(p->p, &iter) < 0 || qpol_iterator_get_size(iter, &num_classes) < 0) {
+		error = errno;
+		goto cleanup;
+	}
+	if ((names = calloc(num_classes * APOL_QUERY_MAX_PERMS + 1, sizeof(*names))) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		goto cleanup;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&cls) < 0 ||
+		    qpol_class_get_value(p->p, cls, &class_val) < 0 || qpol_class_get_common(p->p, cls, &common) < 0) {
+			error = errno;
+			goto cleanup;
+		}
+		if (class_val < 1 || class_val > num_classes) {
+			error = EINVAL;
+			ERR(p, "%s", strerror(error));
+			goto cleanup;
+		}
+		if (qpol_class_get_perm_iter(p->p, cls, &perm_iter) < 0 ||
+		    perm_names_add(p, cls, names + (class_val - 1) * APOL_QUERY_MAX_PERMS, perm_iter) < 0) {
+			error = errno;
+			goto cleanup;
+		}
+		qpol_iterator_destroy(&perm_iter);
+		if (common != NULL &&
+		    (qpol_common_get_perm_iter(p->p, common, &perm_iter) < 0 ||
+		     perm_names_add(p, cls, names + (class_val - 1) * APOL_QUERY_MAX_PERMS, perm_iter) < 0)) {
+			error = errno;
+			goto cleanup;
+		}
+		qpol_iterator_destroy(&perm_iter);
+	}
+	free(p->perm_names);
+	p->perm_names = names;
+	p->perm_names_num_classes = num_classes;
+	p->perm_names_generation = generation;
+	names = NULL;
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	qpol_iterator_destroy(&perm_iter);
+	free(names);
+	if (retval < 0) {
+		errno = error;
+	}
+	return retval;
+}
+
+const char *const *apol_query_get_perm_names(const apol_policy_t * p, uint32_t class_val)
+{
+	/* a frozen policy's table was built by apol_policy_freeze() */
+	if (!p->frozen && apol_query_build_perm_names((apol_policy_t *) p) < 0) {
+		return NULL;
+	}
+	if (class_val < 1 || class_val > p->perm_names_num_classes) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return NULL;
+	}
+	return p->perm_names + (class_val - 1) * APOL_QUERY_MAX_PERMS;
+}
+
+/******************** rendering helpers ********************/
+
+static int render_out_reserve(apol_render_out_t * out, size_t len)
+{
+	size_t size;
+	char *t;
+	if (out->len + len + 1 <= out->size) {
+		return 0;
+	}
+	for (size = (out->size > 0 ? out->size : 64); size < out->len + len + 1; size *= 2) ;
+	if ((t = realloc(out->buf, size)) == NULL) {
+		return -1;
+	}
+	out->buf = t;
+	out->size = size;
+	return 0;
+}
+
+int apol_render_out_puts(apol_render_out_t * out, const char *str)
+{
+	size_t len = strlen(str);
+	if (out->fp != NULL) {
+		if (fputs(str, out->fp) == EOF) {
+			return -1;
+		}
+		return 0;
+	}
+	if (render_out_reserve(out, len) < 0) {
+		return -1;
+	}
+	memcpy(out->buf + out->len, str, len + 1);
+	out->len += len;
+	return 0;
+}
+
+int apol_render_out_printf(apol_render_out_t * out, const char *fmt, ...)
+{
+	va_list ap, ap2;
+	int len;
+	va_start(ap, fmt);
+	if (out->fp != NULL) {
+		len = vfprintf(out->fp, fmt, ap);
+		va_end(ap);
+		return (len < 0 ? -1 : 0);
+	}
+	va_copy(ap2, ap);
+	len = vsnprintf(out->buf != NULL ? out->buf + out->len : NULL, out->size - out->len, fmt, ap);
+	va_end(ap);
+	if (len >= 0 && out->len + len + 1 > out->size) {
+		if (render_out_reserve(out, len) < 0) {
+			va_end(ap2);
+			return -1;
+		}
+		len = vsnprintf(out->buf + out->len, out->size - out->len, fmt, ap2);
+	}
+	va_end(ap2);
+	if (len < 0) {
+		return -1;
+	}
+	out->len += len;
+	return 0;
+}
+
+/******************** parallel task helpers ********************/
+
+struct apol_query_pool
+{
+	apol_query_task_fn_t *fn;
+	void *arg;
+	size_t num_tasks, next_task;
+	/** errno of the first task to fail, or 0 */
+	int error;
+	pthread_mutex_t lock;
+};
+
+static void *apol_query_pool_worker(void *arg)
+{
+	struct apol_query_pool *pool = arg;
+	size_t task;
+	int error;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		if (pool->error != 0 || pool->next_task >= pool->num_tasks) {
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		task = pool->next_task++;
+		pthread_mutex_unlock(&pool->lock);
+		if (pool->fn(pool->arg, task) < 0) {
+			error = (errno != 0 ? errno : EIO);
+			pthread_mutex_lock(&pool->lock);
+			if (pool->error == 0) {
+				pool->error = error;
+			}
+			pthread_mutex_unlock(&pool->lock);
+		}
+	}
+	return NULL;
+}
+
+int apol_query_run_tasks(const apol_policy_t * p, size_t num_threads, size_t num_tasks, apol_query_task_fn_t * fn,
+			 void *arg)
+{
+	struct apol_query_pool pool;
+	pthread_t *threads = NULL;
+	size_t i, num_started = 0;
+	int error;
+
+	if (num_threads > num_tasks) {
+		num_threads = num_tasks;
+	}
+	if (num_threads <= 1) {
+		for (i = 0; i < num_tasks; i++) {
+			if (fn(arg, i) < 0) {
+				return -1;
+			}
+		}
+		return 0;
+	}
+
+	pool.fn = fn;
+	pool.arg = arg;
+	pool.num_tasks = num_tasks;
+	pool.next_task = 0;
+	pool.error = 0;
+	if ((error = pthread_mutex_init(&pool.lock, NULL)) != 0) {
+		ERR(p, "%s", strerror(error));
+		errno = error;
+		return -1;
+	}
+	/* if threads cannot be created, the calling thread and those
+	 * that were created still complete every task */
+	if ((threads = malloc((num_threads - 1) * sizeof(*threads))) != NULL) {
+		for (; num_started < num_threads - 1; num_started++) {
+			if (pthread_create(&threads[num_started], NULL, apol_query_pool_worker, &pool) != 0) {
+				break;
+			}
+		}
+	}
+	apol_query_pool_worker(&pool);
+	for (i = 0; i < num_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&pool.lock);
+
+	if (pool.error != 0) {
+		errno = pool.error;
+		return -1;
+	}
+	return 0;
+}
+
 /********************* comparison helpers *********************/
 
+/** Fewest alternatives in a fully anchored pattern for which
+ *  apol_compare() uses a hash table instead of comparing each one. */
+#define APOL_REGEX_HASH_MIN 4
+
+/**
+ * A regular expression as compiled by apol_compare().  Patterns that
+ * are only literals -- "foo", "^httpd_", "_exec_t$", "^(a|b|c)$" or
+ * "a|b" -- are also kept as their literal alternatives so that
+ * matching needs no regexec().  Everything lives in one allocation
+ * with the regex_t first, so callers may continue to treat the
+ * pointer as a plain regex_t and release it with regfree() and
+ * free().
+ */
+struct apol_regex
+{
+	regex_t regex;
+	/** non-zero if the alternatives below are to be used instead of
+	 *  regexec() */
+	int is_literal;
+	/** non-zero if the pattern was anchored at the start and end */
+	int anchor_start, anchor_end;
+	size_t num_alts;
+	const char **alts;
+	size_t *alt_lens;
+	/** for fully anchored patterns with many alternatives, an open
+	 *  addressed table of alternative index + 1 (or 0 if unused);
+	 *  num_slots is a power of 2, or 0 if there is no table */
+	size_t *slots;
+	size_t num_slots;
+	/** bit c is set if some alternative starts with byte c */
+	unsigned char first[32];
+};
+
+static size_t regex_hash(const char *s, size_t len)
+{
+	size_t h = 2166136261U, i;
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/**
+ * Determine if a POSIX extended regular expression is made only of
+ * literal alternatives.  Accepted forms are an optional leading ^, a
+ * body, and an optional trailing $, where the body is a sequence of
+ * literals separated by | (only if unanchored) or a single
+ * parenthesized group of such.  Within literals, a backslash may
+ * escape a special character.
+ *
+ * @param pattern Pattern to analyze.
+ * @param lits Buffer at least as long as pattern; the alternatives
+ * are written here, each terminated by '\0'.
+ * @param num_alts Reference to where to write number of alternatives.
+ * @param anchor_start Reference to set if pattern starts with ^.
+ * @param anchor_end Reference to set if pattern ends with $.
+ *
+ * @return Non-zero if the pattern is only literals, 0 if not.
+ */
+static int regex_parse_literals(const char *pattern, char *lits, size_t * num_alts, int *anchor_start, int *anchor_end)
+{
+	const char *special = ".[]()*+?{}|^$\\";
+	const char *body = pattern, *end = pattern + strlen(pattern), *s;
+	size_t num_escapes;
+	int grouped = 0;
+
+	*num_alts = 1;
+	*anchor_start = *anchor_end = 0;
+	if (*body == '^') {
+		*anchor_start = 1;
+		body++;
+	}
+	if (end > body && end[-1] == '$') {
+		/* the $ is an anchor unless it is escaped */
+		for (num_escapes = 0, s = end - 1; s > body && s[-1] == '\\'; s--) {
+			num_escapes++;
+		}
+		if (num_escapes % 2 == 0) {
+			*anchor_end = 1;
+			end--;
+		}
+	}
+	if (end - body >= 2 && *body == '(' && end[-1] == ')') {
+		grouped = 1;
+		body++;
+		end--;
+	}
+	for (s = body; s < end; s++) {
+		if (*s == '\\') {
+			if (s + 1 >= end || strchr(special, s[1]) == NULL) {
+				return 0;
+			}
+			*lits++ = *++s;
+		} else if (*s == '|') {
+			/* outside of a group, | would separate the anchors */
+			if (!grouped && (*anchor_start || *anchor_end)) {
+				return 0;
+			}
+			*lits++ = '\0';
+			(*num_alts)++;
+		} else if (strchr(special, *s) != NULL) {
+			return 0;
+		} else {
+			*lits++ = *s;
+		}
+	}
+	*lits = '\0';
+	return 1;
+}
+
+/**
+ * Compile a regular expression for apol_compare(), noting whether it
+ * can be matched literally.
+ */
+static regex_t *apol_regex_create(const apol_policy_t * p, const char *pattern)
+{
+	size_t len = strlen(pattern), num_alts = 0, num_slots = 0, i, j;
+	char *lits, *strs, errbuf[1024] = { '\0' };
+	int is_literal, anchor_start, anchor_end, regretv;
+	struct apol_regex *r;
+
+	if ((lits = malloc(len + 1)) == NULL) {
+		ERR(p, "%s", strerror(ENOMEM));
+		return NULL;
+	}
+	is_literal = regex_parse_literals(pattern, lits, &num_alts, &anchor_start, &anchor_end);
+	if (!is_literal) {
+		num_alts = 0;
+	} else if (anchor_start && anchor_end && num_alts >= APOL_REGEX_HASH_MIN) {
+		for (num_slots = 1; num_slots < num_alts * 2; num_slots *= 2) ;
+	}
+	if ((r = calloc(1, sizeof(*r) + num_alts * (sizeof(*r->alts) + sizeof(*r->alt_lens)) +
+			num_slots * sizeof(*r->slots) + (is_literal ? len + 1 : 0))) == NULL) {
+		free(lits);
+		ERR(p, "%s", strerror(ENOMEM));
+		return NULL;
+	}
+	if ((regretv = regcomp(&r->regex, pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
+		regerror(regretv, &r->regex, errbuf, sizeof(errbuf));
+		free(r);
+		free(lits);
+		ERR(p, "%s", errbuf);
+		return NULL;
+	}
+	if (is_literal) {
+		r->is_literal = 1;
+		r->anchor_start = anchor_start;
+		r->anchor_end = anchor_end;
+		r->num_alts = num_alts;
+		r->alts = (const char **)(r + 1);
+		r->alt_lens = (size_t *) (r->alts + num_alts);
+		r->slots = (size_t *) (r->alt_lens + num_alts);
+		r->num_slots = num_slots;
+		strs = (char *)(r->slots + num_slots);
+		memcpy(strs, lits, len + 1);
+		for (i = 0; i < num_alts; i++) {
+			r->alts[i] = strs;
+			r->alt_lens[i] = strlen(strs);
+			strs += r->alt_lens[i] + 1;
+			r->first[(unsigned char)r->alts[i][0] / 8] |= 1 << ((unsigned char)r->alts[i][0] % 8);
+			if (num_slots > 0) {
+				j = regex_hash(r->alts[i], r->alt_lens[i]) & (num_slots - 1);
+				while (r->slots[j] != 0) {
+					j = (j + 1) & (num_slots - 1);
+				}
+				r->slots[j] = i + 1;
+			}
+		}
+	}
+	free(lits);
+	return &r->regex;
+}
+
+/**
+ * Match a target against a literal pattern's alternatives.
+ *
+ * @return 1 if some alternative matches, 0 if none.
+ */
+static int apol_regex_match_literal(const struct apol_regex *r, const char *target)
+{
+	size_t len = strlen(target), i, j;
+	const char *alt;
+
+	if (r->anchor_start && r->anchor_end && r->num_slots > 0) {
+		for (j = regex_hash(target, len) & (r->num_slots - 1); r->slots[j] != 0; j = (j + 1) & (r->num_slots - 1)) {
+			i = r->slots[j] - 1;
+			if (r->alt_lens[i] == len && memcmp(r->alts[i], target, len) == 0) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+	for (i = 0; i < r->num_alts; i++) {
+		alt = r->alts[i];
+		if (r->alt_lens[i] > len) {
+			continue;
+		}
+		if (r->anchor_start && r->anchor_end) {
+			if (r->alt_lens[i] == len && memcmp(alt, target, len) == 0)
+				return 1;
+		} else if (r->anchor_start) {
+			if (memcmp(alt, target, r->alt_lens[i]) == 0)
+				return 1;
+		} else if (r->anchor_end) {
+			if (memcmp(alt, target + len - r->alt_lens[i], r->alt_lens[i]) == 0)
+				return 1;
+		} else if (r->alt_lens[i] == 0) {
+			return 1;
+		}
+	}
+	if (r->anchor_start || r->anchor_end) {
+		return 0;
+	}
+	/* unanchored: one pass over the target, trying only those
+	 * alternatives whose first byte is at the current position */
+	for (j = 0; j < len; j++) {
+		unsigned char c = (unsigned char)target[j];
+		if (!(r->first[c / 8] & (1 << (c % 8)))) {
+			continue;
+		}
+		for (i = 0; i < r->num_alts; i++) {
+			if (r->alts[i][0] == target[j] && r->alt_lens[i] <= len - j &&
+			    memcmp(r->alts[i], target + j, r->alt_lens[i]) == 0) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
 int apol_compare(const apol_policy_t * p, const char *target, const char *name, unsigned int flags, regex_t ** regex)
 {
 	if (name == NULL || *name == '\0') {
 		return 1;
 	}
-	char errbuf[1024] = { '\0' };
 	if ((flags & APOL_QUERY_REGEX) && regex != NULL) {
-		if (*regex == NULL) {
-			if ((*regex = malloc(sizeof(**regex))) == NULL) {
-				free(*regex);
-				*regex = NULL;
-				ERR(p, "%s", strerror(ENOMEM));
-				return -1;
-			}
-			int regretv = regcomp(*regex, name, REG_EXTENDED | REG_NOSUB);
-			if (regretv) {
-				regerror(regretv, *regex, errbuf, 1024);
-				free(*regex);
-				*regex = NULL;
-				ERR(p, "%s", errbuf);
-				return -1;
-			}
+		const struct apol_regex *r;
+		if (*regex == NULL && (*regex = apol_regex_create(p, name)) == NULL) {
+			return -1;
+		}
+		r = (const struct apol_regex *)*regex;
+		if (r->is_literal) {
+			return apol_regex_match_literal(r, target);
 		}
 		if (regexec(*regex, target, 0, NULL, 0) == 0) {
 			return 1;
@@ -353,8 +830,8 @@ static int apol_query_append_type(const apol_policy_t * p, apol_vector_t * v, co
 	return 0;
 }
 
-apol_vector_t *apol_query_create_candidate_type_list(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
-						     unsigned int ta_flag)
+static apol_vector_t *candidate_type_list_build(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
+						unsigned int ta_flag)
 {
 	apol_vector_t *list = apol_vector_create(NULL);
 	const qpol_type_t *type;
@@ -492,8 +969,8 @@ apol_vector_t *apol_query_create_candidate_type_list(const apol_policy_t * p, co
 	return list;
 }
 
-apol_vector_t *apol_query_create_candidate_syn_type_list(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
-							 unsigned int ta_flag)
+static apol_vector_t *candidate_syn_type_list_build(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
+						    unsigned int ta_flag)
 {
 	apol_vector_t *list = apol_vector_create(NULL);
 	const qpol_type_t *type;
@@ -638,6 +1115,148 @@ apol_vector_t *apol_query_create_candidate_syn_type_list(const apol_policy_t * p
 	return list;
 }
 
+/** Most candidate type lists remembered by a policy; past this the
+ *  cache is emptied and starts again, so that interactive use with
+ *  ever different regular expressions does not grow without bound. */
+#define TYPE_LIST_CACHE_MAX 1024
+
+/* flags making up a type_list_entry_t's key, besides the symbol */
+#define TYPE_LIST_REGEX 0x01
+#define TYPE_LIST_INDIRECT 0x02
+#define TYPE_LIST_SYN 0x04
+#define TYPE_LIST_TA_SHIFT 4
+
+/** A candidate type list remembered within an apol_policy_t. */
+typedef struct type_list_entry
+{
+	char *symbol;
+	unsigned int flags;
+	/** vector of qpol_type_t pointers, as returned to callers */
+	apol_vector_t *types;
+} type_list_entry_t;
+
+static int type_list_entry_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	const type_list_entry_t *e1 = a, *e2 = b;
+	if (e1->flags != e2->flags) {
+		return (e1->flags < e2->flags ? -1 : 1);
+	}
+	return strcmp(e1->symbol, e2->symbol);
+}
+
+static void type_list_entry_free(void *elem)
+{
+	type_list_entry_t *e = elem;
+	if (e != NULL) {
+		free(e->symbol);
+		apol_vector_destroy(&e->types);
+		free(e);
+	}
+}
+
+void apol_query_type_list_cache_destroy(apol_policy_t * p)
+{
+	if (p != NULL) {
+		apol_bst_destroy(&p->type_list_cache);
+	}
+}
+
+/**
+ * Return a copy of a candidate type list, from the policy's cache if
+ * there or else by building the list and remembering it.  Failing to
+ * remember a list is not an error.
+ */
+static apol_vector_t *candidate_type_list_get(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
+					      unsigned int ta_flag, int syn)
+{
+	/* the cache does not change anything the policy reports */
+	apol_policy_t *policy = (apol_policy_t *) p;
+	type_list_entry_t key, *entry = NULL;
+	apol_vector_t *types, *list = NULL;
+	unsigned int generation;
+	int error, found;
+
+	if (p == NULL || symbol == NULL) {
+		return (syn ? candidate_syn_type_list_build(p, symbol, do_regex, do_indirect, ta_flag) :
+			candidate_type_list_build(p, symbol, do_regex, do_indirect, ta_flag));
+	}
+	key.symbol = (char *)symbol;
+	key.flags = (do_regex ? TYPE_LIST_REGEX : 0) | (do_indirect ? TYPE_LIST_INDIRECT : 0) |
+		(syn ? TYPE_LIST_SYN : 0) | (ta_flag << TYPE_LIST_TA_SHIFT);
+	generation = qpol_policy_get_generation(p->p);
+
+	if (p->frozen)
+		pthread_mutex_lock(&policy->type_list_lock);
+	if (policy->type_list_cache != NULL && policy->type_list_generation != generation) {
+		apol_bst_destroy(&policy->type_list_cache);
+	}
+	found = (policy->type_list_cache != NULL && apol_bst_get_element(policy->type_list_cache, &key, NULL, (void **)&entry) == 0);
+	if (found) {
+		list = apol_vector_create_from_vector(entry->types, NULL, NULL, NULL);
+		error = errno;
+	}
+	if (p->frozen)
+		pthread_mutex_unlock(&policy->type_list_lock);
+	if (found) {
+		if (list == NULL) {
+			ERR(p, "%s", strerror(error));
+			errno = error;
+		}
+		return list;
+	}
+
+	/* build without holding the lock, so that other threads may
+	 * resolve other symbols meanwhile */
+	types = (syn ? candidate_syn_type_list_build(p, symbol, do_regex, do_indirect, ta_flag) :
+		 candidate_type_list_build(p, symbol, do_regex, do_indirect, ta_flag));
+	if (types == NULL) {
+		return NULL;
+	}
+	if ((list = apol_vector_create_from_vector(types, NULL, NULL, NULL)) == NULL) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		apol_vector_destroy(&types);
+		errno = error;
+		return NULL;
+	}
+	if ((entry = calloc(1, sizeof(*entry))) == NULL || (entry->symbol = strdup(symbol)) == NULL) {
+		free(entry);
+		apol_vector_destroy(&types);
+		return list;
+	}
+	entry->flags = key.flags;
+	entry->types = types;
+
+	if (p->frozen)
+		pthread_mutex_lock(&policy->type_list_lock);
+	if (policy->type_list_cache != NULL && apol_bst_get_size(policy->type_list_cache) >= TYPE_LIST_CACHE_MAX) {
+		apol_bst_destroy(&policy->type_list_cache);
+	}
+	if (policy->type_list_cache == NULL &&
+	    (policy->type_list_cache = apol_bst_create(type_list_entry_comp, type_list_entry_free)) != NULL) {
+		policy->type_list_generation = generation;
+	}
+	/* another thread may have remembered the same list meanwhile */
+	if (policy->type_list_cache == NULL || apol_bst_insert(policy->type_list_cache, entry, NULL) != 0) {
+		type_list_entry_free(entry);
+	}
+	if (p->frozen)
+		pthread_mutex_unlock(&policy->type_list_lock);
+	return list;
+}
+
+apol_vector_t *apol_query_create_candidate_type_list(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
+						     unsigned int ta_flag)
+{
+	return candidate_type_list_get(p, symbol, do_regex, do_indirect, ta_flag, 0);
+}
+
+apol_vector_t *apol_query_create_candidate_syn_type_list(const apol_policy_t * p, const char *symbol, int do_regex, int do_indirect,
+							 unsigned int ta_flag)
+{
+	return candidate_type_list_get(p, symbol, do_regex, do_indirect, ta_flag, 1);
+}
+
 apol_vector_t *apol_query_create_candidate_role_list(const apol_policy_t * p, char *symbol, int do_regex)
 {
 	apol_vector_t *list = apol_vector_create(NULL);
@@ -725,6 +1344,88 @@ apol_vector_t *apol_query_create_candidate_class_list(const apol_policy_t * p, a
 	return list;
 }
 
+typedef int (apol_query_value_fn_t) (const qpol_policy_t * policy, const void *symbol, uint32_t * value);
+
+static int apol_query_type_value(const qpol_policy_t * policy, const void *symbol, uint32_t * value)
+{
+	return qpol_type_get_value(policy, symbol, value);
+}
+
+static int apol_query_class_value(const qpol_policy_t * policy, const void *symbol, uint32_t * value)
+{
+	return qpol_class_get_value(policy, symbol, value);
+}
+
+/**
+ * Size a bitmap to the largest value within a vector of symbols, then
+ * set the bit for each symbol.
+ */
+static int apol_query_bitmap_create(const apol_policy_t * p, const apol_vector_t * v, apol_query_bitmap_t * bitmap,
+				    apol_query_value_fn_t * get_value)
+{
+	size_t i, n = apol_vector_get_size(v);
+	uint32_t *values = NULL, max_val = 0;
+	int retval = -1;
+
+	bitmap->bits = NULL;
+	bitmap->num_bits = 0;
+	if (n == 0) {
+		return 0;
+	}
+	if ((values = malloc(n * sizeof(*values))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < n; i++) {
+		if (get_value(p->p, apol_vector_get_element(v, i), values + i) < 0) {
+			goto cleanup;
+		}
+		if (values[i] > max_val) {
+			max_val = values[i];
+		}
+	}
+	if ((bitmap->bits = calloc((max_val + 31) / 32, sizeof(*bitmap->bits))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	bitmap->num_bits = max_val;
+	for (i = 0; i < n; i++) {
+		if (values[i] > 0) {
+			bitmap->bits[(values[i] - 1) / 32] |= 1U << ((values[i] - 1) % 32);
+		}
+	}
+	retval = 0;
+      cleanup:
+	free(values);
+	return retval;
+}
+
+int apol_query_bitmap_create_from_types(const apol_policy_t * p, const apol_vector_t * types, apol_query_bitmap_t * bitmap)
+{
+	return apol_query_bitmap_create(p, types, bitmap, apol_query_type_value);
+}
+
+int apol_query_bitmap_create_from_classes(const apol_policy_t * p, const apol_vector_t * classes,
+					  apol_query_bitmap_t * bitmap)
+{
+	return apol_query_bitmap_create(p, classes, bitmap, apol_query_class_value);
+}
+
+void apol_query_bitmap_destroy(apol_query_bitmap_t * bitmap)
+{
+	if (bitmap != NULL) {
+		free(bitmap->bits);
+		bitmap->bits = NULL;
+		bitmap->num_bits = 0;
+	}
+}
+
+void apol_query_vector_free(void *v)
+{
+	apol_vector_t *vec = v;
+	apol_vector_destroy(&vec);
+}
+
 apol_vector_t *apol_query_expand_type(const apol_policy_t * p, const qpol_type_t * t)
 {
 	apol_vector_t *v = NULL;
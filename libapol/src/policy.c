@@ -109,23 +109,24 @@ apol_policy_t *apol_policy_create_from_policy_path(const apol_policy_path_t * pa
 			return policy;
 		}
 		const apol_vector_t *modules = apol_policy_path_get_modules(path);
-		size_t i;
-		for (i = 0; i < apol_vector_get_size(modules); i++) {
-			const char *module_path = apol_vector_get_element(modules, i);
-			qpol_module_t *mod = NULL;
-			INFO(policy, "Loading module %s.", module_path);
-			if (qpol_module_create_from_file(module_path, &mod)) {
-				ERR(policy, "Error loading module %s.", module_path);
-				apol_policy_destroy(&policy);
-				return NULL;
-			}
-			if (qpol_policy_append_module(policy->p, mod)) {
-				ERR(policy, "Error loading module %s.", module_path);
-				apol_policy_destroy(&policy);
-				qpol_module_destroy(&mod);
-				return NULL;
-			}
+		size_t i, num_modules = apol_vector_get_size(modules);
+		const char **module_paths = NULL;
+		if (num_modules > 0 && !(module_paths = calloc(num_modules, sizeof(*module_paths)))) {
+			ERR(policy, "%s", strerror(ENOMEM));
+			apol_policy_destroy(&policy);
+			return NULL;
+		}
+		for (i = 0; i < num_modules; i++) {
+			module_paths[i] = apol_vector_get_element(modules, i);
+			INFO(policy, "Loading module %s.", module_paths[i]);
+		}
+		/* modules are decoded concurrently but appended in path order */
+		if (qpol_policy_append_module_files(policy->p, module_paths, num_modules)) {
+			free(module_paths);
+			apol_policy_destroy(&policy);
+			return NULL;
 		}
+		free(module_paths);
 		INFO(policy, "%s", "Linking modules into base policy.");
 		if (qpol_policy_rebuild(policy->p, options)) {
 			apol_policy_destroy(&policy);
@@ -141,11 +142,91 @@ void apol_policy_destroy(apol_policy_t ** policy)
 		qpol_policy_destroy(&((*policy)->p));
 		permmap_destroy(&(*policy)->pmap);
 		domain_trans_table_destroy(&(*policy)->domain_trans_table);
+		apol_query_type_list_cache_destroy(*policy);
+		apol_infoflow_graph_cache_destroy(*policy);
+		free((*policy)->perm_names);
+		if ((*policy)->frozen) {
+			pthread_mutex_destroy(&(*policy)->domain_trans_lock);
+			pthread_mutex_destroy(&(*policy)->type_list_lock);
+			pthread_mutex_destroy(&(*policy)->infoflow_lock);
+		}
 		free(*policy);
 		*policy = NULL;
 	}
 }
 
+int apol_policy_freeze(apol_policy_t * policy)
+{
+	int error;
+	if (policy == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (policy->frozen) {
+		return 0;
+	}
+	if (qpol_policy_has_capability(policy->p, QPOL_CAP_RULES_LOADED) && apol_policy_build_domain_trans_table(policy)) {
+		return -1;
+	}
+	if (apol_query_build_perm_names(policy)) {
+		return -1;
+	}
+	if ((error = pthread_mutex_init(&policy->domain_trans_lock, NULL)) != 0) {
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return -1;
+	}
+	if ((error = pthread_mutex_init(&policy->type_list_lock, NULL)) != 0) {
+		ERR(policy, "%s", strerror(error));
+		pthread_mutex_destroy(&policy->domain_trans_lock);
+		errno = error;
+		return -1;
+	}
+	if ((error = pthread_mutex_init(&policy->infoflow_lock, NULL)) != 0) {
+		ERR(policy, "%s", strerror(error));
+		pthread_mutex_destroy(&policy->domain_trans_lock);
+		pthread_mutex_destroy(&policy->type_list_lock);
+		errno = error;
+		return -1;
+	}
+	if (qpol_policy_freeze(policy->p)) {
+		error = errno;
+		pthread_mutex_destroy(&policy->domain_trans_lock);
+		pthread_mutex_destroy(&policy->type_list_lock);
+		pthread_mutex_destroy(&policy->infoflow_lock);
+		errno = error;
+		return -1;
+	}
+	policy->frozen = 1;
+	return 0;
+}
+
+int apol_policy_is_frozen(const apol_policy_t * policy)
+{
+	return policy != NULL && policy->frozen;
+}
+
+int apol_policy_set_query_threads(apol_policy_t * policy, size_t num_threads)
+{
+	if (policy == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	policy->query_threads = (num_threads > 0 ? num_threads : 1);
+	return 0;
+}
+
+size_t apol_policy_get_query_threads(const apol_policy_t * policy)
+{
+	if (policy == NULL) {
+		errno = EINVAL;
+		return 0;
+	}
+	return (policy->query_threads > 0 ? policy->query_threads : 1);
+}
+
 int apol_policy_get_policy_type(const apol_policy_t * policy)
 {
 	if (policy == NULL) {
@@ -41,207 +41,580 @@ struct apol_terule_query
 	unsigned int flags;
 };
 
+/** A query prepared for matching against rules; see terule_select_init(). */
+typedef struct terule_select
+{
+	uint32_t rule_type;
+	unsigned int flags;
+	/** if non-NULL, types to use as source; if NULL, accept all types */
+	apol_vector_t *source_list;
+	/** if non-NULL, types to use as target; if NULL, accept all types */
+	apol_vector_t *target_list;
+	/** if non-NULL, classes to use; if NULL, accept all classes */
+	apol_vector_t *class_list;
+	/** if non-NULL, types to use as default; if NULL, accept all types */
+	apol_vector_t *default_list;
+	/** if non-NULL, find conditional rules affected by this boolean */
+	const char *bool_name;
+	/** candidate lists as bitmaps; see apol_query_bitmap_test() */
+	apol_query_bitmap_t source_set, target_set, class_set, default_set;
+	/** non-zero if target_list and default_list are the same vector
+	 *  as source_list */
+	int target_is_source;
+} terule_select_t;
+
+/** Fields of one rule, looked up once no matter how many queries the
+ *  rule is matched against. */
+typedef struct terule_facts
+{
+	qpol_terule_t *rule;
+	uint32_t rule_type, is_enabled, source_val, target_val, default_val, class_val;
+	const qpol_cond_t *cond;
+} terule_facts_t;
+
+/** State shared by the tasks of one rule_select() call. */
+typedef struct terule_select_run
+{
+	const apol_policy_t *p;
+	const terule_select_t *sels;
+	size_t num_sels;
+	/** all rule types wanted by any of the queries */
+	uint32_t rule_type;
+	/** if non-NULL, look up rules by these sources instead of
+	 *  scanning the rule tables */
+	const apol_vector_t *by_source;
+	/** number of tasks into which the selection is split */
+	size_t num_tasks;
+	/** rules found by each task for each query, indexed by
+	 *  task * num_sels + query; these are joined in task order */
+	apol_vector_t **results;
+	/** if non-NULL, call this for each matching rule instead of
+	 *  adding it to results; see apol_terule_get_by_query_map() */
+	apol_terule_map_func *map_fn;
+	void *map_arg;
+} terule_select_run_t;
+
 /**
- *  Common semantic rule selection routine used in get*rule_by_query.
+ *  Build the bitmaps of a prepared query from its candidate lists.
  *  @param p Policy to search.
- *  @param v Vector of rules to populate (of type qpol_terule_t).
- *  @param rule_type Mask of rules to search.
- *  @param flags Query options as specified by the apol_terule_query.
- *  @param source_list If non-NULL, list of types to use as source.
- *  If NULL, accept all types.
- *  @param target_list If non-NULL, list of types to use as target.
- *  If NULL, accept all types.
- *  @param class_list If non-NULL, list of classes to use.
- *  If NULL, accept all classes.
- *  @param default_list If non-NULL, list of types to use as default.
- *  If NULL, accept all types.
- *  @param bool_name If non-NULL, find conditional rules affected by this boolean.
- *  If NULL, all rules will be considered (including unconditional rules).
+ *  @param sel Selection whose lists have been set.
  *  @return 0 on success and < 0 on failure.
  */
-static int rule_select(const apol_policy_t * p, apol_vector_t * v, uint32_t rule_type, unsigned int flags,
-		       const apol_vector_t * source_list, const apol_vector_t * target_list, const apol_vector_t * class_list,
-		       const apol_vector_t * default_list, const char *bool_name)
+static int terule_select_create_sets(const apol_policy_t * p, terule_select_t * sel)
 {
-	qpol_iterator_t *iter = NULL;
-	int only_enabled = flags & APOL_QUERY_ONLY_ENABLED;
-	int is_regex = flags & APOL_QUERY_REGEX;
-	int source_as_any = flags & APOL_QUERY_SOURCE_AS_ANY;
-	int retv = -1;
-	regex_t *bool_regex = NULL;
-
-	if (qpol_policy_get_terule_iter(p->p, rule_type, &iter) < 0) {
-		goto cleanup;
+	/* candidate lists become bitmaps indexed by symbol value, so
+	 * that each rule is matched with a bit test rather than a scan
+	 * of the (possibly attribute-expanded) list */
+	if ((sel->source_list != NULL && apol_query_bitmap_create_from_types(p, sel->source_list, &sel->source_set) < 0) ||
+	    (sel->target_list != NULL && apol_query_bitmap_create_from_types(p, sel->target_list, &sel->target_set) < 0) ||
+	    (sel->default_list != NULL && apol_query_bitmap_create_from_types(p, sel->default_list, &sel->default_set) < 0) ||
+	    (sel->class_list != NULL && apol_query_bitmap_create_from_classes(p, sel->class_list, &sel->class_set) < 0)) {
+		return -1;
 	}
+	return 0;
+}
 
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		qpol_terule_t *rule;
-		uint32_t is_enabled;
-		const qpol_cond_t *cond = NULL;
-		int match_source = 0, match_target = 0, match_default = 0, match_bool = 0;
-		size_t i;
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0) {
-			goto cleanup;
+/**
+ *  Prepare a query for rule_select() by finding its candidate types
+ *  and classes.
+ *  @param p Policy to search.
+ *  @param t Query to prepare, or NULL to accept all rules.
+ *  @param sel Selection to initialize.  The caller must call
+ *  terule_select_destroy() afterwards, even on error.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int terule_select_init(const apol_policy_t * p, const apol_terule_query_t * t, terule_select_t * sel)
+{
+	int is_regex;
+
+	memset(sel, 0, sizeof(*sel));
+	sel->rule_type = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
+	if (t == NULL) {
+		return 0;
+	}
+	if (t->rules != 0) {
+		sel->rule_type &= t->rules;
+	}
+	sel->flags = t->flags;
+	is_regex = t->flags & APOL_QUERY_REGEX;
+	sel->bool_name = t->bool_name;
+	if (t->source != NULL &&
+	    (sel->source_list =
+	     apol_query_create_candidate_type_list(p, t->source, is_regex,
+						   t->flags & APOL_QUERY_SOURCE_INDIRECT,
+						   ((t->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
+						    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+		return -1;
+	}
+	if ((t->flags & APOL_QUERY_SOURCE_AS_ANY) && t->source != NULL) {
+		sel->default_list = sel->target_list = sel->source_list;
+		sel->target_is_source = 1;
+	} else {
+		if (t->target != NULL &&
+		    (sel->target_list =
+		     apol_query_create_candidate_type_list(p, t->target, is_regex,
+							   t->flags & APOL_QUERY_TARGET_INDIRECT,
+							   ((t->flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
+							    / APOL_QUERY_TARGET_TYPE))) == NULL) {
+			return -1;
+		}
+		if (t->default_type != NULL &&
+		    (sel->default_list =
+		     apol_query_create_candidate_type_list(p, t->default_type, is_regex, 0,
+							   APOL_QUERY_SYMBOL_IS_TYPE)) == NULL) {
+			return -1;
 		}
+	}
+	if (t->classes != NULL &&
+	    apol_vector_get_size(t->classes) > 0 &&
+	    (sel->class_list = apol_query_create_candidate_class_list(p, t->classes)) == NULL) {
+		return -1;
+	}
+	return terule_select_create_sets(p, sel);
+}
 
-		if (qpol_terule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
-			goto cleanup;
+static void terule_select_destroy(terule_select_t * sel)
+{
+	apol_vector_destroy(&sel->source_list);
+	if (!sel->target_is_source) {
+		apol_vector_destroy(&sel->target_list);
+		apol_vector_destroy(&sel->default_list);
+	}
+	apol_vector_destroy(&sel->class_list);
+	apol_query_bitmap_destroy(&sel->source_set);
+	apol_query_bitmap_destroy(&sel->target_set);
+	apol_query_bitmap_destroy(&sel->default_set);
+	apol_query_bitmap_destroy(&sel->class_set);
+}
+
+static int terule_facts_get(const apol_policy_t * p, qpol_terule_t * rule, terule_facts_t * f)
+{
+	const qpol_type_t *source_type, *target_type, *default_type;
+	const qpol_class_t *obj_class;
+
+	f->rule = rule;
+	if (qpol_terule_get_rule_type(p->p, rule, &f->rule_type) < 0 ||
+	    qpol_terule_get_is_enabled(p->p, rule, &f->is_enabled) < 0 ||
+	    qpol_terule_get_cond(p->p, rule, &f->cond) < 0 ||
+	    qpol_terule_get_source_type(p->p, rule, &source_type) < 0 ||
+	    qpol_type_get_value(p->p, source_type, &f->source_val) < 0 ||
+	    qpol_terule_get_target_type(p->p, rule, &target_type) < 0 ||
+	    qpol_type_get_value(p->p, target_type, &f->target_val) < 0 ||
+	    qpol_terule_get_default_type(p->p, rule, &default_type) < 0 ||
+	    qpol_type_get_value(p->p, default_type, &f->default_val) < 0 ||
+	    qpol_terule_get_object_class(p->p, rule, &obj_class) < 0 ||
+	    qpol_class_get_value(p->p, obj_class, &f->class_val) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *  Check if a rule matches a prepared query.
+ *  @param p Policy being searched.
+ *  @param sel Prepared query.
+ *  @param bool_regex Compiled boolean expression for this query and
+ *  thread.
+ *  @param f Fields of the rule to check.
+ *  @return 1 if the rule matches, 0 if not, and < 0 on error.
+ */
+static int terule_select_match(const apol_policy_t * p, const terule_select_t * sel, regex_t ** bool_regex,
+			       const terule_facts_t * f)
+{
+	const int source_as_any = sel->flags & APOL_QUERY_SOURCE_AS_ANY;
+	int match_source, match_target, match_default;
+
+	if (!(f->rule_type & sel->rule_type)) {
+		return 0;
+	}
+	if (!f->is_enabled && (sel->flags & APOL_QUERY_ONLY_ENABLED)) {
+		return 0;
+	}
+
+	if (sel->bool_name != NULL) {
+		int match_bool;
+		if (f->cond == NULL) {
+			return 0;      /* skip unconditional rule */
 		}
-		if (!is_enabled && only_enabled) {
-			continue;
+		match_bool = apol_compare_cond_expr(p, f->cond, sel->bool_name, sel->flags & APOL_QUERY_REGEX, bool_regex);
+		if (match_bool <= 0) {
+			return match_bool;
 		}
+	}
 
-		if (bool_name != NULL) {
-			if (qpol_terule_get_cond(p->p, rule, &cond) < 0) {
-				goto cleanup;
-			}
-			if (cond == NULL) {
-				continue;	/* skip unconditional rule */
-			}
-			match_bool = apol_compare_cond_expr(p, cond, bool_name, is_regex, &bool_regex);
-			if (match_bool < 0) {
+	match_source = (sel->source_list == NULL || apol_query_bitmap_test(&sel->source_set, f->source_val));
+
+	/* if source did not match, but treating source symbol
+	 * as any field, then delay rejecting this rule until
+	 * the target and default have been checked */
+	if (!source_as_any && !match_source) {
+		return 0;
+	}
+
+	match_target = (sel->target_list == NULL || (source_as_any && match_source) ||
+			apol_query_bitmap_test(&sel->target_set, f->target_val));
+	if (!source_as_any && !match_target) {
+		return 0;
+	}
+
+	match_default = (sel->default_list == NULL || (source_as_any && match_source) || (source_as_any && match_target) ||
+			 apol_query_bitmap_test(&sel->default_set, f->default_val));
+	if (!source_as_any && !match_default) {
+		return 0;
+	}
+	/* at least one thing must match if source_as_any was given */
+	if (source_as_any && (!match_source && !match_target && !match_default)) {
+		return 0;
+	}
+
+	if (sel->class_list != NULL && !apol_query_bitmap_test(&sel->class_set, f->class_val)) {
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ *  Select the rules for one task of rule_select().  If rules are
+ *  looked up by source, the task covers a contiguous range of the
+ *  candidate sources; otherwise it covers one part of the rule tables
+ *  (see qpol_policy_get_terule_iter_part()).  Joining the results of
+ *  all tasks in order gives the same rules in the same order as a
+ *  single task would; rule_select() then sorts rules looked up by
+ *  more than one source back into rule table order.
+ *  @param arg The terule_select_run_t for this selection.
+ *  @param task Task number.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int rule_select_task(void *arg, size_t task)
+{
+	const terule_select_run_t *run = arg;
+	const apol_policy_t *p = run->p;
+	apol_vector_t **v = (run->results != NULL ? run->results + task * run->num_sels : NULL);
+	regex_t **bool_regexes = NULL;
+	qpol_iterator_t *iter = NULL;
+	size_t first = 0, last = 1, s, q;
+	void *batch[APOL_QUERY_BATCH_SIZE];
+	size_t b, num_batch;
+	int retv = -1, match;
+
+	if ((bool_regexes = calloc(run->num_sels, sizeof(*bool_regexes))) == NULL) {
+		ERR(p, "%s", strerror(ENOMEM));
+		goto cleanup;
+	}
+
+	/* when the source is known, only visit the rules naming one of
+	 * the candidate sources instead of scanning the whole table */
+	if (run->by_source != NULL) {
+		first = apol_vector_get_size(run->by_source) * task / run->num_tasks;
+		last = apol_vector_get_size(run->by_source) * (task + 1) / run->num_tasks;
+	}
+	for (s = first; s < last; s++) {
+		if (run->by_source == NULL) {
+			if (qpol_policy_get_terule_iter_part(p->p, run->rule_type, task, run->num_tasks, &iter) < 0) {
 				goto cleanup;
-			} else if (match_bool == 0) {
-				continue;
 			}
+		} else if (qpol_policy_get_terule_iter_by_source(p->p, run->rule_type,
+								(const qpol_type_t *)apol_vector_get_element(run->by_source, s),
+								&iter) < 0) {
+			goto cleanup;
 		}
-
-		if (source_list == NULL) {
-			match_source = 1;
-		} else {
-			const qpol_type_t *source_type;
-			if (qpol_terule_get_source_type(p->p, rule, &source_type) < 0) {
+		for (b = 0, num_batch = 0;; b++) {
+			terule_facts_t facts;
+			if (b == num_batch) {
+				if (qpol_iterator_next_batch(iter, batch, APOL_QUERY_BATCH_SIZE, &num_batch) < 0) {
+					goto cleanup;
+				}
+				if (num_batch == 0) {
+					break;
+				}
+				b = 0;
+			}
+			if (terule_facts_get(p, batch[b], &facts) < 0) {
 				goto cleanup;
 			}
-			if (apol_vector_get_index(source_list, source_type, NULL, NULL, &i) == 0) {
-				match_source = 1;
+			for (q = 0; q < run->num_sels; q++) {
+				if ((match = terule_select_match(p, run->sels + q, bool_regexes + q, &facts)) < 0) {
+					goto cleanup;
+				}
+				if (!match) {
+					continue;
+				}
+				if (run->map_fn != NULL) {
+					/* a non-zero return ends the selection early */
+					if ((match = run->map_fn(p, facts.rule, run->map_arg)) != 0) {
+						retv = (match < 0 ? -1 : 0);
+						goto cleanup;
+					}
+				} else if (apol_vector_append(v[q], facts.rule)) {
+					ERR(p, "%s", strerror(ENOMEM));
+					goto cleanup;
+				}
 			}
 		}
+		qpol_iterator_destroy(&iter);
+	}
 
-		/* if source did not match, but treating source symbol
-		 * as any field, then delay rejecting this rule until
-		 * the target and default have been checked */
-		if (!source_as_any && !match_source) {
-			continue;
+	retv = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	if (bool_regexes != NULL) {
+		for (q = 0; q < run->num_sels; q++) {
+			apol_regex_destroy(bool_regexes + q);
 		}
+		free(bool_regexes);
+	}
+	return retv;
+}
 
-		if (target_list == NULL || (source_as_any && match_source)) {
-			match_target = 1;
-		} else {
-			const qpol_type_t *target_type;
-			if (qpol_terule_get_target_type(p->p, rule, &target_type) < 0) {
-				goto cleanup;
-			}
-			if (apol_vector_get_index(target_list, target_type, NULL, NULL, &i) == 0) {
-				match_target = 1;
-			}
-		}
+/**
+ *  Fill in the parts of a rule selection that do not depend on how
+ *  it is run.
+ *  @param p Policy to search.
+ *  @param sels Array of prepared queries.
+ *  @param num_sels Number of queries; must be at least 1.
+ *  @param run Selection to initialize.
+ */
+static void terule_select_run_init(const apol_policy_t * p, const terule_select_t * sels, size_t num_sels,
+				   terule_select_run_t * run)
+{
+	size_t q;
 
-		if (!source_as_any && !match_target) {
-			continue;
-		}
+	memset(run, 0, sizeof(*run));
+	run->p = p;
+	run->sels = sels;
+	run->num_sels = num_sels;
+	run->num_tasks = 1;
+	for (q = 0; q < num_sels; q++) {
+		run->rule_type |= sels[q].rule_type;
+	}
+	if (num_sels == 1 && sels[0].source_list != NULL && !(sels[0].flags & APOL_QUERY_SOURCE_AS_ANY)) {
+		run->by_source = sels[0].source_list;
+	}
+}
 
-		if (default_list == NULL || (source_as_any && match_source) || (source_as_any && match_target)) {
-			match_default = 1;
-		} else {
-			const qpol_type_t *default_type;
-			if (qpol_terule_get_default_type(p->p, rule, &default_type) < 0) {
-				goto cleanup;
-			}
-			if (apol_vector_get_index(default_list, default_type, NULL, NULL, &i) == 0) {
-				match_default = 1;
-			}
-		}
+/**
+ *  Compare two rules by their position in the rule tables.
+ *  @param a First qpol_terule_t to compare.
+ *  @param b Second qpol_terule_t to compare.
+ *  @param data The apol_policy_t containing the rules.
+ */
+static int terule_position_comp(const void *a, const void *b, void *data)
+{
+	const apol_policy_t *p = data;
+	size_t pos1, pos2;
+	if (qpol_terule_get_position(p->p, a, &pos1) < 0 || qpol_terule_get_position(p->p, b, &pos2) < 0) {
+		return 0;
+	}
+	if (pos1 != pos2) {
+		return (pos1 < pos2 ? -1 : 1);
+	}
+	return 0;
+}
 
-		if (!source_as_any && !match_default) {
-			continue;
-		}
-		/* at least one thing must match if source_as_any was given */
-		if (source_as_any && (!match_source && !match_target && !match_default)) {
-			continue;
-		}
+/**
+ *  Common semantic rule selection routine used in get*rule_by_query.
+ *  A single query whose source is known looks up rules by source;
+ *  otherwise every query is matched during one pass over the rule
+ *  tables.  Either way the rules are returned in rule table order.
+ *  @param p Policy to search.
+ *  @param sels Array of prepared queries.
+ *  @param num_sels Number of queries; must be at least 1.
+ *  @param v Array of num_sels vectors to which to append the rules
+ *  (of type qpol_terule_t) matching each query.
+ *  @return 0 on success and < 0 on failure.
+ */
+static int rule_select(const apol_policy_t * p, const terule_select_t * sels, size_t num_sels, apol_vector_t ** v)
+{
+	terule_select_run_t run;
+	qpol_iterator_t *iter = NULL;
+	const size_t num_threads = apol_policy_get_query_threads(p);
+	size_t i;
+	int retv = -1;
 
-		if (class_list != NULL) {
-			const qpol_class_t *obj_class;
-			if (qpol_terule_get_object_class(p->p, rule, &obj_class) < 0) {
-				goto cleanup;
+	terule_select_run_init(p, sels, num_sels, &run);
+
+	/* with several threads, split the work into more tasks than
+	 * threads; the index of rules by source is built on first use,
+	 * so build it before the tasks share it */
+	run.num_tasks = 1;
+	if (num_threads > 1) {
+		run.num_tasks = num_threads * APOL_QUERY_TASKS_PER_THREAD;
+		if (run.by_source != NULL) {
+			if (run.num_tasks > apol_vector_get_size(run.by_source)) {
+				run.num_tasks = apol_vector_get_size(run.by_source);
 			}
-			if (apol_vector_get_index(class_list, obj_class, NULL, NULL, &i) < 0) {
-				continue;
+			if (run.num_tasks > 1) {
+				if (qpol_policy_get_terule_iter_by_source(p->p, run.rule_type,
+									 (const qpol_type_t *)apol_vector_get_element(run.by_source, 0),
+									 &iter) < 0) {
+					goto cleanup;
+				}
+				qpol_iterator_destroy(&iter);
+			} else {
+				run.num_tasks = 1;
 			}
 		}
+	}
+	if ((run.results = calloc(run.num_tasks * num_sels, sizeof(*run.results))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < run.num_tasks * num_sels; i++) {
+		if (i < num_sels) {
+			run.results[i] = v[i];
+		} else if ((run.results[i] = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+	}
 
-		if (apol_vector_append(v, rule)) {
-			ERR(p, "%s", strerror(ENOMEM));
+	if (apol_query_run_tasks(p, num_threads, run.num_tasks, rule_select_task, &run) < 0) {
+		goto cleanup;
+	}
+	for (i = num_sels; i < run.num_tasks * num_sels; i++) {
+		if (apol_vector_cat(v[i % num_sels], run.results[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
 			goto cleanup;
 		}
 	}
+	/* each source's rules are in table order, but the sources are
+	 * visited one after another; merge them back into table order so
+	 * that the result does not depend on how the rules were found */
+	if (run.by_source != NULL && apol_vector_get_size(run.by_source) > 1) {
+		apol_vector_sort(v[0], terule_position_comp, (void *)p);
+	}
 
 	retv = 0;
-
       cleanup:
-	apol_regex_destroy(&bool_regex);
 	qpol_iterator_destroy(&iter);
+	if (run.results != NULL) {
+		for (i = num_sels; i < run.num_tasks * num_sels; i++) {
+			apol_vector_destroy(&run.results[i]);
+		}
+		free(run.results);
+	}
 	return retv;
 }
 
 int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_vector_t ** v)
 {
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *default_list = NULL;
-	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
+	terule_select_t sel;
+	int retval = -1;
 	*v = NULL;
-	unsigned int flags = 0;
 
-	uint32_t rule_type = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
-	if (t != NULL) {
-		if (t->rules != 0) {
-			rule_type &= t->rules;
+	if (terule_select_init(p, t, &sel) < 0) {
+		goto cleanup;
+	}
+
+	if ((*v = apol_vector_create(NULL)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+
+	if (rule_select(p, &sel, 1, v)) {
+		goto cleanup;
+	}
+
+	retval = 0;
+      cleanup:
+	if (retval != 0) {
+		apol_vector_destroy(v);
+	}
+	terule_select_destroy(&sel);
+	return retval;
+}
+
+int apol_terule_get_by_query_map(const apol_policy_t * p, const apol_terule_query_t * t, apol_terule_map_func * fn, void *arg)
+{
+	terule_select_t sel;
+	terule_select_run_t run;
+	apol_vector_t *rules = NULL;
+	size_t i;
+	int retval = -1, match;
+
+	if (p == NULL || fn == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (terule_select_init(p, t, &sel) < 0) {
+		goto cleanup;
+	}
+
+	terule_select_run_init(p, &sel, 1, &run);
+	if (run.by_source != NULL && apol_vector_get_size(run.by_source) > 1) {
+		/* rules found under several sources must be sorted back
+		 * into table order before any is passed to the callback */
+		if ((rules = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
 		}
-		flags = t->flags;
-		is_regex = t->flags & APOL_QUERY_REGEX;
-		bool_name = t->bool_name;
-		if (t->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_type_list(p, t->source, is_regex,
-							   t->flags & APOL_QUERY_SOURCE_INDIRECT,
-							   ((t->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
-							    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+		if (rule_select(p, &sel, 1, &rules) < 0) {
 			goto cleanup;
 		}
-		if ((t->flags & APOL_QUERY_SOURCE_AS_ANY) && t->source != NULL) {
-			default_list = target_list = source_list;
-			source_as_any = 1;
-		} else {
-			if (t->target != NULL &&
-			    (target_list =
-			     apol_query_create_candidate_type_list(p, t->target, is_regex,
-								   t->flags & APOL_QUERY_TARGET_INDIRECT,
-								   ((t->
-								     flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
-								    / APOL_QUERY_TARGET_TYPE))) == NULL) {
-				goto cleanup;
-			}
-			if (t->default_type != NULL &&
-			    (default_list =
-			     apol_query_create_candidate_type_list(p, t->default_type, is_regex, 0,
-								   APOL_QUERY_SYMBOL_IS_TYPE)) == NULL) {
-				goto cleanup;
+		for (i = 0; i < apol_vector_get_size(rules); i++) {
+			if ((match = fn(p, apol_vector_get_element(rules, i), arg)) != 0) {
+				if (match < 0) {
+					goto cleanup;
+				}
+				break;
 			}
 		}
-		if (t->classes != NULL &&
-		    apol_vector_get_size(t->classes) > 0 &&
-		    (class_list = apol_query_create_candidate_class_list(p, t->classes)) == NULL) {
+	} else {
+		/* rules are passed to the callback in order as they are
+		 * found, so the selection runs as a single task in this
+		 * thread */
+		run.map_fn = fn;
+		run.map_arg = arg;
+		if (rule_select_task(&run, 0) < 0) {
 			goto cleanup;
 		}
 	}
 
-	if ((*v = apol_vector_create(NULL)) == NULL) {
+	retval = 0;
+      cleanup:
+	apol_vector_destroy(&rules);
+	terule_select_destroy(&sel);
+	return retval;
+}
+
+int apol_terule_get_by_queries(const apol_policy_t * p, const apol_vector_t * queries, apol_vector_t ** v)
+{
+	terule_select_t *sels = NULL;
+	apol_vector_t **results = NULL;
+	size_t num_sels, i;
+	int retval = -1;
+
+	if (v != NULL) {
+		*v = NULL;
+	}
+	if (p == NULL || queries == NULL || v == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+
+	num_sels = apol_vector_get_size(queries);
+	if ((*v = apol_vector_create_with_capacity(num_sels, apol_query_vector_free)) == NULL ||
+	    (sels = calloc(num_sels + 1, sizeof(*sels))) == NULL || (results = calloc(num_sels + 1, sizeof(*results))) == NULL) {
 		ERR(p, "%s", strerror(errno));
 		goto cleanup;
 	}
+	for (i = 0; i < num_sels; i++) {
+		if ((results[i] = apol_vector_create(NULL)) == NULL || apol_vector_append(*v, results[i]) < 0) {
+			ERR(p, "%s", strerror(errno));
+			apol_vector_destroy(&results[i]);
+			goto cleanup;
+		}
+	}
+	for (i = 0; i < num_sels; i++) {
+		if (terule_select_init(p, apol_vector_get_element(queries, i), sels + i) < 0) {
+			goto cleanup;
+		}
+	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, default_list, bool_name)) {
+	/* all queries are answered during the same pass over the rules */
+	if (num_sels > 0 && rule_select(p, sels, num_sels, results)) {
 		goto cleanup;
 	}
 
@@ -250,12 +623,13 @@ int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t
 	if (retval != 0) {
 		apol_vector_destroy(v);
 	}
-	apol_vector_destroy(&source_list);
-	if (!source_as_any) {
-		apol_vector_destroy(&target_list);
-		apol_vector_destroy(&default_list);
+	if (sels != NULL) {
+		for (i = 0; i < num_sels; i++) {
+			terule_select_destroy(sels + i);
+		}
+		free(sels);
 	}
-	apol_vector_destroy(&class_list);
+	free(results);
 	return retval;
 }
 
@@ -264,10 +638,13 @@ int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_quer
 	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *default_list = NULL, *syn_v = NULL;
 	int retval = -1, source_as_any = 0, is_regex = 0;
 	char *bool_name = NULL;
+	terule_select_t sel;
 	*v = NULL;
 	size_t i;
 	unsigned int flags = 0;
 
+	memset(&sel, 0, sizeof(sel));
+
 	if (!p || !qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_SYN_RULES)) {
 		ERR(p, "%s", strerror(EINVAL));
 		goto cleanup;
@@ -322,7 +699,14 @@ int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_quer
 		goto cleanup;
 	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, default_list, bool_name)) {
+	sel.rule_type = rule_type;
+	sel.flags = flags;
+	sel.source_list = source_list;
+	sel.target_list = target_list;
+	sel.class_list = class_list;
+	sel.default_list = default_list;
+	sel.bool_name = bool_name;
+	if (terule_select_create_sets(p, &sel) < 0 || rule_select(p, &sel, 1, v)) {
 		goto cleanup;
 	}
 
@@ -429,6 +813,10 @@ int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_quer
 		apol_vector_destroy(&default_list);
 	}
 	apol_vector_destroy(&class_list);
+	apol_query_bitmap_destroy(&sel.source_set);
+	apol_query_bitmap_destroy(&sel.target_set);
+	apol_query_bitmap_destroy(&sel.default_set);
+	apol_query_bitmap_destroy(&sel.class_set);
 	return retval;
 }
 
@@ -651,13 +1039,11 @@ apol_vector_t *apol_terule_list_to_syn_terules(const apol_policy_t * p, const ap
 	return v;
 }
 
-char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rule)
+static int terule_render(const apol_policy_t * policy, const qpol_terule_t * rule, apol_render_out_t * out)
 {
-	char *tmp = NULL;
 	const char *tmp_name = NULL;
 	const char *rule_type_str;
 	int error = 0;
-	size_t tmp_sz = 0;
 	uint32_t rule_type = 0;
 	const qpol_type_t *type = NULL;
 	const qpol_class_t *obj_class = NULL;
@@ -665,24 +1051,24 @@ char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rul
 	if (!policy || !rule) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 
 	/* rule type */
 	if (qpol_terule_get_rule_type(policy->p, rule, &rule_type)) {
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type &= (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER))) {
 		ERR(policy, "%s", "Invalid TE rule type");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type_str = apol_rule_type_to_str(rule_type))) {
 		ERR(policy, "%s", "Could not get TE rule type's string");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", rule_type_str)) {
+	if (apol_render_out_printf(out, "%s ", rule_type_str)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -697,7 +1083,7 @@ char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -712,7 +1098,7 @@ char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s : ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s : ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -727,7 +1113,7 @@ char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+	if (apol_render_out_printf(out, "%s ", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -742,23 +1128,44 @@ char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rul
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s;", tmp_name)) {
+	if (apol_render_out_printf(out, "%s;", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
 
-	return tmp;
+	return 0;
 
       err:
-	free(tmp);
 	errno = error;
-	return NULL;
+	return -1;
 }
 
-char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule_t * rule)
+char *apol_terule_render(const apol_policy_t * policy, const qpol_terule_t * rule)
+{
+	apol_render_out_t out = { NULL, NULL, 0, 0 };
+	if (terule_render(policy, rule, &out) < 0) {
+		int error = errno;
+		free(out.buf);
+		errno = error;
+		return NULL;
+	}
+	return out.buf;
+}
+
+int apol_terule_render_file(const apol_policy_t * policy, const qpol_terule_t * rule, FILE * fp)
+{
+	apol_render_out_t out = { fp, NULL, 0, 0 };
+	if (fp == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	return terule_render(policy, rule, &out);
+}
+
+static int syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule_t * rule, apol_render_out_t * out)
 {
-	char *tmp = NULL;
 	const char *tmp_name = NULL;
 	const char *rule_type_str;
 	int error = 0;
@@ -766,30 +1173,30 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 	const qpol_type_t *type = NULL;
 	const qpol_class_t *obj_class = NULL;
 	qpol_iterator_t *iter = NULL, *iter2 = NULL;
-	size_t tmp_sz = 0, iter_sz = 0, iter2_sz = 0;
+	size_t iter_sz = 0, iter2_sz = 0;
 	const qpol_type_set_t *set = NULL;
 
 	if (!policy || !rule) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 
 	/* rule type */
 	if (qpol_syn_terule_get_rule_type(policy->p, rule, &rule_type)) {
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type &= (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER))) {
 		ERR(policy, "%s", "Invalid TE rule type");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
 	if (!(rule_type_str = apol_rule_type_to_str(rule_type))) {
 		ERR(policy, "%s", "Could not get TE rule type's string");
 		errno = EINVAL;
-		return NULL;
+		return -1;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s ", rule_type_str)) {
+	if (apol_render_out_printf(out, "%s ", rule_type_str)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -805,7 +1212,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		goto err;
 	}
 	if (star) {
-		if (apol_str_append(&tmp, &tmp_sz, "* ")) {
+		if (apol_render_out_puts(out, "* ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -816,7 +1223,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 			goto err;
 		}
 		if (comp) {
-			if (apol_str_append(&tmp, &tmp_sz, "~")) {
+			if (apol_render_out_puts(out, "~")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -836,7 +1243,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 			goto err;
 		}
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+			if (apol_render_out_puts(out, "{ ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -852,7 +1259,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -868,7 +1275,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "-%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "-%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -877,7 +1284,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		qpol_iterator_destroy(&iter);
 		qpol_iterator_destroy(&iter2);
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+			if (apol_render_out_puts(out, "} ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -895,7 +1302,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		goto err;
 	}
 	if (star) {
-		if (apol_str_append(&tmp, &tmp_sz, "* ")) {
+		if (apol_render_out_puts(out, "* ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -906,7 +1313,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 			goto err;
 		}
 		if (comp) {
-			if (apol_str_append(&tmp, &tmp_sz, "~")) {
+			if (apol_render_out_puts(out, "~")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -926,7 +1333,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 			goto err;
 		}
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+			if (apol_render_out_puts(out, "{ ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -942,7 +1349,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -958,7 +1365,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 				error = errno;
 				goto err;
 			}
-			if (apol_str_appendf(&tmp, &tmp_sz, "-%s ", tmp_name)) {
+			if (apol_render_out_printf(out, "-%s ", tmp_name)) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -967,7 +1374,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		qpol_iterator_destroy(&iter);
 		qpol_iterator_destroy(&iter2);
 		if (iter_sz + iter2_sz > 1) {
-			if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+			if (apol_render_out_puts(out, "} ")) {
 				error = errno;
 				ERR(policy, "%s", strerror(error));
 				goto err;
@@ -975,7 +1382,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		}
 	}
 
-	if (apol_str_append(&tmp, &tmp_sz, ": ")) {
+	if (apol_render_out_puts(out, ": ")) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -992,7 +1399,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		goto err;
 	}
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "{ ")) {
+		if (apol_render_out_puts(out, "{ ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1008,7 +1415,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 			error = errno;
 			goto err;
 		}
-		if (apol_str_appendf(&tmp, &tmp_sz, "%s ", tmp_name)) {
+		if (apol_render_out_printf(out, "%s ", tmp_name)) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1016,7 +1423,7 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 	}
 	qpol_iterator_destroy(&iter);
 	if (iter_sz > 1) {
-		if (apol_str_append(&tmp, &tmp_sz, "} ")) {
+		if (apol_render_out_puts(out, "} ")) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -1032,18 +1439,40 @@ char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule
 		error = errno;
 		goto err;
 	}
-	if (apol_str_appendf(&tmp, &tmp_sz, "%s;", tmp_name)) {
+	if (apol_render_out_printf(out, "%s;", tmp_name)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
 	}
 
-	return tmp;
+	return 0;
 
       err:
-	free(tmp);
 	qpol_iterator_destroy(&iter);
 	qpol_iterator_destroy(&iter2);
 	errno = error;
-	return NULL;
+	return -1;
+}
+
+char *apol_syn_terule_render(const apol_policy_t * policy, const qpol_syn_terule_t * rule)
+{
+	apol_render_out_t out = { NULL, NULL, 0, 0 };
+	if (syn_terule_render(policy, rule, &out) < 0) {
+		int error = errno;
+		free(out.buf);
+		errno = error;
+		return NULL;
+	}
+	return out.buf;
+}
+
+int apol_syn_terule_render_file(const apol_policy_t * policy, const qpol_syn_terule_t * rule, FILE * fp)
+{
+	apol_render_out_t out = { fp, NULL, 0, 0 };
+	if (fp == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	return syn_terule_render(policy, rule, &out);
 }
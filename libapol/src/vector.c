@@ -24,8 +24,10 @@
 
 #include <apol/vector.h>
 #include "vector-internal.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h>
 
 /** The default initial capacity of a vector; must be a positive integer */
@@ -292,35 +294,241 @@ int apol_vector_compare(const apol_vector_t * a, const apol_vector_t * b, apol_v
 	}
 }
 
+/** Ranges this short are finished with an insertion sort. */
+#define VECTOR_SORT_INSERTION_MAX 16
+
+/** Fewest elements worth giving a thread of its own to sort. */
+#define VECTOR_SORT_PARALLEL_MIN 65536
+
+static void vector_insertion_sort(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t i, j;
+	for (i = first + 1; i <= last; i++) {
+		void *elem = data[i];
+		for (j = i; j > first && cmp(data[j - 1], elem, arg) > 0; j--) {
+			data[j] = data[j - 1];
+		}
+		data[j] = elem;
+	}
+}
+
+static void vector_sift_down(void **data, size_t root, size_t size, apol_vector_comp_func * cmp, void *arg)
+{
+	void *elem = data[root];
+	size_t child;
+	while ((child = 2 * root + 1) < size) {
+		if (child + 1 < size && cmp(data[child], data[child + 1], arg) < 0) {
+			child++;
+		}
+		if (cmp(elem, data[child], arg) >= 0) {
+			break;
+		}
+		data[root] = data[child];
+		root = child;
+	}
+	data[root] = elem;
+}
+
+static void vector_heap_sort(void **data, size_t size, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t i;
+	for (i = size / 2; i > 0; i--) {
+		vector_sift_down(data, i - 1, size, cmp, arg);
+	}
+	for (i = size - 1; i > 0; i--) {
+		void *tmp = data[0];
+		data[0] = data[i];
+		data[i] = tmp;
+		vector_sift_down(data, 0, i, cmp, arg);
+	}
+}
+
+/**
+ * Partition data[first..last] around the median of its first, middle
+ * and last elements.  Elements equal to the pivot may end up on
+ * either side, so runs of equal elements are split evenly.
+ *
+ * @return Index of the pivot after partitioning; everything before it
+ * is <= the pivot and everything after it is >= the pivot.
+ */
 static size_t vector_qsort_partition(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
 {
-	void *pivot = data[last];
-	size_t i = first, j = last;
-	while (i < j) {
-		if (cmp(data[i], pivot, arg) <= 0) {
-			i++;
-		} else {
-			data[j] = data[i];
-			data[i] = data[j - 1];
-			j--;
+	size_t mid = first + (last - first) / 2, i, j;
+	void *tmp, *pivot;
+
+	/* order first, middle and last, then use the middle as pivot */
+	if (cmp(data[mid], data[first], arg) < 0) {
+		tmp = data[mid], data[mid] = data[first], data[first] = tmp;
+	}
+	if (cmp(data[last], data[mid], arg) < 0) {
+		tmp = data[last], data[last] = data[mid], data[mid] = tmp;
+		if (cmp(data[mid], data[first], arg) < 0) {
+			tmp = data[mid], data[mid] = data[first], data[first] = tmp;
 		}
 	}
-	data[j] = pivot;
-	return j;
+	pivot = data[mid];
+	data[mid] = data[last - 1];
+	data[last - 1] = pivot;
+
+	/* data[first] <= pivot and data[last] >= pivot act as sentinels */
+	i = first;
+	j = last - 1;
+	for (;;) {
+		while (cmp(data[++i], pivot, arg) < 0) ;
+		while (cmp(pivot, data[--j], arg) < 0) ;
+		if (i >= j) {
+			break;
+		}
+		tmp = data[i], data[i] = data[j], data[j] = tmp;
+	}
+	data[last - 1] = data[i];
+	data[i] = pivot;
+	return i;
 }
 
-static void vector_qsort(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
+/**
+ * Introsort: quicksort that falls back to heapsort once the recursion
+ * gets deeper than depth, so that the worst case stays O(n log n).
+ * Only the smaller side of each partition is recursed into, bounding
+ * the stack depth to O(log n).
+ */
+static void vector_qsort(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg, size_t depth)
 {
+	while (last - first >= VECTOR_SORT_INSERTION_MAX) {
+		size_t i;
+		if (depth == 0) {
+			vector_heap_sort(data + first, last - first + 1, cmp, arg);
+			return;
+		}
+		depth--;
+		i = vector_qsort_partition(data, first, last, cmp, arg);
+		if (i - first < last - i) {
+			if (i > first) {
+				vector_qsort(data, first, i - 1, cmp, arg, depth);
+			}
+			first = i + 1;
+		} else {
+			vector_qsort(data, i + 1, last, cmp, arg, depth);
+			last = i - 1;
+		}
+	}
 	if (first < last) {
-		size_t i = vector_qsort_partition(data, first, last, cmp, arg);
-		/* need this explicit check here, because i is an
-		 * unsigned integer, and subtracting 1 from 0 is
-		 * bad */
-		if (i > 0) {
-			vector_qsort(data, first, i - 1, cmp, arg);
+		vector_insertion_sort(data, first, last, cmp, arg);
+	}
+}
+
+/** Recursion depth allowed before vector_qsort() switches to heapsort. */
+static size_t vector_qsort_depth(size_t size)
+{
+	size_t depth = 0;
+	while (size > 1) {
+		size >>= 1;
+		depth++;
+	}
+	return 2 * depth;
+}
+
+/**
+ * Merge the sorted ranges src[first..mid) and src[mid..last) into
+ * dest[first..last).  Equal elements are taken from the first range
+ * first, which keeps the merge stable.
+ */
+static void vector_merge(void **dest, void *const *src, size_t first, size_t mid, size_t last, apol_vector_comp_func * cmp,
+			 void *arg)
+{
+	size_t i = first, j = mid, k = first;
+	if (mid == first || mid == last || cmp(src[mid - 1], src[mid], arg) <= 0) {
+		/* already in order, which is common for avtab-ordered
+		 * results */
+		memmove(dest + first, src + first, (last - first) * sizeof(*dest));
+		return;
+	}
+	while (i < mid && j < last) {
+		if (cmp(src[j], src[i], arg) < 0) {
+			dest[k++] = src[j++];
+		} else {
+			dest[k++] = src[i++];
+		}
+	}
+	while (i < mid) {
+		dest[k++] = src[i++];
+	}
+	while (j < last) {
+		dest[k++] = src[j++];
+	}
+}
+
+/**
+ * Stable merge sort of data[first..last) using buf (which must be
+ * as large as data) as scratch space.
+ */
+static void vector_merge_sort(void **data, void **buf, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t mid;
+	if (last - first <= VECTOR_SORT_INSERTION_MAX) {
+		if (last - first > 1) {
+			vector_insertion_sort(data, first, last - 1, cmp, arg);
+		}
+		return;
+	}
+	mid = first + (last - first) / 2;
+	vector_merge_sort(data, buf, first, mid, cmp, arg);
+	vector_merge_sort(data, buf, mid, last, cmp, arg);
+	memcpy(buf + first, data + first, (last - first) * sizeof(*buf));
+	vector_merge(data, buf, first, mid, last, cmp, arg);
+}
+
+/** One thread's share of apol_vector_sort_parallel(). */
+typedef struct vector_sort_task
+{
+	void **data, **buf;
+	size_t first, mid, last;
+	apol_vector_comp_func *cmp;
+	void *arg;
+} vector_sort_task_t;
+
+static void *vector_sort_task_run(void *arg)
+{
+	vector_sort_task_t *task = arg;
+	if (task->mid == task->last) {
+		vector_merge_sort(task->data, task->buf, task->first, task->last, task->cmp, task->arg);
+	} else {
+		memcpy(task->buf + task->first, task->data + task->first, (task->last - task->first) * sizeof(*task->buf));
+		vector_merge(task->data, task->buf, task->first, task->mid, task->last, task->cmp, task->arg);
+	}
+	return NULL;
+}
+
+/**
+ * Run tasks in their own threads and wait for them.  If a thread
+ * cannot be created its task is run by the calling thread instead.
+ */
+static void vector_sort_tasks_run(vector_sort_task_t * tasks, size_t num_tasks)
+{
+	pthread_t *threads;
+	int *started;
+	size_t i;
+
+	if (num_tasks == 1 ||
+	    (threads = calloc(num_tasks, sizeof(*threads) + sizeof(*started))) == NULL) {
+		for (i = 0; i < num_tasks; i++) {
+			vector_sort_task_run(tasks + i);
+		}
+		return;
+	}
+	started = (int *)(threads + num_tasks);
+	for (i = 1; i < num_tasks; i++) {
+		started[i] = (pthread_create(threads + i, NULL, vector_sort_task_run, tasks + i) == 0);
+	}
+	vector_sort_task_run(tasks);
+	for (i = 1; i < num_tasks; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		} else {
+			vector_sort_task_run(tasks + i);
 		}
-		vector_qsort(data, i + 1, last, cmp, arg);
 	}
+	free(threads);
 }
 
 /**
@@ -339,7 +547,7 @@ static int vector_int_comp(const void *a, const void *b, void *data __attribute_
 	return 0;
 }
 
-/* implemented as an in-place quicksort */
+/* implemented as an introsort; see vector_qsort() */
 void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
 {
 	if (!v) {
@@ -350,8 +558,104 @@ void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data
 		cmp = vector_int_comp;
 	}
 	if (v->size > 1) {
-		vector_qsort(v->array, 0, v->size - 1, cmp, data);
+		vector_qsort(v->array, 0, v->size - 1, cmp, data, vector_qsort_depth(v->size));
+	}
+}
+
+int apol_vector_sort_stable(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
+{
+	void **buf;
+	if (!v) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (cmp == NULL) {
+		cmp = vector_int_comp;
+	}
+	if (v->size > 1) {
+		if ((buf = malloc(v->size * sizeof(*buf))) == NULL) {
+			return -1;
+		}
+		vector_merge_sort(v->array, buf, 0, v->size, cmp, data);
+		free(buf);
+	}
+	return 0;
+}
+
+int apol_vector_sort_parallel(apol_vector_t * v, apol_vector_comp_func * cmp, void *data, size_t num_threads)
+{
+	vector_sort_task_t *tasks = NULL;
+	size_t *bounds = NULL, num_runs, i;
+	void **buf = NULL;
+	long num_cpus;
+	int error;
+
+	if (!v) {
+		errno = EINVAL;
+		return -1;
+	}
+	/* no more threads than processors, and each with at least
+	 * VECTOR_SORT_PARALLEL_MIN elements to sort */
+	num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_cpus > 0 && num_threads > (size_t) num_cpus) {
+		num_threads = (size_t) num_cpus;
+	}
+	if (num_threads > v->size / VECTOR_SORT_PARALLEL_MIN) {
+		num_threads = v->size / VECTOR_SORT_PARALLEL_MIN;
 	}
+	if (num_threads <= 1) {
+		return apol_vector_sort_stable(v, cmp, data);
+	}
+	if (cmp == NULL) {
+		cmp = vector_int_comp;
+	}
+	if ((buf = malloc(v->size * sizeof(*buf))) == NULL ||
+	    (tasks = calloc(num_threads, sizeof(*tasks))) == NULL || (bounds = calloc(num_threads + 1, sizeof(*bounds))) == NULL) {
+		error = errno;
+		free(buf);
+		free(tasks);
+		errno = error;
+		return -1;
+	}
+
+	/* sort one run per thread, then merge neighbouring runs in
+	 * parallel until one is left; merging neighbours in order keeps
+	 * the result identical to apol_vector_sort_stable() */
+	num_runs = num_threads;
+	for (i = 0; i <= num_runs; i++) {
+		bounds[i] = v->size * i / num_runs;
+	}
+	for (i = 0; i < num_runs; i++) {
+		tasks[i].data = v->array;
+		tasks[i].buf = buf;
+		tasks[i].first = bounds[i];
+		tasks[i].mid = tasks[i].last = bounds[i + 1];
+		tasks[i].cmp = cmp;
+		tasks[i].arg = data;
+	}
+	vector_sort_tasks_run(tasks, num_runs);
+	while (num_runs > 1) {
+		size_t num_merges = num_runs / 2;
+		for (i = 0; i < num_merges; i++) {
+			tasks[i].first = bounds[2 * i];
+			tasks[i].mid = bounds[2 * i + 1];
+			tasks[i].last = bounds[2 * i + 2];
+		}
+		vector_sort_tasks_run(tasks, num_merges);
+		for (i = 0; i < num_merges; i++) {
+			bounds[i + 1] = bounds[2 * i + 2];
+		}
+		if (num_runs % 2) {
+			bounds[num_merges + 1] = bounds[num_runs];
+			num_merges++;
+		}
+		num_runs = num_merges;
+	}
+
+	free(buf);
+	free(tasks);
+	free(bounds);
+	return 0;
 }
 
 void apol_vector_sort_uniquify(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
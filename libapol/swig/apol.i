@@ -3175,6 +3175,17 @@ typedef struct apol_infoflow_graph {} apol_infoflow_graph_t;
 	fail:
 		return retval;
 	};
+	apol_vector_t *trans_further_run(apol_policy_t *p, unsigned int seed, size_t num_iterations, unsigned long max_msecs, apol_vector_t *v) {
+		apol_vector_t *retval = NULL;
+		BEGIN_EXCEPTION
+		if (apol_infoflow_analysis_trans_further_run(p, self, seed, num_iterations, max_msecs, &v)) {
+			SWIG_exception(SWIG_RuntimeError, "Could not run further analysis");
+		}
+		END_EXCEPTION
+		retval = v;
+	fail:
+		return retval;
+	};
 };
 typedef struct apol_infoflow_result {} apol_infoflow_result_t;
 %extend apol_infoflow_result_t {
@@ -27,10 +27,15 @@
 
 #include <CUnit/CUnit.h>
 #include <apol/avrule-query.h>
+#include <apol/neverallow-analysis.h>
 #include <apol/policy.h>
 #include <apol/policy-path.h>
+#include <apol/terule-query.h>
 #include <qpol/policy_extend.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define BIN_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.21"
 #define SOURCE_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.conf"
@@ -114,11 +119,372 @@ static void avrule_default(void)
 	apol_avrule_query_destroy(&aq);
 }
 
+static void avrule_compare_threaded(apol_avrule_query_t * aq)
+{
+	apol_vector_t *serial = NULL, *threaded = NULL;
+	size_t i;
+
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_get_by_query(bp, aq, &serial) == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 4) == 0);
+	CU_ASSERT_FATAL(apol_avrule_get_by_query(bp, aq, &threaded) == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+
+	CU_ASSERT(apol_vector_get_size(serial) > 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(serial) == apol_vector_get_size(threaded));
+	for (i = 0; i < apol_vector_get_size(serial); i++) {
+		CU_ASSERT(apol_vector_get_element(serial, i) == apol_vector_get_element(threaded, i));
+	}
+	apol_vector_destroy(&serial);
+	apol_vector_destroy(&threaded);
+}
+
+static void avrule_threaded(void)
+{
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	/* whole rule table */
+	avrule_compare_threaded(aq);
+
+	/* rules looked up by source */
+	CU_ASSERT_FATAL(apol_avrule_query_set_regex(bp, aq, 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_source(bp, aq, ".*", 1) == 0);
+	avrule_compare_threaded(aq);
+
+	apol_avrule_query_destroy(&aq);
+}
+
+/* rules looked up by source must keep the order of a whole table scan */
+static void avrule_check_table_order(const apol_vector_t * v)
+{
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	apol_vector_t *all = NULL;
+	size_t i, j;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	CU_ASSERT_FATAL(apol_avrule_get_by_query(bp, aq, &all) == 0);
+	for (i = 0, j = 0; i < apol_vector_get_size(all) && j < apol_vector_get_size(v); i++) {
+		if (apol_vector_get_element(all, i) == apol_vector_get_element(v, j)) {
+			j++;
+		}
+	}
+	CU_ASSERT(j == apol_vector_get_size(v));
+	apol_vector_destroy(&all);
+	apol_avrule_query_destroy(&aq);
+}
+
+static void avrule_batch(void)
+{
+	apol_avrule_query_t *aq[3];
+	apol_vector_t *queries = apol_vector_create(NULL), *results = NULL, *v = NULL, *rv;
+	size_t i, j, threads;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries);
+
+	for (i = 0; i < 3; i++) {
+		aq[i] = apol_avrule_query_create();
+		CU_ASSERT_PTR_NOT_NULL_FATAL(aq[i]);
+		CU_ASSERT_FATAL(apol_vector_append(queries, aq[i]) == 0);
+	}
+	CU_ASSERT_FATAL(apol_avrule_query_set_regex(bp, aq[1], 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_source(bp, aq[1], ".*", 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_rules(bp, aq[2], QPOL_RULE_ALLOW) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_append_perm(bp, aq[2], "read") == 0);
+
+	/* each result must be exactly what the query gives on its own */
+	for (threads = 1; threads <= 4; threads += 3) {
+		CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, threads) == 0);
+		CU_ASSERT_FATAL(apol_avrule_get_by_queries(bp, queries, &results) == 0);
+		CU_ASSERT_FATAL(apol_vector_get_size(results) == 3);
+		for (i = 0; i < 3; i++) {
+			rv = apol_vector_get_element(results, i);
+			CU_ASSERT_FATAL(apol_avrule_get_by_query(bp, aq[i], &v) == 0);
+			CU_ASSERT_FATAL(apol_vector_get_size(v) == apol_vector_get_size(rv));
+			for (j = 0; j < apol_vector_get_size(v); j++) {
+				CU_ASSERT(apol_vector_get_element(v, j) == apol_vector_get_element(rv, j));
+			}
+			avrule_check_table_order(v);
+			apol_vector_destroy(&v);
+		}
+		apol_vector_destroy(&results);
+	}
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+
+	for (i = 0; i < 3; i++) {
+		apol_avrule_query_destroy(&aq[i]);
+	}
+	apol_vector_destroy(&queries);
+}
+
+struct avrule_map_state
+{
+	const apol_vector_t *v;
+	size_t num_rules, stop_after;
+};
+
+static int avrule_map_check(const apol_policy_t * p __attribute__ ((unused)), const qpol_avrule_t * rule, void *arg)
+{
+	struct avrule_map_state *state = arg;
+	CU_ASSERT(state->num_rules < apol_vector_get_size(state->v) &&
+		  apol_vector_get_element(state->v, state->num_rules) == rule);
+	state->num_rules++;
+	return (state->num_rules == state->stop_after);
+}
+
+static void avrule_map(void)
+{
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	apol_vector_t *v = NULL;
+	struct avrule_map_state state;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	CU_ASSERT_FATAL(apol_avrule_get_by_query(bp, aq, &v) == 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(v) > 1);
+
+	/* every rule, in the same order as the vector */
+	memset(&state, 0, sizeof(state));
+	state.v = v;
+	CU_ASSERT(apol_avrule_get_by_query_map(bp, aq, avrule_map_check, &state) == 0);
+	CU_ASSERT(state.num_rules == apol_vector_get_size(v));
+
+	/* stopped early by the callback */
+	memset(&state, 0, sizeof(state));
+	state.v = v;
+	state.stop_after = 1;
+	CU_ASSERT(apol_avrule_get_by_query_map(bp, aq, avrule_map_check, &state) == 0);
+	CU_ASSERT(state.num_rules == 1);
+
+	apol_vector_destroy(&v);
+	apol_avrule_query_destroy(&aq);
+}
+
+/* whether rule's source and target are both types rather than attributes */
+static bool avrule_neverallow_is_simple(const qpol_avrule_t * rule, const char **src_name, const char **tgt_name,
+					const char **class_name, uint32_t * perms)
+{
+	qpol_policy_t *q = apol_policy_get_qpol(sp);
+	const qpol_type_t *src, *tgt;
+	const qpol_class_t *obj_class;
+	unsigned char src_attr, tgt_attr;
+	uint32_t class_val;
+	CU_ASSERT_FATAL(qpol_avrule_get_source_type(q, rule, &src) == 0 && qpol_avrule_get_target_type(q, rule, &tgt) == 0 &&
+			qpol_avrule_get_object_class(q, rule, &obj_class) == 0);
+	CU_ASSERT_FATAL(qpol_type_get_name(q, src, src_name) == 0 && qpol_type_get_name(q, tgt, tgt_name) == 0 &&
+			qpol_class_get_name(q, obj_class, class_name) == 0);
+	CU_ASSERT_FATAL(qpol_type_get_isattr(q, src, &src_attr) == 0 && qpol_type_get_isattr(q, tgt, &tgt_attr) == 0);
+	CU_ASSERT_FATAL(qpol_avrule_get_perm_mask(q, rule, &class_val, perms) == 0);
+	return !src_attr && !tgt_attr;
+}
+
+static void avrule_neverallow(void)
+{
+	apol_neverallow_analysis_t *na = apol_neverallow_analysis_create();
+	apol_avrule_query_t *aq = NULL;
+	apol_vector_t *v = NULL, *neverallows = NULL, *allows = NULL, *perms = NULL;
+	const char *src_name, *tgt_name, *class_name;
+	uint32_t rule_type, never_perms, allow_perms, class_val;
+	size_t i, j, num_simple = 0, num_expected = 0;
+	qpol_policy_t *q = apol_policy_get_qpol(sp);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(na);
+
+	/* binary policies have no neverallow rules to check */
+	CU_ASSERT(apol_neverallow_analysis_do(bp, na, &v) < 0);
+	CU_ASSERT_PTR_NULL(v);
+
+	CU_ASSERT_FATAL(apol_neverallow_analysis_do(sp, na, &v) == 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		const apol_neverallow_result_t *r = apol_vector_get_element(v, i);
+		const qpol_avrule_t *never = apol_neverallow_result_get_neverallow(r);
+		const qpol_avrule_t *allow = apol_neverallow_result_get_allow(r);
+		CU_ASSERT(qpol_avrule_get_rule_type(q, never, &rule_type) == 0 && rule_type == QPOL_RULE_NEVERALLOW);
+		CU_ASSERT(qpol_avrule_get_rule_type(q, allow, &rule_type) == 0 && rule_type == QPOL_RULE_ALLOW);
+		perms = apol_neverallow_result_get_perms(sp, r);
+		CU_ASSERT(perms != NULL && apol_vector_get_size(perms) > 0);
+		apol_vector_destroy(&perms);
+		if (avrule_neverallow_is_simple(never, &src_name, &tgt_name, &class_name, &never_perms)) {
+			num_simple++;
+		}
+	}
+
+	/* for neverallows between two types, an indirect av rule query
+	 * finds the same allow rules */
+	aq = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+	CU_ASSERT_FATAL(apol_avrule_query_set_rules(sp, aq, QPOL_RULE_NEVERALLOW) == 0);
+	CU_ASSERT_FATAL(apol_avrule_get_by_query(sp, aq, &neverallows) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_rules(sp, aq, QPOL_RULE_ALLOW) == 0);
+	for (i = 0; i < apol_vector_get_size(neverallows); i++) {
+		const qpol_avrule_t *never = apol_vector_get_element(neverallows, i);
+		if (!avrule_neverallow_is_simple(never, &src_name, &tgt_name, &class_name, &never_perms)) {
+			continue;
+		}
+		CU_ASSERT_FATAL(apol_avrule_query_set_source(sp, aq, src_name, 1) == 0 &&
+				apol_avrule_query_set_target(sp, aq, tgt_name, 1) == 0 &&
+				apol_avrule_query_append_class(sp, aq, NULL) == 0 &&
+				apol_avrule_query_append_class(sp, aq, class_name) == 0);
+		CU_ASSERT_FATAL(apol_avrule_get_by_query(sp, aq, &allows) == 0);
+		for (j = 0; j < apol_vector_get_size(allows); j++) {
+			CU_ASSERT_FATAL(qpol_avrule_get_perm_mask(q, apol_vector_get_element(allows, j), &class_val, &allow_perms) ==
+					0);
+			if (allow_perms & never_perms) {
+				num_expected++;
+			}
+		}
+		apol_vector_destroy(&allows);
+	}
+	CU_ASSERT(num_simple == num_expected);
+	apol_vector_destroy(&v);
+
+	/* restricted to a class that no rule uses */
+	CU_ASSERT(apol_neverallow_analysis_append_class(sp, na, "unknown class") == 0);
+	CU_ASSERT_FATAL(apol_neverallow_analysis_do(sp, na, &v) == 0);
+	CU_ASSERT(apol_vector_get_size(v) == 0);
+
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&neverallows);
+	apol_avrule_query_destroy(&aq);
+	apol_neverallow_analysis_destroy(&na);
+}
+
+/* compare two rule vectors element by element */
+static void avrule_compare_vectors(const apol_vector_t * v1, const apol_vector_t * v2)
+{
+	size_t i;
+	CU_ASSERT_FATAL(apol_vector_get_size(v1) == apol_vector_get_size(v2));
+	for (i = 0; i < apol_vector_get_size(v1); i++) {
+		CU_ASSERT(apol_vector_get_element(v1, i) == apol_vector_get_element(v2, i));
+	}
+}
+
+static void avrule_frozen(void)
+{
+	apol_policy_path_t *ppath = apol_policy_path_create(APOL_POLICY_PATH_TYPE_MONOLITHIC, BIN_POLICY, NULL);
+	apol_policy_t *fp = NULL;
+	apol_avrule_query_t *aq[3];
+	apol_terule_query_t *tq = NULL;
+	apol_vector_t *serial = NULL, *threaded = NULL;
+	size_t i;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ppath);
+
+	/* freezing cannot be undone, so use a policy of its own */
+	fp = apol_policy_create_from_policy_path(ppath, 0, NULL, NULL);
+	apol_policy_path_destroy(&ppath);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+	CU_ASSERT_FATAL(apol_policy_freeze(fp) == 0);
+	CU_ASSERT(apol_policy_is_frozen(fp));
+
+	for (i = 0; i < 3; i++) {
+		aq[i] = apol_avrule_query_create();
+		CU_ASSERT_PTR_NOT_NULL_FATAL(aq[i]);
+	}
+	CU_ASSERT_FATAL(apol_avrule_query_set_regex(fp, aq[1], 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_source(fp, aq[1], ".*", 1) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_set_rules(fp, aq[2], QPOL_RULE_ALLOW) == 0);
+	CU_ASSERT_FATAL(apol_avrule_query_append_perm(fp, aq[2], "read") == 0);
+	tq = apol_terule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tq);
+
+	/* the same queries on the frozen policy with one and several threads */
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT_FATAL(apol_policy_set_query_threads(fp, 1) == 0);
+		CU_ASSERT_FATAL(apol_avrule_get_by_query(fp, aq[i], &serial) == 0);
+		CU_ASSERT_FATAL(apol_policy_set_query_threads(fp, 4) == 0);
+		CU_ASSERT_FATAL(apol_avrule_get_by_query(fp, aq[i], &threaded) == 0);
+		avrule_compare_vectors(serial, threaded);
+		apol_vector_destroy(&serial);
+		apol_vector_destroy(&threaded);
+	}
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(fp, 1) == 0);
+	CU_ASSERT_FATAL(apol_terule_get_by_query(fp, tq, &serial) == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(fp, 4) == 0);
+	CU_ASSERT_FATAL(apol_terule_get_by_query(fp, tq, &threaded) == 0);
+	avrule_compare_vectors(serial, threaded);
+	apol_vector_destroy(&serial);
+	apol_vector_destroy(&threaded);
+
+	for (i = 0; i < 3; i++) {
+		apol_avrule_query_destroy(&aq[i]);
+	}
+	apol_terule_query_destroy(&tq);
+	apol_policy_destroy(&fp);
+}
+
+/* The rule just written to f must be exactly s; frees s. */
+static void avrule_check_render_file(FILE * f, char *s)
+{
+	size_t len;
+	long pos;
+	char *buf;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s);
+	len = strlen(s);
+	pos = ftell(f);
+	CU_ASSERT_FATAL(pos >= 0 && (size_t)pos == len);
+	buf = malloc(len + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	rewind(f);
+	CU_ASSERT_FATAL(fread(buf, 1, len, f) == len);
+	CU_ASSERT(memcmp(buf, s, len) == 0);
+	free(buf);
+	free(s);
+	rewind(f);
+}
+
+static void avrule_render_file(void)
+{
+	apol_policy_t *policies[] = { bp, sp };
+	FILE *f = tmpfile();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	int retval;
+	apol_vector_t *v = NULL;
+	size_t i, j;
+	for (i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+		retval = apol_avrule_get_by_query(policies[i], aq, &v);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		CU_ASSERT(apol_vector_get_size(v) > 0);
+		for (j = 0; j < apol_vector_get_size(v); j++) {
+			const qpol_avrule_t *rule = (const qpol_avrule_t *)apol_vector_get_element(v, j);
+			retval = apol_avrule_render_file(policies[i], rule, f);
+			CU_ASSERT_EQUAL_FATAL(retval, 0);
+			avrule_check_render_file(f, apol_avrule_render(policies[i], rule));
+		}
+		apol_vector_destroy(&v);
+	}
+
+	retval = apol_syn_avrule_get_by_query(sp, aq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT(apol_vector_get_size(v) > 0);
+	for (j = 0; j < apol_vector_get_size(v); j++) {
+		const qpol_syn_avrule_t *syn = (const qpol_syn_avrule_t *)apol_vector_get_element(v, j);
+		retval = apol_syn_avrule_render_file(sp, syn, f);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		avrule_check_render_file(f, apol_syn_avrule_render(sp, syn));
+	}
+	apol_vector_destroy(&v);
+	apol_avrule_query_destroy(&aq);
+	fclose(f);
+}
+
 CU_TestInfo avrule_tests[] = {
 	{"basic syntactic search", avrule_basic_syn}
 	,
 	{"default query", avrule_default}
 	,
+	{"threaded query", avrule_threaded}
+	,
+	{"batch query", avrule_batch}
+	,
+	{"query map", avrule_map}
+	,
+	{"neverallow analysis", avrule_neverallow}
+	,
+	{"frozen policy threaded query", avrule_frozen}
+	,
+	{"render to file", avrule_render_file}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -0,0 +1,231 @@
+/**
+ *  @file
+ *
+ *  Measure the time needed for transitive information flow analyses,
+ *  which find the shortest path from a type to every other type in
+ *  the policy's information flow graph.  The number of results and
+ *  the sum of their lengths are printed alongside each time, so that
+ *  running this program against two builds of the library both
+ *  compares their speed and checks that their answers agree.  The
+ *  time taken to find further paths by many random restarts is also
+ *  measured, with one thread and with several.  With no arguments
+ *  the Fedora Core 4 targeted policy snapshot is used.
+ *  This program is not run by "make check"; build it with "make
+ *  infoflow-bench".
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <apol/infoflow-analysis.h>
+#include <apol/perm-map.h>
+#include <apol/policy.h>
+#include <apol/policy-path.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define DEFAULT_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+#define DEFAULT_PERMMAP TOP_SRCDIR "/apol/perm_maps/apol_perm_mapping_ver19"
+
+/* number of times each analysis is repeated */
+#define BENCH_ROUNDS 5
+
+/* random restarts for each further search, and the thread counts
+ * with which they are run */
+#define BENCH_FURTHER_ITERATIONS 400
+static const size_t further_threads[] = { 1, 2, 4, 0 };
+
+static const char *types[] = {
+	"local_login_t",
+	"unconfined_t",
+	"httpd_t",
+	"named_t",
+	"user_home_t",
+	"shadow_t",
+	NULL
+};
+
+static double bench_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* quiet the library's informational messages */
+static void bench_callback(void *varg __attribute__ ((unused)), const apol_policy_t * p __attribute__ ((unused)),
+			   int level, const char *fmt, va_list va_args)
+{
+	if (level == APOL_MSG_ERR) {
+		vfprintf(stderr, fmt, va_args);
+		fprintf(stderr, "\n");
+	}
+}
+
+static int bench_trans(apol_policy_t * p, const char *type, unsigned int dir)
+{
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	apol_infoflow_graph_t *g = NULL;
+	apol_vector_t *v = NULL;
+	unsigned long total_length = 0;
+	size_t i, num_results = 0;
+	double start, elapsed;
+	int round, retv = -1;
+
+	if (ia == NULL ||
+	    apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS) < 0 ||
+	    apol_infoflow_analysis_set_dir(p, ia, dir) < 0 || apol_infoflow_analysis_set_type(p, ia, type) < 0) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		goto cleanup;
+	}
+	/* the first analysis builds the graph; time only the searches */
+	if (apol_infoflow_analysis_do(p, ia, &v, &g) < 0) {
+		/* the type is not within this policy */
+		retv = 0;
+		goto cleanup;
+	}
+	apol_vector_destroy(&v);
+	start = bench_now();
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		if (apol_infoflow_analysis_do_more(p, g, type, &v) < 0) {
+			fprintf(stderr, "%s\n", strerror(errno));
+			goto cleanup;
+		}
+		if (round + 1 < BENCH_ROUNDS) {
+			apol_vector_destroy(&v);
+		}
+	}
+	elapsed = (bench_now() - start) / BENCH_ROUNDS;
+	num_results = apol_vector_get_size(v);
+	for (i = 0; i < num_results; i++) {
+		total_length += apol_infoflow_result_get_length(apol_vector_get_element(v, i));
+	}
+	printf("%-16s %-4s %10zu %12lu %10.3f ms\n", type, (dir == APOL_INFOFLOW_IN ? "in" : "out"), num_results, total_length,
+	       elapsed * 1000.0);
+	retv = 0;
+      cleanup:
+	apol_vector_destroy(&v);
+	apol_infoflow_graph_destroy(&g);
+	apol_infoflow_analysis_destroy(&ia);
+	return retv;
+}
+
+static int bench_further(apol_policy_t * p, const char *type)
+{
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	apol_infoflow_graph_t *g = NULL;
+	apol_vector_t *v = NULL;
+	const qpol_type_t *end_type = NULL;
+	const char *end_name;
+	double start, elapsed;
+	size_t i, max_steps = 0;
+	int retv = -1;
+
+	if (ia == NULL ||
+	    apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS) < 0 ||
+	    apol_infoflow_analysis_set_dir(p, ia, APOL_INFOFLOW_OUT) < 0 || apol_infoflow_analysis_set_type(p, ia, type) < 0) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		goto cleanup;
+	}
+	if (apol_infoflow_analysis_do(p, ia, &v, &g) < 0 || apol_vector_get_size(v) == 0) {
+		/* the type is not within this policy, or reaches
+		 * nothing */
+		retv = 0;
+		goto cleanup;
+	}
+	/* look for other ways of reaching the type farthest away */
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		const apol_infoflow_result_t *r = apol_vector_get_element(v, i);
+		if (apol_vector_get_size(apol_infoflow_result_get_steps(r)) > max_steps) {
+			max_steps = apol_vector_get_size(apol_infoflow_result_get_steps(r));
+			end_type = apol_infoflow_result_get_end_type(r);
+		}
+	}
+	if (qpol_type_get_name(apol_policy_get_qpol(p), end_type, &end_name) < 0) {
+		goto cleanup;
+	}
+	apol_vector_destroy(&v);
+	if (apol_infoflow_analysis_trans_further_prepare(p, g, type, end_name) < 0) {
+		goto cleanup;
+	}
+	for (i = 0; further_threads[i] != 0; i++) {
+		if (apol_policy_set_query_threads(p, further_threads[i]) < 0) {
+			goto cleanup;
+		}
+		start = bench_now();
+		if (apol_infoflow_analysis_trans_further_run(p, g, 1, BENCH_FURTHER_ITERATIONS, 0, &v) < 0) {
+			fprintf(stderr, "%s\n", strerror(errno));
+			goto cleanup;
+		}
+		elapsed = bench_now() - start;
+		printf("%-16s %-16s %7zu %10zu %10.3f ms\n", type, end_name, further_threads[i], apol_vector_get_size(v),
+		       elapsed * 1000.0);
+		apol_vector_destroy(&v);
+	}
+	retv = 0;
+      cleanup:
+	apol_policy_set_query_threads(p, 1);
+	apol_vector_destroy(&v);
+	apol_infoflow_graph_destroy(&g);
+	apol_infoflow_analysis_destroy(&ia);
+	return retv;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = (argc > 1 ? argv[1] : DEFAULT_POLICY);
+	const char *permmap = (argc > 2 ? argv[2] : DEFAULT_PERMMAP);
+	apol_policy_path_t *ppath = NULL;
+	apol_policy_t *p = NULL;
+	int i, retv = 0;
+
+	if ((ppath = apol_policy_path_create(APOL_POLICY_PATH_TYPE_MONOLITHIC, path, NULL)) == NULL) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		return 1;
+	}
+	if ((p = apol_policy_create_from_policy_path(ppath, QPOL_POLICY_OPTION_NO_NEVERALLOWS, bench_callback, NULL)) == NULL) {
+		fprintf(stderr, "%s: could not be opened\n", path);
+		apol_policy_path_destroy(&ppath);
+		return 1;
+	}
+	apol_policy_path_destroy(&ppath);
+	if (apol_policy_open_permmap(p, permmap) < 0) {
+		fprintf(stderr, "%s: could not be opened\n", permmap);
+		apol_policy_destroy(&p);
+		return 1;
+	}
+
+	printf("%-16s %-4s %10s %12s %13s\n", "type", "dir", "results", "total length", "time/search");
+	for (i = 0; types[i] != NULL; i++) {
+		retv |= bench_trans(p, types[i], APOL_INFOFLOW_IN);
+		retv |= bench_trans(p, types[i], APOL_INFOFLOW_OUT);
+	}
+
+	printf("\n%-16s %-16s %7s %10s %13s\n", "type", "further end", "threads", "paths", "time");
+	for (i = 0; types[i] != NULL; i++) {
+		retv |= bench_further(p, types[i]);
+	}
+
+	apol_policy_destroy(&p);
+	return retv ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+/**
+ *  @file
+ *
+ *  Test the information flow analysis against its own internals: the
+ *  transitive search against the label correcting search it replaced,
+ *  and graphs updated after permission map changes against graphs
+ *  built afresh.  The analysis is compiled into this program, rather
+ *  than linked from the library, to reach its graphs and static
+ *  routines; the tests of the library's interface are within
+ *  libapol-tests.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+#include <apol/infoflow-analysis.h>
+#include <apol/perm-map.h>
+#include <apol/policy.h>
+#include <apol/policy-path.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/infoflow-analysis.c"
+
+#define BIG_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+#define PERMMAP TOP_SRCDIR "/apol/perm_maps/apol_perm_mapping_ver19"
+
+static apol_policy_t *p = NULL;
+
+#define INFOFLOW_COLOR_RED 3
+
+/**
+ * The D'Esopo-Pape label correcting search that transitive analyses
+ * used before apol_infoflow_analysis_trans_shortest_path() switched
+ * to Dijkstra's algorithm.  See Bertsekas, D. P., "A Simple and Fast
+ * Label Correcting Algorithm for Shortest Paths," Networks, Vol. 23,
+ * pp. 703-709, 1993.
+ */
+static int infoflow_label_correcting(const apol_policy_t * policy, apol_infoflow_graph_t * g, size_t start,
+				     apol_vector_t * results)
+{
+	const apol_infoflow_csr_t *csr = g->csr;
+	const apol_infoflow_edge_t *edge;
+	size_t cur_node, node, i, e, first, last;
+
+	for (i = 0; i < csr->num_nodes; i++) {
+		g->parent[i] = APOL_INFOFLOW_NONE;
+		g->color[i] = APOL_INFOFLOW_COLOR_WHITE;
+		g->distance[i] = INT_MAX;
+	}
+	g->color[start] = INFOFLOW_COLOR_RED;
+	g->distance[start] = 0;
+	apol_infoflow_queue_clear(g);
+	apol_infoflow_queue_insert(g, start);
+
+	while ((cur_node = apol_infoflow_queue_remove(g)) != APOL_INFOFLOW_NONE) {
+		g->color[cur_node] = APOL_INFOFLOW_COLOR_GREY;
+		if (g->direction == APOL_INFOFLOW_OUT) {
+			first = csr->out_start[cur_node];
+			last = csr->out_start[cur_node + 1];
+		} else {
+			first = csr->in_start[cur_node];
+			last = csr->in_start[cur_node + 1];
+		}
+		for (i = first; i < last; i++) {
+			e = (g->direction == APOL_INFOFLOW_OUT ? i : csr->in_edges[i]);
+			edge = csr->edges + e;
+			node = apol_infoflow_trans_next_node(g, edge);
+			if (node == start) {
+				continue;
+			}
+			if (g->distance[node] > g->distance[cur_node] + edge->length) {
+				g->distance[node] = g->distance[cur_node] + edge->length;
+				g->parent[node] = e;
+				/* a node that was queued before goes to
+				 * the front, otherwise to the back */
+				if (g->color[node] != INFOFLOW_COLOR_RED) {
+					if (g->color[node] == APOL_INFOFLOW_COLOR_GREY) {
+						apol_infoflow_queue_push(g, node);
+					} else {
+						apol_infoflow_queue_insert(g, node);
+					}
+					g->color[node] = INFOFLOW_COLOR_RED;
+				}
+			}
+		}
+	}
+
+	for (node = 0; node < csr->num_nodes; node++) {
+		if (g->parent[node] == APOL_INFOFLOW_NONE || node == start) {
+			continue;
+		}
+		if (apol_infoflow_analysis_trans_expand(policy, g, start, node, results) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void infoflow_trans_label_correcting(void)
+{
+	const char *types[] = { "local_login_t", "httpd_t", "user_home_t" };
+	const unsigned int dirs[] = { APOL_INFOFLOW_IN, APOL_INFOFLOW_OUT };
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ia);
+	int retval;
+	retval = apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS);
+	CU_ASSERT(retval == 0);
+
+	apol_vector_t *v = NULL, *v_old = NULL;
+	apol_infoflow_graph_t *g = NULL;
+	const apol_infoflow_edge_t *edge;
+	int *distance = NULL;
+	size_t *parent = NULL, *start_nodes = NULL, num_start_nodes, i, j, k, n, from, num_same = 0;
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		for (j = 0; j < sizeof(dirs) / sizeof(dirs[0]); j++) {
+			retval = apol_infoflow_analysis_set_dir(p, ia, dirs[j]);
+			CU_ASSERT(retval == 0);
+			retval = apol_infoflow_analysis_set_type(p, ia, types[i]);
+			CU_ASSERT(retval == 0);
+			retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+			CU_ASSERT_FATAL(retval == 0);
+			apol_vector_destroy(&v);
+			retval = apol_infoflow_graph_get_nodes_for_type(p, g, types[i], &start_nodes, &num_start_nodes);
+			CU_ASSERT_FATAL(retval == 0 && num_start_nodes > 0);
+			distance = malloc(g->csr->num_nodes * sizeof(*distance));
+			parent = malloc(g->csr->num_nodes * sizeof(*parent));
+			CU_ASSERT_FATAL(distance != NULL && parent != NULL);
+
+			for (k = 0; k < num_start_nodes; k++) {
+				v = apol_vector_create(infoflow_result_free);
+				v_old = apol_vector_create(infoflow_result_free);
+				CU_ASSERT_FATAL(v != NULL && v_old != NULL);
+				retval = apol_infoflow_analysis_trans_shortest_path(p, g, start_nodes[k], v);
+				CU_ASSERT_FATAL(retval == 0);
+				memcpy(distance, g->distance, g->csr->num_nodes * sizeof(*distance));
+				memcpy(parent, g->parent, g->csr->num_nodes * sizeof(*parent));
+				retval = infoflow_label_correcting(p, g, start_nodes[k], v_old);
+				CU_ASSERT_FATAL(retval == 0);
+
+				// both searches reach the same nodes at the same
+				// distances; where several paths to a node are
+				// equally short they may keep different ones
+				for (n = 0; n < g->csr->num_nodes; n++) {
+					CU_ASSERT(distance[n] == g->distance[n]);
+					CU_ASSERT((parent[n] == APOL_INFOFLOW_NONE) == (g->parent[n] == APOL_INFOFLOW_NONE));
+					if (parent[n] == APOL_INFOFLOW_NONE) {
+						continue;
+					}
+					edge = g->csr->edges + parent[n];
+					from = (g->direction == APOL_INFOFLOW_OUT ? edge->start_node : edge->end_node);
+					CU_ASSERT(apol_infoflow_trans_next_node(g, edge) == n);
+					CU_ASSERT(distance[from] + edge->length == distance[n]);
+				}
+
+				// and so, barring such ties, the same steps
+				if (apol_vector_get_size(v) == apol_vector_get_size(v_old)) {
+					for (n = 0; n < apol_vector_get_size(v); n++) {
+						const apol_infoflow_result_t *r = apol_vector_get_element(v, n);
+						const apol_infoflow_result_t *r_old = apol_vector_get_element(v_old, n);
+						CU_ASSERT(r->end_type == r_old->end_type && r->length == r_old->length);
+						if (apol_vector_get_size(r->steps) == apol_vector_get_size(r_old->steps) &&
+						    apol_vector_compare(r->steps, r_old->steps, apol_infoflow_trans_step_comp, NULL, &from) == 0) {
+							num_same++;
+						}
+					}
+				}
+				apol_vector_destroy(&v);
+				apol_vector_destroy(&v_old);
+			}
+			free(start_nodes);
+			free(distance);
+			free(parent);
+			apol_infoflow_graph_destroy(&g);
+		}
+	}
+	CU_ASSERT(num_same > 0);
+
+	apol_infoflow_analysis_destroy(&ia);
+}
+
+/* Run an analysis upon the graph the policy keeps, derived from the
+ * one it kept before the permission map changed, and upon a graph
+ * built afresh from the policy's rules; the two must agree exactly. */
+static void infoflow_check_rebuilt(const apol_infoflow_analysis_t * ia)
+{
+	apol_vector_t *v = NULL, *v2 = NULL;
+	apol_infoflow_graph_t *g = NULL, *g2 = NULL;
+	apol_infoflow_csr_t *csr = NULL;
+	const apol_infoflow_csr_t *c, *c2;
+	size_t i, j;
+	int retval;
+	retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+	CU_ASSERT_FATAL(retval == 0);
+	retval = apol_infoflow_csr_create(p, ia, 0, &csr);
+	CU_ASSERT_FATAL(retval == 0);
+	retval = apol_infoflow_graph_create_from_csr(p, ia, csr, &g2);
+	apol_infoflow_csr_unref(&csr);
+	CU_ASSERT_FATAL(retval == 0);
+	retval = apol_infoflow_analysis_do_more(p, g2, ia->type, &v2);
+	CU_ASSERT_FATAL(retval == 0);
+
+	// the graphs have the same nodes, edges, and rules
+	c = g->csr;
+	c2 = g2->csr;
+	CU_ASSERT_FATAL(c->num_nodes == c2->num_nodes && c->num_edges == c2->num_edges);
+	for (i = 0; i < c->num_nodes; i++) {
+		CU_ASSERT(c->nodes[i].type == c2->nodes[i].type && c->nodes[i].node_type == c2->nodes[i].node_type);
+	}
+	for (i = 0; i < c->num_edges; i++) {
+		CU_ASSERT(c->edges[i].start_node == c2->edges[i].start_node && c->edges[i].end_node == c2->edges[i].end_node);
+		CU_ASSERT(c->edges[i].length == c2->edges[i].length);
+		CU_ASSERT_FATAL(c->edges[i].num_rules == c2->edges[i].num_rules);
+		for (j = 0; j < c->edges[i].num_rules; j++) {
+			CU_ASSERT(c->rules[c->edges[i].first_rule + j] == c2->rules[c2->edges[i].first_rule + j]);
+		}
+	}
+
+	// and so the same results, step for step
+	CU_ASSERT(apol_vector_get_size(v) > 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(v) == apol_vector_get_size(v2));
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		const apol_infoflow_result_t *r = apol_vector_get_element(v, i);
+		const apol_infoflow_result_t *r2 = apol_vector_get_element(v2, i);
+		CU_ASSERT(r->start_type == r2->start_type && r->end_type == r2->end_type);
+		CU_ASSERT(r->direction == r2->direction && r->length == r2->length);
+		CU_ASSERT(apol_vector_get_size(r->steps) == apol_vector_get_size(r2->steps) &&
+			  apol_vector_compare(r->steps, r2->steps, apol_infoflow_trans_step_comp, NULL, &j) == 0);
+	}
+
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&v2);
+	apol_infoflow_graph_destroy(&g);
+	apol_infoflow_graph_destroy(&g2);
+}
+
+static void infoflow_permmap_derive(void)
+{
+	/* weights to give file write in turn, so that its flows grow
+	 * both longer and shorter; zero removes them */
+	const int weights[] = { 3, 8, 2, 0 };
+	const unsigned int modes[] = { APOL_INFOFLOW_MODE_DIRECT, APOL_INFOFLOW_MODE_TRANS, APOL_INFOFLOW_MODE_TRANS };
+	const unsigned int dirs[] = { APOL_INFOFLOW_EITHER, APOL_INFOFLOW_OUT, APOL_INFOFLOW_IN };
+	apol_infoflow_analysis_t *ia[3 * 2];
+	int retval, map, weight;
+	size_t i, j;
+	retval = apol_policy_get_permmap(p, "file", "write", &map, &weight);
+	CU_ASSERT_FATAL(retval == 0);
+	for (i = 0; i < sizeof(ia) / sizeof(ia[0]); i++) {
+		ia[i] = apol_infoflow_analysis_create();
+		CU_ASSERT_PTR_NOT_NULL_FATAL(ia[i]);
+		retval = apol_infoflow_analysis_set_mode(p, ia[i], modes[i / 2]);
+		CU_ASSERT(retval == 0);
+		retval = apol_infoflow_analysis_set_dir(p, ia[i], dirs[i / 2]);
+		CU_ASSERT(retval == 0);
+		retval = apol_infoflow_analysis_set_type(p, ia[i], "local_login_t");
+		CU_ASSERT(retval == 0);
+		// every other analysis limits the minimum weight, and
+		// so uses a graph derived from the kept one
+		if (i % 2) {
+			retval = apol_infoflow_analysis_set_min_weight(p, ia[i], 4);
+			CU_ASSERT(retval == 0);
+		}
+		infoflow_check_rebuilt(ia[i]);
+	}
+
+	for (j = 0; j < sizeof(weights) / sizeof(weights[0]); j++) {
+		if (weights[j] > 0) {
+			retval = apol_policy_set_permmap(p, "file", "write", map, weights[j]);
+		} else {
+			retval = apol_policy_set_permmap(p, "file", "write", APOL_PERMMAP_NONE, weight);
+		}
+		CU_ASSERT_FATAL(retval == 0);
+		for (i = 0; i < sizeof(ia) / sizeof(ia[0]); i++) {
+			infoflow_check_rebuilt(ia[i]);
+		}
+	}
+
+	retval = apol_policy_set_permmap(p, "file", "write", map, weight);
+	CU_ASSERT_FATAL(retval == 0);
+	for (i = 0; i < sizeof(ia) / sizeof(ia[0]); i++) {
+		infoflow_check_rebuilt(ia[i]);
+		apol_infoflow_analysis_destroy(&ia[i]);
+	}
+}
+
+static CU_TestInfo infoflow_internal_tests[] = {
+	{"trans against label correcting", infoflow_trans_label_correcting}
+	,
+	{"permmap derived graph", infoflow_permmap_derive}
+	,
+	CU_TEST_INFO_NULL
+};
+
+static int infoflow_internal_init(void)
+{
+	apol_policy_path_t *ppath = apol_policy_path_create(APOL_POLICY_PATH_TYPE_MONOLITHIC, BIG_POLICY, NULL);
+	if (ppath == NULL) {
+		return 1;
+	}
+
+	if ((p = apol_policy_create_from_policy_path(ppath, QPOL_POLICY_OPTION_NO_NEVERALLOWS, NULL, NULL)) == NULL) {
+		apol_policy_path_destroy(&ppath);
+		return 1;
+	}
+	apol_policy_path_destroy(&ppath);
+
+	if (apol_policy_open_permmap(p, PERMMAP) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+static int infoflow_internal_cleanup(void)
+{
+	apol_policy_destroy(&p);
+	return 0;
+}
+
+int main(void)
+{
+	if (CU_initialize_registry() != CUE_SUCCESS) {
+		return CU_get_error();
+	}
+
+	CU_SuiteInfo suites[] = {
+		{"Infoflow Analysis Internals", infoflow_internal_init, infoflow_internal_cleanup, infoflow_internal_tests},
+		CU_SUITE_INFO_NULL
+	};
+
+	CU_register_suites(suites);
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	unsigned int num_failures = CU_get_number_of_failure_records();
+	CU_cleanup_registry();
+	return (int)num_failures;
+}
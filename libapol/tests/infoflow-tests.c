@@ -96,11 +96,194 @@ static void infoflow_trans_overview(void)
 	apol_infoflow_graph_destroy(&g);
 }
 
+static void infoflow_graph_reuse(void)
+{
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ia);
+	int retval;
+	retval = apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_dir(p, ia, APOL_INFOFLOW_OUT);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_type(p, ia, "local_login_t");
+	CU_ASSERT(retval == 0);
+
+	// the second analysis reuses the graph built by the first
+	apol_vector_t *v = NULL, *v2 = NULL;
+	apol_infoflow_graph_t *g = NULL, *g2 = NULL;
+	retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v) > 0);
+	retval = apol_infoflow_analysis_do(p, ia, &v2, &g2);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v) == apol_vector_get_size(v2));
+	apol_vector_destroy(&v2);
+	apol_infoflow_graph_destroy(&g2);
+
+	// a graph limited to some permissions is never larger
+	retval = apol_infoflow_analysis_append_class_perm(p, ia, "file", "write");
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_do(p, ia, &v2, &g2);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v2) <= apol_vector_get_size(v));
+
+	apol_infoflow_analysis_destroy(&ia);
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&v2);
+	apol_infoflow_graph_destroy(&g);
+	apol_infoflow_graph_destroy(&g2);
+}
+
+static void infoflow_permmap_update(void)
+{
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ia);
+	int retval, map, weight;
+	retval = apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_dir(p, ia, APOL_INFOFLOW_OUT);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_type(p, ia, "local_login_t");
+	CU_ASSERT(retval == 0);
+	retval = apol_policy_get_permmap(p, "file", "write", &map, &weight);
+	CU_ASSERT_FATAL(retval == 0);
+
+	apol_vector_t *v = NULL, *v2 = NULL;
+	apol_infoflow_graph_t *g = NULL;
+	unsigned int length = 0, length2 = 0;
+	size_t i;
+	retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+	CU_ASSERT(retval == 0);
+	apol_infoflow_graph_destroy(&g);
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		length += apol_infoflow_result_get_length(apol_vector_get_element(v, i));
+	}
+
+	// removing a permission's flows updates the cached graph
+	retval = apol_policy_set_permmap(p, "file", "write", APOL_PERMMAP_NONE, weight);
+	CU_ASSERT_FATAL(retval == 0);
+	retval = apol_infoflow_analysis_do(p, ia, &v2, &g);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v2) <= apol_vector_get_size(v));
+	apol_vector_destroy(&v2);
+	apol_infoflow_graph_destroy(&g);
+
+	// and restoring it gives back the original results
+	retval = apol_policy_set_permmap(p, "file", "write", map, weight);
+	CU_ASSERT_FATAL(retval == 0);
+	retval = apol_infoflow_analysis_do(p, ia, &v2, &g);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v2) == apol_vector_get_size(v));
+	for (i = 0; i < apol_vector_get_size(v2); i++) {
+		length2 += apol_infoflow_result_get_length(apol_vector_get_element(v2, i));
+	}
+	CU_ASSERT(length2 == length);
+
+	apol_infoflow_analysis_destroy(&ia);
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&v2);
+	apol_infoflow_graph_destroy(&g);
+}
+
+static void infoflow_batch(void)
+{
+	const char *types[] = { "local_login_t", "httpd_t", "user_home_t" };
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ia);
+	apol_vector_t *start_types = apol_vector_create(NULL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(start_types);
+	int retval;
+	size_t i, expected = 0;
+	retval = apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_dir(p, ia, APOL_INFOFLOW_OUT);
+	CU_ASSERT(retval == 0);
+
+	// a batch finds exactly what one analysis per type finds
+	apol_vector_t *v = NULL;
+	apol_infoflow_graph_t *g = NULL;
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		retval = apol_infoflow_analysis_set_type(p, ia, types[i]);
+		CU_ASSERT(retval == 0);
+		retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+		CU_ASSERT(retval == 0);
+		expected += apol_vector_get_size(v);
+		apol_vector_destroy(&v);
+		apol_infoflow_graph_destroy(&g);
+		apol_vector_append(start_types, (void *)types[i]);
+	}
+	CU_ASSERT(expected > 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(p, 4) == 0);
+	retval = apol_infoflow_analysis_do_batch(p, ia, start_types, &v);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v) == expected);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(p, 1) == 0);
+
+	apol_infoflow_analysis_destroy(&ia);
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&start_types);
+}
+
+static void infoflow_further_run(void)
+{
+	apol_infoflow_analysis_t *ia = apol_infoflow_analysis_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ia);
+	int retval;
+	retval = apol_infoflow_analysis_set_mode(p, ia, APOL_INFOFLOW_MODE_TRANS);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_dir(p, ia, APOL_INFOFLOW_OUT);
+	CU_ASSERT(retval == 0);
+	retval = apol_infoflow_analysis_set_type(p, ia, "local_login_t");
+	CU_ASSERT(retval == 0);
+
+	apol_vector_t *v = NULL, *v1 = NULL, *v4 = NULL;
+	apol_infoflow_graph_t *g = NULL;
+	retval = apol_infoflow_analysis_do(p, ia, &v, &g);
+	CU_ASSERT_FATAL(retval == 0 && apol_vector_get_size(v) > 0);
+	const apol_infoflow_result_t *r = apol_vector_get_element(v, 0);
+	const char *end_name;
+	CU_ASSERT_FATAL(qpol_type_get_name(apol_policy_get_qpol(p), apol_infoflow_result_get_end_type(r), &end_name) == 0);
+	retval = apol_infoflow_analysis_trans_further_prepare(p, g, "local_login_t", end_name);
+	CU_ASSERT_FATAL(retval == 0);
+
+	// the same seed finds the same paths, whatever the thread count
+	retval = apol_infoflow_analysis_trans_further_run(p, g, 42, 32, 0, &v1);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT(apol_vector_get_size(v1) > 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(p, 4) == 0);
+	retval = apol_infoflow_analysis_trans_further_run(p, g, 42, 32, 0, &v4);
+	CU_ASSERT(retval == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(p, 1) == 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(v1) == apol_vector_get_size(v4));
+	size_t i;
+	for (i = 0; i < apol_vector_get_size(v1); i++) {
+		const apol_infoflow_result_t *r1 = apol_vector_get_element(v1, i);
+		const apol_infoflow_result_t *r4 = apol_vector_get_element(v4, i);
+		CU_ASSERT(apol_infoflow_result_get_length(r1) == apol_infoflow_result_get_length(r4));
+		CU_ASSERT(apol_vector_get_size(apol_infoflow_result_get_steps(r1)) ==
+			  apol_vector_get_size(apol_infoflow_result_get_steps(r4)));
+	}
+
+	apol_infoflow_analysis_destroy(&ia);
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&v1);
+	apol_vector_destroy(&v4);
+	apol_infoflow_graph_destroy(&g);
+}
+
 CU_TestInfo infoflow_tests[] = {
 	{"infoflow direct overview", infoflow_direct_overview}
 	,
 	{"infoflow trans overview", infoflow_trans_overview}
 	,
+	{"infoflow graph reuse", infoflow_graph_reuse}
+	,
+	{"infoflow permmap update", infoflow_permmap_update}
+	,
+	{"infoflow batch", infoflow_batch}
+	,
+	{"infoflow further run", infoflow_further_run}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *
+ *  Test the string intern table.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <apol/intern.h>
+#include <stdio.h>
+#include <string.h>
+
+/* enough strings to make the table grow several times */
+#define NUM_MANY 10000
+
+static void intern_basic(void)
+{
+	apol_intern_t *t = apol_intern_create();
+	char buf[16];
+	const char *a, *b, *a2;
+	size_t id_a, id_b, id_a2;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(t);
+	CU_ASSERT(apol_intern_get_size(t) == 0);
+
+	a = apol_intern_str(t, "alpha", &id_a);
+	b = apol_intern_str(t, "beta", &id_b);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(a);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(b);
+	CU_ASSERT(strcmp(a, "alpha") == 0 && strcmp(b, "beta") == 0);
+	CU_ASSERT(a != b && id_a != id_b);
+
+	/* an equal string from another buffer gives back the same copy */
+	strcpy(buf, "alpha");
+	a2 = apol_intern_str(t, buf, &id_a2);
+	CU_ASSERT(a2 == a && id_a2 == id_a);
+	CU_ASSERT(a2 != buf);
+	CU_ASSERT(apol_intern_get_size(t) == 2);
+
+	CU_ASSERT(apol_intern_get(t, "beta", &id_b) == b);
+	CU_ASSERT(apol_intern_get(t, "gamma", NULL) == NULL);
+	CU_ASSERT(apol_intern_get_size(t) == 2);
+	CU_ASSERT(apol_intern_get_by_id(t, id_a) == a && apol_intern_get_by_id(t, id_b) == b);
+	CU_ASSERT(apol_intern_get_by_id(t, 2) == NULL);
+
+	apol_intern_destroy(&t);
+	CU_ASSERT(t == NULL);
+}
+
+static void intern_many(void)
+{
+	apol_intern_t *t = apol_intern_create();
+	apol_vector_t *v = NULL;
+	const char *first, *s;
+	char buf[32];
+	size_t i, id;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(t);
+
+	first = apol_intern_str(t, "s0", NULL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(first);
+	for (i = 0; i < NUM_MANY; i++) {
+		snprintf(buf, sizeof(buf), "s%zu", i);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(apol_intern_str(t, buf, NULL));
+	}
+	CU_ASSERT(apol_intern_get_size(t) == NUM_MANY);
+
+	/* interning every string again adds nothing, and strings do not
+	 * move as the table grows */
+	for (i = 0; i < NUM_MANY; i++) {
+		snprintf(buf, sizeof(buf), "s%zu", i);
+		s = apol_intern_str(t, buf, &id);
+		CU_ASSERT(s != NULL && strcmp(s, buf) == 0 && apol_intern_get_by_id(t, id) == s);
+	}
+	CU_ASSERT(apol_intern_get_size(t) == NUM_MANY);
+	CU_ASSERT(apol_intern_get(t, "s0", NULL) == first);
+
+	v = apol_intern_get_vector(t);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	CU_ASSERT(apol_vector_get_size(v) == NUM_MANY);
+	for (i = 1; i < apol_vector_get_size(v); i++) {
+		CU_ASSERT(strcmp(apol_vector_get_element(v, i - 1), apol_vector_get_element(v, i)) < 0);
+	}
+	apol_vector_destroy(&v);
+	apol_intern_destroy(&t);
+}
+
+CU_TestInfo intern_tests[] = {
+	{"duplicate and distinct strings", intern_basic}
+	,
+	{"many strings", intern_many}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int intern_init()
+{
+	return 0;
+}
+
+int intern_cleanup()
+{
+	return 0;
+}
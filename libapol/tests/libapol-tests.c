@@ -31,11 +31,14 @@
 #include "avrule-tests.h"
 #include "dta-tests.h"
 #include "infoflow-tests.h"
+#include "intern-tests.h"
 #include "policy-21-tests.h"
+#include "regex-tests.h"
 #include "role-tests.h"
 #include "terule-tests.h"
 #include "constrain-tests.h"
 #include "user-tests.h"
+#include "vector-tests.h"
 
 int main(void)
 {
@@ -52,6 +55,9 @@ int main(void)
 		{"TE Rule Query", terule_init, terule_cleanup, terule_tests},
 		{"User Query", user_init, user_cleanup, user_tests},
 		{"Constrain query", constrain_init, constrain_cleanup, constrain_tests},
+		{"Vector", vector_init, vector_cleanup, vector_tests},
+		{"Intern Table", intern_init, intern_cleanup, intern_tests},
+		{"Regular Expression Matching", regex_init, regex_cleanup, regex_tests},
 		CU_SUITE_INFO_NULL
 	};
 
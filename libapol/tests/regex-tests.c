@@ -0,0 +1,99 @@
+/**
+ *  @file
+ *
+ *  Test that regular expressions matched by apol_compare() without
+ *  regexec(), because they are only literal alternatives, match the
+ *  same names as regexec() does.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include "../src/policy-query-internal.h"
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *regex_patterns[] = {
+	/* literals, anchored at either end, both or neither */
+	"foo", "^httpd_", "_exec_t$", "^bin_t$",
+	/* empty bodies */
+	"^$", "$", "^",
+	/* alternatives, including empty ones */
+	"a|b", "a|", "|a", "foo|bar|baz",
+	/* escaped special characters */
+	"a\\$", "\\(x\\)", "a\\|b", "\\.", "\\\\$", "a\\\\\\$",
+	/* groups */
+	"^(a|b)$", "(a)|(b)", "^(a|)$", "^(foo|bar)", "(_t|_exec_t)$",
+	/* fully anchored with enough alternatives for the hash table */
+	"^(bin_t|sbin_t|etc_t|usr_t|var_t|tmp_t|home_t|a|b|)$",
+	/* not literals at all, checked anyway */
+	"a.c", "^[ab]$", "^a|b$", "x*",
+	NULL
+};
+
+static const char *regex_subjects[] = {
+	"", "a", "b", "ab", "ba", "c", "x", "xx", "(x)", "a$", "a|", "a|b", "a\\$", "\\", "a\\", ".", "abc",
+	"foo", "xfoo", "foox", "bar", "baz", "httpd_t", "my_httpd_t", "bin_exec_t", "bin_exec_t2",
+	"bin_t", "sbin_t", "etc_t", "usr_t", "var_t", "tmp_t", "home_t", "home_t_", "_t",
+	NULL
+};
+
+static void regex_literal_match(void)
+{
+	const char **pattern, **subject;
+	regex_t reference, *regex;
+	int expected, got;
+
+	for (pattern = regex_patterns; *pattern != NULL; pattern++) {
+		CU_ASSERT_FATAL(regcomp(&reference, *pattern, REG_EXTENDED | REG_NOSUB) == 0);
+		regex = NULL;
+		for (subject = regex_subjects; *subject != NULL; subject++) {
+			expected = (regexec(&reference, *subject, 0, NULL, 0) == 0);
+			got = apol_compare(NULL, *subject, *pattern, APOL_QUERY_REGEX, &regex);
+			if (got != expected) {
+				fprintf(stderr, "pattern \"%s\" on \"%s\": %d, regexec() gives %d\n", *pattern, *subject, got,
+					expected);
+			}
+			CU_ASSERT(got == expected);
+		}
+		regfree(&reference);
+		if (regex != NULL) {
+			regfree(regex);
+			free(regex);
+		}
+	}
+}
+
+CU_TestInfo regex_tests[] = {
+	{"literal patterns match as regexec() does", regex_literal_match}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int regex_init()
+{
+	return 0;
+}
+
+int regex_cleanup()
+{
+	return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ *  @file
+ *
+ *  Measure the time needed to answer av and type rule queries whose
+ *  source and target are attributes searched indirectly, which is the
+ *  case where candidate type lists are largest.  With no arguments the
+ *  Fedora Core 4 targeted policy snapshot is used.  This program is
+ *  not run by "make check"; build it with "make rule-query-bench".
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <apol/avrule-query.h>
+#include <apol/policy.h>
+#include <apol/policy-path.h>
+#include <apol/terule-query.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define DEFAULT_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+
+/* number of times each query is repeated */
+#define BENCH_ROUNDS 10
+
+struct bench_query
+{
+	const char *source, *target, *obj_class;
+};
+
+static const struct bench_query queries[] = {
+	{"domain", NULL, NULL},
+	{NULL, "file_type", NULL},
+	{"domain", "file_type", NULL},
+	{"domain", "domain", "process"},
+	{"unconfined_t", "file_type", "file"},
+	{NULL, NULL, NULL}
+};
+
+static double bench_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* quiet the library's informational messages */
+static void bench_callback(void *varg __attribute__ ((unused)), const apol_policy_t * p __attribute__ ((unused)),
+			   int level, const char *fmt, va_list va_args)
+{
+	if (level == APOL_MSG_ERR) {
+		vfprintf(stderr, fmt, va_args);
+		fprintf(stderr, "\n");
+	}
+}
+
+static const char *bench_name(const char *symbol)
+{
+	return symbol != NULL ? symbol : "*";
+}
+
+static int bench_avrule(apol_policy_t * p, const struct bench_query *q)
+{
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	apol_vector_t *v = NULL;
+	size_t num_rules = 0;
+	double start, elapsed;
+	int i, retv = -1;
+
+	if (aq == NULL ||
+	    apol_avrule_query_set_source(p, aq, q->source, 1) < 0 ||
+	    apol_avrule_query_set_target(p, aq, q->target, 1) < 0 ||
+	    (q->obj_class != NULL && apol_avrule_query_append_class(p, aq, q->obj_class) < 0)) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		goto cleanup;
+	}
+	start = bench_now();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		if (apol_avrule_get_by_query(p, aq, &v) < 0) {
+			fprintf(stderr, "%s\n", strerror(errno));
+			goto cleanup;
+		}
+		num_rules = apol_vector_get_size(v);
+		apol_vector_destroy(&v);
+	}
+	elapsed = (bench_now() - start) / BENCH_ROUNDS;
+	printf("%-8s %-14s %-14s %-10s %10zu %10.3f ms\n", "avrule", bench_name(q->source), bench_name(q->target),
+	       bench_name(q->obj_class), num_rules, elapsed * 1000.0);
+	retv = 0;
+      cleanup:
+	apol_avrule_query_destroy(&aq);
+	return retv;
+}
+
+static int bench_terule(apol_policy_t * p, const struct bench_query *q)
+{
+	apol_terule_query_t *tq = apol_terule_query_create();
+	apol_vector_t *v = NULL;
+	size_t num_rules = 0;
+	double start, elapsed;
+	int i, retv = -1;
+
+	if (tq == NULL ||
+	    apol_terule_query_set_source(p, tq, q->source, 1) < 0 ||
+	    apol_terule_query_set_target(p, tq, q->target, 1) < 0 ||
+	    (q->obj_class != NULL && apol_terule_query_append_class(p, tq, q->obj_class) < 0)) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		goto cleanup;
+	}
+	start = bench_now();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		if (apol_terule_get_by_query(p, tq, &v) < 0) {
+			fprintf(stderr, "%s\n", strerror(errno));
+			goto cleanup;
+		}
+		num_rules = apol_vector_get_size(v);
+		apol_vector_destroy(&v);
+	}
+	elapsed = (bench_now() - start) / BENCH_ROUNDS;
+	printf("%-8s %-14s %-14s %-10s %10zu %10.3f ms\n", "terule", bench_name(q->source), bench_name(q->target),
+	       bench_name(q->obj_class), num_rules, elapsed * 1000.0);
+	retv = 0;
+      cleanup:
+	apol_terule_query_destroy(&tq);
+	return retv;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = (argc > 1 ? argv[1] : DEFAULT_POLICY);
+	apol_policy_path_t *ppath = NULL;
+	apol_policy_t *p = NULL;
+	int i, retv = 0;
+
+	if ((ppath = apol_policy_path_create(APOL_POLICY_PATH_TYPE_MONOLITHIC, path, NULL)) == NULL) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		return 1;
+	}
+	if ((p = apol_policy_create_from_policy_path(ppath, QPOL_POLICY_OPTION_NO_NEVERALLOWS, bench_callback, NULL)) == NULL) {
+		fprintf(stderr, "%s: could not be opened\n", path);
+		apol_policy_path_destroy(&ppath);
+		return 1;
+	}
+	apol_policy_path_destroy(&ppath);
+
+	printf("%-8s %-14s %-14s %-10s %10s %13s\n", "rules", "source", "target", "class", "matches", "time/query");
+	for (i = 0; queries[i].source != NULL || queries[i].target != NULL; i++) {
+		retv |= bench_avrule(p, queries + i);
+		retv |= bench_terule(p, queries + i);
+	}
+
+	apol_policy_destroy(&p);
+	return retv ? 1 : 0;
+}
@@ -31,6 +31,9 @@
 #include <apol/terule-query.h>
 #include <qpol/policy_extend.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define BIN_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.21"
 #define SOURCE_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.conf"
@@ -85,9 +88,169 @@ static void terule_basic_syn(void)
 	apol_terule_query_destroy(&tq);
 }
 
+static void terule_compare_threaded(apol_terule_query_t * tq)
+{
+	apol_vector_t *serial = NULL, *threaded = NULL;
+	size_t i;
+
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+	CU_ASSERT_FATAL(apol_terule_get_by_query(bp, tq, &serial) == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 4) == 0);
+	CU_ASSERT_FATAL(apol_terule_get_by_query(bp, tq, &threaded) == 0);
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+
+	CU_ASSERT(apol_vector_get_size(serial) > 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(serial) == apol_vector_get_size(threaded));
+	for (i = 0; i < apol_vector_get_size(serial); i++) {
+		CU_ASSERT(apol_vector_get_element(serial, i) == apol_vector_get_element(threaded, i));
+	}
+	apol_vector_destroy(&serial);
+	apol_vector_destroy(&threaded);
+}
+
+static void terule_threaded(void)
+{
+	apol_terule_query_t *tq = apol_terule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tq);
+
+	/* whole rule table */
+	terule_compare_threaded(tq);
+
+	/* rules looked up by source */
+	CU_ASSERT_FATAL(apol_terule_query_set_regex(bp, tq, 1) == 0);
+	CU_ASSERT_FATAL(apol_terule_query_set_source(bp, tq, ".*", 1) == 0);
+	terule_compare_threaded(tq);
+
+	apol_terule_query_destroy(&tq);
+}
+
+/* rules looked up by source must keep the order of a whole table scan */
+static void terule_check_table_order(const apol_vector_t * v)
+{
+	apol_terule_query_t *tq = apol_terule_query_create();
+	apol_vector_t *all = NULL;
+	size_t i, j;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tq);
+
+	CU_ASSERT_FATAL(apol_terule_get_by_query(bp, tq, &all) == 0);
+	for (i = 0, j = 0; i < apol_vector_get_size(all) && j < apol_vector_get_size(v); i++) {
+		if (apol_vector_get_element(all, i) == apol_vector_get_element(v, j)) {
+			j++;
+		}
+	}
+	CU_ASSERT(j == apol_vector_get_size(v));
+	apol_vector_destroy(&all);
+	apol_terule_query_destroy(&tq);
+}
+
+static void terule_batch(void)
+{
+	apol_terule_query_t *tq[3];
+	apol_vector_t *queries = apol_vector_create(NULL), *results = NULL, *v = NULL, *rv;
+	size_t i, j, threads;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries);
+
+	for (i = 0; i < 3; i++) {
+		tq[i] = apol_terule_query_create();
+		CU_ASSERT_PTR_NOT_NULL_FATAL(tq[i]);
+		CU_ASSERT_FATAL(apol_vector_append(queries, tq[i]) == 0);
+	}
+	CU_ASSERT_FATAL(apol_terule_query_set_regex(bp, tq[1], 1) == 0);
+	CU_ASSERT_FATAL(apol_terule_query_set_source(bp, tq[1], ".*", 1) == 0);
+	CU_ASSERT_FATAL(apol_terule_query_set_rules(bp, tq[2], QPOL_RULE_TYPE_TRANS) == 0);
+
+	/* each result must be exactly what the query gives on its own */
+	for (threads = 1; threads <= 4; threads += 3) {
+		CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, threads) == 0);
+		CU_ASSERT_FATAL(apol_terule_get_by_queries(bp, queries, &results) == 0);
+		CU_ASSERT_FATAL(apol_vector_get_size(results) == 3);
+		for (i = 0; i < 3; i++) {
+			rv = apol_vector_get_element(results, i);
+			CU_ASSERT_FATAL(apol_terule_get_by_query(bp, tq[i], &v) == 0);
+			CU_ASSERT_FATAL(apol_vector_get_size(v) == apol_vector_get_size(rv));
+			for (j = 0; j < apol_vector_get_size(v); j++) {
+				CU_ASSERT(apol_vector_get_element(v, j) == apol_vector_get_element(rv, j));
+			}
+			terule_check_table_order(v);
+			apol_vector_destroy(&v);
+		}
+		apol_vector_destroy(&results);
+	}
+	CU_ASSERT_FATAL(apol_policy_set_query_threads(bp, 1) == 0);
+
+	for (i = 0; i < 3; i++) {
+		apol_terule_query_destroy(&tq[i]);
+	}
+	apol_vector_destroy(&queries);
+}
+
+/* The rule just written to f must be exactly s; frees s. */
+static void terule_check_render_file(FILE * f, char *s)
+{
+	size_t len;
+	long pos;
+	char *buf;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(s);
+	len = strlen(s);
+	pos = ftell(f);
+	CU_ASSERT_FATAL(pos >= 0 && (size_t)pos == len);
+	buf = malloc(len + 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+	rewind(f);
+	CU_ASSERT_FATAL(fread(buf, 1, len, f) == len);
+	CU_ASSERT(memcmp(buf, s, len) == 0);
+	free(buf);
+	free(s);
+	rewind(f);
+}
+
+static void terule_render_file(void)
+{
+	apol_policy_t *policies[] = { bp, sp };
+	FILE *f = tmpfile();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(f);
+	apol_terule_query_t *aq = apol_terule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	int retval;
+	apol_vector_t *v = NULL;
+	size_t i, j;
+	for (i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+		retval = apol_terule_get_by_query(policies[i], aq, &v);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		CU_ASSERT(apol_vector_get_size(v) > 0);
+		for (j = 0; j < apol_vector_get_size(v); j++) {
+			const qpol_terule_t *rule = (const qpol_terule_t *)apol_vector_get_element(v, j);
+			retval = apol_terule_render_file(policies[i], rule, f);
+			CU_ASSERT_EQUAL_FATAL(retval, 0);
+			terule_check_render_file(f, apol_terule_render(policies[i], rule));
+		}
+		apol_vector_destroy(&v);
+	}
+
+	retval = apol_syn_terule_get_by_query(sp, aq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT(apol_vector_get_size(v) > 0);
+	for (j = 0; j < apol_vector_get_size(v); j++) {
+		const qpol_syn_terule_t *syn = (const qpol_syn_terule_t *)apol_vector_get_element(v, j);
+		retval = apol_syn_terule_render_file(sp, syn, f);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		terule_check_render_file(f, apol_syn_terule_render(sp, syn));
+	}
+	apol_vector_destroy(&v);
+	apol_terule_query_destroy(&aq);
+	fclose(f);
+}
+
 CU_TestInfo terule_tests[] = {
 	{"basic syntactic search", terule_basic_syn}
 	,
+	{"threaded query", terule_threaded}
+	,
+	{"batch query", terule_batch}
+	,
+	{"render to file", terule_render_file}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -0,0 +1,137 @@
+/**
+ *  @file
+ *
+ *  Measure the time needed to sort vectors of 10^6 elements that are
+ *  already sorted, reversed or in random order, using each of the
+ *  vector sorting functions.  This program is not run by "make
+ *  check"; build it with "make vector-sort-bench".
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <apol/vector.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define BENCH_SIZE 1000000
+
+/* threads used by the parallel sort */
+#define BENCH_THREADS 4
+
+enum bench_order
+{
+	BENCH_SORTED, BENCH_REVERSED, BENCH_RANDOM
+};
+
+static const char *order_names[] = { "sorted", "reversed", "random" };
+
+static double bench_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int bench_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	uintptr_t x = (uintptr_t) a, y = (uintptr_t) b;
+	return (x < y ? -1 : x > y);
+}
+
+static apol_vector_t *bench_vector(enum bench_order order)
+{
+	apol_vector_t *v = apol_vector_create_with_capacity(BENCH_SIZE, NULL);
+	size_t i;
+
+	if (v == NULL)
+		return NULL;
+	srand(BENCH_SIZE);
+	for (i = 0; i < BENCH_SIZE; i++) {
+		uintptr_t elem;
+		if (order == BENCH_SORTED)
+			elem = i + 1;
+		else if (order == BENCH_REVERSED)
+			elem = BENCH_SIZE - i;
+		else
+			elem = (uintptr_t) rand() + 1;
+		if (apol_vector_append(v, (void *)elem) < 0) {
+			apol_vector_destroy(&v);
+			return NULL;
+		}
+	}
+	return v;
+}
+
+static int bench_check(const apol_vector_t * v)
+{
+	size_t i;
+
+	for (i = 1; i < apol_vector_get_size(v); i++) {
+		if (bench_comp(apol_vector_get_element(v, i - 1), apol_vector_get_element(v, i), NULL) > 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int bench_sort(enum bench_order order, const char *name, int which)
+{
+	apol_vector_t *v = bench_vector(order);
+	double start, elapsed;
+	int retv = 0;
+
+	if (v == NULL) {
+		fprintf(stderr, "%s\n", strerror(errno));
+		return -1;
+	}
+	start = bench_now();
+	if (which == 0)
+		apol_vector_sort(v, bench_comp, NULL);
+	else if (which == 1)
+		retv = apol_vector_sort_stable(v, bench_comp, NULL);
+	else
+		retv = apol_vector_sort_parallel(v, bench_comp, NULL, BENCH_THREADS);
+	elapsed = bench_now() - start;
+	if (retv < 0 || bench_check(v) < 0) {
+		fprintf(stderr, "%s of %s input failed\n", name, order_names[order]);
+		retv = -1;
+	} else {
+		printf("%-10s %-10s %10.3f ms\n", order_names[order], name, elapsed * 1000.0);
+	}
+	apol_vector_destroy(&v);
+	return retv;
+}
+
+int main(void)
+{
+	int order, retv = 0;
+
+	printf("%-10s %-10s %13s\n", "input", "sort", "time");
+	for (order = BENCH_SORTED; order <= BENCH_RANDOM; order++) {
+		retv |= bench_sort(order, "introsort", 0);
+		retv |= bench_sort(order, "stable", 1);
+		retv |= bench_sort(order, "parallel", 2);
+	}
+	return retv ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+/**
+ *  @file
+ *
+ *  Test the vector sorting functions.
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <apol/vector.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* sizes around the cut-offs of the insertion sort and of the parallel
+ * sort, which gives each thread at least 65536 elements */
+static const size_t sort_sizes[] = { 0, 1, 2, 16, 17, 1000, 65536, 131072, 131073, 300001 };
+static const size_t sort_threads[] = { 1, 2, 3, 4, 8 };
+
+#define NUM_SORT_SIZES (sizeof(sort_sizes) / sizeof(sort_sizes[0]))
+#define NUM_SORT_THREADS (sizeof(sort_threads) / sizeof(sort_threads[0]))
+
+/* an element whose key repeats often; seq records the original order */
+typedef struct sort_elem
+{
+	size_t key;
+	size_t seq;
+} sort_elem_t;
+
+static int sort_elem_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	const sort_elem_t *x = a, *y = b;
+	if (x->key != y->key) {
+		return (x->key < y->key ? -1 : 1);
+	}
+	return 0;
+}
+
+/* fill a vector with num elements in a fixed pseudo-random order */
+static apol_vector_t *sort_elem_vector_create(sort_elem_t * elems, size_t num)
+{
+	apol_vector_t *v = apol_vector_create_with_capacity(num ? num : 1, NULL);
+	uint32_t x = 12345;
+	size_t i;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	for (i = 0; i < num; i++) {
+		x = x * 1103515245 + 12345;
+		elems[i].key = (x >> 16) % 97;
+		elems[i].seq = i;
+		CU_ASSERT_FATAL(apol_vector_append(v, elems + i) == 0);
+	}
+	return v;
+}
+
+/* sizes around the cut-off of the insertion sort within the unstable
+ * sort, which is 16 elements */
+static const size_t unstable_sizes[] = { 0, 1, 2, 3, 15, 16, 17, 18, 31, 32, 33, 1000, 10007 };
+
+#define NUM_UNSTABLE_SIZES (sizeof(unstable_sizes) / sizeof(unstable_sizes[0]))
+
+enum unstable_order
+{
+	UNSTABLE_SORTED = 0, UNSTABLE_REVERSED, UNSTABLE_EQUAL, UNSTABLE_RANDOM, UNSTABLE_NUM_ORDERS
+};
+
+static int unstable_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	uintptr_t x = (uintptr_t) a, y = (uintptr_t) b;
+	if (x != y) {
+		return (x < y ? -1 : 1);
+	}
+	return 0;
+}
+
+/* fill a vector with num integers, 1 through num, in the given order;
+ * counts[k] is set to the number of times k was added */
+static apol_vector_t *unstable_vector_create(enum unstable_order order, size_t num, size_t * counts)
+{
+	apol_vector_t *v = apol_vector_create_with_capacity(num ? num : 1, NULL);
+	uint32_t x = 54321;
+	size_t i, key;
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	for (i = 0; i < num; i++) {
+		switch (order) {
+		case UNSTABLE_SORTED:
+			key = i + 1;
+			break;
+		case UNSTABLE_REVERSED:
+			key = num - i;
+			break;
+		case UNSTABLE_EQUAL:
+			key = 1;
+			break;
+		default:
+			/* about half the keys are duplicates */
+			x = x * 1103515245 + 12345;
+			key = (x >> 16) % (num / 2 + 1) + 1;
+			break;
+		}
+		counts[key]++;
+		CU_ASSERT_FATAL(apol_vector_append(v, (void *)key) == 0);
+	}
+	return v;
+}
+
+static void vector_sort_unstable(void)
+{
+	apol_vector_t *v;
+	size_t *counts, *found, s, i, key, prev;
+	int order, by_cmp;
+
+	for (s = 0; s < NUM_UNSTABLE_SIZES; s++) {
+		counts = calloc(unstable_sizes[s] + 1, sizeof(*counts));
+		found = calloc(unstable_sizes[s] + 1, sizeof(*found));
+		CU_ASSERT_PTR_NOT_NULL_FATAL(counts);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(found);
+		for (order = 0; order < UNSTABLE_NUM_ORDERS; order++) {
+			/* sort both by the integer comparison used when no
+			 * callback is given and by a callback */
+			for (by_cmp = 0; by_cmp < 2; by_cmp++) {
+				memset(counts, 0, (unstable_sizes[s] + 1) * sizeof(*counts));
+				memset(found, 0, (unstable_sizes[s] + 1) * sizeof(*found));
+				v = unstable_vector_create(order, unstable_sizes[s], counts);
+				apol_vector_sort(v, by_cmp ? unstable_comp : NULL, NULL);
+				CU_ASSERT_FATAL(apol_vector_get_size(v) == unstable_sizes[s]);
+				/* nondecreasing, and a permutation of the input */
+				for (i = 0, prev = 0; i < apol_vector_get_size(v); i++) {
+					key = (size_t) apol_vector_get_element(v, i);
+					CU_ASSERT_FATAL(key >= 1 && key <= unstable_sizes[s]);
+					CU_ASSERT(prev <= key);
+					found[key]++;
+					prev = key;
+				}
+				CU_ASSERT(memcmp(counts, found, (unstable_sizes[s] + 1) * sizeof(*counts)) == 0);
+				apol_vector_destroy(&v);
+			}
+		}
+		free(counts);
+		free(found);
+	}
+}
+
+static void vector_sort_uniquify(void)
+{
+	apol_vector_t *v;
+	size_t *counts, s, i, key, prev, num_unique;
+	int order, by_cmp;
+
+	for (s = 0; s < NUM_UNSTABLE_SIZES; s++) {
+		counts = calloc(unstable_sizes[s] + 1, sizeof(*counts));
+		CU_ASSERT_PTR_NOT_NULL_FATAL(counts);
+		for (order = 0; order < UNSTABLE_NUM_ORDERS; order++) {
+			for (by_cmp = 0; by_cmp < 2; by_cmp++) {
+				memset(counts, 0, (unstable_sizes[s] + 1) * sizeof(*counts));
+				v = unstable_vector_create(order, unstable_sizes[s], counts);
+				apol_vector_sort_uniquify(v, by_cmp ? unstable_comp : NULL, NULL);
+				for (i = 1, num_unique = 0; i <= unstable_sizes[s]; i++) {
+					if (counts[i] > 0) {
+						num_unique++;
+					}
+				}
+				/* strictly increasing, with each input key once */
+				CU_ASSERT(apol_vector_get_size(v) == num_unique);
+				for (i = 0, prev = 0; i < apol_vector_get_size(v); i++) {
+					key = (size_t) apol_vector_get_element(v, i);
+					CU_ASSERT_FATAL(key >= 1 && key <= unstable_sizes[s]);
+					CU_ASSERT(prev < key);
+					CU_ASSERT(counts[key] > 0);
+					prev = key;
+				}
+				apol_vector_destroy(&v);
+			}
+		}
+		free(counts);
+	}
+}
+
+static void vector_sort_stable(void)
+{
+	sort_elem_t *elems = NULL;
+	const sort_elem_t *prev, *cur;
+	apol_vector_t *v;
+	size_t s, i;
+
+	for (s = 0; s < NUM_SORT_SIZES; s++) {
+		elems = malloc((sort_sizes[s] ? sort_sizes[s] : 1) * sizeof(*elems));
+		CU_ASSERT_PTR_NOT_NULL_FATAL(elems);
+		v = sort_elem_vector_create(elems, sort_sizes[s]);
+		CU_ASSERT_FATAL(apol_vector_sort_stable(v, sort_elem_comp, NULL) == 0);
+		CU_ASSERT(apol_vector_get_size(v) == sort_sizes[s]);
+		/* equal keys keep their original order */
+		for (i = 1; i < apol_vector_get_size(v); i++) {
+			prev = apol_vector_get_element(v, i - 1);
+			cur = apol_vector_get_element(v, i);
+			CU_ASSERT(prev->key < cur->key || (prev->key == cur->key && prev->seq < cur->seq));
+		}
+		apol_vector_destroy(&v);
+		free(elems);
+	}
+}
+
+/* apol_vector_sort_parallel() uses no more threads than there are
+ * online processors, so on a machine with only one every case below
+ * falls back to apol_vector_sort_stable(); the merging of runs sorted
+ * by separate threads is tested only where there are several */
+static void vector_sort_parallel(void)
+{
+	sort_elem_t *elems = NULL;
+	apol_vector_t *serial, *parallel;
+	size_t s, t, i;
+
+	for (s = 0; s < NUM_SORT_SIZES; s++) {
+		elems = malloc((sort_sizes[s] ? sort_sizes[s] : 1) * sizeof(*elems));
+		CU_ASSERT_PTR_NOT_NULL_FATAL(elems);
+		serial = sort_elem_vector_create(elems, sort_sizes[s]);
+		CU_ASSERT_FATAL(apol_vector_sort_stable(serial, sort_elem_comp, NULL) == 0);
+		for (t = 0; t < NUM_SORT_THREADS; t++) {
+			parallel = sort_elem_vector_create(elems, sort_sizes[s]);
+			CU_ASSERT_FATAL(apol_vector_sort_parallel(parallel, sort_elem_comp, NULL, sort_threads[t]) == 0);
+			CU_ASSERT_FATAL(apol_vector_get_size(parallel) == sort_sizes[s]);
+			for (i = 0; i < sort_sizes[s]; i++) {
+				if (apol_vector_get_element(parallel, i) != apol_vector_get_element(serial, i)) {
+					break;
+				}
+			}
+			CU_ASSERT(i == sort_sizes[s]);
+			apol_vector_destroy(&parallel);
+		}
+		apol_vector_destroy(&serial);
+		free(elems);
+	}
+}
+
+CU_TestInfo vector_tests[] = {
+	{"unstable sort", vector_sort_unstable}
+	,
+	{"sort and uniquify", vector_sort_uniquify}
+	,
+	{"stable sort", vector_sort_stable}
+	,
+	{"parallel sort", vector_sort_parallel}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int vector_init()
+{
+	return 0;
+}
+
+int vector_cleanup()
+{
+	return 0;
+}
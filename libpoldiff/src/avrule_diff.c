@@ -52,14 +52,14 @@ struct poldiff_avrule
 	uint32_t spec;
 	/* pointer into policy's symbol table */
 	const char *source, *target;
-	/** the class string is pointer into the class_bst BST */
+	/** the class string is pointer into the class_pool */
 	char *cls;
 	poldiff_form_e form;
-	/** vector of pointers into the perm_bst BST (char *) */
+	/** vector of pointers into the perm_pool (char *) */
 	apol_vector_t *unmodified_perms;
-	/** vector of pointers into the perm_bst BST (char *) */
+	/** vector of pointers into the perm_pool (char *) */
 	apol_vector_t *added_perms;
-	/** vector of pointers into the perm_bst BST (char *) */
+	/** vector of pointers into the perm_pool (char *) */
 	apol_vector_t *removed_perms;
 	/** pointer into policy's conditional list, needed to render
 	 * conditional expressions */
@@ -82,13 +82,13 @@ typedef struct pseudo_avrule
 	uint32_t spec;
 	/** pseudo-type values */
 	uint32_t source, target;
-	/** pointer into the class_bst BST */
+	/** pointer into the class_pool */
 	char *cls;
-	/** array of pointers into the perm_bst BST */
+	/** array of pointers into the perm_pool */
 	/* (use an array here to save space) */
 	char **perms;
 	size_t num_perms;
-	/** array of pointers into the bool_bst BST */
+	/** array of pointers into the bool_pool */
 	char *bools[5];
 	uint32_t bool_val;
 	uint32_t branch;
@@ -751,7 +751,7 @@ static int avrule_build_cond(poldiff_t * diff, const apol_policy_t * p, const qp
 			error = errno;
 			goto cleanup;
 		}
-		if (apol_bst_get_element(diff->bool_bst, (void *)bool_name, NULL, (void **)&pseudo_bool) < 0) {
+		if ((pseudo_bool = (char *)apol_intern_get(diff->bool_pool, bool_name, NULL)) == NULL) {
 			error = EBADRQC;	/* should never get here */
 			ERR(diff, "%s", strerror(error));
 			assert(0);
@@ -868,7 +868,7 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 		error = errno;
 		goto cleanup;
 	}
-	if (apol_bst_get_element(diff->class_bst, (void *)class_name, NULL, (void **)&key->cls) < 0) {
+	if ((key->cls = (char *)apol_intern_get(diff->class_pool, class_name, NULL)) == NULL) {
 		error = EBADRQC;       /* should never get here */
 		ERR(diff, "%s", strerror(error));
 		assert(0);
@@ -906,7 +906,7 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 			error = errno;
 			goto cleanup;
 		}
-		if (apol_bst_get_element(diff->perm_bst, perm_name, NULL, (void **)&pseudo_perm) < 0) {
+		if ((pseudo_perm = (char *)apol_intern_get(diff->perm_pool, perm_name, NULL)) == NULL) {
 			error = EBADRQC;	/* should never get here */
 			ERR(diff, "%s", strerror(error));
 			assert(0);
@@ -1073,7 +1073,7 @@ static apol_vector_t *avrule_get_items(poldiff_t * diff, const apol_policy_t * p
 		return v;
 	}
 
-	if (poldiff_build_bsts(diff) < 0) {
+	if (poldiff_build_pools(diff) < 0) {
 		error = errno;
 		goto cleanup;
 	}
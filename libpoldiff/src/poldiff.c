@@ -385,9 +385,9 @@ void poldiff_destroy(poldiff_t ** diff)
 		return;
 	apol_policy_destroy(&(*diff)->orig_pol);
 	apol_policy_destroy(&(*diff)->mod_pol);
-	apol_bst_destroy(&(*diff)->class_bst);
-	apol_bst_destroy(&(*diff)->perm_bst);
-	apol_bst_destroy(&(*diff)->bool_bst);
+	apol_intern_destroy(&(*diff)->class_pool);
+	apol_intern_destroy(&(*diff)->perm_pool);
+	apol_intern_destroy(&(*diff)->bool_pool);
 
 	type_map_destroy(&(*diff)->type_map);
 	attrib_summary_destroy(&(*diff)->attrib_diffs);
@@ -654,7 +654,7 @@ int poldiff_enable_line_numbers(poldiff_t * diff)
 	return 0;
 }
 
-int poldiff_build_bsts(poldiff_t * diff)
+int poldiff_build_pools(poldiff_t * diff)
 {
 	apol_vector_t *classes[2] = { NULL, NULL };
 	apol_vector_t *perms[2] = { NULL, NULL };
@@ -663,14 +663,12 @@ int poldiff_build_bsts(poldiff_t * diff)
 	const qpol_class_t *cls;
 	qpol_bool_t *qbool;
 	const char *name;
-	char *new_name;
 	int retval = -1, error = 0;
-	if (diff->class_bst != NULL) {
+	if (diff->class_pool != NULL) {
 		return 0;
 	}
-	if ((diff->class_bst = apol_bst_create(apol_str_strcmp, free)) == NULL ||
-	    (diff->perm_bst = apol_bst_create(apol_str_strcmp, free)) == NULL ||
-	    (diff->bool_bst = apol_bst_create(apol_str_strcmp, free)) == NULL) {
+	if ((diff->class_pool = apol_intern_create()) == NULL ||
+	    (diff->perm_pool = apol_intern_create()) == NULL || (diff->bool_pool = apol_intern_create()) == NULL) {
 		error = errno;
 		ERR(diff, "%s", strerror(error));
 		goto cleanup;
@@ -689,8 +687,7 @@ int poldiff_build_bsts(poldiff_t * diff)
 				error = errno;
 				goto cleanup;
 			}
-			if ((new_name = strdup(name)) == NULL ||
-			    apol_bst_insert_and_get(diff->class_bst, (void **)&new_name, NULL) < 0) {
+			if (apol_intern_str(diff->class_pool, name, NULL) == NULL) {
 				error = errno;
 				ERR(diff, "%s", strerror(error));
 				goto cleanup;
@@ -698,8 +695,7 @@ int poldiff_build_bsts(poldiff_t * diff)
 		}
 		for (j = 0; j < apol_vector_get_size(perms[i]); j++) {
 			name = (char *)apol_vector_get_element(perms[i], j);
-			if ((new_name = strdup(name)) == NULL ||
-			    apol_bst_insert_and_get(diff->perm_bst, (void **)&new_name, NULL) < 0) {
+			if (apol_intern_str(diff->perm_pool, name, NULL) == NULL) {
 				error = errno;
 				ERR(diff, "%s", strerror(error));
 				goto cleanup;
@@ -711,8 +707,7 @@ int poldiff_build_bsts(poldiff_t * diff)
 				error = errno;
 				goto cleanup;
 			}
-			if ((new_name = strdup(name)) == NULL ||
-			    apol_bst_insert_and_get(diff->bool_bst, (void **)&new_name, NULL) < 0) {
+			if (apol_intern_str(diff->bool_pool, name, NULL) == NULL) {
 				error = errno;
 				ERR(diff, "%s", strerror(error));
 				goto cleanup;
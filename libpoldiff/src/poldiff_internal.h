@@ -32,6 +32,7 @@ extern "C"
 
 #include <poldiff/poldiff.h>
 #include <apol/bst.h>
+#include <apol/intern.h>
 
 	typedef enum
 	{
@@ -92,12 +93,12 @@ extern "C"
 		qpol_policy_t *mod_qpol;
 		/** non-zero if rules' line numbers are accurate */
 		int line_numbers_enabled;
-		/** BST of duplicated strings, used when making pseudo-rules */
-		apol_bst_t *class_bst;
-		/** BST of duplicated strings, used when making pseudo-rules */
-		apol_bst_t *perm_bst;
-		/** BST of duplicated strings, used when making pseudo-rules */
-		apol_bst_t *bool_bst;
+		/** pool of class names, used when making pseudo-rules */
+		apol_intern_t *class_pool;
+		/** pool of permission names, used when making pseudo-rules */
+		apol_intern_t *perm_pool;
+		/** pool of boolean names, used when making pseudo-rules */
+		apol_intern_t *bool_pool;
 		poldiff_handle_fn_t fn;
 		void *handle_arg;
 		/** set of POLDIF_DIFF_* bits for diffs run */
@@ -222,15 +223,15 @@ extern "C"
 #define INFO(handle, format, ...) poldiff_handle_msg(handle, POLDIFF_MSG_INFO, format, __VA_ARGS__)
 
 /**
- * Build the BST for classes, permissions, and booleans if the
- * policies have changed.  This effectively provides a partial mapping
+ * Build the string pools for classes, permissions, and booleans if
+ * the policies have changed.  This effectively provides a partial mapping
  * of rules from one policy to the other.
  *
  * @param diff Policy difference structure containing policies to diff.
  *
  * @return 0 on success, < 0 on error.
  */
-	int poldiff_build_bsts(poldiff_t * diff);
+	int poldiff_build_pools(poldiff_t * diff);
 
 #ifdef	__cplusplus
 }
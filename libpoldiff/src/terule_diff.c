@@ -52,7 +52,7 @@ struct poldiff_terule
 	uint32_t spec;
 	/* pointer into policy's symbol table */
 	const char *source, *target;
-	/** the class string is pointer into the class_bst BST */
+	/** the class string is pointer into the class_pool */
 	const char *cls;
 	poldiff_form_e form;
 	/* pointer into policy's symbol table */
@@ -78,9 +78,9 @@ typedef struct pseudo_terule
 	uint32_t spec;
 	/** pseudo-type values */
 	uint32_t source, target, default_type;
-	/** pointer into the class_bst BST */
+	/** pointer into the class_pool */
 	const char *cls;
-	/** array of pointers into the bool_bst BST */
+	/** array of pointers into the bool_pool */
 	const char *bools[5];
 	uint32_t bool_val;
 	uint32_t branch;
@@ -641,7 +641,7 @@ static int terule_build_cond(const poldiff_t * diff, const apol_policy_t * p, co
 			error = errno;
 			goto cleanup;
 		}
-		if (apol_bst_get_element(diff->bool_bst, (void *)bool_name, NULL, (void **)&pseudo_bool) < 0) {
+		if ((pseudo_bool = apol_intern_get(diff->bool_pool, bool_name, NULL)) == NULL) {
 			error = EBADRQC;	/* should never get here */
 			ERR(diff, "%s", strerror(error));
 			assert(0);
@@ -729,7 +729,7 @@ static int terule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 		error = errno;
 		goto cleanup;
 	}
-	if (apol_bst_get_element(diff->class_bst, (void *)class_name, NULL, (void **)&key->cls) < 0) {
+	if ((key->cls = apol_intern_get(diff->class_pool, class_name, NULL)) == NULL) {
 		error = EBADRQC;       /* should never get here */
 		ERR(diff, "%s", strerror(error));
 		assert(0);
@@ -877,7 +877,7 @@ static apol_vector_t *terule_get_items(poldiff_t * diff, const apol_policy_t * p
 	qpol_terule_t *rule;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
 	int retval = -1, error = 0;
-	if (poldiff_build_bsts(diff) < 0) {
+	if (poldiff_build_pools(diff) < 0) {
 		error = errno;
 		goto cleanup;
 	}
@@ -63,6 +63,108 @@ extern "C"
  */
 	extern int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter);
 
+/**
+ *  Get an iterator over one part of the av rules returned by
+ *  qpol_policy_get_avrule_iter().  The rule tables are split into
+ *  num_parts nearly equal ranges of hash buckets.  Iterating over
+ *  parts 0 through num_parts - 1 in order returns the same rules, in
+ *  the same order, as the single iterator would; different parts may
+ *  be iterated by different threads at the same time.
+ *  @param policy Policy from which to get the av rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param part Part to iterate over, from 0 to num_parts - 1.
+ *  @param num_parts Number of parts into which the rules are split.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part,
+						    size_t num_parts, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask whose source is the given type.  Rules come from
+ *  both the unconditional and conditional tables.  Only rules that
+ *  name the type itself are returned; rules naming an attribute
+ *  containing the type are not.  Unlike qpol_policy_get_avrule_iter()
+ *  this does not scan every rule; an index is built on the first
+ *  call and kept until the policy is rebuilt.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param source Source type (or attribute) of the rules.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						      const qpol_type_t * source, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask whose target is the given type.  See
+ *  qpol_policy_get_avrule_iter_by_source() for details.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param target Target type (or attribute) of the rules.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						      const qpol_type_t * target, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask that apply to the given type: those whose source or
+ *  target is the type or one of its attributes.  Each rule is returned
+ *  once.  If an attribute is given, only rules naming the attribute
+ *  itself are returned.  Rules come from both the unconditional and
+ *  conditional tables, and are found through the index built when the
+ *  policy is loaded rather than by scanning every rule.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param type Type (or attribute) to which the rules apply.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_type(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						    const qpol_type_t * type, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask with exactly the given source, target and object
+ *  class, from both the unconditional and conditional tables.  The
+ *  rules are found by hash lookup.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param source Source type (or attribute) of the rules.
+ *  @param target Target type (or attribute) of the rules.
+ *  @param obj_class Object class of the rules.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_key(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						   const qpol_type_t * source, const qpol_type_t * target,
+						   const qpol_class_t * obj_class, qpol_iterator_t ** iter);
+
 /**
  *  Get the source type from an av rule.
  *  @param policy Policy from which the rule comes.
@@ -114,6 +216,23 @@ extern "C"
  */
 	extern int qpol_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_avrule_t * rule, qpol_iterator_t ** perms);
 
+/**
+ *  Get the permissions of an av rule as a bit mask, without allocating
+ *  anything.  Bit n of the mask is set if the permission whose value
+ *  is n + 1 within the rule's object class is granted (or, for
+ *  dontaudit rules, not audited).  Use qpol_class_get_perm_mask() to
+ *  build a mask from permission names to compare against.
+ *  @param policy Policy from which the rule comes.
+ *  @param rule The rule from which to get the permissions.
+ *  @param obj_class_val If non-NULL, reference in which to store the
+ *  value of the rule's object class.
+ *  @param perm_mask Reference in which to store the permission mask.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *perm_mask will be 0.
+ */
+	extern int qpol_avrule_get_perm_mask(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * obj_class_val,
+					     uint32_t * perm_mask);
+
 /**
  *  Get the rule type value for an av rule.
  *  @param policy Policy from which the rule comes.
@@ -160,6 +279,22 @@ extern "C"
  */
 	extern int qpol_avrule_get_which_list(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * which_list);
 
+/**
+ *  Get the position of a rule in the order in which
+ *  qpol_policy_get_avrule_iter() returns the rules of a policy.  The
+ *  rule lookups by source, target and type each return their rules
+ *  in this order for a single type, so callers combining the lookups
+ *  of several types can sort by position to restore the full
+ *  iteration order.  Uses the index built by
+ *  qpol_policy_get_avrule_iter_by_source().
+ *  @param policy Policy from which the rule comes.
+ *  @param rule The rule whose position to get.
+ *  @param pos Pointer in which to store the position.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *pos will be 0.
+ */
+	extern int qpol_avrule_get_position(const qpol_policy_t * policy, const qpol_avrule_t * rule, size_t * pos);
+
 #ifdef	__cplusplus
 }
 #endif
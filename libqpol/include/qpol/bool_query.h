@@ -109,6 +109,31 @@ extern "C"
  */
 	extern int qpol_bool_set_state_no_eval(qpol_policy_t * policy, qpol_bool_t * datum, int state);
 
+/**
+ *  Set the state of a boolean and update the state of only the
+ *  conditionals using the boolean, reporting which rules were enabled
+ *  or disabled as a result.  Unlike qpol_bool_set_state(), changes
+ *  made to other booleans by qpol_bool_set_state_no_eval() are only
+ *  applied where they share a conditional with this boolean.
+ *  @param policy The policy with which the boolean is associated.
+ *  The state of the policy is changed by this function.
+ *  @param datum Boolean datum for which to set the state. Must be non-NULL.
+ *  @param state Value to which to set the state of the boolean.
+ *  @param avrules If non-NULL, iterator of type qpol_avrule_t returned
+ *  over the av rules whose enabled state changed.  The caller is
+ *  responsible for calling qpol_iterator_destroy() to free memory used.
+ *  Use qpol_avrule_get_is_enabled() for the new state of each rule.
+ *  @param terules If non-NULL, iterator of type qpol_terule_t returned
+ *  over the te rules whose enabled state changed.  The caller is
+ *  responsible for calling qpol_iterator_destroy() to free memory used.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *avrules and *terules will be NULL.  On
+ *  failure the boolean, its conditionals and their rules are left as
+ *  they were before the call.
+ */
+	extern int qpol_bool_set_state_incremental(qpol_policy_t * policy, qpol_bool_t * datum, int state,
+						   qpol_iterator_t ** avrules, qpol_iterator_t ** terules);
+
 /**
  *  Get the name which identifies a boolean from its datum.
  *  @param policy The policy with which the boolean is associated.
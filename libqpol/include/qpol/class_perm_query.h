@@ -132,6 +132,23 @@ extern "C"
  */
 	extern int qpol_class_get_perm_iter(const qpol_policy_t * policy, const qpol_class_t * obj_class, qpol_iterator_t ** perms);
 
+/**
+ *  Compile a set of permission names into a bit mask for a class, in
+ *  the form returned by qpol_avrule_get_perm_mask().  Permissions the
+ *  class inherits from its common are included.  Names which are not
+ *  permissions of the class contribute no bits.
+ *  @param policy The policy with which the class is associated.
+ *  @param obj_class The class whose permission values to use.
+ *  @param perms Array of permission names; searching is case sensitive.
+ *  @param num_perms Number of names in the array.
+ *  @param perm_mask Reference in which to store the permission mask.
+ *  @return Returns the number of names that are permissions of the
+ *  class (>= 0) on success and < 0 on failure; if the call fails,
+ *  errno will be set and *perm_mask will be 0.
+ */
+	extern int qpol_class_get_perm_mask(const qpol_policy_t * policy, const qpol_class_t * obj_class, const char *const *perms,
+					    size_t num_perms, uint32_t * perm_mask);
+
 /**
  *  Get the name which identifies a class.
  *  @param policy The policy with which the class is associated.
@@ -88,6 +88,26 @@ extern "C"
  */
 	extern int qpol_iterator_get_size(const qpol_iterator_t * iter, size_t * size);
 
+/**
+ *  Get up to max items starting at the current position of the
+ *  iterator, and advance the iterator past them.  This returns the
+ *  same items in the same order as calling qpol_iterator_get_item()
+ *  and qpol_iterator_next() in turn, but iterators over rules, symbol
+ *  tables, bitmaps and ocontexts fill the array directly instead of
+ *  going through those calls for every item.
+ *  @param iter The iterator from which to get the items.
+ *  @param out Array of at least max elements in which to store the
+ *  items; see qpol_iterator_get_item() regarding the items.
+ *  @param max Maximum number of items to get.
+ *  @param num Pointer in which to store the number of items stored
+ *  in out.  This is less than max only if the iterator reached the
+ *  end, and is 0 if it was already at the end.  Must be non-NULL.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set, *num will be the number of items stored before
+ *  the failure and the iterator's position is undefined.
+ */
+	extern int qpol_iterator_next_batch(qpol_iterator_t * iter, void **out, size_t max, size_t * num);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -91,6 +91,17 @@ extern "C"
  */
 #define QPOL_POLICY_OPTION_MATCH_SYSTEM   0x00000004
 
+/**
+ *  When building the syntactic rule table of a source policy (see
+ *  qpol_policy_build_syn_rule_table()), read it from a cache file
+ *  next to the policy, named after the policy with ".qpolcache"
+ *  appended.  If there is no cache file, or it was written for
+ *  different policy text, libqpol version or load options, the table
+ *  is built as usual and the cache file is (re)written.  This option
+ *  has no effect on other kinds of policies.
+ */
+#define QPOL_POLICY_OPTION_CACHE_SYN_RULES 0x00000008
+
 /**
  *  List of capabilities a policy may have. This list represents
  *  features of policy that may differ from version to version or
@@ -213,6 +224,22 @@ extern "C"
  */
 	extern int qpol_policy_append_module(qpol_policy_t * policy, qpol_module_t * module);
 
+/**
+ *  Read a list of module packages and append them to a policy, in
+ *  the order given.  The packages are decoded concurrently, one
+ *  thread per online processor.  As with qpol_policy_append_module(),
+ *  the caller must still invoke qpol_policy_rebuild() to update the
+ *  policy.  The time taken to read the modules, and that of each
+ *  phase of the rebuild, is reported as an informational message
+ *  through the policy's callback.
+ *  @param policy The policy to which to add the modules.
+ *  @param paths Array of paths of module packages.
+ *  @param num_paths Number of paths in the array.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the policy will remain unchanged.
+ */
+	extern int qpol_policy_append_module_files(qpol_policy_t * policy, const char *const *paths, size_t num_paths);
+
 /**
  *  Rebuild the policy. If the options provided are the same as those
  *  provied to the last call to rebuild or open and the modules were not
@@ -277,6 +304,41 @@ extern "C"
  */
 	extern int qpol_policy_get_policy_handle_unknown(const qpol_policy_t * policy, unsigned int *handle_unknown);
 
+/**
+ *  Make a policy read-only so that it may be shared by concurrent
+ *  readers.  All data that libqpol would otherwise build on first use
+ *  (the rule indices and, for policies with syntactic rules, the
+ *  syntactic rule table) is built now.  Afterwards every function
+ *  that would modify the policy, such as qpol_policy_rebuild(),
+ *  qpol_policy_append_module(), qpol_module_set_enabled(),
+ *  qpol_policy_reevaluate_conds() and the qpol_bool_set_state()
+ *  family, fails with errno set to EPERM.  Any number of threads may
+ *  then query a frozen policy at once, provided that the policy's
+ *  message callback is itself safe to call from several threads.
+ *  Freezing cannot be undone.
+ *  @param policy The policy to freeze.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the policy will not be frozen.
+ */
+	extern int qpol_policy_freeze(qpol_policy_t * policy);
+
+/**
+ *  Determine if a policy has been frozen by qpol_policy_freeze().
+ *  @param policy The policy to check.
+ *  @return Non-zero if the policy is frozen, and zero otherwise.
+ */
+	extern int qpol_policy_is_frozen(const qpol_policy_t * policy);
+
+/**
+ *  Get a number that changes every time qpol_policy_rebuild()
+ *  replaces the policy's symbols and rules.  Callers that keep data
+ *  derived from the policy, such as lists of qpol_type_t pointers,
+ *  may compare generations to tell if that data is stale.
+ *  @param policy The policy to check.
+ *  @return The policy's generation, or 0 if policy is NULL.
+ */
+	extern unsigned int qpol_policy_get_generation(const qpol_policy_t * policy);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -33,7 +33,8 @@
 #include <stdlib.h>
 #include "qpol_internal.h"
 
-int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+int qpol_policy_get_avrule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+				     qpol_iterator_t ** iter)
 {
 	policydb_t *db;
 	avtab_state_t *state;
@@ -41,7 +42,7 @@ int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	if (iter) {
 		*iter = NULL;
 	}
-	if (policy == NULL || iter == NULL) {
+	if (policy == NULL || iter == NULL || part >= num_parts) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
 		return STATUS_ERR;
@@ -69,10 +70,7 @@ int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type
 		errno = ENOMEM;
 		return STATUS_ERR;
 	}
-	state->ucond_tab = &db->te_avtab;
-	state->cond_tab = &db->te_cond_avtab;
-	state->rule_type_mask = rule_type_mask;
-	state->node = db->te_avtab.htable[0];
+	avtab_state_init(state, &db->te_avtab, &db->te_cond_avtab, rule_type_mask, part, num_parts);
 
 	if (qpol_iterator_create
 	    (policy, state, avtab_state_get_cur, avtab_state_next, avtab_state_end, avtab_state_size, free, iter)) {
@@ -85,6 +83,126 @@ int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+{
+	return qpol_policy_get_avrule_iter_part(policy, rule_type_mask, 0, 1, iter);
+}
+
+/**
+ *  Check that the av rules named by rule_type_mask are available.
+ *  @return 0 if they are, < 0 if not; errno will be set.
+ */
+static int avrule_iter_check_loaded(const qpol_policy_t * policy, uint32_t rule_type_mask)
+{
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get avrules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
+	if ((rule_type_mask & QPOL_RULE_NEVERALLOW) && !qpol_policy_has_capability(policy, QPOL_CAP_NEVERALLOW)) {
+		ERR(policy, "%s", "Cannot get avrules: Neverallow rules requested but not available");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ *  Common implementation of qpol_policy_get_avrule_iter_by_source()
+ *  and qpol_policy_get_avrule_iter_by_target().
+ */
+static int avrule_iter_by_type(const qpol_policy_t * policy, uint32_t rule_type_mask, int by_target, const qpol_type_t * type,
+			       qpol_iterator_t ** iter)
+{
+	avtab_ptr_t *list = NULL;
+	size_t num = 0;
+	uint32_t type_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (avrule_iter_check_loaded(policy, rule_type_mask) ||
+	    qpol_type_get_value(policy, type, &type_val) ||
+	    qpol_policy_get_avtab_index(policy, by_target, type_val, &list, &num)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT);
+	return qpol_avtab_list_iter_create(policy, list, num, rule_type_mask, 0, iter);
+}
+
+int qpol_policy_get_avrule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+					  qpol_iterator_t ** iter)
+{
+	return avrule_iter_by_type(policy, rule_type_mask, 0, source, iter);
+}
+
+int qpol_policy_get_avrule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * target,
+					  qpol_iterator_t ** iter)
+{
+	return avrule_iter_by_type(policy, rule_type_mask, 1, target, iter);
+}
+
+int qpol_policy_get_avrule_iter_by_type(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * type,
+					qpol_iterator_t ** iter)
+{
+	avtab_ptr_t *list = NULL;
+	size_t num = 0;
+	uint32_t type_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (avrule_iter_check_loaded(policy, rule_type_mask) || qpol_type_get_value(policy, type, &type_val)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT);
+	if (qpol_policy_get_avtab_nodes_by_type(policy, type_val, rule_type_mask, &list, &num)) {
+		return STATUS_ERR;
+	}
+
+	return qpol_avtab_list_iter_create(policy, list, num, rule_type_mask, 1, iter);
+}
+
+int qpol_policy_get_avrule_iter_by_key(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+				       const qpol_type_t * target, const qpol_class_t * obj_class, qpol_iterator_t ** iter)
+{
+	uint32_t source_val, target_val, class_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || source == NULL || target == NULL || obj_class == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (avrule_iter_check_loaded(policy, rule_type_mask) ||
+	    qpol_type_get_value(policy, source, &source_val) ||
+	    qpol_type_get_value(policy, target, &target_val) || qpol_class_get_value(policy, obj_class, &class_val)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT);
+	return qpol_avtab_key_iter_create(policy, rule_type_mask, source_val, target_val, class_val, iter);
+}
+
 int qpol_avrule_get_source_type(const qpol_policy_t * policy, const qpol_avrule_t * rule, const qpol_type_t ** source)
 {
 	policydb_t *db = NULL;
@@ -194,6 +312,47 @@ int qpol_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_avrule_t
 	return STATUS_SUCCESS;
 }
 
+int qpol_avrule_get_perm_mask(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * obj_class_val,
+			      uint32_t * perm_mask)
+{
+	policydb_t *db = NULL;
+	avtab_ptr_t avrule = NULL;
+	uint32_t nprim;
+
+	if (obj_class_val) {
+		*obj_class_val = 0;
+	}
+	if (perm_mask) {
+		*perm_mask = 0;
+	}
+
+	if (!policy || !rule || !perm_mask) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	avrule = (avtab_ptr_t) rule;
+
+	if (avrule->key.specified & QPOL_RULE_DONTAUDIT) {
+		/* stored as auditdeny; flip the bits and drop those past
+		 * the last permission of the class */
+		nprim = db->class_val_to_struct[avrule->key.target_class - 1]->permissions.nprim;
+		*perm_mask = ~(avrule->datum.data);
+		if (nprim < 32) {
+			*perm_mask &= ((uint32_t) 1 << nprim) - 1;
+		}
+	} else {
+		*perm_mask = avrule->datum.data;
+	}
+	if (obj_class_val) {
+		*obj_class_val = avrule->key.target_class;
+	}
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_avrule_get_rule_type(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * rule_type)
 {
 	policydb_t *db = NULL;
@@ -286,3 +445,18 @@ int qpol_avrule_get_which_list(const qpol_policy_t * policy, const qpol_avrule_t
 
 	return STATUS_SUCCESS;
 }
+
+int qpol_avrule_get_position(const qpol_policy_t * policy, const qpol_avrule_t * rule, size_t * pos)
+{
+	if (pos) {
+		*pos = 0;
+	}
+
+	if (!policy || !rule || !pos) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	return qpol_policy_get_avtab_node_pos(policy, (const struct avtab_node *)rule, pos);
+}
@@ -30,8 +30,12 @@
 #include <sepol/policydb.h>
 #include <sepol/policydb/policydb.h>
 #include <sepol/policydb/expand.h>
+#include <sepol/policydb/conditional.h>
 #include "iterator_internal.h"
 #include <qpol/bool_query.h>
+#include <qpol/avrule_query.h>
+#include <qpol/cond_query.h>
+#include <qpol/terule_query.h>
 #include "qpol_internal.h"
 
 int qpol_policy_get_bool_by_name(const qpol_policy_t * policy, const char *name, qpol_bool_t ** datum)
@@ -144,6 +148,9 @@ int qpol_bool_set_state(qpol_policy_t * policy, qpol_bool_t * datum, int state)
 		return STATUS_ERR;
 	}
 
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
 	internal_datum = (cond_bool_datum_t *) datum;
 	internal_datum->state = state;
 
@@ -165,10 +172,161 @@ int qpol_bool_set_state_no_eval(qpol_policy_t * policy, qpol_bool_t * datum, int
 		return STATUS_ERR;
 	}
 
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
+	internal_datum = (cond_bool_datum_t *) datum;
+	internal_datum->state = state;
+
+	return STATUS_SUCCESS;
+}
+
+#define QPOL_BOOL_AV_RULES (QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT)
+#define QPOL_BOOL_TE_RULES (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER)
+
+/** list of rules whose enabled state changed */
+typedef struct bool_changed_list
+{
+	avtab_ptr_t *list;
+	size_t num;
+	size_t cap;
+} bool_changed_list_t;
+
+static int bool_changed_list_append(bool_changed_list_t * changed, avtab_ptr_t node)
+{
+	avtab_ptr_t *tmp;
+	size_t cap;
+
+	if (changed->num == changed->cap) {
+		cap = changed->cap ? changed->cap * 2 : 64;
+		if (!(tmp = realloc(changed->list, cap * sizeof(avtab_ptr_t))))
+			return STATUS_ERR;
+		changed->list = tmp;
+		changed->cap = cap;
+	}
+	changed->list[changed->num++] = node;
+	return STATUS_SUCCESS;
+}
+
+/**
+ *  Set the enabled flag of each rule in one of a conditional's lists,
+ *  recording the rules whose flag changes.
+ *  @param list The list of rules to update.
+ *  @param enabled Non-zero if the rules are to be enabled.
+ *  @param av If non-NULL, list to which to append changed av rules.
+ *  @param te If non-NULL, list to which to append changed te rules.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int bool_update_cond_list(cond_av_list_t * list, int enabled, bool_changed_list_t * av, bool_changed_list_t * te)
+{
+	for (; list; list = list->next) {
+		if (!(list->node->merged & QPOL_COND_RULE_ENABLED) == !enabled)
+			continue;
+		if (enabled)
+			list->node->merged |= QPOL_COND_RULE_ENABLED;
+		else
+			list->node->merged &= ~(QPOL_COND_RULE_ENABLED);
+		if (av && (list->node->key.specified & QPOL_BOOL_AV_RULES) && bool_changed_list_append(av, list->node))
+			return STATUS_ERR;
+		if (te && (list->node->key.specified & QPOL_BOOL_TE_RULES) && bool_changed_list_append(te, list->node))
+			return STATUS_ERR;
+	}
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_set_state_incremental(qpol_policy_t * policy, qpol_bool_t * datum, int state, qpol_iterator_t ** avrules,
+				    qpol_iterator_t ** terules)
+{
+	cond_bool_datum_t *internal_datum;
+	policydb_t *db;
+	cond_node_t **conds = NULL;
+	size_t num_conds = 0, i = 0, j;
+	bool_changed_list_t av = { NULL, 0, 0 }, te = { NULL, 0, 0 };
+	int *old_cur_states = NULL, old_state, error = 0;
+
+	if (avrules != NULL)
+		*avrules = NULL;
+	if (terules != NULL)
+		*terules = NULL;
+
+	if (policy == NULL || datum == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
+	db = &policy->p->p;
 	internal_datum = (cond_bool_datum_t *) datum;
+	if (qpol_policy_get_bool_conds(policy, internal_datum->s.value, &conds, &num_conds)) {
+		return STATUS_ERR;     /* errno already set */
+	}
+	/* remember what a failure has to put back */
+	if (!(old_cur_states = malloc((num_conds ? num_conds : 1) * sizeof(int)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	for (i = 0; i < num_conds; i++)
+		old_cur_states[i] = conds[i]->cur_state;
+	old_state = internal_datum->state;
 	internal_datum->state = state;
 
+	/* only the conditionals using this boolean can change */
+	for (i = 0; i < num_conds; i++) {
+		conds[i]->cur_state = cond_evaluate_expr(db, conds[i]->expr);
+		if (conds[i]->cur_state < 0) {
+			ERR(policy, "Error evaluating conditional: %s", strerror(EILSEQ));
+			error = EILSEQ;
+			goto err;
+		}
+		if (bool_update_cond_list(conds[i]->true_list, conds[i]->cur_state, avrules ? &av : NULL, terules ? &te : NULL) ||
+		    bool_update_cond_list(conds[i]->false_list, !conds[i]->cur_state, avrules ? &av : NULL,
+					  terules ? &te : NULL)) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			goto err;
+		}
+	}
+
+	if (avrules != NULL && qpol_avtab_list_iter_create(policy, av.list, av.num, QPOL_BOOL_AV_RULES, 1, avrules)) {
+		av.list = NULL;	       /* freed by qpol_avtab_list_iter_create() */
+		error = errno;
+		goto err;
+	}
+	if (terules != NULL && qpol_avtab_list_iter_create(policy, te.list, te.num, QPOL_BOOL_TE_RULES, 1, terules)) {
+		te.list = NULL;
+		error = errno;
+		goto err;
+	}
+
+	free(old_cur_states);
 	return STATUS_SUCCESS;
+
+      err:
+	if (avrules != NULL && *avrules != NULL)
+		qpol_iterator_destroy(avrules);
+	else
+		free(av.list);
+	free(te.list);
+	/* put back the boolean and each conditional visited; the rule
+	 * flags were last set from the old states, so setting them again
+	 * without recording changes restores them and cannot fail */
+	internal_datum->state = old_state;
+	for (j = 0; j <= i && j < num_conds; j++) {
+		conds[j]->cur_state = old_cur_states[j];
+		if (old_cur_states[j] < 0)
+			continue;
+		bool_update_cond_list(conds[j]->true_list, old_cur_states[j], NULL, NULL);
+		bool_update_cond_list(conds[j]->false_list, !old_cur_states[j], NULL, NULL);
+	}
+	free(old_cur_states);
+	errno = error;
+	return STATUS_ERR;
 }
 
 int qpol_bool_get_name(const qpol_policy_t * policy, const qpol_bool_t * datum, const char **name)
@@ -487,6 +487,37 @@ int qpol_class_get_perm_iter(const qpol_policy_t * policy, const qpol_class_t *
 	return STATUS_SUCCESS;
 }
 
+int qpol_class_get_perm_mask(const qpol_policy_t * policy, const qpol_class_t * obj_class, const char *const *perms,
+			     size_t num_perms, uint32_t * perm_mask)
+{
+	class_datum_t *internal_datum = NULL;
+	perm_datum_t *perm = NULL;
+	size_t i;
+	int num_found = 0;
+
+	if (perm_mask != NULL)
+		*perm_mask = 0;
+	if (policy == NULL || obj_class == NULL || (perms == NULL && num_perms > 0) || perm_mask == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	internal_datum = (class_datum_t *) obj_class;
+	for (i = 0; i < num_perms; i++) {
+		perm = hashtab_search(internal_datum->permissions.table, (const hashtab_key_t)perms[i]);
+		if (perm == NULL && internal_datum->comdatum != NULL)
+			perm = hashtab_search(internal_datum->comdatum->permissions.table, (const hashtab_key_t)perms[i]);
+		/* access vectors are 32 bits wide */
+		if (perm == NULL || perm->s.value < 1 || perm->s.value > 32)
+			continue;
+		*perm_mask |= (uint32_t) 1 << (perm->s.value - 1);
+		num_found++;
+	}
+
+	return num_found;
+}
+
 int qpol_class_get_name(const qpol_policy_t * policy, const qpol_class_t * obj_class, const char **name)
 {
 	class_datum_t *internal_datum = NULL;
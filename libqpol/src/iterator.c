@@ -64,7 +64,7 @@ struct qpol_iterator
  * libsepol < 2.0.20.  With libsepol 2.0.20, this size was dynamically
  * calculated based upon the number of rules.
  */
-static uint32_t iterator_get_avtab_size(const avtab_t * avtab)
+uint32_t iterator_get_avtab_size(const avtab_t * avtab)
 {
 #ifdef SEPOL_DYNAMIC_AVTAB
 	return avtab->nslot;
@@ -259,6 +259,34 @@ int ocon_state_next(qpol_iterator_t * iter)
 	return STATUS_SUCCESS;
 }
 
+/* number of buckets of an avtab that may be visited */
+static uint32_t avtab_state_num_buckets(const avtab_t * avtab)
+{
+	return avtab->htable ? iterator_get_avtab_size(avtab) : 0;
+}
+
+void avtab_state_init(avtab_state_t * state, avtab_t * ucond_tab, avtab_t * cond_tab, uint32_t rule_type_mask, size_t part,
+		      size_t num_parts)
+{
+	uint64_t num_ucond = avtab_state_num_buckets(ucond_tab);
+	uint64_t total = num_ucond + avtab_state_num_buckets(cond_tab);
+	uint64_t first = total * part / num_parts, last = total * (part + 1) / num_parts;
+
+	state->ucond_tab = ucond_tab;
+	state->cond_tab = cond_tab;
+	state->rule_type_mask = rule_type_mask;
+	state->begin[QPOL_AVTAB_STATE_AV] = (uint32_t) (first < num_ucond ? first : num_ucond);
+	state->end[QPOL_AVTAB_STATE_AV] = (uint32_t) (last < num_ucond ? last : num_ucond);
+	state->begin[QPOL_AVTAB_STATE_COND] = (uint32_t) (first > num_ucond ? first - num_ucond : 0);
+	state->end[QPOL_AVTAB_STATE_COND] = (uint32_t) (last > num_ucond ? last - num_ucond : 0);
+	state->which = QPOL_AVTAB_STATE_AV;
+	state->bucket = state->begin[QPOL_AVTAB_STATE_AV];
+	if (state->bucket < state->end[QPOL_AVTAB_STATE_AV])
+		state->node = ucond_tab->htable[state->bucket];
+	else
+		state->node = NULL;
+}
+
 int avtab_state_next(qpol_iterator_t * iter)
 {
 	avtab_t *avtab;
@@ -269,39 +297,37 @@ int avtab_state_next(qpol_iterator_t * iter)
 		return STATUS_ERR;
 	}
 
-	state = iter->state;
-	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
-
-	if ((!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) && state->which == QPOL_AVTAB_STATE_COND) {
+	if (avtab_state_end(iter)) {
 		errno = ERANGE;
 		return STATUS_ERR;
 	}
 
+	state = iter->state;
+	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
+
 	do {
 		if (state->node != NULL && state->node->next != NULL) {
 			state->node = state->node->next;
-		} else {
-			/* find the next bucket */
-			do {
-				state->bucket++;
-				if (!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) {
-					if (state->which == QPOL_AVTAB_STATE_AV) {
-						state->bucket = 0;
-						avtab = state->cond_tab;
-						state->which = QPOL_AVTAB_STATE_COND;
-					} else {
-						state->node = NULL;
-						break;
-					}
-				}
-				if (avtab->htable && avtab->htable[state->bucket] != NULL) {
-					state->node = avtab->htable[state->bucket];
+			continue;
+		}
+		/* find the next non-empty bucket, moving on to the
+		 * conditional table after the unconditional one */
+		state->node = NULL;
+		for (;;) {
+			state->bucket++;
+			if (state->bucket >= state->end[state->which]) {
+				if (state->which == QPOL_AVTAB_STATE_COND)
 					break;
-				}
-			} while (avtab->htable && state->bucket < iterator_get_avtab_size(avtab));
+				avtab = state->cond_tab;
+				state->which = QPOL_AVTAB_STATE_COND;
+				state->bucket = state->begin[QPOL_AVTAB_STATE_COND];
+				if (state->bucket >= state->end[QPOL_AVTAB_STATE_COND])
+					break;
+			}
+			if ((state->node = avtab->htable[state->bucket]) != NULL)
+				break;
 		}
-	} while (avtab->htable && state->bucket < iterator_get_avtab_size(avtab) &&
-		 state->node ? !(state->rule_type_mask & state->node->key.specified) : 0);
+	} while (state->node != NULL && !(state->rule_type_mask & state->node->key.specified));
 
 	return STATUS_SUCCESS;
 }
@@ -360,15 +386,13 @@ int ocon_state_end(const qpol_iterator_t * iter)
 int avtab_state_end(const qpol_iterator_t * iter)
 {
 	avtab_state_t *state;
-	avtab_t *avtab;
 
 	if (iter == NULL || iter->state == NULL) {
 		errno = EINVAL;
 		return STATUS_ERR;
 	}
 	state = iter->state;
-	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
-	if ((!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) && state->which == QPOL_AVTAB_STATE_COND)
+	if (state->which == QPOL_AVTAB_STATE_COND && state->bucket >= state->end[QPOL_AVTAB_STATE_COND])
 		return 1;
 	return 0;
 }
@@ -442,7 +466,7 @@ size_t avtab_state_size(const qpol_iterator_t * iter)
 	state = iter->state;
 	avtab = state->ucond_tab;
 
-	for (bucket = 0; avtab->htable && bucket < iterator_get_avtab_size(avtab); bucket++) {
+	for (bucket = state->begin[QPOL_AVTAB_STATE_AV]; bucket < state->end[QPOL_AVTAB_STATE_AV]; bucket++) {
 		for (node = avtab->htable[bucket]; node; node = node->next) {
 			if (node->key.specified & state->rule_type_mask)
 				count++;
@@ -451,7 +475,7 @@ size_t avtab_state_size(const qpol_iterator_t * iter)
 
 	avtab = state->cond_tab;
 
-	for (bucket = 0; avtab->htable && bucket < iterator_get_avtab_size(avtab); bucket++) {
+	for (bucket = state->begin[QPOL_AVTAB_STATE_COND]; bucket < state->end[QPOL_AVTAB_STATE_COND]; bucket++) {
 		for (node = avtab->htable[bucket]; node; node = node->next) {
 			if (node->key.specified & state->rule_type_mask)
 				count++;
@@ -525,6 +549,162 @@ int qpol_iterator_get_size(const qpol_iterator_t * iter, size_t * size)
 	return STATUS_SUCCESS;
 }
 
+/**
+ *  Batch version of avtab_state_next().  Nodes further along a hash
+ *  chain are taken directly; avtab_state_next() is only called to
+ *  move to the next bucket or table.
+ */
+static size_t avtab_state_next_batch(qpol_iterator_t * iter, void **out, size_t max)
+{
+	avtab_state_t *state = iter->state;
+	size_t n = 0;
+
+	while (n < max && !avtab_state_end(iter)) {
+		out[n++] = state->node;
+		while (n < max && state->node->next) {
+			state->node = state->node->next;
+			if (state->node->key.specified & state->rule_type_mask)
+				out[n++] = state->node;
+		}
+		/* the last node visited was either returned or skipped */
+		avtab_state_next(iter);
+	}
+
+	return n;
+}
+
+/**
+ *  Batch version of avtab_list_state_next().
+ */
+static size_t avtab_list_state_next_batch(qpol_iterator_t * iter, void **out, size_t max)
+{
+	avtab_list_state_t *as = iter->state;
+	size_t n = 0;
+
+	for (; n < max && as->cur < as->end; as->cur++) {
+		if (as->list[as->cur]->key.specified & as->rule_type_mask)
+			out[n++] = as->list[as->cur];
+	}
+	/* leave the iterator on a matching node, as next() does */
+	while (as->cur < as->end && !(as->list[as->cur]->key.specified & as->rule_type_mask))
+		as->cur++;
+
+	return n;
+}
+
+/**
+ *  Batch version of hash_state_next() for iterators returning either
+ *  the datum (hash_state_get_cur()) or the key (hash_state_get_cur_key())
+ *  of each entry.
+ */
+static size_t hash_state_next_batch(qpol_iterator_t * iter, void **out, size_t max)
+{
+	hash_state_t *hs = iter->state;
+	const int want_key = (iter->get_cur == hash_state_get_cur_key);
+	size_t n = 0;
+
+	while (n < max && !hash_state_end(iter)) {
+		out[n++] = want_key ? (void *)hs->node->key : hs->node->datum;
+		while (n < max && hs->node->next) {
+			hs->node = hs->node->next;
+			out[n++] = want_key ? (void *)hs->node->key : hs->node->datum;
+		}
+		if (n == max && hs->node->next) {
+			/* resume within this chain */
+			hs->node = hs->node->next;
+			break;
+		}
+		hash_state_next(iter);
+	}
+
+	return n;
+}
+
+/**
+ *  Batch version of ebitmap_state_next().  Set bits are found by
+ *  walking the bitmap's nodes once rather than by probing each bit;
+ *  each item is still made by the iterator's get_cur function, which
+ *  differs by the kind of bitmap.
+ */
+static size_t ebitmap_state_next_batch(qpol_iterator_t * iter, void **out, size_t max)
+{
+	ebitmap_state_t *es = iter->state;
+	ebitmap_node_t *node = NULL;
+	size_t n = 0, bit;
+
+	for (node = es->bmap->node; node && es->cur < es->bmap->highbit; node = node->next) {
+		if (node->startbit + MAPSIZE <= es->cur)
+			continue;
+		for (bit = (es->cur > node->startbit ? es->cur : node->startbit); bit < node->startbit + MAPSIZE; bit++) {
+			if (!(node->map & (MAPBIT << (bit - node->startbit))))
+				continue;
+			es->cur = bit;
+			if (n == max)
+				return n;
+			if (!(out[n] = iter->get_cur(iter)))
+				return n;
+			n++;
+		}
+	}
+	es->cur = es->bmap->highbit;
+
+	return n;
+}
+
+/**
+ *  Batch version of ocon_state_next().
+ */
+static size_t ocon_state_next_batch(qpol_iterator_t * iter, void **out, size_t max)
+{
+	ocon_state_t *os = iter->state;
+	size_t n = 0;
+
+	for (; n < max && os->cur; os->cur = os->cur->next)
+		out[n++] = os->cur;
+
+	return n;
+}
+
+int qpol_iterator_next_batch(qpol_iterator_t * iter, void **out, size_t max, size_t * num)
+{
+	size_t n = 0;
+
+	if (num != NULL)
+		*num = 0;
+
+	if (iter == NULL || iter->state == NULL || out == NULL || num == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	/* iterators over the common policy structures are walked
+	 * directly; any other iterator goes one item at a time */
+	if (iter->next == avtab_state_next && iter->get_cur == avtab_state_get_cur) {
+		n = avtab_state_next_batch(iter, out, max);
+	} else if (iter->next == avtab_list_state_next && iter->get_cur == avtab_list_state_get_cur) {
+		n = avtab_list_state_next_batch(iter, out, max);
+	} else if (iter->next == hash_state_next &&
+		   (iter->get_cur == hash_state_get_cur || iter->get_cur == hash_state_get_cur_key)) {
+		n = hash_state_next_batch(iter, out, max);
+	} else if (iter->next == ebitmap_state_next && iter->end == ebitmap_state_end) {
+		n = ebitmap_state_next_batch(iter, out, max);
+		if (n < max && !ebitmap_state_end(iter))
+			return STATUS_ERR;	/* get_cur failed and set errno */
+	} else if (iter->next == ocon_state_next && iter->get_cur == ocon_state_get_cur) {
+		n = ocon_state_next_batch(iter, out, max);
+	} else {
+		for (; n < max && !iter->end(iter); n++) {
+			if (!(out[n] = iter->get_cur(iter)) || iter->next(iter)) {
+				*num = n;
+				return STATUS_ERR;
+			}
+		}
+	}
+
+	*num = n;
+	return STATUS_SUCCESS;
+}
+
 void *ebitmap_state_get_cur_type(const qpol_iterator_t * iter)
 {
 	ebitmap_state_t *es = NULL;
@@ -690,6 +870,41 @@ int perm_state_end(const qpol_iterator_t * iter)
 	return 0;
 }
 
+/** arguments for perm_val_to_name_find() */
+struct perm_val_to_name_args
+{
+	uint32_t value;
+	const char *name;
+};
+
+static int perm_val_to_name_find(hashtab_key_t key, hashtab_datum_t datum, void *data)
+{
+	struct perm_val_to_name_args *args = (struct perm_val_to_name_args *)data;
+
+	if (((perm_datum_t *) datum)->s.value == args->value) {
+		args->name = key;
+		return 1;      /* stop the walk */
+	}
+	return 0;
+}
+
+const char *qpol_perm_val_to_name(const policydb_t * db, uint32_t class_val, uint32_t perm_val)
+{
+	const class_datum_t *obj_class;
+	struct perm_val_to_name_args args = { perm_val, NULL };
+
+	if (!db || class_val < 1 || class_val > db->p_classes.nprim)
+		return NULL;
+
+	/* unlike sepol_av_to_string() this uses no static buffer,
+	 * so it may be called from several threads at once */
+	obj_class = db->class_val_to_struct[class_val - 1];
+	hashtab_map(obj_class->permissions.table, perm_val_to_name_find, &args);
+	if (!args.name && obj_class->comdatum)
+		hashtab_map(obj_class->comdatum->permissions.table, perm_val_to_name_find, &args);
+	return args.name;
+}
+
 void *perm_state_get_cur(const qpol_iterator_t * iter)
 {
 	const policydb_t *db = NULL;
@@ -697,7 +912,7 @@ void *perm_state_get_cur(const qpol_iterator_t * iter)
 	common_datum_t *comm = NULL;
 	perm_state_t *ps = NULL;
 	unsigned int perm_max = 0;
-	char *tmp = NULL;
+	const char *tmp = NULL;
 
 	if (iter == NULL || (db = qpol_iterator_policy(iter)) == NULL ||
 	    (ps = (perm_state_t *) qpol_iterator_state(iter)) == NULL || perm_state_end(iter)) {
@@ -724,10 +939,8 @@ void *perm_state_get_cur(const qpol_iterator_t * iter)
 		return NULL;
 	}
 
-	/* explicit const_cast for sepol */
-	tmp = sepol_av_to_string((policydb_t *) db, ps->obj_class_val, (sepol_access_vector_t) 1 << (ps->cur));
+	tmp = qpol_perm_val_to_name(db, ps->obj_class_val, ps->cur + 1);
 	if (tmp) {
-		tmp++;		       /*sepol_av_to_string prepends a ' ' to the name */
 		return strdup(tmp);
 	} else {
 		errno = EINVAL;
@@ -795,3 +1008,195 @@ size_t perm_state_size(const qpol_iterator_t * iter)
 
 	return count;
 }
+
+void *avtab_list_state_get_cur(const qpol_iterator_t * iter)
+{
+	avtab_list_state_t *as = NULL;
+
+	if (iter == NULL || iter->state == NULL || avtab_list_state_end(iter)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	as = (avtab_list_state_t *) iter->state;
+
+	return as->list[as->cur];
+}
+
+int avtab_list_state_next(qpol_iterator_t * iter)
+{
+	avtab_list_state_t *as = NULL;
+
+	if (iter == NULL || iter->state == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	as = (avtab_list_state_t *) iter->state;
+
+	if (as->cur >= as->end) {
+		errno = ERANGE;
+		return STATUS_ERR;
+	}
+
+	do {
+		as->cur++;
+	} while (as->cur < as->end && !(as->list[as->cur]->key.specified & as->rule_type_mask));
+
+	return STATUS_SUCCESS;
+}
+
+int avtab_list_state_end(const qpol_iterator_t * iter)
+{
+	avtab_list_state_t *as = NULL;
+
+	if (iter == NULL || iter->state == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	as = (avtab_list_state_t *) iter->state;
+
+	return (as->cur >= as->end);
+}
+
+size_t avtab_list_state_size(const qpol_iterator_t * iter)
+{
+	avtab_list_state_t *as = NULL;
+	size_t i, count = 0;
+
+	if (iter == NULL || iter->state == NULL) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	as = (avtab_list_state_t *) iter->state;
+
+	for (i = 0; i < as->end; i++) {
+		if (as->list[i]->key.specified & as->rule_type_mask)
+			count++;
+	}
+
+	return count;
+}
+
+void avtab_list_state_destroy(void *as)
+{
+	avtab_list_state_t *ias = (avtab_list_state_t *) as;
+
+	if (!as)
+		return;
+
+	if (ias->own_list)
+		free(ias->list);
+	free(ias);
+}
+
+int qpol_avtab_list_iter_create(const qpol_policy_t * policy, avtab_ptr_t * list, size_t num, uint32_t rule_type_mask,
+				int own_list, qpol_iterator_t ** iter)
+{
+	avtab_list_state_t *as = NULL;
+	int error = 0;
+
+	if (iter != NULL)
+		*iter = NULL;
+
+	if (policy == NULL || iter == NULL || (list == NULL && num > 0)) {
+		if (own_list)
+			free(list);
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if ((as = calloc(1, sizeof(avtab_list_state_t))) == NULL) {
+		error = errno;
+		if (own_list)
+			free(list);
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	as->rule_type_mask = rule_type_mask;
+	as->list = list;
+	as->end = num;
+	as->own_list = own_list;
+
+	if (qpol_iterator_create(policy, (void *)as, avtab_list_state_get_cur, avtab_list_state_next, avtab_list_state_end,
+				 avtab_list_state_size, avtab_list_state_destroy, iter)) {
+		error = errno;
+		avtab_list_state_destroy(as);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	if (as->end > 0 && !(as->list[0]->key.specified & as->rule_type_mask))
+		avtab_list_state_next(*iter);
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ *  Append to a list all nodes in an avtab matching a key.
+ *  @param tab Table to search.
+ *  @param key Key to find; its specified field is the rule type mask.
+ *  @param list Reference to the list to which to append; it will be
+ *  grown as needed.
+ *  @param num Reference to the number of nodes in the list.
+ *  @param cap Reference to the allocated capacity of the list.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int avtab_append_key_matches(avtab_t * tab, avtab_key_t * key, avtab_ptr_t ** list, size_t * num, size_t * cap)
+{
+	avtab_ptr_t node = NULL, *tmp = NULL;
+
+	for (node = avtab_search_node(tab, key); node; node = avtab_search_node_next(node, key->specified)) {
+		if (*num >= *cap) {
+			*cap = (*cap ? *cap * 2 : 4);
+			if ((tmp = realloc(*list, *cap * sizeof(avtab_ptr_t))) == NULL) {
+				return STATUS_ERR;
+			}
+			*list = tmp;
+		}
+		(*list)[(*num)++] = node;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_avtab_key_iter_create(const qpol_policy_t * policy, uint32_t rule_type_mask, uint32_t source_val,
+			       uint32_t target_val, uint32_t class_val, qpol_iterator_t ** iter)
+{
+	policydb_t *db = NULL;
+	avtab_key_t key;
+	avtab_ptr_t *list = NULL;
+	size_t num = 0, cap = 0;
+	int error = 0;
+
+	if (iter != NULL)
+		*iter = NULL;
+
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	key.source_type = (uint16_t) source_val;
+	key.target_type = (uint16_t) target_val;
+	key.target_class = (uint16_t) class_val;
+	key.specified = (uint16_t) rule_type_mask;
+
+	if (avtab_append_key_matches(&db->te_avtab, &key, &list, &num, &cap) ||
+	    avtab_append_key_matches(&db->te_cond_avtab, &key, &list, &num, &cap)) {
+		error = errno;
+		free(list);
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	return qpol_avtab_list_iter_create(policy, list, num, rule_type_mask, 1, iter);
+}
@@ -75,8 +75,22 @@ extern "C"
 #define QPOL_AVTAB_STATE_AV   0
 #define QPOL_AVTAB_STATE_COND 1
 		unsigned which;
+	/** range of buckets visited within each table, indexed by
+	 *  QPOL_AVTAB_STATE_AV and QPOL_AVTAB_STATE_COND; see
+	 *  avtab_state_init() */
+		uint32_t begin[2], end[2];
 	} avtab_state_t;
 
+	typedef struct avtab_list_state
+	{
+		uint32_t rule_type_mask;
+		avtab_ptr_t *list;
+		size_t cur;
+		size_t end;
+		/** non-zero if list was allocated for this state and must be freed with it */
+		int own_list;
+	} avtab_list_state_t;
+
 	int qpol_iterator_create(const qpol_policy_t * policy, void *state,
 				 void *(*get_cur) (const qpol_iterator_t * iter),
 				 int (*next) (qpol_iterator_t * iter),
@@ -84,6 +98,18 @@ extern "C"
 				 size_t(*size) (const qpol_iterator_t * iter), void (*free_fn) (void *x), qpol_iterator_t ** iter);
 
 	void *qpol_iterator_state(const qpol_iterator_t * iter);
+
+/**
+ *  Get the name of a permission of a class, including permissions
+ *  inherited from the class's common.
+ *  @param db The policy containing the class.
+ *  @param class_val Value of the class.
+ *  @param perm_val Value of the permission within the class.
+ *  @return The permission's name, or NULL if the class has no such
+ *  permission.  The caller must not free the string.
+ */
+	const char *qpol_perm_val_to_name(const policydb_t * db, uint32_t class_val, uint32_t perm_val);
+	uint32_t iterator_get_avtab_size(const avtab_t * avtab);
 	const policydb_t *qpol_iterator_policy(const qpol_iterator_t * iter);
 
 	void *hash_state_get_cur(const qpol_iterator_t * iter);
@@ -97,25 +123,82 @@ extern "C"
 	void *perm_state_get_cur(const qpol_iterator_t * iter);
 	void *avtab_state_get_cur(const qpol_iterator_t * iter);
 
+/**
+ *  Initialize the state of an iterator over one part of the rules in
+ *  an unconditional and a conditional avtab.  The buckets of both
+ *  tables are treated as one sequence, unconditional first, and split
+ *  into num_parts nearly equal ranges.  Visiting parts 0 through
+ *  num_parts - 1 in order yields the same rules in the same order as
+ *  visiting the whole of both tables.  After creating the iterator the
+ *  caller must advance it with avtab_state_next() if state->node is
+ *  NULL or does not match the rule type mask.
+ *  @param state State to initialize.
+ *  @param ucond_tab The unconditional table.
+ *  @param cond_tab The conditional table.
+ *  @param rule_type_mask Rule types to visit.
+ *  @param part Part to visit, starting at 0.
+ *  @param num_parts Total number of parts; must be greater than part.
+ */
+	void avtab_state_init(avtab_state_t * state, avtab_t * ucond_tab, avtab_t * cond_tab, uint32_t rule_type_mask, size_t part,
+			      size_t num_parts);
+	void *avtab_list_state_get_cur(const qpol_iterator_t * iter);
+
 	int hash_state_next(qpol_iterator_t * iter);
 	int ebitmap_state_next(qpol_iterator_t * iter);
 	int ocon_state_next(qpol_iterator_t * iter);
 	int perm_state_next(qpol_iterator_t * iter);
 	int avtab_state_next(qpol_iterator_t * iter);
+	int avtab_list_state_next(qpol_iterator_t * iter);
 
 	int hash_state_end(const qpol_iterator_t * iter);
 	int ebitmap_state_end(const qpol_iterator_t * iter);
 	int ocon_state_end(const qpol_iterator_t * iter);
 	int perm_state_end(const qpol_iterator_t * iter);
 	int avtab_state_end(const qpol_iterator_t * iter);
+	int avtab_list_state_end(const qpol_iterator_t * iter);
 
 	size_t hash_state_size(const qpol_iterator_t * iter);
 	size_t ebitmap_state_size(const qpol_iterator_t * iter);
 	size_t ocon_state_size(const qpol_iterator_t * iter);
 	size_t perm_state_size(const qpol_iterator_t * iter);
 	size_t avtab_state_size(const qpol_iterator_t * iter);
+	size_t avtab_list_state_size(const qpol_iterator_t * iter);
 
 	void ebitmap_state_destroy(void *es);
+	void avtab_list_state_destroy(void *as);
+
+/**
+ *  Create an iterator over a list of avtab nodes, returning only
+ *  those whose rule type is in rule_type_mask.
+ *  @param policy The policy from which the nodes come.
+ *  @param list Array of nodes over which to iterate.
+ *  @param num Number of nodes in the array.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param own_list If non-zero the iterator takes ownership of list
+ *  and will free() it when destroyed, even if this call fails.
+ *  @param iter Iterator over items of type avtab_ptr_t returned.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	int qpol_avtab_list_iter_create(const qpol_policy_t * policy, avtab_ptr_t * list, size_t num, uint32_t rule_type_mask,
+					int own_list, qpol_iterator_t ** iter);
+
+/**
+ *  Create an iterator over the avtab nodes, from both the
+ *  unconditional and conditional tables, that exactly match a
+ *  (source, target, class) key.  The tables are searched by hash so
+ *  this does not scan the full avtab.
+ *  @param policy The policy to search.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param source_val Value of the source type.
+ *  @param target_val Value of the target type.
+ *  @param class_val Value of the object class.
+ *  @param iter Iterator over items of type avtab_ptr_t returned.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	int qpol_avtab_key_iter_create(const qpol_policy_t * policy, uint32_t rule_type_mask, uint32_t source_val,
+				       uint32_t target_val, uint32_t class_val, qpol_iterator_t ** iter);
 #ifdef	__cplusplus
 }
 #endif
@@ -26,9 +26,13 @@
 #include <config.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <qpol/module.h>
 #include <qpol/util.h>
@@ -37,24 +41,26 @@
 #include <sepol/policydb.h>
 #include <sepol/policydb/module.h>
 
-int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
+int qpol_module_create_from_data(const char *path, char *data, size_t size, qpol_module_t ** module)
 {
 	sepol_module_package_t *smp = NULL;
 	sepol_policy_file_t *spf = NULL;
-	FILE *infile = NULL;
 	int error = 0;
 	char *tmp = NULL;
-	char *data = NULL;
-	ssize_t size;
 
 	if (module)
 		*module = NULL;
 
-	if (!path || !module) {
+	if (!path || !data || !module) {
 		errno = EINVAL;
 		return STATUS_ERR;
 	}
 
+	if (size < sizeof(uint32_t) || !qpol_is_data_mod_pkg(data)) {
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
 	if (!(*module = calloc(1, sizeof(qpol_module_t)))) {
 		return STATUS_ERR;
 	}
@@ -68,28 +74,7 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 		error = errno;
 		goto err;
 	}
-
-	infile = fopen(path, "rb");
-	if (!infile) {
-		error = errno;
-		goto err;
-	}
-	size = qpol_bunzip(infile, &data);
-
-	if (size > 0) {
-		if (!qpol_is_data_mod_pkg(data)) {
-			error = ENOTSUP;
-			goto err;
-		}
-		sepol_policy_file_set_mem(spf, data, size);
-	} else {
-		if (!qpol_is_file_mod_pkg(infile)) {
-			error = ENOTSUP;
-			goto err;
-		}
-		rewind(infile);
-		sepol_policy_file_set_fp(spf, infile);
-	}
+	sepol_policy_file_set_mem(spf, data, size);
 
 	if (sepol_module_package_create(&smp)) {
 		error = EIO;
@@ -102,14 +87,10 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 	}
 	free(tmp);
 	tmp = NULL;
-	if (size > 0) {
-		// Re setting the memory location has the effect of rewind
-		// API is not accessible from here to explicitly "rewind" the
-		// in-memory file.
-		sepol_policy_file_set_mem(spf, data, size);
-	} else {
-		rewind(infile);
-	}
+	/* Re setting the memory location has the effect of rewind
+	 * API is not accessible from here to explicitly "rewind" the
+	 * in-memory file. */
+	sepol_policy_file_set_mem(spf, data, size);
 
 	if (sepol_module_package_read(smp, spf, 0)) {
 		error = EIO;
@@ -127,9 +108,6 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 	(*module)->enabled = 1;
 
 	sepol_module_package_free(smp);
-	fclose(infile);
-	if (data != NULL)
-		free (data);
 	sepol_policy_file_free(spf);
 
 	return STATUS_SUCCESS;
@@ -138,16 +116,165 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 	qpol_module_destroy(module);
 	sepol_policy_file_free(spf);
 	sepol_module_package_free(smp);
-	if (infile)
-		fclose(infile);
-	if (data != NULL)
-		free (data);
-	if (tmp != NULL)
-		free(tmp);
+	free(tmp);
 	errno = error;
 	return STATUS_ERR;
 }
 
+int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
+{
+	FILE *infile = NULL;
+	struct stat sb;
+	int error = 0, retv;
+	char *data = NULL;
+	ssize_t size;
+
+	if (module)
+		*module = NULL;
+
+	if (!path || !module) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	infile = fopen(path, "rb");
+	if (!infile) {
+		return STATUS_ERR;
+	}
+
+	size = qpol_bunzip(infile, &data);
+	if (size > 0) {
+		retv = qpol_module_create_from_data(path, data, size, module);
+		error = errno;
+		free(data);
+	} else {
+		/* not compressed, so hand sepol a read-only view of the file */
+		if (fstat(fileno(infile), &sb) < 0) {
+			error = errno;
+			fclose(infile);
+			errno = error;
+			return STATUS_ERR;
+		}
+		if (sb.st_size < (off_t) sizeof(uint32_t)) {
+			fclose(infile);
+			errno = ENOTSUP;
+			return STATUS_ERR;
+		}
+		data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fileno(infile), 0);
+		if (data == MAP_FAILED) {
+			error = errno;
+			fclose(infile);
+			errno = error;
+			return STATUS_ERR;
+		}
+		retv = qpol_module_create_from_data(path, data, sb.st_size, module);
+		error = errno;
+		munmap(data, sb.st_size);
+	}
+	fclose(infile);
+
+	errno = error;
+	return retv;
+}
+
+/** work shared by the threads of qpol_module_create_from_files() */
+typedef struct module_read_job
+{
+	const char *const *paths;
+	qpol_module_t **modules;
+	int *errors;
+	size_t num_paths;
+	/** index of the next path to read, protected by lock */
+	size_t next;
+	pthread_mutex_t lock;
+} module_read_job_t;
+
+static void *module_read_worker(void *arg)
+{
+	module_read_job_t *job = (module_read_job_t *) arg;
+	size_t i;
+
+	for (;;) {
+		pthread_mutex_lock(&job->lock);
+		i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+		if (i >= job->num_paths)
+			break;
+		if (qpol_module_create_from_file(job->paths[i], &job->modules[i]))
+			job->errors[i] = errno ? errno : EIO;
+	}
+	return NULL;
+}
+
+int qpol_module_create_from_files(const char *const *paths, size_t num_paths, size_t num_threads, qpol_module_t ** modules,
+				  size_t * failed)
+{
+	module_read_job_t job;
+	pthread_t *threads = NULL;
+	size_t num_started = 0, i;
+	long num_cpus;
+	int error = 0;
+
+	if (failed)
+		*failed = 0;
+	if ((!paths || !modules) && num_paths > 0) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (num_paths == 0)
+		return STATUS_SUCCESS;
+
+	memset(modules, 0, num_paths * sizeof(qpol_module_t *));
+	memset(&job, 0, sizeof(job));
+	job.paths = paths;
+	job.modules = modules;
+	job.num_paths = num_paths;
+	if (!(job.errors = calloc(num_paths, sizeof(int))))
+		return STATUS_ERR;
+	if ((error = pthread_mutex_init(&job.lock, NULL))) {
+		free(job.errors);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	if (num_threads == 0) {
+		num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = num_cpus > 0 ? (size_t) num_cpus : 1;
+	}
+	if (num_threads > num_paths)
+		num_threads = num_paths;
+
+	/* the calling thread is one of the workers; if a thread cannot
+	 * be started the remaining ones simply read more modules */
+	if (num_threads > 1 && (threads = calloc(num_threads - 1, sizeof(pthread_t)))) {
+		for (num_started = 0; num_started < num_threads - 1; num_started++) {
+			if (pthread_create(&threads[num_started], NULL, module_read_worker, &job))
+				break;
+		}
+	}
+	module_read_worker(&job);
+	for (i = 0; i < num_started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&job.lock);
+
+	/* report the first failure in list order, whichever thread hit it */
+	for (i = 0; i < num_paths && !job.errors[i]; i++) ;
+	if (i < num_paths) {
+		error = job.errors[i];
+		if (failed)
+			*failed = i;
+		for (i = 0; i < num_paths; i++)
+			qpol_module_destroy(&modules[i]);
+		free(job.errors);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	free(job.errors);
+	return STATUS_SUCCESS;
+}
+
 void qpol_module_destroy(qpol_module_t ** module)
 {
 	if (!module || !(*module))
@@ -227,6 +354,9 @@ int qpol_module_set_enabled(qpol_module_t * module, int enabled)
 		return STATUS_ERR;
 	}
 
+	if (module->parent && QPOL_POLICY_CHECK_NOT_FROZEN(module->parent))
+		return STATUS_ERR;
+
 	if (enabled != module->enabled && module->parent) {
 		module->parent->modified = 1;
 	}
@@ -36,6 +36,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <asm/types.h>
 
 #include <sepol/debug.h>
@@ -351,6 +353,22 @@ int qpol_is_data_mod_pkg(char * data)
 	return 0;
 }
 
+int qpol_is_data_binpol(const char *data, size_t size)
+{
+	__u32 ubuf;
+
+	if (data == NULL || size < sizeof(__u32))
+		return 0;
+
+	memcpy(&ubuf, data, sizeof(__u32));
+
+	ubuf = le32_to_cpu(ubuf);
+	if (ubuf == SELINUX_MAGIC)
+		return 1;
+
+	return 0;
+}
+
 int qpol_is_file_mod_pkg(FILE * fp)
 {
 	size_t sz;
@@ -761,6 +779,18 @@ err:
 	return 1;
 }
 
+/**
+ *  Get the current time in seconds, for reporting how long each phase
+ *  of loading a policy takes.
+ */
+static double qpol_policy_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 /* forward declarations see policy_extend.c */
 struct qpol_extended_image;
 extern void qpol_extended_image_destroy(struct qpol_extended_image **ext);
@@ -788,6 +818,7 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 	qpol_module_t *base = NULL;
 	size_t num_modules = 0, i;
 	int error = 0, old_options;
+	double start;
 
 	if (!policy) {
 		ERR(NULL, "%s", strerror(EINVAL));
@@ -799,6 +830,9 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 	if (policy->type == QPOL_POLICY_KERNEL_BINARY)
 		return STATUS_SUCCESS;
 
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
 	/* if options are the same and the modules were not modified, do nothing */
 	if (options == policy->options && policy->modified == 0)
 		return STATUS_SUCCESS;
@@ -828,8 +862,16 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 				modules[num_modules++] = (policy->modules[i])->p;
 			}
 		}
-		/* have to reopen the base since link alters it */
-		if (qpol_module_create_from_file((policy->modules[0])->path, &base)) {
+		/* have to reopen the base since link alters it; reuse the
+		 * mapped file if the base was opened through this policy */
+		if (policy->file_data_type == QPOL_POLICY_FILE_DATA_TYPE_MMAP &&
+		    policy->file_data_sz >= sizeof(__u32) && qpol_is_data_mod_pkg(policy->file_data)) {
+			if (qpol_module_create_from_data((policy->modules[0])->path, policy->file_data, policy->file_data_sz, &base)) {
+				error = errno;
+				ERR(policy, "%s", strerror(error));
+				goto err;
+			}
+		} else if (qpol_module_create_from_file((policy->modules[0])->path, &base)) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -838,10 +880,12 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 		policy->p = base->p;
 		base->p = NULL;
 		qpol_module_destroy(&base);
+		start = qpol_policy_now();
 		if (sepol_link_modules(policy->sh, policy->p, modules, num_modules, 0)) {
 			error = EIO;
 			goto err;
 		}
+		INFO(policy, "Linked %zu modules in %.3f seconds.", num_modules, qpol_policy_now() - start);
 		free(modules);
 	} else {
 		/* repeat open process as if qpol_policy_open_from_memory() */
@@ -884,23 +928,28 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 		goto err;
 	}
 
+	start = qpol_policy_now();
 	if (qpol_expand_module(policy, !(policy->options & (QPOL_POLICY_OPTION_NO_NEVERALLOWS)))) {
 		error = errno;
 		goto err;
 	}
+	INFO(policy, "Expanded policy in %.3f seconds.", qpol_policy_now() - start);
 
 	if (infer_policy_version(policy)) {
 		error = errno;
 		goto err;
 	}
 
+	start = qpol_policy_now();
 	if (policy_extend(policy)) {
 		error = errno;
 		goto err;
 	}
+	INFO(policy, "Extended policy in %.3f seconds.", qpol_policy_now() - start);
 	qpol_extended_image_destroy(&ext);
 
 	sepol_policydb_free(old_p);
+	policy->generation++;
 
 	return STATUS_SUCCESS;
 
@@ -1019,10 +1068,33 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 
 	sepol_policy_file_set_handle(pfile, (*policy)->sh);
 
+	/* map the file once; the same view is handed to sepol for binary
+	 * policies, to the module reader for packages, and to the parser
+	 * for source policies, and is kept for rebuild() */
+	fd = fileno(infile);
+	if (fd < 0) {
+		error = errno;
+		goto err;
+	}
+	if (fstat(fd, &sb) < 0) {
+		error = errno;
+		ERR(*policy, "Can't stat '%s':	%s\n", path, strerror(errno));
+		goto err;
+	}
+	(*policy)->file_data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if ((*policy)->file_data == MAP_FAILED) {
+		(*policy)->file_data = NULL;
+		error = errno;
+		ERR(*policy, "Can't map '%s':  %s\n", path, strerror(errno));
+		goto err;
+	}
+	(*policy)->file_data_sz = sb.st_size;
+	(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_MMAP;
+
     errno=0;
-	if (qpol_is_file_binpol(infile)) {
+	if (qpol_is_data_binpol((*policy)->file_data, (*policy)->file_data_sz)) {
 		(*policy)->type = retv = QPOL_POLICY_KERNEL_BINARY;
-		sepol_policy_file_set_fp(pfile, infile);
+		sepol_policy_file_set_mem(pfile, (*policy)->file_data, (*policy)->file_data_sz);
 		if (sepol_policydb_read((*policy)->p, pfile)) {
 //			error = EIO;
 			goto err;
@@ -1034,7 +1106,8 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 			error = errno;
 			goto err;
 		}
-	} else if (qpol_module_create_from_file(path, &mod) == STATUS_SUCCESS) {
+	} else if (qpol_module_create_from_data(path, (*policy)->file_data, (*policy)->file_data_sz, &mod) == STATUS_SUCCESS ||
+		   qpol_module_create_from_file(path, &mod) == STATUS_SUCCESS) {
 		(*policy)->type = retv = QPOL_POLICY_MODULE_BINARY;
 
 		if (qpol_policy_append_module(*policy, mod)) {
@@ -1049,32 +1122,18 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 		}
 	} else {
 		(*policy)->type = retv = QPOL_POLICY_KERNEL_SOURCE;
-		fd = fileno(infile);
-		if (fd < 0) {
-			error = errno;
-			goto err;
-		}
-		if (fstat(fd, &sb) < 0) {
-			error = errno;
-			ERR(*policy, "Can't stat '%s':	%s\n", path, strerror(errno));
-			goto err;
-		}
-		qpol_src_input = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-		if (qpol_src_input == MAP_FAILED) {
-			error = errno;
-			ERR(*policy, "Can't map '%s':  %s\n", path, strerror(errno));
-
-			goto err;
+		if (options & QPOL_POLICY_OPTION_CACHE_SYN_RULES) {
+			if (!((*policy)->cache_path = malloc(strlen(path) + strlen(".qpolcache") + 1))) {
+				error = errno;
+				goto err;
+			}
+			sprintf((*policy)->cache_path, "%s.qpolcache", path);
 		}
+		qpol_src_input = (*policy)->file_data;
 		qpol_src_inputptr = qpol_src_input;
 		qpol_src_inputlim = &qpol_src_inputptr[sb.st_size - 1];
 		qpol_src_originalinput = qpol_src_input;
 
-		/* store mmaped version for rebuild() */
-		(*policy)->file_data = qpol_src_originalinput;
-		(*policy)->file_data_sz = sb.st_size;
-		(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_MMAP;
-
 		(*policy)->p->p.policy_type = POLICY_BASE;
 		if (read_source_policy(*policy, "libqpol", (*policy)->options) < 0) {
 			error = errno;
@@ -1278,6 +1337,7 @@ void qpol_policy_destroy(qpol_policy_t ** policy)
 		sepol_policydb_free((*policy)->p);
 		sepol_handle_destroy((*policy)->sh);
 		qpol_extended_image_destroy(&((*policy)->ext));
+		free((*policy)->cache_path);
 		if ((*policy)->modules) {
 			size_t i = 0;
 			for (i = 0; i < (*policy)->num_modules; i++) {
@@ -1307,6 +1367,9 @@ int qpol_policy_reevaluate_conds(qpol_policy_t * policy)
 		return STATUS_ERR;
 	}
 
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
 	db = &policy->p->p;
 
 	for (cond = db->cond_list; cond; cond = cond->next) {
@@ -1353,6 +1416,9 @@ int qpol_policy_append_module(qpol_policy_t * policy, qpol_module_t * module)
 		return STATUS_ERR;
 	}
 
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+
 	if (!(tmp = realloc(policy->modules, (1 + policy->num_modules) * sizeof(qpol_module_t *)))) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
@@ -1369,6 +1435,95 @@ int qpol_policy_append_module(qpol_policy_t * policy, qpol_module_t * module)
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_append_module_files(qpol_policy_t * policy, const char *const *paths, size_t num_paths)
+{
+	qpol_module_t **tmp = NULL, **mods = NULL;
+	size_t failed = 0, i;
+	double start;
+	int error = 0;
+
+	if (!policy || (!paths && num_paths > 0)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return STATUS_ERR;
+	if (num_paths == 0)
+		return STATUS_SUCCESS;
+
+	if (!(mods = calloc(num_paths, sizeof(qpol_module_t *)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	start = qpol_policy_now();
+	if (qpol_module_create_from_files(paths, num_paths, 0, mods, &failed)) {
+		error = errno;
+		ERR(policy, "Error loading module %s: %s", paths[failed], strerror(error));
+		free(mods);
+		errno = error;
+		return STATUS_ERR;
+	}
+	INFO(policy, "Read %zu modules in %.3f seconds.", num_paths, qpol_policy_now() - start);
+
+	if (!(tmp = realloc(policy->modules, (num_paths + policy->num_modules) * sizeof(qpol_module_t *)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		for (i = 0; i < num_paths; i++)
+			qpol_module_destroy(&mods[i]);
+		free(mods);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	policy->modules = tmp;
+	for (i = 0; i < num_paths; i++) {
+		policy->modules[policy->num_modules++] = mods[i];
+		mods[i]->parent = policy;
+	}
+	policy->modified = 1;
+	free(mods);
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_freeze(qpol_policy_t * policy)
+{
+	if (!policy) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (policy->frozen)
+		return STATUS_SUCCESS;
+
+	/* pending module changes would otherwise never be applied */
+	if (policy->modified) {
+		ERR(policy, "%s", "The policy must be rebuilt before it can be frozen.");
+		errno = EBUSY;
+		return STATUS_ERR;
+	}
+
+	if (policy_extend_complete(policy))
+		return STATUS_ERR;     /* errno already set */
+
+	policy->frozen = 1;
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_is_frozen(const qpol_policy_t * policy)
+{
+	return policy != NULL && policy->frozen;
+}
+
+unsigned int qpol_policy_get_generation(const qpol_policy_t * policy)
+{
+	return policy != NULL ? policy->generation : 0;
+}
+
 typedef struct mod_state
 {
 	qpol_module_t **list;
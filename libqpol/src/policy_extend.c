@@ -42,36 +42,26 @@
 #include <selinux/selinux.h>
 #include <errno.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
 #include "syn_rule_internal.h"
 
-#ifdef SETOOLS_DEBUG
-#include <math.h>
-#endif
-
 #define OBJECT_R "object_r"
 
-#define QPOL_SYN_RULE_TABLE_BITS 16
-#define QPOL_SYN_RULE_TABLE_SIZE (1 << QPOL_SYN_RULE_TABLE_BITS)
-#define QPOL_SYN_RULE_TABLE_MASK (QPOL_SYN_RULE_TABLE_SIZE - 1)
-
-/* original hashing function below */
-/*
-#define QPOL_SYN_RULE_TABLE_HASH(rule_key) \
-((rule_key->class_val + \
- (rule_key->target_val << 2) +\
- (rule_key->source_val << 9)) & \
- QPOL_SYN_RULE_TABLE_MASK)
-*/
-
-/* new hashing function, introduced in SETools 3.3 */
-#define QPOL_SYN_RULE_TABLE_HASH(rule_key) \
-(((((rule_key->source_val & 0xff) << 8) | (rule_key->target_val & 0xff)) ^ \
- (rule_key->class_val & 0xf) ^ \
- ((int) ((size_t) rule_key->cond) & 0xfff0)) & QPOL_SYN_RULE_TABLE_MASK)
+/* the table starts with room for this many keys per syntactic rule,
+ * and doubles whenever it becomes more than 3/4 full */
+#define QPOL_SYN_RULE_TABLE_KEYS_PER_RULE 4
+#define QPOL_SYN_RULE_TABLE_MIN_SIZE 64
+/* number of rule list entries allocated at a time */
+#define QPOL_SYN_RULE_BLOCK_SIZE 4096
 
 typedef struct qpol_syn_rule_key
 {
@@ -88,23 +78,83 @@ typedef struct qpol_syn_rule_list
 	struct qpol_syn_rule_list *next;
 } qpol_syn_rule_list_t;
 
+/** a slot of the table; the slot is empty if rules is NULL */
 typedef struct qpol_syn_rule_node
 {
 	qpol_syn_rule_key_t key;
 	qpol_syn_rule_list_t *rules;
-	struct qpol_syn_rule_node *next;
 } qpol_syn_rule_node_t;
 
+/** a block of rule list entries, handed out in order */
+typedef struct qpol_syn_rule_block
+{
+	struct qpol_syn_rule_block *next;
+	size_t used;
+	qpol_syn_rule_list_t entries[QPOL_SYN_RULE_BLOCK_SIZE];
+} qpol_syn_rule_block_t;
+
+/**
+ *  Open addressing (linearly probed) hash table from a rule key to
+ *  the list of syntactic rules that produced it.  The list entries
+ *  live in blocks owned by the table and are only freed with it.
+ */
 typedef struct qpol_syn_rule_table
 {
-	qpol_syn_rule_node_t **buckets;
+	qpol_syn_rule_node_t *slots;
+	/** number of slots, always a power of 2 */
+	size_t size;
+	size_t num_nodes;
+	qpol_syn_rule_block_t *blocks;
 } qpol_syn_rule_table_t;
 
+/** position of an avtab node in table order */
+typedef struct qpol_avtab_index_pos
+{
+	avtab_ptr_t node;
+	size_t pos;
+} qpol_avtab_index_pos_t;
+
+/**
+ *  Index of the nodes in both the unconditional and conditional
+ *  avtabs by source and by target type value.  The nodes whose key
+ *  names type value v are by_source[source_start[v]] through
+ *  by_source[source_start[v + 1] - 1] (likewise for targets); each
+ *  list is in table order.  by_addr holds the table position of every
+ *  node, sorted by node address.
+ */
+typedef struct qpol_avtab_index
+{
+	size_t *source_start;
+	avtab_ptr_t *by_source;
+	size_t *target_start;
+	avtab_ptr_t *by_target;
+	qpol_avtab_index_pos_t *by_addr;
+	size_t num_nodes;
+	uint32_t num_types;
+} qpol_avtab_index_t;
+
+/**
+ *  Index of the conditionals that use each boolean.  The conditionals
+ *  whose expression names boolean value v are conds[start[v]] through
+ *  conds[start[v + 1] - 1]; each is listed once per boolean.
+ */
+typedef struct qpol_bool_cond_index
+{
+	size_t *start;
+	cond_node_t **conds;
+	uint32_t num_bools;
+} qpol_bool_cond_index_t;
+
 typedef struct qpol_extended_image
 {
 	qpol_syn_rule_table_t *syn_rule_table;
 	struct qpol_syn_rule **syn_rule_master_list;
 	size_t master_list_sz;
+	/** built by policy_extend(), or on first use by
+	 *  qpol_policy_get_avtab_index() if the policy was not extended */
+	qpol_avtab_index_t *avtab_index;
+	/** built on first use by qpol_policy_get_bool_conds() */
+	qpol_bool_cond_index_t *bool_cond_index;
 } qpol_extended_image_t;
 
 struct extend_bogus_alias_struct
@@ -659,41 +709,49 @@ static void qpol_syn_rule_destroy(struct qpol_syn_rule **r)
 }
 
 /**
- *  Free all memory used by a syn rule list.
- *  @param list Reference pointer to the head node of
- *  the syn rule list to destroy. All nodes in the list will
- *  be destroyed.
+ *  Hash a syntactic rule key.  The rule type is not hashed, as
+ *  dontaudit rules are looked up by a mask of two rule types.
+ *  @param key The key to hash.
+ *  @return The hash value.
  */
-static void qpol_syn_rule_list_destroy(qpol_syn_rule_list_t ** list)
+static size_t qpol_syn_rule_key_hash(const qpol_syn_rule_key_t * key)
 {
-	qpol_syn_rule_list_t *cur = NULL, *next = NULL;
-
-	if (!list || !(*list))
-		return;
-
-	for (cur = *list; cur; cur = next) {
-		next = cur->next;
-		free(cur);
-	}
+	uint64_t h = key->source_val;
+
+	h = h * 0x9e3779b97f4a7c15ULL + key->target_val;
+	h = h * 0x9e3779b97f4a7c15ULL + key->class_val;
+	h = h * 0x9e3779b97f4a7c15ULL + (uint64_t) (size_t) key->cond;
+	h ^= h >> 29;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 32;
+	return (size_t) h;
 }
 
 /**
- *  Free all memory used by a syn rule node in the rule table.
- *  @param node Reference pointer to the first node in the chain.
- *  All nodes in the chain will be destroyed.
+ *  Create an empty syntactic rule table.
+ *  @param num_nodes Number of keys the table should hold without
+ *  having to grow.
+ *  @return The new table or NULL on failure; if the call fails,
+ *  errno will be set.
  */
-static void qpol_syn_rule_node_destroy(qpol_syn_rule_node_t ** node)
+static qpol_syn_rule_table_t *qpol_syn_rule_table_create(size_t num_nodes)
 {
-	qpol_syn_rule_node_t *cur = NULL, *next = NULL;
+	qpol_syn_rule_table_t *t = NULL;
+	size_t size = QPOL_SYN_RULE_TABLE_MIN_SIZE;
+	int error;
 
-	if (!node || !(*node))
-		return;
+	while (size / 4 * 3 < num_nodes)
+		size *= 2;
 
-	for (cur = *node; cur; cur = next) {
-		next = cur->next;
-		qpol_syn_rule_list_destroy(&cur->rules);
-		free(cur);
+	if (!(t = calloc(1, sizeof(qpol_syn_rule_table_t))) || !(t->slots = calloc(size, sizeof(qpol_syn_rule_node_t)))) {
+		error = errno;
+		free(t);
+		errno = error;
+		return NULL;
 	}
+	t->size = size;
+
+	return t;
 }
 
 /**
@@ -702,15 +760,16 @@ static void qpol_syn_rule_node_destroy(qpol_syn_rule_node_t ** node)
  */
 static void qpol_syn_rule_table_destroy(qpol_syn_rule_table_t ** t)
 {
-	size_t i = 0;
+	qpol_syn_rule_block_t *block = NULL, *next = NULL;
 
 	if (!t || !(*t))
 		return;
 
-	for (i = 0; i < QPOL_SYN_RULE_TABLE_SIZE; i++)
-		qpol_syn_rule_node_destroy(&((*t)->buckets[i]));
-
-	free((*t)->buckets);
+	for (block = (*t)->blocks; block; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free((*t)->slots);
 	free(*t);
 	*t = NULL;
 }
@@ -725,22 +784,91 @@ static qpol_syn_rule_node_t *qpol_syn_rule_table_find_node_by_key(const qpol_syn
 								  const qpol_syn_rule_key_t * key)
 {
 	qpol_syn_rule_node_t *node = NULL;
+	size_t i;
 
-	for (node = table->buckets[QPOL_SYN_RULE_TABLE_HASH(key)]; node; node = node->next) {
+	for (i = qpol_syn_rule_key_hash(key) & (table->size - 1);; i = (i + 1) & (table->size - 1)) {
+		node = table->slots + i;
+		if (!node->rules)
+			return NULL;
 		if ((node->key.rule_type & key->rule_type) &&
 		    (node->key.source_val == key->source_val) &&
 		    (node->key.target_val == key->target_val) &&
 		    (node->key.class_val == key->class_val) && (node->key.cond == key->cond))
 			return node;
 	}
+}
 
-	return NULL;
+/**
+ *  Find the empty slot in which a key not yet in the table belongs.
+ */
+static qpol_syn_rule_node_t *qpol_syn_rule_table_find_slot(const qpol_syn_rule_table_t * table, const qpol_syn_rule_key_t * key)
+{
+	size_t i = qpol_syn_rule_key_hash(key) & (table->size - 1);
+
+	while (table->slots[i].rules)
+		i = (i + 1) & (table->size - 1);
+	return table->slots + i;
+}
+
+/**
+ *  Add a key that is not yet in the table, growing the table if it
+ *  would become more than 3/4 full.  The caller must set the new
+ *  node's rules, as a node without rules is an empty slot.  Growing
+ *  moves every node, so pointers to nodes are only valid until the
+ *  next call.
+ *  @param table The table to which to add the key.
+ *  @param key The key to add.
+ *  @return The new node or NULL on failure; if the call fails,
+ *  errno will be set and the table is unchanged.
+ */
+static qpol_syn_rule_node_t *qpol_syn_rule_table_add_node(qpol_syn_rule_table_t * table, const qpol_syn_rule_key_t * key)
+{
+	qpol_syn_rule_node_t *old_slots = table->slots, *node = NULL;
+	size_t old_size = table->size, i;
+
+	if (table->num_nodes + 1 > table->size / 4 * 3) {
+		if (!(table->slots = calloc(old_size * 2, sizeof(qpol_syn_rule_node_t)))) {
+			table->slots = old_slots;
+			return NULL;
+		}
+		table->size = old_size * 2;
+		for (i = 0; i < old_size; i++) {
+			if (old_slots[i].rules)
+				*qpol_syn_rule_table_find_slot(table, &old_slots[i].key) = old_slots[i];
+		}
+		free(old_slots);
+	}
+
+	node = qpol_syn_rule_table_find_slot(table, key);
+	node->key = *key;
+	table->num_nodes++;
+	return node;
+}
+
+/**
+ *  Get an unused rule list entry from the table's blocks.
+ *  @param table The table that will own the entry.
+ *  @return The entry or NULL on failure; if the call fails, errno
+ *  will be set.
+ */
+static qpol_syn_rule_list_t *qpol_syn_rule_table_new_entry(qpol_syn_rule_table_t * table)
+{
+	qpol_syn_rule_block_t *block = table->blocks;
+
+	if (!block || block->used == QPOL_SYN_RULE_BLOCK_SIZE) {
+		if (!(block = malloc(sizeof(qpol_syn_rule_block_t))))
+			return NULL;
+		block->used = 0;
+		block->next = table->blocks;
+		table->blocks = block;
+	}
+
+	return block->entries + block->used++;
 }
 
 /**
  *  Given a syn rule key and a syn rule, adds the key/rule pair to the
- *  syn rule table.  Note that this function takes ownership of the
- *  key.
+ *  syn rule table.  The key is copied into the table.
  *
  *  @param policy Policy associated with the rule.
  *  @param table The table to which to add the rule.
@@ -756,31 +884,24 @@ static int qpol_syn_rule_table_insert_entry(qpol_policy_t * policy,
 	qpol_syn_rule_node_t *table_node = NULL;
 	qpol_syn_rule_list_t *list_entry = NULL;
 
-	if (!(list_entry = malloc(sizeof(qpol_syn_rule_list_t)))) {
+	if (!(list_entry = qpol_syn_rule_table_new_entry(table))) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
+		errno = error;
 		return -1;
 	}
 	list_entry->rule = rule;
 
 	table_node = qpol_syn_rule_table_find_node_by_key(table, key);
-	if (table_node) {
-		list_entry->next = table_node->rules;
-		table_node->rules = list_entry;
-	} else {
-		list_entry->next = NULL;
-		if (!(table_node = malloc(sizeof(qpol_syn_rule_node_t)))) {
-			error = errno;
-			ERR(policy, "%s", strerror(error));
-			free(list_entry);
-			return -1;
-		}
-		table_node->key = *key;
-		table_node->rules = list_entry;
-		size_t hash = QPOL_SYN_RULE_TABLE_HASH(key);
-		table_node->next = table->buckets[hash];
-		table->buckets[hash] = table_node;
+	if (!table_node && !(table_node = qpol_syn_rule_table_add_node(table, key))) {
+		/* the entry stays unused in its block until the table is freed */
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return -1;
 	}
+	list_entry->next = table_node->rules;
+	table_node->rules = list_entry;
 	return 0;
 }
 
@@ -788,37 +909,22 @@ static int qpol_syn_rule_table_insert_entry(qpol_policy_t * policy,
  *  Add a syntactic rule (sepol's avrule_t) to the syntactic rule table.
  *  @param policy Policy associated with the rule.
  *  @param table The table to which to add the rule.
- *  @param rule The rule to add.
- *  @param cond The conditional associated with the rule (NULL if
- *  unconditional).  with the rule (needed for conditional tracking).
- *  @param branch If the rule is conditional, then 0 if in the true
- *  branch, 1 if in else.
+ *  @param new_rule The rule to add, already in the master list.
  *  @return 0 on success and < 0 on failure; if the call fails,
  *  errno will be set and the table may be in an inconsistent state.
  */
-static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_syn_rule_table_t * table, avrule_t * rule,
-						   cond_node_t * cond, int branch)
+static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_syn_rule_table_t * table,
+						   struct qpol_syn_rule *new_rule)
 {
 	int error = 0;
 	qpol_syn_rule_key_t key = { 0, 0, 0, 0, NULL };
-	struct qpol_syn_rule *new_rule = NULL;
+	avrule_t *rule = new_rule->rule;
+	cond_node_t *cond = new_rule->cond;
 	ebitmap_t source_types, source_types2, target_types, target_types2;
 	ebitmap_node_t *snode = NULL, *tnode = NULL;
 	unsigned int i, j;
 	class_perm_node_t *class_node = NULL;
 
-	if (!(new_rule = malloc(sizeof(struct qpol_syn_rule)))) {
-		error = errno;
-		ERR(policy, "%s", strerror(error));
-		goto err;
-	}
-	new_rule->rule = rule;
-	new_rule->cond = cond;
-	new_rule->cond_branch = branch;
-
-	policy->ext->syn_rule_master_list[policy->ext->master_list_sz] = new_rule;
-	policy->ext->master_list_sz++;
-
 	if (type_set_expand(&rule->stypes, &source_types, &policy->p->p, 0) ||
 	    type_set_expand(&rule->stypes, &source_types2, &policy->p->p, 1)) {
 		ERR(policy, "%s", strerror(ENOMEM));
@@ -845,8 +951,10 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 				key.source_val = key.target_val = i + 1;
 				key.class_val = class_node->class;
 				key.cond = cond;
-				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule))
+				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule)) {
+					error = errno;
 					goto err;
+				}
 			}
 		}
 		ebitmap_for_each_bit(&target_types, tnode, j) {
@@ -858,8 +966,10 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 				key.target_val = j + 1;
 				key.class_val = class_node->class;
 				key.cond = cond;
-				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule))
+				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule)) {
+					error = errno;
 					goto err;
+				}
 			}
 		}
 	}
@@ -875,16 +985,383 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 	ebitmap_destroy(&source_types2);
 	ebitmap_destroy(&target_types);
 	ebitmap_destroy(&target_types2);
+	errno = error;
+	return -1;
+}
+
+/**
+ *  Append a syntactic rule to the policy's master list.
+ *  @param policy Policy associated with the rule.
+ *  @param rule The rule to append.
+ *  @param cond The conditional associated with the rule (NULL if
+ *  unconditional).
+ *  @param branch If the rule is conditional, then 0 if in the true
+ *  branch, 1 if in else.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_syn_rule_master_list_append(qpol_policy_t * policy, avrule_t * rule, cond_node_t * cond, int branch)
+{
+	struct qpol_syn_rule *new_rule = NULL;
+	int error = 0;
+
+	if (!(new_rule = malloc(sizeof(struct qpol_syn_rule)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return -1;
+	}
+	new_rule->rule = rule;
+	new_rule->cond = cond;
+	new_rule->cond_branch = branch;
+
+	policy->ext->syn_rule_master_list[policy->ext->master_list_sz] = new_rule;
+	policy->ext->master_list_sz++;
+	return 0;
+}
+
+#define QPOL_SYN_RULE_CACHE_MAGIC "QPOLSYN"
+#define QPOL_SYN_RULE_CACHE_BYTE_ORDER 0x01020304
+#define QPOL_SYN_RULE_CACHE_SUFFIX ".qpolcache"
+/* load options that change which syntactic rules are read */
+#define QPOL_SYN_RULE_CACHE_OPTIONS (QPOL_POLICY_OPTION_NO_NEVERALLOWS | QPOL_POLICY_OPTION_NO_RULES)
+/* rule types a cached key may hold */
+#define QPOL_SYN_RULE_CACHE_RULE_TYPES (AVRULE_ALLOWED | AVRULE_AUDITALLOW | AVRULE_AUDITDENY | AVRULE_DONTAUDIT | \
+					AVRULE_NEVERALLOW | AVRULE_TRANSITION | AVRULE_MEMBER | AVRULE_CHANGE)
+
+/**
+ *  Header of a syntactic rule table cache file.  It is followed by
+ *  num_nodes qpol_syn_rule_cache_node_t and then by num_refs uint32_t
+ *  master list indices, the rules of each node in turn.  Everything
+ *  up to num_nodes must match the policy being loaded.
+ */
+typedef struct qpol_syn_rule_cache_header
+{
+	char magic[8];
+	uint32_t byte_order;
+	char version[16];
+	uint32_t options;
+	uint64_t policy_size;
+	uint64_t policy_hash;
+	uint32_t num_rules;
+	uint32_t num_conds;
+	uint32_t num_nodes;
+	uint32_t num_refs;
+} qpol_syn_rule_cache_header_t;
+
+typedef struct qpol_syn_rule_cache_node
+{
+	uint32_t rule_type;
+	uint32_t source_val;
+	uint32_t target_val;
+	uint32_t class_val;
+	/** 0 if unconditional, else the 1 based position in cond_list */
+	uint32_t cond;
+	uint32_t num_refs;
+} qpol_syn_rule_cache_node_t;
+
+/** pointer to number mapping used when writing a cache file */
+typedef struct qpol_syn_rule_cache_ptr
+{
+	const void *ptr;
+	uint32_t val;
+} qpol_syn_rule_cache_ptr_t;
+
+static int qpol_syn_rule_cache_ptr_comp(const void *a, const void *b)
+{
+	const qpol_syn_rule_cache_ptr_t *x = a, *y = b;
+
+	if (x->ptr == y->ptr)
+		return 0;
+	return (x->ptr < y->ptr) ? -1 : 1;
+}
+
+/**
+ *  Look up the number previously assigned to a pointer.
+ *  @return The number, or 0 if the pointer is not in the mapping;
+ *  callers only look up pointers that were mapped.
+ */
+static uint32_t qpol_syn_rule_cache_ptr_find(const qpol_syn_rule_cache_ptr_t * map, size_t num, const void *ptr)
+{
+	qpol_syn_rule_cache_ptr_t key, *found;
+
+	key.ptr = ptr;
+	found = bsearch(&key, map, num, sizeof(*map), qpol_syn_rule_cache_ptr_comp);
+	return found ? found->val : 0;
+}
+
+/**
+ *  Fill in the identifying part of a cache header for a policy: the
+ *  libqpol version, the load options and a hash of the policy text.
+ *  The node and reference counts are left zero.
+ */
+static void qpol_syn_rule_cache_fill_header(const qpol_policy_t * policy, uint32_t num_conds, qpol_syn_rule_cache_header_t * hdr)
+{
+	const unsigned char *data = (const unsigned char *)policy->file_data;
+	uint64_t hash = 14695981039346656037ULL;	/* 64 bit FNV-1a */
+	size_t i;
+
+	for (i = 0; i < policy->file_data_sz; i++) {
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	memset(hdr, 0, sizeof(*hdr));
+	strncpy(hdr->magic, QPOL_SYN_RULE_CACHE_MAGIC, sizeof(hdr->magic) - 1);
+	hdr->byte_order = QPOL_SYN_RULE_CACHE_BYTE_ORDER;
+	strncpy(hdr->version, LIBQPOL_VERSION_STRING, sizeof(hdr->version) - 1);
+	hdr->options = policy->options & QPOL_SYN_RULE_CACHE_OPTIONS;
+	hdr->policy_size = policy->file_data_sz;
+	hdr->policy_hash = hash;
+	hdr->num_rules = policy->ext->master_list_sz;
+	hdr->num_conds = num_conds;
+}
+
+/**
+ *  Read the syntactic rule table from the policy's cache file.  The
+ *  master list must already be filled and the table not yet created.
+ *  @param policy Policy whose table to load.
+ *  @param conds Array of the policy's conditionals in cond_list order.
+ *  @param num_conds Number of conditionals.
+ *  @return 0 if the table was loaded, 1 if there is no cache file or
+ *  it does not match the policy (no table is left behind, so the
+ *  caller builds one as usual), and < 0 on error; if the call fails,
+ *  errno will be set and the table may have been created and
+ *  partially filled.
+ */
+static int qpol_syn_rule_cache_load(qpol_policy_t * policy, cond_node_t ** conds, uint32_t num_conds)
+{
+	qpol_syn_rule_cache_header_t expected, *hdr;
+	const qpol_syn_rule_cache_node_t *cnodes;
+	const uint32_t *refs;
+	qpol_syn_rule_table_t *table = NULL;
+	qpol_syn_rule_key_t key;
+	qpol_syn_rule_node_t *node = NULL;
+	qpol_syn_rule_list_t *entry = NULL, *rules = NULL;
+	const policydb_t *db = NULL;
+	struct stat sb;
+	void *data = MAP_FAILED;
+	uint64_t total;
+	size_t i, j, ref;
+	int fd, error = 0, retv = 1;
+
+	if ((fd = open(policy->cache_path, O_RDONLY)) < 0)
+		return 1;
+	if (fstat(fd, &sb) == 0 && (size_t) sb.st_size >= sizeof(*hdr))
+		data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return 1;
+
+	hdr = data;
+	qpol_syn_rule_cache_fill_header(policy, num_conds, &expected);
+	total = sizeof(*hdr) + (uint64_t) hdr->num_nodes * sizeof(*cnodes) + (uint64_t) hdr->num_refs * sizeof(*refs);
+	if (memcmp(hdr, &expected, offsetof(qpol_syn_rule_cache_header_t, num_nodes)) || total != (uint64_t) sb.st_size)
+		goto out;
+	cnodes = (const qpol_syn_rule_cache_node_t *)(hdr + 1);
+	refs = (const uint32_t *)(cnodes + hdr->num_nodes);
+
+	/* check everything before building so a bad file is simply ignored */
+	db = &policy->p->p;
+	for (i = 0, total = 0; i < hdr->num_nodes; i++) {
+		if (cnodes[i].cond > num_conds || cnodes[i].num_refs == 0 ||
+		    cnodes[i].rule_type == 0 || (cnodes[i].rule_type & ~QPOL_SYN_RULE_CACHE_RULE_TYPES) ||
+		    cnodes[i].source_val == 0 || cnodes[i].source_val > db->p_types.nprim ||
+		    cnodes[i].target_val == 0 || cnodes[i].target_val > db->p_types.nprim ||
+		    cnodes[i].class_val == 0 || cnodes[i].class_val > db->p_classes.nprim)
+			goto out;
+		total += cnodes[i].num_refs;
+	}
+	if (total != hdr->num_refs)
+		goto out;
+	for (i = 0; i < hdr->num_refs; i++) {
+		if (refs[i] >= hdr->num_rules)
+			goto out;
+	}
+
+	INFO(policy, "Reading syntactic rules table from %s.", policy->cache_path);
+	if (!(table = qpol_syn_rule_table_create(hdr->num_nodes))) {
+		error = errno;
+		goto err;
+	}
+	policy->ext->syn_rule_table = table;
+	for (i = 0, ref = 0; i < hdr->num_nodes; i++) {
+		key.rule_type = cnodes[i].rule_type;
+		key.source_val = cnodes[i].source_val;
+		key.target_val = cnodes[i].target_val;
+		key.class_val = cnodes[i].class_val;
+		key.cond = cnodes[i].cond ? conds[cnodes[i].cond - 1] : NULL;
+		/* prepend in reverse to keep the original order */
+		for (rules = NULL, j = cnodes[i].num_refs; j > 0; j--) {
+			if (!(entry = qpol_syn_rule_table_new_entry(table))) {
+				error = errno;
+				goto err;
+			}
+			entry->rule = policy->ext->syn_rule_master_list[refs[ref + j - 1]];
+			entry->next = rules;
+			rules = entry;
+		}
+		ref += cnodes[i].num_refs;
+		/* a written table never holds two keys that one lookup could
+		 * both match; a file that does is rebuilt from the policy */
+		if (qpol_syn_rule_table_find_node_by_key(table, &key)) {
+			WARN(policy, "Ignoring %s: duplicate rule key.", policy->cache_path);
+			qpol_syn_rule_table_destroy(&policy->ext->syn_rule_table);
+			goto out;
+		}
+		/* the table is already large enough, so it never grows */
+		if (!(node = qpol_syn_rule_table_add_node(table, &key))) {
+			error = errno;
+			goto err;
+		}
+		node->rules = rules;
+	}
+	retv = 0;
+
+      out:
+	munmap(data, sb.st_size);
+	return retv;
+
+      err:
+	munmap(data, sb.st_size);
+	ERR(policy, "%s", strerror(error));
+	errno = error;
+	return -1;
+}
+
+/**
+ *  Write the policy's syntactic rule table to its cache file.  The
+ *  file is written under a temporary name and then renamed, so that
+ *  concurrent readers never see a partial file.
+ *  @param policy Policy whose table to save.
+ *  @param num_conds Number of conditionals in the policy.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_syn_rule_cache_save(qpol_policy_t * policy, uint32_t num_conds)
+{
+	qpol_syn_rule_cache_header_t hdr;
+	qpol_syn_rule_cache_node_t cnode;
+	qpol_syn_rule_cache_ptr_t *rule_map = NULL, *cond_map = NULL;
+	qpol_syn_rule_table_t *table = policy->ext->syn_rule_table;
+	qpol_syn_rule_node_t *node = NULL;
+	qpol_syn_rule_list_t *entry = NULL;
+	cond_node_t *cond = NULL;
+	char *tmp_path = NULL;
+	FILE *fp = NULL;
+	size_t i;
+	uint32_t val;
+	int fd = -1, created = 0, error = 0;
+
+	qpol_syn_rule_cache_fill_header(policy, num_conds, &hdr);
+	hdr.num_nodes = table->num_nodes;
+	for (i = 0; i < table->size; i++) {
+		for (entry = table->slots[i].rules; entry; entry = entry->next)
+			hdr.num_refs++;
+	}
+
+	if (!(rule_map = calloc(hdr.num_rules ? hdr.num_rules : 1, sizeof(*rule_map))) ||
+	    !(cond_map = calloc(num_conds ? num_conds : 1, sizeof(*cond_map))) ||
+	    !(tmp_path = malloc(strlen(policy->cache_path) + 8))) {
+		error = errno;
+		goto err;
+	}
+	for (i = 0; i < hdr.num_rules; i++) {
+		rule_map[i].ptr = policy->ext->syn_rule_master_list[i];
+		rule_map[i].val = i;
+	}
+	qsort(rule_map, hdr.num_rules, sizeof(*rule_map), qpol_syn_rule_cache_ptr_comp);
+	for (i = 0, cond = policy->p->p.cond_list; cond && i < num_conds; i++, cond = cond->next) {
+		cond_map[i].ptr = cond;
+		cond_map[i].val = i + 1;
+	}
+	qsort(cond_map, num_conds, sizeof(*cond_map), qpol_syn_rule_cache_ptr_comp);
+
+	sprintf(tmp_path, "%s.XXXXXX", policy->cache_path);
+	if ((fd = mkstemp(tmp_path)) < 0) {
+		error = errno;
+		goto err;
+	}
+	created = 1;
+	if (!(fp = fdopen(fd, "wb"))) {
+		error = errno;
+		goto err;
+	}
+	fd = -1;		       /* now owned by fp */
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+		error = errno;
+		goto err;
+	}
+	for (i = 0; i < table->size; i++) {
+		node = table->slots + i;
+		if (node->rules) {
+			memset(&cnode, 0, sizeof(cnode));
+			cnode.rule_type = node->key.rule_type;
+			cnode.source_val = node->key.source_val;
+			cnode.target_val = node->key.target_val;
+			cnode.class_val = node->key.class_val;
+			if (node->key.cond)
+				cnode.cond = qpol_syn_rule_cache_ptr_find(cond_map, num_conds, node->key.cond);
+			for (entry = node->rules; entry; entry = entry->next)
+				cnode.num_refs++;
+			if (fwrite(&cnode, sizeof(cnode), 1, fp) != 1) {
+				error = errno;
+				goto err;
+			}
+		}
+	}
+	for (i = 0; i < table->size; i++) {
+		node = table->slots + i;
+		if (node->rules) {
+			for (entry = node->rules; entry; entry = entry->next) {
+				val = qpol_syn_rule_cache_ptr_find(rule_map, hdr.num_rules, entry->rule);
+				if (fwrite(&val, sizeof(val), 1, fp) != 1) {
+					error = errno;
+					goto err;
+				}
+			}
+		}
+	}
+	if (fclose(fp)) {
+		fp = NULL;
+		error = errno;
+		goto err;
+	}
+	fp = NULL;
+	if (rename(tmp_path, policy->cache_path)) {
+		error = errno;
+		goto err;
+	}
+
+	free(rule_map);
+	free(cond_map);
+	free(tmp_path);
+	return 0;
+
+      err:
+	if (fp)
+		fclose(fp);
+	if (fd >= 0)
+		close(fd);
+	if (created)
+		unlink(tmp_path);
+	free(rule_map);
+	free(cond_map);
+	free(tmp_path);
+	errno = error;
 	return -1;
 }
 
 int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 {
-	int error = 0, created = 0;
+	int error = 0, created = 0, retv;
 	avrule_block_t *cur_block = NULL;
 	avrule_decl_t *decl = NULL;
 	avrule_t *cur_rule = NULL;
-	cond_node_t *cur_cond = NULL, *remapped_cond;
+	cond_node_t *cur_cond = NULL, *remapped_cond, **conds = NULL;
+	uint32_t num_conds = 0;
+	size_t i;
 
 	if (!policy) {
 		ERR(policy, "%s", strerror(EINVAL));
@@ -903,19 +1380,8 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 
 	if (policy->ext->syn_rule_table)
 		return 0;	       /* already built */
-
-	policy->ext->syn_rule_table = calloc(1, sizeof(qpol_syn_rule_table_t));
-	if (!policy->ext->syn_rule_table) {
-		error = errno;
-		ERR(policy, "%s", strerror(error));
-		goto err;
-	}
-	policy->ext->syn_rule_table->buckets = calloc(QPOL_SYN_RULE_TABLE_SIZE, sizeof(qpol_syn_rule_node_t *));
-	if (!policy->ext->syn_rule_table->buckets) {
-		error = errno;
-		ERR(policy, "%s", strerror(error));
-		goto err;
-	}
+	if (QPOL_POLICY_CHECK_NOT_FROZEN(policy))
+		return -1;
 
 	policy->ext->master_list_sz = 0;
 	for (cur_block = policy->p->p.global; cur_block; cur_block = cur_block->next) {
@@ -938,7 +1404,13 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 
 	if (policy->ext->master_list_sz == 0) {
 		policy->ext->syn_rule_master_list = NULL;
-		return 0;	       /* policy is not a source policy */
+		/* policy is not a source policy; an empty table marks it built */
+		if (!(policy->ext->syn_rule_table = qpol_syn_rule_table_create(0))) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			goto err;
+		}
+		return 0;
 	}
 
 	INFO(policy, "%s", "Building syntactic rules tables.");
@@ -959,7 +1431,7 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 			continue;
 
 		for (cur_rule = decl->avrules; cur_rule; cur_rule = cur_rule->next) {
-			if (qpol_syn_rule_table_insert_sepol_avrule(policy, policy->ext->syn_rule_table, cur_rule, NULL, 0)) {
+			if (qpol_syn_rule_master_list_append(policy, cur_rule, NULL, 0)) {
 				error = errno;
 				goto err;
 			}
@@ -976,15 +1448,13 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 				goto err;
 			}
 			for (cur_rule = cur_cond->avtrue_list; cur_rule; cur_rule = cur_rule->next) {
-				if (qpol_syn_rule_table_insert_sepol_avrule
-				    (policy, policy->ext->syn_rule_table, cur_rule, remapped_cond, 0)) {
+				if (qpol_syn_rule_master_list_append(policy, cur_rule, remapped_cond, 0)) {
 					error = errno;
 					goto err;
 				}
 			}
 			for (cur_rule = cur_cond->avfalse_list; cur_rule; cur_rule = cur_rule->next) {
-				if (qpol_syn_rule_table_insert_sepol_avrule
-				    (policy, policy->ext->syn_rule_table, cur_rule, remapped_cond, 1)) {
+				if (qpol_syn_rule_master_list_append(policy, cur_rule, remapped_cond, 1)) {
 					error = errno;
 					goto err;
 				}
@@ -992,44 +1462,62 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 		}
 	}
 
-#ifdef SETOOLS_DEBUG
-	/*
-	 * Debugging code to measure the how well the syntactic rules
-	 * are being hashed.  Calculate the min, max, and std
-	 * deviation.
-	 */
-	size_t bucket;
-	float o2 = 0.0f;
-	long total_entries = 0;
-	for (bucket = 0; bucket < QPOL_SYN_RULE_TABLE_SIZE; bucket++) {
-		qpol_syn_rule_node_t *n = policy->ext->syn_rule_table->buckets[bucket];
-		while (n != NULL) {
-			total_entries++;
-			n = n->next;
-		}
-	}
-	float expected_value = total_entries * 1.0f / QPOL_SYN_RULE_TABLE_SIZE;
-	size_t min_items = total_entries;
-	size_t max_items = 0;
-	for (bucket = 0; bucket < QPOL_SYN_RULE_TABLE_SIZE; bucket++) {
-		size_t num_items = 0;
-		qpol_syn_rule_node_t *n = policy->ext->syn_rule_table->buckets[bucket];
-		while (n != NULL) {
-			num_items++;
-			n = n->next;
+	if (policy->cache_path) {
+		for (cur_cond = policy->p->p.cond_list; cur_cond; cur_cond = cur_cond->next)
+			num_conds++;
+		if (!(conds = calloc(num_conds ? num_conds : 1, sizeof(cond_node_t *)))) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			goto err;
 		}
-		if (num_items > max_items) {
-			max_items = num_items;
+		for (i = 0, cur_cond = policy->p->p.cond_list; cur_cond; cur_cond = cur_cond->next)
+			conds[i++] = cur_cond;
+		retv = qpol_syn_rule_cache_load(policy, conds, num_conds);
+		free(conds);
+		if (retv < 0) {
+			error = errno;
+			goto err;
 		}
-		if (num_items < min_items) {
-			min_items = num_items;
+		if (retv == 0)
+			return 0;
+	}
+
+	if (!(policy->ext->syn_rule_table = qpol_syn_rule_table_create(policy->ext->master_list_sz * QPOL_SYN_RULE_TABLE_KEYS_PER_RULE))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	for (i = 0; i < policy->ext->master_list_sz; i++) {
+		if (qpol_syn_rule_table_insert_sepol_avrule(policy, policy->ext->syn_rule_table, policy->ext->syn_rule_master_list[i])) {
+			error = errno;
+			goto err;
 		}
-		o2 += (num_items - expected_value) * (num_items - expected_value);
 	}
-	float stddev = sqrtf(o2 / (QPOL_SYN_RULE_TABLE_SIZE - 1));
-	fprintf(stderr, "libqpol synrule table %d bits:  total entries %lu, expected %g\n", QPOL_SYN_RULE_TABLE_BITS, total_entries,
-		expected_value);
-	fprintf(stderr, "                        min %zd, max %zd, stddev %g\n", min_items, max_items, stddev);
+
+	/* the cache only saves time, so failing to write it is not an error */
+	if (policy->cache_path && qpol_syn_rule_cache_save(policy, num_conds))
+		WARN(policy, "Could not write %s: %s", policy->cache_path, strerror(errno));
+
+#ifdef SETOOLS_DEBUG
+	/*
+	 * Debugging code to measure the how well the syntactic rules
+	 * are being hashed.  Calculate the mean and max distance of
+	 * each key from its home slot.
+	 */
+	qpol_syn_rule_table_t *t = policy->ext->syn_rule_table;
+	size_t slot, dist, total_dist = 0, max_dist = 0;
+	for (slot = 0; slot < t->size; slot++) {
+		if (!t->slots[slot].rules)
+			continue;
+		dist = (slot - qpol_syn_rule_key_hash(&t->slots[slot].key)) & (t->size - 1);
+		total_dist += dist;
+		if (dist > max_dist)
+			max_dist = dist;
+	}
+	fprintf(stderr, "libqpol synrule table %zd slots:  total entries %zd, load %g\n", t->size, t->num_nodes,
+		t->num_nodes * 1.0f / t->size);
+	fprintf(stderr, "                        mean probe %g, max probe %zd\n",
+		t->num_nodes ? total_dist * 1.0f / t->num_nodes : 0.0f, max_dist);
 #endif
 
 	return 0;
@@ -1041,6 +1529,460 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 	return -1;
 }
 
+/**
+ *  Get a policy's extended image, allocating an empty one if needed.
+ *  @param policy The policy from which to get the extended image.
+ *  @return The extended image or NULL on failure; if the call fails,
+ *  errno will be set.
+ */
+static qpol_extended_image_t *qpol_policy_get_ext(const qpol_policy_t * policy)
+{
+	/* the extended image only caches data derived from the policy,
+	 * so creating it does not modify the policy itself */
+	qpol_policy_t *p = (qpol_policy_t *) policy;
+	int error = 0;
+
+	if (!p->ext) {
+		p->ext = calloc(1, sizeof(qpol_extended_image_t));
+		if (!p->ext) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			errno = error;
+			return NULL;
+		}
+	}
+
+	return p->ext;
+}
+
+/**
+ *  Free all memory used by an avtab index and set it to NULL.
+ *  @param idx Reference pointer to the index to destroy.
+ */
+static void qpol_avtab_index_destroy(qpol_avtab_index_t ** idx)
+{
+	if (!idx || !(*idx))
+		return;
+
+	free((*idx)->source_start);
+	free((*idx)->by_source);
+	free((*idx)->target_start);
+	free((*idx)->by_target);
+	free((*idx)->by_addr);
+	free(*idx);
+	*idx = NULL;
+}
+
+static int qpol_avtab_index_pos_comp(const void *a, const void *b)
+{
+	const qpol_avtab_index_pos_t *x = a, *y = b;
+
+	if (x->node == y->node)
+		return 0;
+	return (x->node < y->node) ? -1 : 1;
+}
+
+/**
+ *  Count (pass 0) or place (pass 1) the nodes of one avtab into an
+ *  avtab index.  During the placing pass source_start and
+ *  target_start are used as insertion cursors and num_nodes counts
+ *  the nodes placed so far.
+ */
+static void qpol_avtab_index_add_table(qpol_avtab_index_t * idx, const avtab_t * tab, int pass)
+{
+	uint32_t bucket;
+	avtab_ptr_t node;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if (pass == 0) {
+				idx->source_start[node->key.source_type + 1]++;
+				idx->target_start[node->key.target_type + 1]++;
+			} else {
+				idx->by_source[idx->source_start[node->key.source_type]++] = node;
+				idx->by_target[idx->target_start[node->key.target_type]++] = node;
+				idx->by_addr[idx->num_nodes].node = node;
+				idx->by_addr[idx->num_nodes].pos = idx->num_nodes;
+				idx->num_nodes++;
+			}
+		}
+	}
+}
+
+/**
+ *  Build the avtab index for a policy.
+ *  @param policy The policy whose avtabs to index.
+ *  @param idx Reference pointer in which to store the new index.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *idx will be NULL.
+ */
+static int qpol_avtab_index_build(const qpol_policy_t * policy, qpol_avtab_index_t ** idx)
+{
+	policydb_t *db = &policy->p->p;
+	size_t num_nodes, i;
+	int error = 0;
+
+	*idx = NULL;
+	if (!(*idx = calloc(1, sizeof(qpol_avtab_index_t)))) {
+		error = errno;
+		goto err;
+	}
+	(*idx)->num_types = db->p_types.nprim;
+	num_nodes = db->te_avtab.nel + db->te_cond_avtab.nel;
+
+	/* values are 1 based; two extra slots for the end sentinel and
+	 * the shift used while placing */
+	if (!((*idx)->source_start = calloc((*idx)->num_types + 2, sizeof(size_t))) ||
+	    !((*idx)->target_start = calloc((*idx)->num_types + 2, sizeof(size_t))) ||
+	    !((*idx)->by_source = calloc(num_nodes ? num_nodes : 1, sizeof(avtab_ptr_t))) ||
+	    !((*idx)->by_target = calloc(num_nodes ? num_nodes : 1, sizeof(avtab_ptr_t))) ||
+	    !((*idx)->by_addr = calloc(num_nodes ? num_nodes : 1, sizeof(qpol_avtab_index_pos_t)))) {
+		error = errno;
+		goto err;
+	}
+
+	qpol_avtab_index_add_table(*idx, &db->te_avtab, 0);
+	qpol_avtab_index_add_table(*idx, &db->te_cond_avtab, 0);
+	for (i = 1; i < (size_t) (*idx)->num_types + 2; i++) {
+		(*idx)->source_start[i] += (*idx)->source_start[i - 1];
+		(*idx)->target_start[i] += (*idx)->target_start[i - 1];
+	}
+	qpol_avtab_index_add_table(*idx, &db->te_avtab, 1);
+	qpol_avtab_index_add_table(*idx, &db->te_cond_avtab, 1);
+	/* placing advanced each start to the next value's start; shift back */
+	for (i = (*idx)->num_types + 1; i > 0; i--) {
+		(*idx)->source_start[i] = (*idx)->source_start[i - 1];
+		(*idx)->target_start[i] = (*idx)->target_start[i - 1];
+	}
+	(*idx)->source_start[0] = (*idx)->target_start[0] = 0;
+	qsort((*idx)->by_addr, (*idx)->num_nodes, sizeof(qpol_avtab_index_pos_t), qpol_avtab_index_pos_comp);
+
+	return STATUS_SUCCESS;
+
+      err:
+	qpol_avtab_index_destroy(idx);
+	ERR(policy, "%s", strerror(error));
+	errno = error;
+	return STATUS_ERR;
+}
+
+/**
+ *  Free all memory used by a boolean to conditional index and set it
+ *  to NULL.
+ *  @param idx Reference pointer to the index to destroy.
+ */
+static void qpol_bool_cond_index_destroy(qpol_bool_cond_index_t ** idx)
+{
+	if (!idx || !(*idx))
+		return;
+
+	free((*idx)->start);
+	free((*idx)->conds);
+	free(*idx);
+	*idx = NULL;
+}
+
+/**
+ *  Count (pass 0) or place (pass 1) the conditionals using each
+ *  boolean.  During the placing pass start is used as the insertion
+ *  cursor.  A boolean named more than once in an expression is only
+ *  counted once for it.
+ */
+static void qpol_bool_cond_index_add_conds(qpol_bool_cond_index_t * idx, cond_node_t * cond_list, int pass)
+{
+	cond_node_t *cond;
+	cond_expr_t *expr, *prev;
+
+	for (cond = cond_list; cond; cond = cond->next) {
+		for (expr = cond->expr; expr; expr = expr->next) {
+			if (expr->expr_type != COND_BOOL || expr->bool < 1 || expr->bool > idx->num_bools)
+				continue;
+			for (prev = cond->expr; prev != expr; prev = prev->next) {
+				if (prev->expr_type == COND_BOOL && prev->bool == expr->bool)
+					break;
+			}
+			if (prev != expr)
+				continue;
+			if (pass == 0)
+				idx->start[expr->bool + 1]++;
+			else
+				idx->conds[idx->start[expr->bool]++] = cond;
+		}
+	}
+}
+
+/**
+ *  Build the boolean to conditional index for a policy.
+ *  @param policy The policy whose conditionals to index.
+ *  @param idx Reference pointer in which to store the new index.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *idx will be NULL.
+ */
+static int qpol_bool_cond_index_build(const qpol_policy_t * policy, qpol_bool_cond_index_t ** idx)
+{
+	policydb_t *db = &policy->p->p;
+	size_t i;
+	int error = 0;
+
+	*idx = NULL;
+	if (!(*idx = calloc(1, sizeof(qpol_bool_cond_index_t)))) {
+		error = errno;
+		goto err;
+	}
+	(*idx)->num_bools = db->p_bools.nprim;
+	if (!((*idx)->start = calloc((*idx)->num_bools + 2, sizeof(size_t)))) {
+		error = errno;
+		goto err;
+	}
+
+	qpol_bool_cond_index_add_conds(*idx, db->cond_list, 0);
+	for (i = 1; i < (size_t) (*idx)->num_bools + 2; i++)
+		(*idx)->start[i] += (*idx)->start[i - 1];
+	if (!((*idx)->conds = calloc((*idx)->start[(*idx)->num_bools + 1] ? (*idx)->start[(*idx)->num_bools + 1] : 1,
+				     sizeof(cond_node_t *)))) {
+		error = errno;
+		goto err;
+	}
+	qpol_bool_cond_index_add_conds(*idx, db->cond_list, 1);
+	for (i = (*idx)->num_bools + 1; i > 0; i--)
+		(*idx)->start[i] = (*idx)->start[i - 1];
+	(*idx)->start[0] = 0;
+
+	return STATUS_SUCCESS;
+
+      err:
+	qpol_bool_cond_index_destroy(idx);
+	ERR(policy, "%s", strerror(error));
+	errno = error;
+	return STATUS_ERR;
+}
+
+int qpol_policy_get_bool_conds(const qpol_policy_t * policy, uint32_t bool_val, struct cond_node ***list, size_t * num)
+{
+	qpol_extended_image_t *ext = NULL;
+
+	if (list)
+		*list = NULL;
+	if (num)
+		*num = 0;
+
+	if (!policy || !list || !num) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(ext = qpol_policy_get_ext(policy)))
+		return STATUS_ERR;
+	if (!ext->bool_cond_index) {
+		if (qpol_bool_cond_index_build(policy, &ext->bool_cond_index))
+			return STATUS_ERR;
+	}
+
+	if (bool_val < 1 || bool_val > ext->bool_cond_index->num_bools) {
+		ERR(policy, "%s", strerror(ERANGE));
+		errno = ERANGE;
+		return STATUS_ERR;
+	}
+
+	*list = ext->bool_cond_index->conds + ext->bool_cond_index->start[bool_val];
+	*num = ext->bool_cond_index->start[bool_val + 1] - ext->bool_cond_index->start[bool_val];
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ *  Get a policy's avtab index, building it if needed.
+ *  @param policy The policy whose avtab index to get.
+ *  @return The index or NULL on failure; if the call fails,
+ *  errno will be set.
+ */
+static qpol_avtab_index_t *qpol_policy_get_avtab_index_internal(const qpol_policy_t * policy)
+{
+	qpol_extended_image_t *ext = NULL;
+
+	if (!(ext = qpol_policy_get_ext(policy)))
+		return NULL;
+
+	if (!ext->avtab_index) {
+		INFO(policy, "%s", "Building av table index.");
+		if (qpol_avtab_index_build(policy, &ext->avtab_index))
+			return NULL;
+	}
+
+	return ext->avtab_index;
+}
+
+int qpol_policy_get_avtab_index(const qpol_policy_t * policy, int by_target, uint32_t type_val, struct avtab_node ***list,
+				size_t * num)
+{
+	qpol_avtab_index_t *idx = NULL;
+
+	if (list)
+		*list = NULL;
+	if (num)
+		*num = 0;
+
+	if (!policy || !list || !num) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(idx = qpol_policy_get_avtab_index_internal(policy)))
+		return STATUS_ERR;
+
+	if (type_val == 0 || type_val > idx->num_types)
+		return STATUS_SUCCESS;
+
+	if (by_target) {
+		*list = idx->by_target + idx->target_start[type_val];
+		*num = idx->target_start[type_val + 1] - idx->target_start[type_val];
+	} else {
+		*list = idx->by_source + idx->source_start[type_val];
+		*num = idx->source_start[type_val + 1] - idx->source_start[type_val];
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_get_avtab_node_pos(const qpol_policy_t * policy, const struct avtab_node *node, size_t * pos)
+{
+	qpol_avtab_index_t *idx = NULL;
+	qpol_avtab_index_pos_t key, *found;
+
+	if (pos)
+		*pos = 0;
+
+	if (!policy || !node || !pos) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(idx = qpol_policy_get_avtab_index_internal(policy)))
+		return STATUS_ERR;
+
+	key.node = (avtab_ptr_t) node;
+	if (!(found = bsearch(&key, idx->by_addr, idx->num_nodes, sizeof(*idx->by_addr), qpol_avtab_index_pos_comp))) {
+		ERR(policy, "%s", strerror(ENOENT));
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+	*pos = found->pos;
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ *  Determine if a type value is the queried type or one of the
+ *  attributes containing it.
+ *  @param type The queried type.
+ *  @param type_val Value of the queried type.
+ *  @param val Value to check.
+ *  @return Non-zero if val is type_val or an attribute of the type.
+ */
+static int qpol_avtab_index_type_has_val(const type_datum_t * type, uint32_t type_val, uint32_t val)
+{
+	if (val == type_val)
+		return 1;
+	/* after policy_extend() a type's types bitmap holds its attributes */
+	return type->flavor == TYPE_TYPE && ebitmap_get_bit(&type->types, val - 1);
+}
+
+/**
+ *  Count (if list is NULL) or copy the nodes of an avtab index that
+ *  name a given value on either side and apply to a queried type.
+ *  A node naming the queried type or its attributes on both sides is
+ *  only taken from the source list so that it is not returned twice.
+ *  @return The number of nodes counted or copied.
+ */
+static size_t qpol_avtab_index_collect(const qpol_avtab_index_t * idx, const type_datum_t * type, uint32_t type_val,
+				       uint32_t val, uint32_t rule_type_mask, avtab_ptr_t * list)
+{
+	size_t i, n = 0;
+	avtab_ptr_t node;
+
+	if (val == 0 || val > idx->num_types)
+		return 0;
+
+	for (i = idx->source_start[val]; i < idx->source_start[val + 1]; i++) {
+		node = idx->by_source[i];
+		if (!(node->key.specified & rule_type_mask))
+			continue;
+		if (list)
+			list[n] = node;
+		n++;
+	}
+	for (i = idx->target_start[val]; i < idx->target_start[val + 1]; i++) {
+		node = idx->by_target[i];
+		if (!(node->key.specified & rule_type_mask) ||
+		    qpol_avtab_index_type_has_val(type, type_val, node->key.source_type))
+			continue;
+		if (list)
+			list[n] = node;
+		n++;
+	}
+
+	return n;
+}
+
+int qpol_policy_get_avtab_nodes_by_type(const qpol_policy_t * policy, uint32_t type_val, uint32_t rule_type_mask,
+					struct avtab_node ***list, size_t * num)
+{
+	qpol_avtab_index_t *idx = NULL;
+	policydb_t *db = NULL;
+	type_datum_t *type = NULL;
+	ebitmap_node_t *node = NULL;
+	uint32_t bit = 0;
+	size_t total = 0;
+	int pass, error;
+
+	if (list)
+		*list = NULL;
+	if (num)
+		*num = 0;
+
+	if (!policy || !list || !num) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(idx = qpol_policy_get_avtab_index_internal(policy)))
+		return STATUS_ERR;
+
+	db = &policy->p->p;
+	if (type_val == 0 || type_val > idx->num_types || !(type = db->type_val_to_struct[type_val - 1]))
+		return STATUS_SUCCESS;
+
+	/* the first pass sizes the list, the second fills it */
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			if (total == 0)
+				break;
+			if (!(*list = malloc(total * sizeof(avtab_ptr_t)))) {
+				error = errno;
+				ERR(policy, "%s", strerror(error));
+				errno = error;
+				return STATUS_ERR;
+			}
+		}
+		total = qpol_avtab_index_collect(idx, type, type_val, type_val, rule_type_mask, *list);
+		if (type->flavor != TYPE_TYPE)
+			continue;
+		ebitmap_for_each_bit(&type->types, node, bit) {
+			if (!ebitmap_node_get_bit(node, bit) || bit + 1 == type_val)
+				continue;
+			total += qpol_avtab_index_collect(idx, type, type_val, bit + 1, rule_type_mask,
+							  *list ? *list + total : NULL);
+		}
+	}
+	*num = total;
+
+	return STATUS_SUCCESS;
+}
+
 /**
  *  Free all memory used by a qpol extended image and set it to NULL.
  *  @param ext The extended image to destroy.
@@ -1059,6 +2001,9 @@ void qpol_extended_image_destroy(qpol_extended_image_t ** ext)
 	}
 	free((*ext)->syn_rule_master_list);
 
+	qpol_avtab_index_destroy(&((*ext)->avtab_index));
+	qpol_bool_cond_index_destroy(&((*ext)->bool_cond_index));
+
 	free(*ext);
 	*ext = NULL;
 }
@@ -1120,6 +2065,12 @@ int policy_extend(qpol_policy_t * policy)
 		goto err;
 	}
 
+	/* build the rule index now so that lookups never pay for it */
+	if (!qpol_policy_get_avtab_index_internal(policy)) {
+		error = errno;
+		goto err;
+	}
+
 	return STATUS_SUCCESS;
 
       err:
@@ -1129,6 +2080,33 @@ int policy_extend(qpol_policy_t * policy)
 	return STATUS_ERR;
 }
 
+int policy_extend_complete(qpol_policy_t * policy)
+{
+	struct cond_node **conds;
+	size_t num_conds;
+
+	if (policy == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!qpol_policy_get_ext(policy))
+		return STATUS_ERR;
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED))
+		return STATUS_SUCCESS;
+
+	if (!qpol_policy_get_avtab_index_internal(policy))
+		return STATUS_ERR;
+	/* looking up any boolean builds the whole index */
+	if (policy->p->p.p_bools.nprim > 0 && qpol_policy_get_bool_conds(policy, 1, &conds, &num_conds))
+		return STATUS_ERR;
+	if (qpol_policy_has_capability(policy, QPOL_CAP_SYN_RULES) && qpol_policy_build_syn_rule_table(policy))
+		return STATUS_ERR;
+
+	return STATUS_SUCCESS;
+}
+
 typedef struct syn_rule_state
 {
 	qpol_syn_rule_node_t *node;
@@ -71,11 +71,19 @@ extern "C"
 		char *file_data;
 		size_t file_data_sz;
 		int file_data_type;
+		/** path of the syntactic rule table cache, or NULL if not caching */
+		char *cache_path;
+		/** non-zero once qpol_policy_freeze() has been called */
+		int frozen;
+		/** number of successful rebuilds; see qpol_policy_get_generation() */
+		unsigned int generation;
 	};
 /* qpol_policy_t.file_data_type will be one of the following to denote
  * the proper method of destroying the data:
  * _BIN if policy is from a binary source (modular or kernel) destroy is a no-op
- * _MMAP if policy is from a file and destroy should call munmap
+ * _MMAP if policy is from a file and destroy should call munmap;
+ *       binary policies and module packages are also kept mapped so
+ *       that rebuild() need not read the file again
  * _MEM if policy is from open_from_memory and destroy should call free */
 #define QPOL_POLICY_FILE_DATA_TYPE_BIN  0
 #define QPOL_POLICY_FILE_DATA_TYPE_MMAP 1
@@ -93,6 +101,107 @@ extern "C"
  */
 	int policy_extend(qpol_policy_t * policy);
 
+/**
+ *  Build all of the extended policy data that would otherwise be built
+ *  on first use, so that later lookups never modify the policy.
+ *  @param policy The policy whose extended data to build.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+	int policy_extend_complete(qpol_policy_t * policy);
+
+	struct avtab_node;
+	struct cond_node;
+/**
+ *  Get the position of an avtab node in table order, that is the
+ *  order in which an iterator over the unconditional and then the
+ *  conditional table returns it.  Uses the index of
+ *  qpol_policy_get_avtab_index().
+ *  @param policy The policy containing the node.
+ *  @param node The node to find.
+ *  @param pos Pointer in which to store the position.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *pos will be 0.
+ */
+	int qpol_policy_get_avtab_node_pos(const qpol_policy_t * policy, const struct avtab_node *node, size_t * pos);
+
+/**
+ *  Get the avtab nodes, from both the unconditional and conditional
+ *  tables, whose key names a given source or target type value.  The
+ *  index is built on first use and lives in the extended image, so it
+ *  is discarded whenever the policy is rebuilt.
+ *  @param policy The policy whose rules to look up.
+ *  @param by_target If non-zero look up by target type, else by source.
+ *  @param type_val Type value to find.
+ *  @param list Pointer in which to store the first matching node.
+ *  The caller must not free this array.
+ *  @param num Pointer in which to store the number of matching nodes.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set, *list will be NULL and *num will be 0.
+ */
+	int qpol_policy_get_avtab_index(const qpol_policy_t * policy, int by_target, uint32_t type_val, struct avtab_node ***list,
+					size_t * num);
+
+/**
+ *  Get the avtab nodes, from both the unconditional and conditional
+ *  tables, that apply to a type: those whose source or target is the
+ *  type itself or an attribute containing it.  Each node is returned
+ *  once, even if both its source and target apply.  The lists of the
+ *  type and of each of its attributes are taken from the avtab index,
+ *  so the cost is proportional to the number of nodes returned.
+ *  @param policy The policy whose rules to look up.
+ *  @param type_val Value of the type (or attribute) to find.  An
+ *  attribute only matches the nodes that name it directly.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  @param list Pointer in which to store a newly allocated array of
+ *  the matching nodes.  The caller must free() this array.
+ *  @param num Pointer in which to store the number of matching nodes.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set, *list will be NULL and *num will be 0.
+ */
+	int qpol_policy_get_avtab_nodes_by_type(const qpol_policy_t * policy, uint32_t type_val, uint32_t rule_type_mask,
+						struct avtab_node ***list, size_t * num);
+
+/**
+ *  Get the conditionals whose expressions use a boolean.  The index
+ *  is built on first use and discarded whenever the policy is
+ *  rebuilt.
+ *  @param policy The policy whose conditionals to look up.
+ *  @param bool_val Value of the boolean to find.
+ *  @param list Pointer in which to store the first conditional.
+ *  The caller must not free this array.
+ *  @param num Pointer in which to store the number of conditionals.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set, *list will be NULL and *num will be 0.
+ */
+	int qpol_policy_get_bool_conds(const qpol_policy_t * policy, uint32_t bool_val, struct cond_node ***list, size_t * num);
+
+/**
+ *  Create modules from a list of module package files, decoding the
+ *  packages concurrently.  The modules are stored in the same order
+ *  as the paths, regardless of the order in which they were read.
+ *  @param paths Array of paths of module packages.
+ *  @param num_paths Number of paths in the array.
+ *  @param num_threads Maximum number of threads to use, including the
+ *  calling thread; if 0, use one per online processor.
+ *  @param modules Array of num_paths entries in which to store the
+ *  new modules.  The caller must destroy each module.
+ *  @param failed If non-NULL, reference in which to store the index
+ *  of the first path that could not be read.
+ *  @return 0 on success and < 0 on failure; if the call fails, errno
+ *  will be set to the error of the first failing path and every
+ *  entry of modules will be NULL.
+ */
+	int qpol_module_create_from_files(const char *const *paths, size_t num_paths, size_t num_threads, qpol_module_t ** modules,
+					  size_t * failed);
+
+/**
+ *  Fail a modifying operation on a frozen policy.  Evaluates to
+ *  non-zero, with errno set to EPERM, if the policy is frozen.
+ */
+#define QPOL_POLICY_CHECK_NOT_FROZEN(policy) \
+	((policy)->frozen ? (ERR((policy), "%s", "The policy is frozen and cannot be modified."), errno = EPERM, 1) : 0)
+
 	extern void qpol_handle_msg(const qpol_policy_t * policy, int level, const char *fmt, ...);
 	int qpol_is_file_binpol(FILE * fp);
 	int qpol_is_file_mod_pkg(FILE * fp);
@@ -111,6 +220,29 @@ extern "C"
  */
 	int qpol_is_data_mod_pkg(char * data);
 
+/**
+ * Returns true if the buffer holds a binary (kernel) policy.
+ * @param data Buffer to check.
+ * @param size Number of bytes in the buffer.
+ * @return Returns 1 for binary policies, 0 otherwise.
+ */
+	int qpol_is_data_binpol(const char *data, size_t size);
+
+/**
+ *  Create a qpol module from an uncompressed policy package already
+ *  in memory, such as a mapped file.  The buffer is only read during
+ *  this call; the caller retains ownership of it.
+ *  @param path The file from which the data was read. This string
+ *  will be duplicated.
+ *  @param data Buffer containing the policy package.
+ *  @param size Number of bytes in the buffer.
+ *  @param module Pointer in which to store the newly allocated
+ *  module.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *module will be NULL.
+ */
+	int qpol_module_create_from_data(const char *path, char *data, size_t size, qpol_module_t ** module);
+
 #define ERR(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_ERR, format, __VA_ARGS__)
 #define WARN(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_WARN, format, __VA_ARGS__)
 #define INFO(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_INFO, format, __VA_ARGS__)
@@ -435,7 +435,8 @@ int qpol_syn_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_syn_a
 {
 	avrule_t *internal_rule = NULL;
 	policydb_t *db = NULL;
-	char **perm_list, *tmp = NULL, **tmp_copy = NULL;
+	char **perm_list, **tmp_copy = NULL;
+	const char *tmp = NULL;
 	class_perm_node_t *node = NULL;
 	size_t node_num = 0, i, cur, perm_list_sz = 0;
 	int error = 0;
@@ -468,9 +469,8 @@ int qpol_syn_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_syn_a
 		for (i = 0; i < db->class_val_to_struct[node->class - 1]->permissions.nprim; i++) {
 			if (!(node->data & (1 << i)))
 				continue;
-			tmp = sepol_av_to_string(db, node->class, (sepol_access_vector_t) (1 << i));
+			tmp = qpol_perm_val_to_name(db, node->class, i + 1);
 			if (tmp) {
-				tmp++; /* remove prepended space */
 				for (cur = 0; cur < perm_list_sz; cur++)
 					if (!strcmp(tmp, perm_list[cur]))
 						break;
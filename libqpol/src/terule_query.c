@@ -33,7 +33,8 @@
 #include <stdlib.h>
 #include "qpol_internal.h"
 
-int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+int qpol_policy_get_terule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+				     qpol_iterator_t ** iter)
 {
 	policydb_t *db;
 	avtab_state_t *state;
@@ -41,7 +42,7 @@ int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	if (iter) {
 		*iter = NULL;
 	}
-	if (policy == NULL || iter == NULL) {
+	if (policy == NULL || iter == NULL || part >= num_parts) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
 		return STATUS_ERR;
@@ -63,10 +64,7 @@ int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type
 		errno = ENOMEM;
 		return STATUS_ERR;
 	}
-	state->ucond_tab = &db->te_avtab;
-	state->cond_tab = &db->te_cond_avtab;
-	state->rule_type_mask = rule_type_mask;
-	state->node = db->te_avtab.htable[0];
+	avtab_state_init(state, &db->te_avtab, &db->te_cond_avtab, rule_type_mask, part, num_parts);
 
 	if (qpol_iterator_create
 	    (policy, state, avtab_state_get_cur, avtab_state_next, avtab_state_end, avtab_state_size, free, iter)) {
@@ -79,6 +77,121 @@ int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+{
+	return qpol_policy_get_terule_iter_part(policy, rule_type_mask, 0, 1, iter);
+}
+
+/**
+ *  Common implementation of qpol_policy_get_terule_iter_by_source()
+ *  and qpol_policy_get_terule_iter_by_target().
+ */
+static int terule_iter_by_type(const qpol_policy_t * policy, uint32_t rule_type_mask, int by_target, const qpol_type_t * type,
+			       qpol_iterator_t ** iter)
+{
+	avtab_ptr_t *list = NULL;
+	size_t num = 0;
+	uint32_t type_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
+	if (qpol_type_get_value(policy, type, &type_val) ||
+	    qpol_policy_get_avtab_index(policy, by_target, type_val, &list, &num)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER);
+	return qpol_avtab_list_iter_create(policy, list, num, rule_type_mask, 0, iter);
+}
+
+int qpol_policy_get_terule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+					  qpol_iterator_t ** iter)
+{
+	return terule_iter_by_type(policy, rule_type_mask, 0, source, iter);
+}
+
+int qpol_policy_get_terule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * target,
+					  qpol_iterator_t ** iter)
+{
+	return terule_iter_by_type(policy, rule_type_mask, 1, target, iter);
+}
+
+int qpol_policy_get_terule_iter_by_type(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * type,
+					qpol_iterator_t ** iter)
+{
+	avtab_ptr_t *list = NULL;
+	size_t num = 0;
+	uint32_t type_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
+	if (qpol_type_get_value(policy, type, &type_val)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER);
+	if (qpol_policy_get_avtab_nodes_by_type(policy, type_val, rule_type_mask, &list, &num)) {
+		return STATUS_ERR;
+	}
+
+	return qpol_avtab_list_iter_create(policy, list, num, rule_type_mask, 1, iter);
+}
+
+int qpol_policy_get_terule_iter_by_key(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+				       const qpol_type_t * target, const qpol_class_t * obj_class, qpol_iterator_t ** iter)
+{
+	uint32_t source_val, target_val, class_val;
+
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || source == NULL || target == NULL || obj_class == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
+	if (qpol_type_get_value(policy, source, &source_val) ||
+	    qpol_type_get_value(policy, target, &target_val) || qpol_class_get_value(policy, obj_class, &class_val)) {
+		return STATUS_ERR;
+	}
+
+	rule_type_mask &= (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER);
+	return qpol_avtab_key_iter_create(policy, rule_type_mask, source_val, target_val, class_val, iter);
+}
+
 int qpol_terule_get_source_type(const qpol_policy_t * policy, const qpol_terule_t * rule, const qpol_type_t ** source)
 {
 	policydb_t *db = NULL;
@@ -262,3 +375,18 @@ int qpol_terule_get_which_list(const qpol_policy_t * policy, const qpol_terule_t
 
 	return STATUS_SUCCESS;
 }
+
+int qpol_terule_get_position(const qpol_policy_t * policy, const qpol_terule_t * rule, size_t * pos)
+{
+	if (pos) {
+		*pos = 0;
+	}
+
+	if (!policy || !rule || !pos) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	return qpol_policy_get_avtab_node_pos(policy, (const struct avtab_node *)rule, pos);
+}
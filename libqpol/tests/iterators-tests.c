@@ -65,9 +65,71 @@ static void iterators_alias(void)
 	qpol_iterator_destroy(&iter);
 }
 
+#define BATCH_SIZE 7
+
+/* check that batches from one iterator match stepping through another over the same list */
+static void iterators_compare_batch(qpol_iterator_t * single, qpol_iterator_t * batch)
+{
+	void *items[BATCH_SIZE], *v;
+	size_t n, i;
+
+	do {
+		CU_ASSERT_FATAL(qpol_iterator_next_batch(batch, items, BATCH_SIZE, &n) == 0);
+		for (i = 0; i < n; i++) {
+			CU_ASSERT_FATAL(!qpol_iterator_end(single));
+			CU_ASSERT_FATAL(qpol_iterator_get_item(single, &v) == 0);
+			CU_ASSERT(v == items[i]);
+			qpol_iterator_next(single);
+		}
+	} while (n == BATCH_SIZE);
+	CU_ASSERT(qpol_iterator_end(single));
+	CU_ASSERT(qpol_iterator_end(batch));
+}
+
+static void iterators_batch(void)
+{
+	qpol_iterator_t *iter = NULL, *single = NULL, *batch = NULL;
+	void *v;
+
+	/* hash table */
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &single) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &batch) == 0);
+	iterators_compare_batch(single, batch);
+	qpol_iterator_destroy(&single);
+	qpol_iterator_destroy(&batch);
+
+	/* ocontext list */
+	CU_ASSERT_FATAL(qpol_policy_get_isid_iter(qp, &single) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_isid_iter(qp, &batch) == 0);
+	iterators_compare_batch(single, batch);
+	qpol_iterator_destroy(&single);
+	qpol_iterator_destroy(&batch);
+
+	/* bitmaps and iterators without a batch implementation */
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		unsigned char isattr = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_isattr(qp, (qpol_type_t *) v, &isattr) == 0);
+		if (isattr) {
+			CU_ASSERT_FATAL(qpol_type_get_type_iter(qp, (qpol_type_t *) v, &single) == 0);
+			CU_ASSERT_FATAL(qpol_type_get_type_iter(qp, (qpol_type_t *) v, &batch) == 0);
+		} else {
+			CU_ASSERT_FATAL(qpol_type_get_alias_iter(qp, (qpol_type_t *) v, &single) == 0);
+			CU_ASSERT_FATAL(qpol_type_get_alias_iter(qp, (qpol_type_t *) v, &batch) == 0);
+		}
+		iterators_compare_batch(single, batch);
+		qpol_iterator_destroy(&single);
+		qpol_iterator_destroy(&batch);
+	}
+	qpol_iterator_destroy(&iter);
+}
+
 CU_TestInfo iterators_tests[] = {
 	{"alias iterator", iterators_alias}
 	,
+	{"batch iterator", iterators_batch}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -27,12 +27,22 @@
 
 #include <CUnit/CUnit.h>
 #include <qpol/policy.h>
+#include <qpol/policy_extend.h>
 #include "../src/qpol_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #define BROKEN_ALIAS_POLICY TEST_POLICIES "/setools-3.3/policy-features/broken-alias-mod.21"
 #define NOT_BROKEN_ALIAS_POLICY TEST_POLICIES "/setools-3.3/policy-features/not-broken-alias-mod.21"
 #define NOGENFS_POLICY TEST_POLICIES "/setools-3.3/policy-features/nogenfscon-policy.21"
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+#define BASE_MODULE_6 TEST_POLICIES "/policy-versions/base-6.pp"
+#define BASE_MODULE_8 TEST_POLICIES "/policy-versions/base-8.pp"
 
 static void policy_features_alias_count(void *varg, const qpol_policy_t * policy
 					__attribute__ ((unused)), int level, const char *fmt, va_list va_args)
@@ -126,11 +136,509 @@ static void policy_features_nogenfscon_iter(void)
 	qpol_policy_destroy(&qp);
 }
 
+/** Test that the indexed av rule lookups return exactly the rules
+ *  found by scanning the whole table. */
+static void policy_features_avrule_index(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *type_iter = NULL, *key_iter = NULL;
+	const uint32_t mask = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+	size_t num_scanned = 0, num_indexed = 0, num_by_target = 0, sz;
+	void *v;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, mask, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &num_scanned) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		const qpol_type_t *source, *target;
+		const qpol_class_t *obj_class;
+		int found = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_source_type(qp, v, &source) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_target_type(qp, v, &target) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_object_class(qp, v, &obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_key(qp, mask, source, target, obj_class, &key_iter) == 0);
+		for (; !qpol_iterator_end(key_iter); qpol_iterator_next(key_iter)) {
+			void *kv;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(key_iter, &kv) == 0);
+			if (kv == v)
+				found = 1;
+		}
+		CU_ASSERT(found);
+		qpol_iterator_destroy(&key_iter);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &type_iter) == 0);
+	for (; !qpol_iterator_end(type_iter); qpol_iterator_next(type_iter)) {
+		const qpol_type_t *rule_type;
+		unsigned char isalias = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(type_iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_isalias(qp, (qpol_type_t *) v, &isalias) == 0);
+		if (isalias)
+			continue;
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_source(qp, mask, (qpol_type_t *) v, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			void *rv;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rv) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_source_type(qp, rv, &rule_type) == 0);
+			CU_ASSERT(rule_type == v);
+			num_indexed++;
+			sz--;
+		}
+		CU_ASSERT(sz == 0);
+		qpol_iterator_destroy(&iter);
+
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_target(qp, mask, (qpol_type_t *) v, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+		num_by_target += sz;
+		qpol_iterator_destroy(&iter);
+	}
+	qpol_iterator_destroy(&type_iter);
+
+	CU_ASSERT(num_indexed == num_scanned);
+	CU_ASSERT(num_by_target == num_scanned);
+	qpol_policy_destroy(&qp);
+}
+
+/* does rule_type name type, or an attribute containing it? */
+static int policy_features_type_applies(qpol_policy_t * qp, const qpol_type_t * rule_type, const qpol_type_t * type)
+{
+	qpol_iterator_t *iter = NULL;
+	unsigned char isattr = 0;
+	void *v;
+	int applies = 0;
+
+	if (rule_type == type)
+		return 1;
+	CU_ASSERT_FATAL(qpol_type_get_isattr(qp, rule_type, &isattr) == 0);
+	if (!isattr)
+		return 0;
+	CU_ASSERT_FATAL(qpol_type_get_type_iter(qp, rule_type, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		if (v == type)
+			applies = 1;
+	}
+	qpol_iterator_destroy(&iter);
+	return applies;
+}
+
+static void policy_features_avrule_type_index(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *type_iter = NULL;
+	const uint32_t mask = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+	const qpol_type_t *source, *target;
+	size_t num_scanned, num_indexed;
+	void *v, *rv;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &type_iter) == 0);
+	for (; !qpol_iterator_end(type_iter); qpol_iterator_next(type_iter)) {
+		unsigned char isalias = 0, isattr = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(type_iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_isalias(qp, (qpol_type_t *) v, &isalias) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_isattr(qp, (qpol_type_t *) v, &isattr) == 0);
+		if (isalias || isattr)
+			continue;
+
+		num_scanned = num_indexed = 0;
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, mask, &iter) == 0);
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rv) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_source_type(qp, rv, &source) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_target_type(qp, rv, &target) == 0);
+			if (policy_features_type_applies(qp, source, v) || policy_features_type_applies(qp, target, v))
+				num_scanned++;
+		}
+		qpol_iterator_destroy(&iter);
+
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_type(qp, mask, (qpol_type_t *) v, &iter) == 0);
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rv) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_source_type(qp, rv, &source) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_target_type(qp, rv, &target) == 0);
+			CU_ASSERT(policy_features_type_applies(qp, source, v) || policy_features_type_applies(qp, target, v));
+			num_indexed++;
+		}
+		qpol_iterator_destroy(&iter);
+		CU_ASSERT(num_indexed == num_scanned);
+	}
+	qpol_iterator_destroy(&type_iter);
+	qpol_policy_destroy(&qp);
+}
+
+static void policy_features_avrule_perm_mask(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
+	const qpol_class_t *obj_class;
+	uint32_t class_val, value, rule_mask, name_mask, perm_mask;
+	const char *bogus = "no_such_permission";
+	void *v;
+	char *perm;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_perm_mask(qp, v, &class_val, &rule_mask) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_object_class(qp, v, &obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_class_get_value(qp, obj_class, &value) == 0);
+		CU_ASSERT(class_val == value);
+
+		/* the permission names must compile back into the same mask */
+		name_mask = 0;
+		CU_ASSERT_FATAL(qpol_avrule_get_perm_iter(qp, v, &perm_iter) == 0);
+		for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(perm_iter, (void **)&perm) == 0);
+			CU_ASSERT(qpol_class_get_perm_mask(qp, obj_class, (const char **)&perm, 1, &perm_mask) == 1);
+			CU_ASSERT(perm_mask != 0 && (perm_mask & rule_mask) == perm_mask);
+			name_mask |= perm_mask;
+			free(perm);
+		}
+		qpol_iterator_destroy(&perm_iter);
+		CU_ASSERT(name_mask == rule_mask);
+
+		CU_ASSERT(qpol_class_get_perm_mask(qp, obj_class, &bogus, 1, &perm_mask) == 0);
+		CU_ASSERT(perm_mask == 0);
+	}
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+}
+
+/* open a source policy with the syn rule cache and count its syntactic av rules */
+static size_t policy_features_count_syn_avrules(const char *path)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	size_t total = 0, sz;
+	void *v;
+
+	int policy_type = qpol_policy_open_from_file(path, &qp, NULL, NULL, QPOL_POLICY_OPTION_CACHE_SYN_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+	CU_ASSERT_FATAL(qpol_policy_build_syn_rule_table(qp) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(qp, v, &syn_iter) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(syn_iter, &sz) == 0);
+		CU_ASSERT(sz > 0);
+		total += sz;
+		qpol_iterator_destroy(&syn_iter);
+	}
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+	return total;
+}
+
+/* offsets within a cache file as written by policy_extend.c: a 64 byte
+ * header ending in num_nodes and num_refs, then 24 byte nodes whose
+ * first five fields form the rule key */
+#define CACHE_NUM_NODES_OFFSET 56
+#define CACHE_NODE_OFFSET(i) (64 + (i) * 24)
+#define CACHE_NODE_KEY_SIZE 20
+
+/* overwrite part of a cache file */
+static void policy_features_cache_write(const char *cache_path, off_t offset, const void *data, size_t size)
+{
+	int fd = open(cache_path, O_WRONLY);
+	CU_ASSERT_FATAL(fd >= 0);
+	CU_ASSERT_FATAL(pwrite(fd, data, size, offset) == (ssize_t) size);
+	close(fd);
+}
+
+static void policy_features_syn_rule_cache(void)
+{
+	char path[] = "/tmp/qpol-cache-test-XXXXXX";
+	char cache_path[sizeof(path) + sizeof(".qpolcache")];
+	FILE *in = NULL, *out = NULL;
+	char buf[4096];
+	size_t len, built, cached;
+	uint32_t bad_val = UINT32_MAX, num_nodes, key[CACHE_NODE_KEY_SIZE / sizeof(uint32_t)];
+	int fd;
+
+	/* work on a copy so that the cache is not written next to the test policies */
+	fd = mkstemp(path);
+	CU_ASSERT_FATAL(fd >= 0);
+	CU_ASSERT_FATAL((out = fdopen(fd, "w")) != NULL);
+	CU_ASSERT_FATAL((in = fopen(SOURCE_POLICY, "r")) != NULL);
+	while ((len = fread(buf, 1, sizeof(buf), in)) > 0)
+		CU_ASSERT_FATAL(fwrite(buf, 1, len, out) == len);
+	fclose(in);
+	fclose(out);
+	snprintf(cache_path, sizeof(cache_path), "%s.qpolcache", path);
+
+	built = policy_features_count_syn_avrules(path);
+	CU_ASSERT(access(cache_path, R_OK) == 0);
+	cached = policy_features_count_syn_avrules(path);
+	CU_ASSERT(built > 0);
+	CU_ASSERT(cached == built);
+
+	/* a key naming a type that does not exist makes the file be ignored
+	 * and rewritten */
+	policy_features_cache_write(cache_path, CACHE_NODE_OFFSET(0) + 4, &bad_val, sizeof(bad_val));
+	CU_ASSERT(policy_features_count_syn_avrules(path) == built);
+	cached = policy_features_count_syn_avrules(path);
+	CU_ASSERT(cached == built);
+
+	/* as does a key given twice */
+	fd = open(cache_path, O_RDONLY);
+	CU_ASSERT_FATAL(fd >= 0);
+	CU_ASSERT_FATAL(pread(fd, &num_nodes, sizeof(num_nodes), CACHE_NUM_NODES_OFFSET) == sizeof(num_nodes));
+	CU_ASSERT_FATAL(pread(fd, key, sizeof(key), CACHE_NODE_OFFSET(0)) == sizeof(key));
+	close(fd);
+	CU_ASSERT_FATAL(num_nodes > 1);
+	policy_features_cache_write(cache_path, CACHE_NODE_OFFSET(1), key, sizeof(key));
+	CU_ASSERT(policy_features_count_syn_avrules(path) == built);
+	cached = policy_features_count_syn_avrules(path);
+	CU_ASSERT(cached == built);
+
+	unlink(cache_path);
+	unlink(path);
+}
+
+#define NUM_BOOLS_TOGGLED 8
+
+/* record the enabled state of every av and te rule, in iteration order */
+static size_t policy_features_rule_states(qpol_policy_t * qp, uint32_t ** states)
+{
+	qpol_iterator_t *iter = NULL;
+	size_t num = 0, sz;
+	void *v;
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+	*states = realloc(*states, (sz + 1) * sizeof(uint32_t));
+	CU_ASSERT_FATAL(*states != NULL);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_is_enabled(qp, v, &(*states)[num++]) == 0);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_terule_iter(qp, QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+	*states = realloc(*states, (num + sz + 1) * sizeof(uint32_t));
+	CU_ASSERT_FATAL(*states != NULL);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_terule_get_is_enabled(qp, v, &(*states)[num++]) == 0);
+	}
+	qpol_iterator_destroy(&iter);
+	return num;
+}
+
+static size_t policy_features_count_diffs(const uint32_t * a, const uint32_t * b, size_t num)
+{
+	size_t i, diffs = 0;
+	for (i = 0; i < num; i++) {
+		if (!a[i] != !b[i])
+			diffs++;
+	}
+	return diffs;
+}
+
+static void policy_features_bool_incremental(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *bool_iter = NULL, *av = NULL, *te = NULL;
+	uint32_t *orig = NULL, *incr = NULL, *full = NULL;
+	size_t num, num_av, num_te, i = 0;
+	int state;
+	void *v;
+
+	int policy_type = qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_NEVERALLOWS);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &bool_iter) == 0);
+	for (; !qpol_iterator_end(bool_iter) && i < NUM_BOOLS_TOGGLED; qpol_iterator_next(bool_iter), i++) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(bool_iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_bool_get_state(qp, v, &state) == 0);
+		num = policy_features_rule_states(qp, &orig);
+
+		/* each reported rule must have changed, and nothing else */
+		CU_ASSERT_FATAL(qpol_bool_set_state_incremental(qp, v, !state, &av, &te) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(av, &num_av) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(te, &num_te) == 0);
+		CU_ASSERT(policy_features_rule_states(qp, &incr) == num);
+		CU_ASSERT(policy_features_count_diffs(orig, incr, num) == num_av + num_te);
+		qpol_iterator_destroy(&av);
+		qpol_iterator_destroy(&te);
+
+		/* a full re-evaluation must agree */
+		CU_ASSERT_FATAL(qpol_policy_reevaluate_conds(qp) == 0);
+		CU_ASSERT(policy_features_rule_states(qp, &full) == num);
+		CU_ASSERT(policy_features_count_diffs(incr, full, num) == 0);
+
+		/* and toggling back restores the original states */
+		CU_ASSERT_FATAL(qpol_bool_set_state_incremental(qp, v, state, NULL, NULL) == 0);
+		CU_ASSERT(policy_features_rule_states(qp, &incr) == num);
+		CU_ASSERT(policy_features_count_diffs(orig, incr, num) == 0);
+	}
+	qpol_iterator_destroy(&bool_iter);
+	free(orig);
+	free(incr);
+	free(full);
+	qpol_policy_destroy(&qp);
+}
+
+static void policy_features_append_module_files(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	const char *paths[] = { BASE_MODULE_6, BASE_MODULE_8, BASE_MODULE_6, BASE_MODULE_8, BASE_MODULE_6 };
+	const char *bad_paths[] = { BASE_MODULE_6, TEST_POLICIES "/no-such-module.pp", BASE_MODULE_8 };
+	const size_t num_paths = sizeof(paths) / sizeof(paths[0]);
+	const char *path;
+	size_t sz, i;
+	void *v;
+
+	int policy_type = qpol_policy_open_from_file(BASE_MODULE_8, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_MODULE_BINARY);
+
+	/* modules are read concurrently but must be kept in list order */
+	CU_ASSERT_FATAL(qpol_policy_append_module_files(qp, paths, num_paths) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_module_iter(qp, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+	CU_ASSERT_FATAL(sz == num_paths + 1);
+	qpol_iterator_next(iter);      /* skip the base */
+	for (i = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), i++) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+		CU_ASSERT_FATAL(qpol_module_get_path(v, &path) == 0);
+		CU_ASSERT_STRING_EQUAL(path, paths[i]);
+	}
+	qpol_iterator_destroy(&iter);
+
+	/* a module that cannot be read leaves the policy unchanged */
+	CU_ASSERT(qpol_policy_append_module_files(qp, bad_paths, sizeof(bad_paths) / sizeof(bad_paths[0])) < 0);
+	CU_ASSERT_FATAL(qpol_policy_get_module_iter(qp, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+	CU_ASSERT(sz == num_paths + 1);
+	qpol_iterator_destroy(&iter);
+
+	qpol_policy_destroy(&qp);
+}
+
+static void policy_features_avrule_iter_part(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	void **all = NULL, *v;
+	size_t num_all = 0, i, j, part, sz, total;
+	const size_t num_parts[] = { 1, 2, 3, 7, 64 };
+
+	int policy_type = qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_NEVERALLOWS);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &num_all) == 0);
+	CU_ASSERT_FATAL(num_all > 0);
+	all = calloc(num_all, sizeof(*all));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(all);
+	for (i = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), i++) {
+		CU_ASSERT_FATAL(i < num_all);
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &all[i]) == 0);
+	}
+	CU_ASSERT_FATAL(i == num_all);
+	qpol_iterator_destroy(&iter);
+
+	/* the parts, joined in order, must be the whole */
+	for (j = 0; j < sizeof(num_parts) / sizeof(num_parts[0]); j++) {
+		i = 0;
+		total = 0;
+		for (part = 0; part < num_parts[j]; part++) {
+			CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_part
+					(qp, QPOL_RULE_ALLOW | QPOL_RULE_DONTAUDIT, part, num_parts[j], &iter) == 0);
+			CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sz) == 0);
+			total += sz;
+			for (; !qpol_iterator_end(iter); qpol_iterator_next(iter), i++) {
+				CU_ASSERT_FATAL(i < num_all);
+				CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &v) == 0);
+				CU_ASSERT(v == all[i]);
+			}
+			qpol_iterator_destroy(&iter);
+		}
+		CU_ASSERT(i == num_all);
+		CU_ASSERT(total == num_all);
+	}
+	CU_ASSERT(qpol_policy_get_avrule_iter_part(qp, QPOL_RULE_ALLOW, 2, 2, &iter) < 0);
+
+	free(all);
+	qpol_policy_destroy(&qp);
+}
+
+static void policy_features_freeze(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	qpol_bool_t *b;
+	int state;
+
+	int policy_type = qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_NEVERALLOWS);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+
+	/* only a rebuild that does something starts a new generation */
+	CU_ASSERT(qpol_policy_get_generation(qp) == 0);
+	CU_ASSERT_FATAL(qpol_policy_rebuild(qp, QPOL_POLICY_OPTION_NO_NEVERALLOWS) == 0);
+	CU_ASSERT(qpol_policy_get_generation(qp) == 0);
+	CU_ASSERT_FATAL(qpol_policy_rebuild(qp, 0) == 0);
+	CU_ASSERT(qpol_policy_get_generation(qp) == 1);
+
+	CU_ASSERT(qpol_policy_is_frozen(qp) == 0);
+	CU_ASSERT_FATAL(qpol_policy_freeze(qp) == 0);
+	CU_ASSERT(qpol_policy_is_frozen(qp) == 1);
+	/* freezing twice is harmless */
+	CU_ASSERT(qpol_policy_freeze(qp) == 0);
+
+	/* all lazily built indices must exist once frozen */
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&b) == 0);
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT(qpol_bool_get_state(qp, b, &state) == 0);
+	CU_ASSERT(qpol_bool_set_state(qp, b, !state) < 0 && errno == EPERM);
+	CU_ASSERT(qpol_policy_rebuild(qp, QPOL_POLICY_OPTION_NO_NEVERALLOWS) < 0 && errno == EPERM);
+	CU_ASSERT(qpol_policy_get_generation(qp) == 1);
+	CU_ASSERT(qpol_policy_build_syn_rule_table(qp) == 0);
+
+	/* queries still work */
+	CU_ASSERT(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW, &iter) == 0);
+	CU_ASSERT(!qpol_iterator_end(iter));
+	qpol_iterator_destroy(&iter);
+
+	qpol_policy_destroy(&qp);
+}
+
 CU_TestInfo policy_features_tests[] = {
 	{"invalid alias", policy_features_invalid_alias}
 	,
 	{"No genfscon", policy_features_nogenfscon_iter}
 	,
+	{"av rule index", policy_features_avrule_index}
+	,
+	{"av rule type index", policy_features_avrule_type_index}
+	,
+	{"syn rule cache", policy_features_syn_rule_cache}
+	,
+	{"av rule permission mask", policy_features_avrule_perm_mask}
+	,
+	{"incremental boolean evaluation", policy_features_bool_incremental}
+	,
+	{"append module files", policy_features_append_module_files}
+	,
+	{"frozen policy", policy_features_freeze}
+	,
+	{"av rule iterator parts", policy_features_avrule_iter_part}
+	,
 	CU_TEST_INFO_NULL
 };
 
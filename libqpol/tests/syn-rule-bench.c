@@ -0,0 +1,127 @@
+/**
+ *  @file
+ *
+ *  Measure the time and memory needed to build the syntactic rule
+ *  table of source policies.  With no arguments the monolithic source
+ *  test policies are measured.  This program is not run by "make
+ *  check"; build it with "make syn-rule-bench".
+ *
+ *  This file is part of SETools; see the AUTHORS file for its
+ *  contributors.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <qpol/policy.h>
+#include <qpol/policy_extend.h>
+#include "../src/qpol_internal.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define POLICY_ROOT TEST_POLICIES "/policy-versions"
+
+static const char *default_policies[] = {
+	POLICY_ROOT "/policy-12.conf",
+	POLICY_ROOT "/policy-15.conf",
+	POLICY_ROOT "/policy-16.conf",
+	POLICY_ROOT "/policy-17.conf",
+	POLICY_ROOT "/policy-18.conf",
+	POLICY_ROOT "/policy-mls-21.conf",
+	POLICY_ROOT "/policy-mls-22.conf",
+	POLICY_ROOT "/policy-mls-23.conf",
+	TEST_POLICIES "/snapshots/fc4_targeted.policy.conf",
+	NULL
+};
+
+/* current resident set size in kilobytes, or 0 if unknown */
+static long bench_rss(void)
+{
+	FILE *f = fopen("/proc/self/statm", "r");
+	long size = 0, resident = 0;
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static double bench_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* quiet the library's informational messages */
+static void bench_callback(void *varg __attribute__ ((unused)), const qpol_policy_t * policy __attribute__ ((unused)),
+			   int level, const char *fmt, va_list va_args)
+{
+	if (level == QPOL_MSG_ERR) {
+		vfprintf(stderr, fmt, va_args);
+		fprintf(stderr, "\n");
+	}
+}
+
+static int bench_policy(const char *path)
+{
+	qpol_policy_t *qp = NULL;
+	double start, elapsed;
+	long rss;
+
+	if (qpol_policy_open_from_file(path, &qp, bench_callback, NULL, QPOL_POLICY_OPTION_NO_NEVERALLOWS) !=
+	    QPOL_POLICY_KERNEL_SOURCE) {
+		fprintf(stderr, "%s: not a source policy or could not be opened\n", path);
+		qpol_policy_destroy(&qp);
+		return -1;
+	}
+
+	rss = bench_rss();
+	start = bench_now();
+	if (qpol_policy_build_syn_rule_table(qp)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		qpol_policy_destroy(&qp);
+		return -1;
+	}
+	elapsed = bench_now() - start;
+	rss = bench_rss() - rss;
+
+	printf("%-60s %10.3f ms %10ld kB\n", path, elapsed * 1000.0, rss);
+	qpol_policy_destroy(&qp);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i, retv = 0;
+
+	printf("%-60s %13s %13s\n", "policy", "build time", "RSS growth");
+	if (argc > 1) {
+		for (i = 1; i < argc; i++)
+			retv |= bench_policy(argv[i]);
+	} else {
+		for (i = 0; default_policies[i]; i++)
+			retv |= bench_policy(default_policies[i]);
+	}
+
+	return retv ? 1 : 0;
+}
@@ -167,7 +167,8 @@ static int insert_time(const seaudit_log_t * log, const apol_vector_t * tokens,
  */
 static int insert_hostname(const seaudit_log_t * log, const apol_vector_t * tokens, size_t * position, seaudit_message_t * msg)
 {
-	char *s, *host;
+	char *s;
+	const char *host;
 	if (*position >= apol_vector_get_size(tokens)) {
 		WARN(log, "%s", "Not enough tokens for hostname.");
 		return 1;
@@ -180,13 +181,13 @@ static int insert_hostname(const seaudit_log_t * log, const apol_vector_t * toke
 		return 1;
 	}
 	(*position)++;
-	if ((host = strdup(s)) == NULL || apol_bst_insert_and_get(log->hosts, (void **)&host, NULL) < 0) {
+	if ((host = apol_intern_str(log->hosts, s, NULL)) == NULL) {
 		int error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		return -1;
 	}
-	msg->host = host;
+	msg->host = (char *)host;
 	return 0;
 }
 
@@ -208,24 +209,25 @@ static int insert_standard_msg_header(const seaudit_log_t * log, const apol_vect
  */
 static int insert_manager(const seaudit_log_t * log, seaudit_message_t * msg, const char *manager)
 {
-	char *m;
-	if ((m = strdup(manager)) == NULL || apol_bst_insert_and_get(log->managers, (void **)&m, NULL) < 0) {
+	const char *m;
+	if ((m = apol_intern_str(log->managers, manager, NULL)) == NULL) {
 		int error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		return -1;
 	}
-	msg->manager = m;
+	msg->manager = (char *)m;
 	return 0;
 }
 
 /**
  * Parse a context (user:role:type).  For each of the pieces, add them
- * to the log's BSTs.  Set reference pointers to those strings.
+ * to the log's intern pools.  Set reference pointers to those strings.
  */
 static int parse_context(seaudit_log_t * log, char *token, char **user, char **role, char **type, char **mls_lvl, char **mls_clr)
 {
-	char *s, *range;
+	const char *s;
+	char *range;
 	int error, ret = 0;
 	context_t con = context_new(token);
 	*user = *role = *type = *mls_lvl = *mls_clr = NULL;
@@ -236,32 +238,32 @@ static int parse_context(seaudit_log_t * log, char *token, char **user, char **r
 		goto out;
 	}
 
-	if ((s = strdup(context_user_get(con))) == NULL || apol_bst_insert_and_get(log->users, (void **)&s, NULL) < 0) {
+	if ((s = apol_intern_str(log->users, context_user_get(con), NULL)) == NULL) {
 		error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		ret = -1;
 		goto out;
 	}
-	*user = s;
+	*user = (char *)s;
 
-	if ((s = strdup(context_role_get(con))) == NULL || apol_bst_insert_and_get(log->roles, (void **)&s, NULL) < 0) {
+	if ((s = apol_intern_str(log->roles, context_role_get(con), NULL)) == NULL) {
 		error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		ret = -1;
 		goto out;
 	}
-	*role = s;
+	*role = (char *)s;
 
-	if ((s = strdup(context_type_get(con))) == NULL || apol_bst_insert_and_get(log->types, (void **)&s, NULL) < 0) {
+	if ((s = apol_intern_str(log->types, context_type_get(con), NULL)) == NULL) {
 		error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		ret = -1;
 		goto out;
 	}
-	*type = s;
+	*type = (char *)s;
 
 	if (range = context_range_get(con)) {
 		char *lvl, *clr;
@@ -271,23 +273,23 @@ static int parse_context(seaudit_log_t * log, char *token, char **user, char **r
 			/* level and clearance are the same */
 			clr = lvl;
 
-		if ((s = strdup(lvl)) == NULL || apol_bst_insert_and_get(log->mls_lvl, (void **)&s, NULL) < 0) {
+		if ((s = apol_intern_str(log->mls_lvl, lvl, NULL)) == NULL) {
 			error = errno;
 			ERR(log, "%s", strerror(error));
 			errno = error;
 			ret = -1;
 			goto out;
 		}
-		*mls_lvl = s;
+		*mls_lvl = (char *)s;
 
-		if ((s = strdup(clr)) == NULL || apol_bst_insert_and_get(log->mls_clr, (void **)&s, NULL) < 0) {
+		if ((s = apol_intern_str(log->mls_clr, clr, NULL)) == NULL) {
 			error = errno;
 			ERR(log, "%s", strerror(error));
 			errno = error;
 			ret = -1;
 			goto out;
 		}
-		*mls_clr = s;
+		*mls_clr = (char *)s;
 	}
 
 out:
@@ -338,7 +340,8 @@ static int avc_msg_is_prefix(char *token, char *prefix, char **result)
  */
 static int avc_msg_insert_perms(const seaudit_log_t * log, apol_vector_t * tokens, size_t * position, seaudit_avc_message_t * avc)
 {
-	char *s, *perm;
+	char *s;
+	const char *perm;
 	int error;
 	if ((s = apol_vector_get_element(tokens, *position)) == NULL || strcmp(s, "{") != 0) {
 		WARN(log, "%s", "Expected an opening brace while parsing permissions.");
@@ -354,8 +357,7 @@ static int avc_msg_insert_perms(const seaudit_log_t * log, apol_vector_t * token
 			return 0;
 		}
 
-		if ((perm = strdup(s)) == NULL ||
-		    apol_bst_insert_and_get(log->perms, (void **)&perm, NULL) < 0 || apol_vector_append(avc->perms, perm) < 0) {
+		if ((perm = apol_intern_str(log->perms, s, NULL)) == NULL || apol_vector_append(avc->perms, (void *)perm) < 0) {
 			error = errno;
 			ERR(log, "%s", strerror(error));
 			errno = error;
@@ -478,14 +480,14 @@ static int avc_msg_insert_tcon(seaudit_log_t * log, seaudit_avc_message_t * avc,
 
 static int avc_msg_insert_tclass(seaudit_log_t * log, seaudit_avc_message_t * avc, const char *tmp)
 {
-	char *tclass;
-	if ((tclass = strdup(tmp)) == NULL || apol_bst_insert_and_get(log->classes, (void **)&tclass, NULL) < 0) {
+	const char *tclass;
+	if ((tclass = apol_intern_str(log->classes, tmp, NULL)) == NULL) {
 		int error = errno;
 		ERR(log, "%s", strerror(error));
 		errno = error;
 		return -1;
 	}
-	avc->tclass = tclass;
+	avc->tclass = (char *)tclass;
 	return 0;
 }
 
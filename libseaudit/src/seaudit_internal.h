@@ -37,7 +37,7 @@
 #include <seaudit/model.h>
 #include <seaudit/sort.h>
 
-#include <apol/bst.h>
+#include <apol/intern.h>
 #include <apol/vector.h>
 
 #include <libxml/uri.h>
@@ -55,9 +55,11 @@ struct seaudit_log
 	apol_vector_t *malformed_msgs;
 	/** vector of seaudit_model_t that are watching this log */
 	apol_vector_t *models;
-	apol_bst_t *types, *classes, *roles, *users;
-	apol_bst_t *perms, *hosts, *bools, *managers;
-	apol_bst_t *mls_lvl, *mls_clr;
+	/** pools of the names seen within messages; messages point
+	 * into these rather than holding their own copies */
+	apol_intern_t *types, *classes, *roles, *users;
+	apol_intern_t *perms, *hosts, *bools, *managers;
+	apol_intern_t *mls_lvl, *mls_clr;
 	seaudit_log_type_e logtype;
 	seaudit_handle_fn_t fn;
 	void *handle_arg;
@@ -165,7 +167,7 @@ typedef enum seaudit_avc_message_class
 
 /**
  * Definition of an avc message.  Note that unless stated otherwise,
- * character pointers are into the message's log's respective BST.
+ * character pointers are into the message's log's respective intern pool.
  */
 struct seaudit_avc_message
 {
@@ -223,7 +225,7 @@ struct seaudit_avc_message
 	long tm_stmp_nano;
 	/** audit header serial number */
 	unsigned int serial;
-	/** pointers into log->perms BST (hence char *) */
+	/** pointers into log->perms intern pool (hence char *) */
 	apol_vector_t *perms;
 	/** key for an IPC call */
 	int key;
@@ -310,7 +312,7 @@ char *avc_message_to_misc_string(const seaudit_avc_message_t * avc);
 
 typedef struct seaudit_bool_message_change
 {
-	/** pointer into log's bools BST */
+	/** pointer into log's bools intern pool */
 	char *boolean;
 	/** new value for the boolean */
 	int value;
@@ -332,9 +334,9 @@ seaudit_bool_message_t *bool_message_create(void);
 
 /**
  * Append a boolean change to a particular boolean message.  This will
- * add the boolean name to the log's BST as needed.
+ * add the boolean name to the log's intern pool as needed.
  *
- * @param log Log containing boolean name BST.
+ * @param log Log containing boolean name intern pool.
  * @param bool Boolean message to change.
  * @param name Name of the boolean that was changed.  This function
  * will dup the incoming name.
@@ -31,6 +31,7 @@
 #include <sefs/db.hh>
 #include <sefs/filesystem.hh>
 #include <sefs/entry.hh>
+#include <apol/intern.h>
 #include <apol/util.h>
 
 #include <sqlite3.h>
@@ -339,19 +340,6 @@ static int db_count_callback(void *arg, int argc __attribute__ ((unused)), char
 
 /******************** convert from a filesystem to a db ********************/
 
-struct strindex
-{
-	const char *str;
-	int id;
-};
-
-static int db_strindex_comp(const void *a, const void *b, void *arg __attribute__ ((unused)))
-{
-	const struct strindex *n1 = static_cast < const struct strindex *>(a);
-	const struct strindex *n2 = static_cast < const struct strindex *>(b);
-	return strcmp(n1->str, n2->str);
-}
-
 class db_convert
 {
       public:
@@ -360,77 +348,50 @@ class db_convert
 		_db = db;
 		_target_db = target_db;
 		_user = _role = _type = _range = _dev = NULL;
-		_user_id = _role_id = _type_id = _range_id = _dev_id = 0;
 		_errmsg = NULL;
-		try
+		if ((_user = apol_intern_create()) == NULL || (_role = apol_intern_create()) == NULL ||
+		    (_type = apol_intern_create()) == NULL || (_range = apol_intern_create()) == NULL ||
+		    (_dev = apol_intern_create()) == NULL)
 		{
-			if ((_user = apol_bst_create(db_strindex_comp, free)) == NULL)
-			{
-				SEFS_ERR(_db, "%s", strerror(errno));
-				throw std::runtime_error(strerror(errno));
-			}
-			if ((_role = apol_bst_create(db_strindex_comp, free)) == NULL)
-			{
-				SEFS_ERR(_db, "%s", strerror(errno));
-				throw std::runtime_error(strerror(errno));
-			}
-			if ((_type = apol_bst_create(db_strindex_comp, free)) == NULL)
-			{
-				SEFS_ERR(_db, "%s", strerror(errno));
-				throw std::runtime_error(strerror(errno));
-			}
-			if ((_range = apol_bst_create(db_strindex_comp, free)) == NULL)
-			{
-				SEFS_ERR(_db, "%s", strerror(errno));
-				throw std::runtime_error(strerror(errno));
-			}
-			if ((_dev = apol_bst_create(db_strindex_comp, free)) == NULL)
-			{
-				SEFS_ERR(_db, "%s", strerror(errno));
-				throw std::runtime_error(strerror(errno));
-			}
-		}
-		catch(...)
-		{
-			apol_bst_destroy(&_user);
-			apol_bst_destroy(&_role);
-			apol_bst_destroy(&_type);
-			apol_bst_destroy(&_range);
-			apol_bst_destroy(&_dev);
-			throw;
+			int error = errno;
+			SEFS_ERR(_db, "%s", strerror(error));
+			apol_intern_destroy(&_user);
+			apol_intern_destroy(&_role);
+			apol_intern_destroy(&_type);
+			apol_intern_destroy(&_range);
+			apol_intern_destroy(&_dev);
+			throw std::runtime_error(strerror(error));
 		}
 	}
 	~db_convert()
 	{
-		apol_bst_destroy(&_user);
-		apol_bst_destroy(&_role);
-		apol_bst_destroy(&_type);
-		apol_bst_destroy(&_range);
-		apol_bst_destroy(&_dev);
+		apol_intern_destroy(&_user);
+		apol_intern_destroy(&_role);
+		apol_intern_destroy(&_type);
+		apol_intern_destroy(&_range);
+		apol_intern_destroy(&_dev);
 		sqlite3_free(_errmsg);
 	}
-	int getID(const char *sym, apol_bst_t * tree, int &id, const char *table) throw(std::bad_alloc)
+	/**
+	 * Get the row identifier of a symbol.  The pool numbers its
+	 * strings densely in the order first seen, so a symbol whose
+	 * identifier is past the old end of the pool is new and gets
+	 * added to the given table.
+	 */
+	int getID(const char *sym, apol_intern_t * pool, const char *table) throw(std::bad_alloc)
 	{
-		struct strindex st = { sym, -1 }, *result;
-		if (apol_bst_get_element(tree, &st, NULL, (void **)&result) == 0)
-		{
-			return result->id;
-		}
-		if ((result = static_cast < struct strindex * >(malloc(sizeof(*result)))) == NULL)
+		size_t num_syms = apol_intern_get_size(pool), id;
+		if (apol_intern_str(pool, sym, &id) == NULL)
 		{
 			SEFS_ERR(_db, "%s", strerror(errno));
 			throw std::bad_alloc();
 		}
-		result->str = sym;
-		result->id = id++;
-		if (apol_bst_insert(tree, result, NULL) < 0)
+		if (id < num_syms)
 		{
-			SEFS_ERR(_db, "%s", strerror(errno));
-			free(result);
-			throw std::bad_alloc();
+			return static_cast < int >(id);
 		}
 		char *insert_stmt = NULL;
-		if (asprintf(&insert_stmt, "INSERT INTO %s VALUES (%d, '%s')", table, result->id, result->str) < 0)
+		if (asprintf(&insert_stmt, "INSERT INTO %s VALUES (%d, '%s')", table, static_cast < int >(id), sym) < 0)
 		{
 			SEFS_ERR(_db, "%s", strerror(errno));
 			throw std::bad_alloc();
@@ -442,10 +403,9 @@ class db_convert
 			throw std::runtime_error(_errmsg);
 		}
 		free(insert_stmt);
-		return result->id;
+		return static_cast < int >(id);
 	}
-	apol_bst_t *_user, *_role, *_type, *_range, *_dev;
-	int _user_id, _role_id, _type_id, _range_id, _dev_id;
+	apol_intern_t *_user, *_role, *_type, *_range, *_dev;
 	bool _isMLS;
 	char *_errmsg;
 	sefs_db *_db;
@@ -462,15 +422,15 @@ int db_create_from_filesystem(sefs_fclist * fclist __attribute__ ((unused)), con
 
 		// add the user, role, type, range, and dev into the
 		// target_db if needed
-		int user_id = dbc->getID(context->user, dbc->_user, dbc->_user_id, "users");
-		int role_id = dbc->getID(context->role, dbc->_role, dbc->_role_id, "roles");
-		int type_id = dbc->getID(context->type, dbc->_type, dbc->_type_id, "types");
+		int user_id = dbc->getID(context->user, dbc->_user, "users");
+		int role_id = dbc->getID(context->role, dbc->_role, "roles");
+		int type_id = dbc->getID(context->type, dbc->_type, "types");
 		int range_id = 0;
 		if (dbc->_isMLS)
 		{
-			range_id = dbc->getID(context->range, dbc->_range, dbc->_range_id, "mls");
+			range_id = dbc->getID(context->range, dbc->_range, "mls");
 		}
-		int dev_id = dbc->getID(entry->dev(), dbc->_dev, dbc->_dev_id, "devs");
+		int dev_id = dbc->getID(entry->dev(), dbc->_dev, "devs");
 		const char *path = entry->path();
 		const ino64_t inode = entry->inode();
 		const uint32_t objclass = entry->objectClass();
@@ -231,6 +231,42 @@ int inc_net_access_init(sechk_module_t * mod, apol_policy_t * policy, void *arg
 #define TCP_FULL_PERM_SET (RULE_TCP_SOCK_FILE|RULE_TCP_SELF_SOC|RULE_TCP_NETIF|RULE_TCP_NODE|RULE_TCP_PORT|RULE_TCP_ASSOC)
 #define COMMON_ACCESS_SET (PERM_SELF_SOCK_FILE_READ|PERM_SELF_SOCK_FILE_WRITE|PERM_SELF_SOCK_FILE_GETATTR|PERM_ASSOC_SEND|PERM_ASSOC_RECV)
 
+/* The rules checked for each network domain, one query per entry; the
+ * domain is always the source and, for "self" entries, the target too. */
+typedef enum net_query_idx
+{
+	NET_QUERY_SELF_SOCK_FILE = 0,
+	NET_QUERY_SELF_TCP_SOC,
+	NET_QUERY_SELF_UDP_SOC,
+	NET_QUERY_NETIF,
+	NET_QUERY_NODE,
+	NET_QUERY_PORT_TCP,
+	NET_QUERY_PORT_UDP,
+	NET_QUERY_ASSOC,
+	NET_QUERY_NUM
+} net_query_idx_e;
+
+static const struct
+{
+	const char *obj_class;
+	int self;
+} net_queries[NET_QUERY_NUM] = {
+	{"sock_file", 1},
+	{"tcp_socket", 1},
+	{"udp_socket", 1},
+	{"netif", 0},
+	{"node", 0},
+	{"tcp_socket", 0},
+	{"udp_socket", 0},
+	{"association", 0}
+};
+
+static void net_query_free(void *q)
+{
+	apol_avrule_query_t *query = q;
+	apol_avrule_query_destroy(&query);
+}
+
 typedef struct net_state
 {
 	uint32_t perms;
@@ -1305,7 +1341,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 	size_t i = 0, j = 0;
 	int error = 0;
 	apol_avrule_query_t *avrule_query = NULL;
-	apol_vector_t *avrule_vector = NULL, *net_domain_vector = NULL;
+	apol_vector_t *avrule_queries = NULL, *avrule_results = NULL;
+	const apol_vector_t *avrule_vector = NULL;
+	apol_vector_t *net_domain_vector = NULL;
 	const qpol_type_t *net_domain = NULL, *tmp_type = NULL;
 	const char *net_domain_name = NULL, *tgt_name = NULL;
 	char *perm_name = NULL;
@@ -1363,13 +1401,40 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 	}
 	net_domain_vector = (apol_vector_t *) net_domain_res->items;
 
-	avrule_query = apol_avrule_query_create();
-	if (!avrule_query) {
+	/* build every query for every domain first, so that all of them
+	 * are answered during a single pass over the rules */
+	if (!(avrule_queries = apol_vector_create(net_query_free))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto inc_net_access_run_fail;
+	}
+	for (i = 0; i < apol_vector_get_size(net_domain_vector); i++) {
+		tmp_item = apol_vector_get_element(net_domain_vector, i);
+		qpol_type_get_name(q, tmp_item->item, &net_domain_name);
+		for (j = 0; j < NET_QUERY_NUM; j++) {
+			if (!(avrule_query = apol_avrule_query_create())) {
+				error = errno;
+				ERR(policy, "%s", strerror(error));
+				goto inc_net_access_run_fail;
+			}
+			if (apol_vector_append(avrule_queries, avrule_query)) {
+				error = errno;
+				apol_avrule_query_destroy(&avrule_query);
+				ERR(policy, "%s", strerror(error));
+				goto inc_net_access_run_fail;
+			}
+			apol_avrule_query_set_rules(policy, avrule_query, QPOL_RULE_ALLOW);
+			apol_avrule_query_set_source(policy, avrule_query, net_domain_name, 1);
+			if (net_queries[j].self)
+				apol_avrule_query_set_target(policy, avrule_query, net_domain_name, 1);
+			apol_avrule_query_append_class(policy, avrule_query, net_queries[j].obj_class);
+		}
+	}
+	if (apol_avrule_get_by_queries(policy, avrule_queries, &avrule_results)) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto inc_net_access_run_fail;
 	}
-	apol_avrule_query_set_rules(policy, avrule_query, QPOL_RULE_ALLOW);
 
 	for (i = 0; i < apol_vector_get_size(net_domain_vector); i++) {
 		tmp_item = apol_vector_get_element(net_domain_vector, i);
@@ -1378,11 +1443,7 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 		state = net_state_create();
 
 		/* find any self sock_file perms */
-		apol_avrule_query_set_source(policy, avrule_query, net_domain_name, 1);
-		apol_avrule_query_set_target(policy, avrule_query, net_domain_name, 1);
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "sock_file");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_SELF_SOCK_FILE);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_perm_iter(q, rule, &iter);
@@ -1400,12 +1461,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any self tcp_socket perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "tcp_socket");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_SELF_TCP_SOC);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_perm_iter(q, rule, &iter);
@@ -1423,12 +1481,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any self udp_socket perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "udp_socket");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_SELF_UDP_SOC);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_perm_iter(q, rule, &iter);
@@ -1446,13 +1501,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any if_t netif perms */
-		apol_avrule_query_set_target(policy, avrule_query, NULL, 0);
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "netif");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_NETIF);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_target_type(q, rule, &tmp_type);
@@ -1478,12 +1529,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any node_t node perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "node");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_NODE);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_target_type(q, rule, &tmp_type);
@@ -1509,12 +1557,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any port_t tcp_socket perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "tcp_socket");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_PORT_TCP);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_target_type(q, rule, &tmp_type);
@@ -1537,12 +1582,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any port_t udp_socket perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "udp_socket");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_PORT_UDP);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_target_type(q, rule, &tmp_type);
@@ -1565,12 +1607,9 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* find any assoc_t association perms */
-		apol_avrule_query_append_class(policy, avrule_query, NULL);
-		apol_avrule_query_append_class(policy, avrule_query, "association");
-		apol_avrule_get_by_query(policy, avrule_query, &avrule_vector);
+		avrule_vector = apol_vector_get_element(avrule_results, i * NET_QUERY_NUM + NET_QUERY_ASSOC);
 		for (j = 0; j < apol_vector_get_size(avrule_vector); j++) {
 			rule = apol_vector_get_element(avrule_vector, j);
 			qpol_avrule_get_target_type(q, rule, &tmp_type);
@@ -1590,7 +1629,6 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 			}
 			qpol_iterator_destroy(&iter);
 		}
-		apol_vector_destroy(&avrule_vector);
 
 		/* if has tcp perms check for missing ones */
 		if ((state->perms & ((~(COMMON_ACCESS_SET)) & (TCP_FULL_PERM_SET))) &&
@@ -1758,14 +1796,16 @@ int inc_net_access_run(sechk_module_t * mod, apol_policy_t * policy, void *arg _
 		net_state_destroy(&state);
 	}
 	mod->result = res;
+	apol_vector_destroy(&avrule_queries);
+	apol_vector_destroy(&avrule_results);
 
 	if (apol_vector_get_size(res->items))
 		return 1;
 	return 0;
 
       inc_net_access_run_fail:
-	apol_avrule_query_destroy(&avrule_query);
-	apol_vector_destroy(&avrule_vector);
+	apol_vector_destroy(&avrule_queries);
+	apol_vector_destroy(&avrule_results);
 	qpol_iterator_destroy(&iter);
 	free(perm_name);
 	net_state_destroy(&state);
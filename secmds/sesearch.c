@@ -55,7 +55,7 @@ enum opt_values
 {
 	RULE_NEVERALLOW = 256, RULE_AUDIT, RULE_AUDITALLOW, RULE_DONTAUDIT,
 	RULE_ROLE_ALLOW, RULE_ROLE_TRANS, RULE_RANGE_TRANS, RULE_ALL,
-	EXPR_ROLE_SOURCE, EXPR_ROLE_TARGET
+	EXPR_ROLE_SOURCE, EXPR_ROLE_TARGET, OPT_CACHE, OPT_THREADS
 };
 
 static struct option const longopts[] = {
@@ -84,6 +84,8 @@ static struct option const longopts[] = {
 	{"linenum", no_argument, NULL, 'n'},
 	{"semantic", no_argument, NULL, 'S'},
 	{"show_cond", no_argument, NULL, 'C'},
+	{"cache", no_argument, NULL, OPT_CACHE},
+	{"threads", required_argument, NULL, OPT_THREADS},
 	{"help", no_argument, NULL, 'h'},
 	{"version", no_argument, NULL, 'V'},
 	{NULL, 0, NULL, 0}
@@ -114,9 +116,35 @@ typedef struct options
 	bool role_trans;
 	bool useregex;
 	bool show_cond;
+	bool cache;
+	size_t threads;
 	apol_vector_t *perm_vector;
 } options_t;
 
+/* semantic rules are printed as they are found; a first pass over
+ * them only counts them, so that the count may head the list */
+typedef struct print_state
+{
+	const options_t *opt;
+	size_t num_rules;
+} print_state_t;
+
+static int count_av_rule(const apol_policy_t * policy __attribute__ ((unused)), const qpol_avrule_t * rule
+			 __attribute__ ((unused)), void *arg)
+{
+	print_state_t *state = arg;
+	state->num_rules++;
+	return 0;
+}
+
+static int count_te_rule(const apol_policy_t * policy __attribute__ ((unused)), const qpol_terule_t * rule
+			 __attribute__ ((unused)), void *arg)
+{
+	print_state_t *state = arg;
+	state->num_rules++;
+	return 0;
+}
+
 void usage(const char *program_name, int brief)
 {
 	printf("Usage: %s [OPTIONS] RULE_TYPE [RULE_TYPE ...] [EXPESSION] [POLICY ...]\n\n", program_name);
@@ -151,6 +179,8 @@ void usage(const char *program_name, int brief)
 	printf("  -n, --linenum             show line number for each rule if available\n");
 	printf("  -S, --semantic            search rules semantically instead of syntactically\n");
 	printf("  -C, --show_cond           show conditional expression for conditional rules\n");
+	printf("  --cache                   cache the syntactic rules of a source policy\n");
+	printf("  --threads=N               use N threads for semantic rule searches\n");
 	printf("  -h, --help                print this help text and exit\n");
 	printf("  -V, --version             print version information and exit\n");
 	printf("\n");
@@ -160,6 +190,47 @@ void usage(const char *program_name, int brief)
 	printf("policy, will be opened if no policy is provided.\n\n");
 }
 
+static int print_av_rule(const apol_policy_t * policy, const qpol_avrule_t * rule, void *arg)
+{
+	print_state_t *state = arg;
+	qpol_policy_t *q = apol_policy_get_qpol(policy);
+	char *tmp = NULL, *expr = NULL;
+	char enable_char = ' ', branch_char = ' ';
+	const qpol_cond_t *cond = NULL;
+	uint32_t enabled = 0, list = 0;
+	int retv = -1;
+
+	if (state->opt->show_cond) {
+		if (qpol_avrule_get_cond(q, rule, &cond))
+			goto cleanup;
+		if (qpol_avrule_get_is_enabled(q, rule, &enabled))
+			goto cleanup;
+		if (cond) {
+			if (qpol_avrule_get_which_list(q, rule, &list))
+				goto cleanup;
+			if (!(tmp = apol_cond_expr_render(policy, cond)))
+				goto cleanup;
+			enable_char = (enabled ? 'E' : 'D');
+			branch_char = (list ? 'T' : 'F');
+			if (asprintf(&expr, "[ %s ]", tmp) < 0) {
+				expr = NULL;
+				goto cleanup;
+			}
+		}
+	}
+	/* written straight to stdout, as there may be very many */
+	fprintf(stdout, "%c%c ", enable_char, branch_char);
+	if (apol_avrule_render_file(policy, rule, stdout))
+		goto cleanup;
+	fprintf(stdout, " %s\n", expr ? expr : "");
+	retv = 0;
+
+      cleanup:
+	free(tmp);
+	free(expr);
+	return retv;
+}
+
 static int perform_av_query(const apol_policy_t * policy, const options_t * opt, apol_vector_t ** v)
 {
 	apol_avrule_query_t *avq = NULL;
@@ -244,10 +315,38 @@ static int perform_av_query(const apol_policy_t * policy, const options_t * opt,
 			goto err;
 		}
 	} else {
-		if (apol_avrule_get_by_query(policy, avq, v)) {
+		print_state_t state = { opt, 0 };
+		/* the count heads the list.  A search split among
+		 * threads collects the rules before printing them;
+		 * otherwise search twice, first to count the rules and
+		 * then to print them as they are found, so that memory
+		 * use does not grow with their number. */
+		*v = NULL;
+		if (opt->threads > 1) {
+			if (apol_avrule_get_by_query(policy, avq, v)) {
+				error = errno;
+				goto err;
+			}
+			state.num_rules = apol_vector_get_size(*v);
+		} else if (apol_avrule_get_by_query_map(policy, avq, count_av_rule, &state)) {
+			error = errno;
+			goto err;
+		}
+		if (state.num_rules)
+			fprintf(stdout, "Found %zd semantic av rules:\n", state.num_rules);
+		if (*v != NULL) {
+			for (size_t i = 0; i < apol_vector_get_size(*v); i++) {
+				if (print_av_rule(policy, apol_vector_get_element(*v, i), &state)) {
+					error = errno;
+					goto err;
+				}
+			}
+			apol_vector_destroy(v);
+		} else if (state.num_rules && apol_avrule_get_by_query_map(policy, avq, print_av_rule, &state)) {
 			error = errno;
 			goto err;
 		}
+		fprintf(stdout, "\n");
 	}
 
 	apol_avrule_query_destroy(&avq);
@@ -269,7 +368,7 @@ static void print_syn_av_results(const apol_policy_t * policy, const options_t *
 	size_t i, num_rules = 0;
 	const apol_vector_t *syn_list = NULL;
 	const qpol_syn_avrule_t *rule = NULL;
-	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
+	char *tmp = NULL, *expr = NULL;
 	char enable_char = ' ', branch_char = ' ';
 	const qpol_cond_t *cond = NULL;
 	uint32_t enabled = 0, is_true = 0;
@@ -306,85 +405,64 @@ static void print_syn_av_results(const apol_policy_t * policy, const options_t *
 					goto cleanup;
 			}
 		}
-		if (!(rule_str = apol_syn_avrule_render(policy, rule)))
-			goto cleanup;
 		if (opt->lineno) {
 			if (qpol_syn_avrule_get_lineno(q, rule, &lineno))
 				goto cleanup;
-			fprintf(stdout, "%c%c [%7lu] %s %s\n", enable_char, branch_char, lineno, rule_str, expr ? expr : "");
+			fprintf(stdout, "%c%c [%7lu] ", enable_char, branch_char, lineno);
 		} else {
-			fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
+			fprintf(stdout, "%c%c ", enable_char, branch_char);
 		}
-		free(rule_str);
-		rule_str = NULL;
+		if (apol_syn_avrule_render_file(policy, rule, stdout))
+			goto cleanup;
+		fprintf(stdout, " %s\n", expr ? expr : "");
 		free(expr);
 		expr = NULL;
 	}
 
       cleanup:
 	free(tmp);
-	free(rule_str);
 	free(expr);
 }
 
-static void print_av_results(const apol_policy_t * policy, const options_t * opt, const apol_vector_t * v)
+static int print_te_rule(const apol_policy_t * policy, const qpol_terule_t * rule, void *arg)
 {
+	print_state_t *state = arg;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
-	size_t i, num_rules = 0;
-	const qpol_avrule_t *rule = NULL;
-	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
+	char *tmp = NULL, *expr = NULL;
 	char enable_char = ' ', branch_char = ' ';
-	qpol_iterator_t *iter = NULL;
 	const qpol_cond_t *cond = NULL;
 	uint32_t enabled = 0, list = 0;
+	int retv = -1;
 
-	if (!policy || !v)
-		return;
-
-	if (!(num_rules = apol_vector_get_size(v)))
-		return;
-
-	fprintf(stdout, "Found %zd semantic av rules:\n", num_rules);
-
-	for (i = 0; i < num_rules; i++) {
-		enable_char = branch_char = ' ';
-		if (!(rule = apol_vector_get_element(v, i)))
+	if (state->opt->show_cond) {
+		if (qpol_terule_get_cond(q, rule, &cond))
 			goto cleanup;
-		if (opt->show_cond) {
-			if (qpol_avrule_get_cond(q, rule, &cond))
+		if (qpol_terule_get_is_enabled(q, rule, &enabled))
+			goto cleanup;
+		if (cond) {
+			if (qpol_terule_get_which_list(q, rule, &list))
 				goto cleanup;
-			if (qpol_avrule_get_is_enabled(q, rule, &enabled))
+			if (!(tmp = apol_cond_expr_render(policy, cond)))
+				goto cleanup;
+			enable_char = (enabled ? 'E' : 'D');
+			branch_char = (list ? 'T' : 'F');
+			if (asprintf(&expr, "[ %s ]", tmp) < 0) {
+				expr = NULL;
 				goto cleanup;
-			if (cond) {
-				if (qpol_avrule_get_which_list(q, rule, &list))
-					goto cleanup;
-				tmp = apol_cond_expr_render(policy, cond);
-				qpol_iterator_destroy(&iter);
-				enable_char = (enabled ? 'E' : 'D');
-				branch_char = (list ? 'T' : 'F');
-				if (asprintf(&expr, "[ %s ]", tmp) < 0) {
-					expr = NULL;
-					goto cleanup;
-				}
-				free(tmp);
-				tmp = NULL;
-				if (!expr)
-					goto cleanup;
 			}
 		}
-		if (!(rule_str = apol_avrule_render(policy, rule)))
-			goto cleanup;
-		fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
-		free(rule_str);
-		rule_str = NULL;
-		free(expr);
-		expr = NULL;
 	}
+	/* written straight to stdout, as there may be very many */
+	fprintf(stdout, "%c%c ", enable_char, branch_char);
+	if (apol_terule_render_file(policy, rule, stdout))
+		goto cleanup;
+	fprintf(stdout, " %s\n", expr ? expr : "");
+	retv = 0;
 
       cleanup:
 	free(tmp);
-	free(rule_str);
 	free(expr);
+	return retv;
 }
 
 static int perform_te_query(const apol_policy_t * policy, const options_t * opt, apol_vector_t ** v)
@@ -449,10 +527,38 @@ static int perform_te_query(const apol_policy_t * policy, const options_t * opt,
 			goto err;
 		}
 	} else {
-		if (apol_terule_get_by_query(policy, teq, v)) {
+		print_state_t state = { opt, 0 };
+		/* the count heads the list.  A search split among
+		 * threads collects the rules before printing them;
+		 * otherwise search twice, first to count the rules and
+		 * then to print them as they are found, so that memory
+		 * use does not grow with their number. */
+		*v = NULL;
+		if (opt->threads > 1) {
+			if (apol_terule_get_by_query(policy, teq, v)) {
+				error = errno;
+				goto err;
+			}
+			state.num_rules = apol_vector_get_size(*v);
+		} else if (apol_terule_get_by_query_map(policy, teq, count_te_rule, &state)) {
+			error = errno;
+			goto err;
+		}
+		if (state.num_rules)
+			fprintf(stdout, "Found %zd semantic te rules:\n", state.num_rules);
+		if (*v != NULL) {
+			for (size_t i = 0; i < apol_vector_get_size(*v); i++) {
+				if (print_te_rule(policy, apol_vector_get_element(*v, i), &state)) {
+					error = errno;
+					goto err;
+				}
+			}
+			apol_vector_destroy(v);
+		} else if (state.num_rules && apol_terule_get_by_query_map(policy, teq, print_te_rule, &state)) {
 			error = errno;
 			goto err;
 		}
+		fprintf(stdout, "\n");
 	}
 
 	apol_terule_query_destroy(&teq);
@@ -472,7 +578,7 @@ static void print_syn_te_results(const apol_policy_t * policy, const options_t *
 	size_t i, num_rules = 0;
 	const apol_vector_t *syn_list = NULL;
 	const qpol_syn_terule_t *rule = NULL;
-	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
+	char *tmp = NULL, *expr = NULL;
 	char enable_char = ' ', branch_char = ' ';
 	const qpol_cond_t *cond = NULL;
 	uint32_t enabled = 0, is_true = 0;
@@ -509,86 +615,22 @@ static void print_syn_te_results(const apol_policy_t * policy, const options_t *
 					goto cleanup;
 			}
 		}
-		if (!(rule_str = apol_syn_terule_render(policy, rule)))
-			goto cleanup;
 		if (opt->lineno) {
 			if (qpol_syn_terule_get_lineno(q, rule, &lineno))
 				goto cleanup;
-			fprintf(stdout, "%c%c [%7lu] %s %s\n", enable_char, branch_char, lineno, rule_str, expr ? expr : "");
+			fprintf(stdout, "%c%c [%7lu] ", enable_char, branch_char, lineno);
 		} else {
-			fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
+			fprintf(stdout, "%c%c ", enable_char, branch_char);
 		}
-		free(rule_str);
-		rule_str = NULL;
-		free(expr);
-		expr = NULL;
-	}
-
-      cleanup:
-	free(tmp);
-	free(rule_str);
-	free(expr);
-}
-
-static void print_te_results(const apol_policy_t * policy, const options_t * opt, const apol_vector_t * v)
-{
-	qpol_policy_t *q = apol_policy_get_qpol(policy);
-	size_t i, num_rules = 0;
-	const qpol_terule_t *rule = NULL;
-	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
-	char enable_char = ' ', branch_char = ' ';
-	qpol_iterator_t *iter = NULL;
-	const qpol_cond_t *cond = NULL;
-	uint32_t enabled = 0, list = 0;
-
-	if (!policy || !v)
-		goto cleanup;
-
-	if (!(num_rules = apol_vector_get_size(v)))
-		goto cleanup;
-
-	fprintf(stdout, "Found %zd semantic te rules:\n", num_rules);
-
-	for (i = 0; i < num_rules; i++) {
-		enable_char = branch_char = ' ';
-		if (!(rule = apol_vector_get_element(v, i)))
+		if (apol_syn_terule_render_file(policy, rule, stdout))
 			goto cleanup;
-		if (opt->show_cond) {
-			if (qpol_terule_get_cond(q, rule, &cond))
-				goto cleanup;
-			if (qpol_terule_get_is_enabled(q, rule, &enabled))
-				goto cleanup;
-			if (cond) {
-				if (qpol_terule_get_which_list(q, rule, &list))
-					goto cleanup;
-				if (qpol_cond_get_expr_node_iter(q, cond, &iter))
-					goto cleanup;
-				tmp = apol_cond_expr_render(policy, cond);
-				qpol_iterator_destroy(&iter);
-				enable_char = (enabled ? 'E' : 'D');
-				branch_char = (list ? 'T' : 'F');
-				if (asprintf(&expr, "[ %s ]", tmp) < 0) {
-					expr = NULL;
-					goto cleanup;
-				}
-				free(tmp);
-				tmp = NULL;
-				if (!expr)
-					goto cleanup;
-			}
-		}
-		if (!(rule_str = apol_terule_render(policy, rule)))
-			goto cleanup;
-		fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
-		free(rule_str);
-		rule_str = NULL;
+		fprintf(stdout, " %s\n", expr ? expr : "");
 		free(expr);
 		expr = NULL;
 	}
 
       cleanup:
 	free(tmp);
-	free(rule_str);
 	free(expr);
 }
 
@@ -964,6 +1006,7 @@ int main(int argc, char **argv)
 {
 	options_t cmd_opts;
 	int optc, rt = -1;
+	char *endptr = NULL;
 
 	apol_policy_t *policy = NULL;
 	apol_vector_t *v = NULL;
@@ -1120,6 +1163,16 @@ int main(int argc, char **argv)
 		case 'C':
 			cmd_opts.show_cond = true;
 			break;
+		case OPT_CACHE:
+			cmd_opts.cache = true;
+			break;
+		case OPT_THREADS:
+			cmd_opts.threads = strtoul(optarg, &endptr, 10);
+			if (*optarg == '\0' || *endptr != '\0' || cmd_opts.threads == 0) {
+				fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+				exit(1);
+			}
+			break;
 		case 'h':	       /* help */
 			usage(argv[0], 0);
 			exit(0);
@@ -1143,6 +1196,8 @@ int main(int argc, char **argv)
 	int pol_opt = 0;
 	if (!(cmd_opts.nallow || cmd_opts.all))
 		pol_opt |= QPOL_POLICY_OPTION_NO_NEVERALLOWS;
+	if (cmd_opts.cache)
+		pol_opt |= QPOL_POLICY_OPTION_CACHE_SYN_RULES;
 
 	if (argc - optind < 1) {
 		rt = qpol_default_policy_find(&policy_file);
@@ -1202,6 +1257,12 @@ int main(int argc, char **argv)
 		apol_policy_path_destroy(&pol_path);
 		exit(1);
 	}
+	if (cmd_opts.threads > 0 && apol_policy_set_query_threads(policy, cmd_opts.threads)) {
+		ERR(policy, "%s", strerror(errno));
+		apol_policy_path_destroy(&pol_path);
+		apol_policy_destroy(&policy);
+		exit(1);
+	}
 	/* handle regex for class name */
 	if (cmd_opts.useregex && cmd_opts.class_name != NULL) {
 		cmd_opts.class_vector = apol_vector_create(NULL);
@@ -1254,10 +1315,7 @@ int main(int argc, char **argv)
 		goto cleanup;
 	}
 	if (v) {
-		if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES))
-			print_syn_av_results(policy, &cmd_opts, v);
-		else
-			print_av_results(policy, &cmd_opts, v);
+		print_syn_av_results(policy, &cmd_opts, v);
 		fprintf(stdout, "\n");
 	}
 	apol_vector_destroy(&v);
@@ -1266,10 +1324,7 @@ int main(int argc, char **argv)
 		goto cleanup;
 	}
 	if (v) {
-		if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES))
-			print_syn_te_results(policy, &cmd_opts, v);
-		else
-			print_te_results(policy, &cmd_opts, v);
+		print_syn_te_results(policy, &cmd_opts, v);
 		fprintf(stdout, "\n");
 	}
 